@@ -0,0 +1,199 @@
+/* Benchmark aligned_alloc and free.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include "bench-timing.h"
+#include "json-lib.h"
+
+/* Benchmark the aligned_alloc/free performance of a varying number of
+   blocks of a given size, for the alignments commonly used for SIMD
+   data and I/O buffers.  Alignment 0 stands for plain malloc, which is
+   the baseline for the others.  Like bench-malloc-simple, each case
+   runs single-threaded using main arena, multi-threaded using a thread
+   arena, and in main arena with SINGLE_THREAD_P false.  The size of
+   the heap after each alignment shows how much the aligned blocks
+   fragment it.  */
+
+#define NUM_ITERS 200000
+#define NUM_ALLOCS 3
+#define NUM_ALIGNS 4
+#define MAX_ALLOCS 400
+
+typedef struct
+{
+  size_t iters;
+  size_t size;
+  size_t align;
+  int n;
+  timing_t elapsed;
+} malloc_args;
+
+static void
+do_benchmark (malloc_args *args, void **arr)
+{
+  timing_t start, stop;
+  size_t iters = args->iters;
+  size_t size = args->size;
+  size_t align = args->align;
+  int n = args->n;
+
+  TIMING_NOW (start);
+
+  for (int j = 0; j < iters; j++)
+    {
+      if (align == 0)
+	for (int i = 0; i < n; i++)
+	  arr[i] = malloc (size);
+      else
+	for (int i = 0; i < n; i++)
+	  arr[i] = aligned_alloc (align, size);
+
+      for (int i = 0; i < n; i++)
+	free (arr[i]);
+    }
+
+  TIMING_NOW (stop);
+
+  TIMING_DIFF (args->elapsed, start, stop);
+}
+
+static malloc_args tests[3][NUM_ALIGNS][NUM_ALLOCS];
+static int allocs[NUM_ALLOCS] = { 1, 25, MAX_ALLOCS };
+static size_t aligns[NUM_ALIGNS] = { 0, 64, 128, 4096 };
+static size_t heap_size[3][NUM_ALIGNS];
+
+static void
+run_tests (int t, void **arr)
+{
+  for (int a = 0; a < NUM_ALIGNS; a++)
+    {
+      for (int i = 0; i < NUM_ALLOCS; i++)
+	do_benchmark (&tests[t][a][i], arr);
+      heap_size[t][a] = mallinfo2 ().arena;
+    }
+}
+
+static void *
+thread_test (void *p)
+{
+  /* Run benchmark multi-threaded.  */
+  run_tests (2, p);
+
+  return p;
+}
+
+void
+bench (unsigned long size)
+{
+  size_t iters = NUM_ITERS;
+  void **arr = malloc (MAX_ALLOCS * sizeof (void*));
+
+  for (int t = 0; t < 3; t++)
+    for (int a = 0; a < NUM_ALIGNS; a++)
+      for (int i = 0; i < NUM_ALLOCS; i++)
+	{
+	  tests[t][a][i].n = allocs[i];
+	  tests[t][a][i].size = size;
+	  tests[t][a][i].align = aligns[a];
+	  tests[t][a][i].iters = iters / allocs[i];
+	}
+
+  /* Run benchmark single threaded in main_arena.  */
+  run_tests (0, arr);
+
+  /* Run benchmark in a thread_arena.  */
+  pthread_t t;
+  pthread_create (&t, NULL, thread_test, arr);
+  pthread_join (t, NULL);
+
+  /* Repeat benchmark in main_arena with SINGLE_THREAD_P == false.  */
+  run_tests (1, arr);
+
+  free (arr);
+
+  json_ctx_t json_ctx;
+
+  json_init (&json_ctx, 0, stdout);
+
+  json_document_begin (&json_ctx);
+
+  json_attr_string (&json_ctx, "timing_type", TIMING_TYPE);
+
+  json_attr_object_begin (&json_ctx, "functions");
+
+  json_attr_object_begin (&json_ctx, "aligned_alloc");
+
+  char s[100];
+  double iters2 = iters;
+  static const char *const names[3] =
+    { "main_arena_st", "main_arena_mt", "thread_arena_" };
+
+  json_attr_object_begin (&json_ctx, "");
+  json_attr_double (&json_ctx, "malloc_block_size", size);
+
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  json_attr_double (&json_ctx, "max_rss", usage.ru_maxrss);
+
+  for (int t = 0; t < 3; t++)
+    for (int a = 0; a < NUM_ALIGNS; a++)
+      {
+	for (int i = 0; i < NUM_ALLOCS; i++)
+	  {
+	    sprintf (s, "%s_align_%04zu_allocs_%04d_time", names[t],
+		     aligns[a], allocs[i]);
+	    json_attr_double (&json_ctx, s,
+			      tests[t][a][i].elapsed / iters2);
+	  }
+	sprintf (s, "%s_align_%04zu_heap_size", names[t], aligns[a]);
+	json_attr_double (&json_ctx, s, heap_size[t][a]);
+      }
+
+  json_attr_object_end (&json_ctx);
+
+  json_attr_object_end (&json_ctx);
+
+  json_attr_object_end (&json_ctx);
+
+  json_document_end (&json_ctx);
+}
+
+static void usage (const char *name)
+{
+  fprintf (stderr, "%s: <alloc_size>\n", name);
+  exit (1);
+}
+
+int
+main (int argc, char **argv)
+{
+  long val = 64;
+  if (argc == 2)
+    val = strtol (argv[1], NULL, 0);
+
+  if (argc > 2 || val <= 0)
+    usage (argv[0]);
+
+  bench (val);
+
+  return 0;
+}
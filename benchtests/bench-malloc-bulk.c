@@ -0,0 +1,27 @@
+/* Benchmark malloc_bulk and free_bulk functions.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* This is the same workload as bench-malloc-simple, but all the blocks
+   of an iteration are allocated with one malloc_bulk call and freed with
+   one free_bulk call, which take the arena lock once for the blocks
+   which do not fit into the tcache.  Compare the results with
+   bench-malloc-simple for the same block size.  */
+
+#define ALLOC_BLOCKS(arr, n, size) malloc_bulk (size, n, (void **) arr)
+#define FREE_BLOCKS(arr, n, size) free_bulk (n, (void **) arr)
+#include "bench-malloc-simple.c"
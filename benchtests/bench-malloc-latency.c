@@ -0,0 +1,203 @@
+/* Benchmark the latency of malloc in a fragmented heap.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The benchmark fills the heap with blocks of random sizes separated
+   by small blocks which are never freed, so that the free chunks are
+   not merged, and frees half of them.  It then repeatedly frees a
+   burst of random blocks and allocates blocks of random sizes in
+   their place, timing each malloc call.  The result is the
+   distribution of the malloc latencies, whose tail shows the cost of
+   sorting freed chunks into the bins and of searching the bins.
+   Compare the results with and without glibc.malloc.tlsf.  */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "bench-timing.h"
+#include "json-lib.h"
+
+#define RAND_SEED		88
+
+/* Number of blocks in the heap, half of which are free at any time.  */
+#define NUM_BLOCKS		20000
+
+/* Number of blocks freed and allocated again in each round.  */
+#define BURST			64
+
+/* Block sizes are chosen uniformly in this range.  The sizes are above
+   the tcache limit, so that all requests reach the arena.  */
+#define MIN_ALLOCATION_SIZE	2048
+#define MAX_ALLOCATION_SIZE	32768
+
+static void *blocks[NUM_BLOCKS];
+
+static size_t
+random_size (void)
+{
+  return MIN_ALLOCATION_SIZE
+    + rand () % (MAX_ALLOCATION_SIZE - MIN_ALLOCATION_SIZE + 1);
+}
+
+static int
+compare_timing (const void *a, const void *b)
+{
+  timing_t ta = *(const timing_t *) a;
+  timing_t tb = *(const timing_t *) b;
+  return ta < tb ? -1 : ta > tb;
+}
+
+static void
+usage (const char *name)
+{
+  fprintf (stderr, "%s: [<rounds>]\n", name);
+  exit (1);
+}
+
+int
+main (int argc, char **argv)
+{
+  size_t rounds = 2000;
+  json_ctx_t json_ctx;
+
+  if (argc == 2)
+    {
+      long ret;
+
+      errno = 0;
+      ret = strtol (argv[1], NULL, 10);
+
+      if (errno || ret <= 0)
+	usage (argv[0]);
+
+      rounds = ret;
+    }
+  else if (argc != 1)
+    usage (argv[0]);
+
+  srand (RAND_SEED);
+
+  /* Fragment the heap.  The small blocks between the others are
+     never freed.  */
+  for (size_t i = 0; i < NUM_BLOCKS; i++)
+    {
+      blocks[i] = malloc (random_size ());
+      if (malloc (16) == NULL || blocks[i] == NULL)
+	{
+	  perror ("malloc");
+	  exit (1);
+	}
+    }
+  for (size_t i = 0; i < NUM_BLOCKS; i += 2)
+    {
+      free (blocks[i]);
+      blocks[i] = NULL;
+    }
+
+  size_t iters = rounds * BURST;
+  timing_t *latency = malloc (iters * sizeof (timing_t));
+  size_t freed[BURST];
+  if (latency == NULL)
+    {
+      perror ("malloc");
+      exit (1);
+    }
+
+  timing_t total = 0;
+  for (size_t r = 0; r < rounds; r++)
+    {
+      /* Free a burst of allocated blocks.  */
+      for (size_t j = 0; j < BURST; j++)
+	{
+	  size_t i;
+	  do
+	    i = rand () % NUM_BLOCKS;
+	  while (blocks[i] == NULL);
+	  free (blocks[i]);
+	  blocks[i] = NULL;
+	  freed[j] = i;
+	}
+
+      /* Allocate blocks of new sizes in their place.  */
+      for (size_t j = 0; j < BURST; j++)
+	{
+	  size_t size = random_size ();
+	  timing_t start, stop, elapsed;
+	  TIMING_NOW (start);
+	  void *p = malloc (size);
+	  TIMING_NOW (stop);
+	  if (p == NULL)
+	    {
+	      perror ("malloc");
+	      exit (1);
+	    }
+	  /* Touch the block, as a program would.  */
+	  *(volatile char *) p = 0;
+	  blocks[freed[j]] = p;
+	  TIMING_DIFF (elapsed, start, stop);
+	  TIMING_ACCUM (total, elapsed);
+	  latency[r * BURST + j] = elapsed;
+	}
+    }
+
+  qsort (latency, iters, sizeof (timing_t), compare_timing);
+
+  struct mallinfo2 info = mallinfo2 ();
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+
+  json_init (&json_ctx, 0, stdout);
+
+  json_document_begin (&json_ctx);
+
+  json_attr_string (&json_ctx, "timing_type", TIMING_TYPE);
+
+  json_attr_object_begin (&json_ctx, "functions");
+
+  json_attr_object_begin (&json_ctx, "malloc");
+
+  json_attr_object_begin (&json_ctx, "latency");
+
+  json_attr_double (&json_ctx, "iterations", iters);
+  json_attr_double (&json_ctx, "mean", (double) total / iters);
+  json_attr_double (&json_ctx, "median", latency[iters / 2]);
+  json_attr_double (&json_ctx, "p99", latency[(iters - 1) * 99 / 100]);
+  json_attr_double (&json_ctx, "p99.9", latency[(iters - 1) * 999 / 1000]);
+  json_attr_double (&json_ctx, "max", latency[iters - 1]);
+  json_attr_double (&json_ctx, "free_chunks", info.ordblks);
+  json_attr_double (&json_ctx, "free_bytes", info.fordblks);
+  json_attr_double (&json_ctx, "max_rss", usage.ru_maxrss);
+
+  json_attr_double (&json_ctx, "blocks", NUM_BLOCKS);
+  json_attr_double (&json_ctx, "burst", BURST);
+  json_attr_double (&json_ctx, "min_size", MIN_ALLOCATION_SIZE);
+  json_attr_double (&json_ctx, "max_size", MAX_ALLOCATION_SIZE);
+  json_attr_double (&json_ctx, "random_seed", RAND_SEED);
+
+  json_attr_object_end (&json_ctx);
+
+  json_attr_object_end (&json_ctx);
+
+  json_attr_object_end (&json_ctx);
+
+  json_document_end (&json_ctx);
+
+  return 0;
+}
@@ -0,0 +1,279 @@
+/* Benchmark malloc and free with blocks freed by another thread.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* Each producer thread allocates blocks and passes them through a
+   single-producer single-consumer ring to its consumer thread, which
+   frees them.  This is the pattern of message-passing pipelines, where
+   most frees happen on a thread not attached to the arena of the
+   block.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "bench-timing.h"
+#include "json-lib.h"
+
+/* Benchmark duration in seconds.  */
+#define BENCHMARK_DURATION	10
+#define RAND_SEED		88
+
+/* Number of blocks in flight between a producer and its consumer.  */
+#define RING_SIZE		1024
+
+/* Block sizes are chosen uniformly in this range.  The lower bound is
+   above the default fastbin limit, so that frees go through the arena
+   bins.  */
+#define MIN_ALLOCATION_SIZE	256
+#define MAX_ALLOCATION_SIZE	4096
+
+#define NUM_BLOCK_SIZES		8000
+
+static unsigned int random_block_sizes[NUM_BLOCK_SIZES];
+
+static volatile bool timeout;
+
+static void
+alarm_handler (int signum)
+{
+  timeout = true;
+}
+
+struct ring
+{
+  void *slots[RING_SIZE];
+  /* Written by the producer.  */
+  size_t head __attribute__ ((aligned (64)));
+  /* Written by the consumer.  */
+  size_t tail __attribute__ ((aligned (64)));
+  /* Set by the producer when it stops.  */
+  bool done;
+};
+
+struct thread_args
+{
+  struct ring *ring;
+  size_t iters;
+  timing_t elapsed;
+};
+
+static void *
+producer_thread (void *arg)
+{
+  struct thread_args *args = arg;
+  struct ring *ring = args->ring;
+  unsigned int block_state = 0;
+  size_t head = 0;
+  size_t iters = 0;
+  timing_t start, stop;
+
+  TIMING_NOW (start);
+  while (!timeout)
+    {
+      while (head - __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE)
+	     == RING_SIZE)
+	{
+	  if (timeout)
+	    goto out;
+	  sched_yield ();
+	}
+
+      if (++block_state == NUM_BLOCK_SIZES)
+	block_state = 0;
+      void *p = malloc (random_block_sizes[block_state]);
+      /* Touch the block, as a producer filling in a message would.  */
+      *(volatile char *) p = 0;
+      ring->slots[head % RING_SIZE] = p;
+      __atomic_store_n (&ring->head, ++head, __ATOMIC_RELEASE);
+      iters++;
+    }
+ out:
+  TIMING_NOW (stop);
+  __atomic_store_n (&ring->done, true, __ATOMIC_RELEASE);
+
+  TIMING_DIFF (args->elapsed, start, stop);
+  args->iters = iters;
+  return NULL;
+}
+
+static void *
+consumer_thread (void *arg)
+{
+  struct thread_args *args = arg;
+  struct ring *ring = args->ring;
+  size_t tail = 0;
+  size_t iters = 0;
+  timing_t start, stop;
+
+  TIMING_NOW (start);
+  for (;;)
+    {
+      size_t head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+      if (head == tail)
+	{
+	  if (__atomic_load_n (&ring->done, __ATOMIC_ACQUIRE)
+	      && __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) == tail)
+	    break;
+	  sched_yield ();
+	  continue;
+	}
+
+      while (tail != head)
+	{
+	  free (ring->slots[tail % RING_SIZE]);
+	  tail++;
+	  iters++;
+	}
+      __atomic_store_n (&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+  TIMING_NOW (stop);
+
+  TIMING_DIFF (args->elapsed, start, stop);
+  args->iters = iters;
+  return NULL;
+}
+
+static timing_t
+do_benchmark (size_t num_pairs, size_t *iters)
+{
+  timing_t elapsed = 0;
+  struct ring *rings;
+  struct thread_args producers[num_pairs];
+  struct thread_args consumers[num_pairs];
+  pthread_t threads[2 * num_pairs];
+
+  rings = calloc (num_pairs, sizeof (struct ring));
+  if (rings == NULL)
+    {
+      perror ("calloc");
+      exit (1);
+    }
+
+  for (size_t i = 0; i < num_pairs; i++)
+    {
+      producers[i].ring = consumers[i].ring = &rings[i];
+      pthread_create (&threads[2 * i], NULL, producer_thread, &producers[i]);
+      pthread_create (&threads[2 * i + 1], NULL, consumer_thread,
+		      &consumers[i]);
+    }
+
+  *iters = 0;
+  for (size_t i = 0; i < num_pairs; i++)
+    {
+      pthread_join (threads[2 * i], NULL);
+      pthread_join (threads[2 * i + 1], NULL);
+      TIMING_ACCUM (elapsed, producers[i].elapsed);
+      TIMING_ACCUM (elapsed, consumers[i].elapsed);
+      *iters += producers[i].iters + consumers[i].iters;
+    }
+
+  free (rings);
+  return elapsed;
+}
+
+static void
+usage (const char *name)
+{
+  fprintf (stderr, "%s: <num_pairs>\n", name);
+  exit (1);
+}
+
+int
+main (int argc, char **argv)
+{
+  timing_t cur;
+  size_t iters = 0, num_pairs = 1;
+  json_ctx_t json_ctx;
+  double d_total_s, d_total_i;
+  struct sigaction act;
+
+  if (argc == 2)
+    {
+      long ret;
+
+      errno = 0;
+      ret = strtol (argv[1], NULL, 10);
+
+      if (errno || ret <= 0)
+	usage (argv[0]);
+
+      num_pairs = ret;
+    }
+  else if (argc != 1)
+    usage (argv[0]);
+
+  srand (RAND_SEED);
+  for (size_t i = 0; i < NUM_BLOCK_SIZES; i++)
+    random_block_sizes[i] = MIN_ALLOCATION_SIZE
+      + rand () % (MAX_ALLOCATION_SIZE - MIN_ALLOCATION_SIZE + 1);
+
+  json_init (&json_ctx, 0, stdout);
+
+  json_document_begin (&json_ctx);
+
+  json_attr_string (&json_ctx, "timing_type", TIMING_TYPE);
+
+  json_attr_object_begin (&json_ctx, "functions");
+
+  json_attr_object_begin (&json_ctx, "malloc");
+
+  json_attr_object_begin (&json_ctx, "producer-consumer");
+
+  memset (&act, 0, sizeof (act));
+  act.sa_handler = &alarm_handler;
+
+  sigaction (SIGALRM, &act, NULL);
+
+  alarm (BENCHMARK_DURATION);
+
+  cur = do_benchmark (num_pairs, &iters);
+
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+
+  d_total_s = cur;
+  d_total_i = iters;
+
+  json_attr_double (&json_ctx, "duration", d_total_s);
+  json_attr_double (&json_ctx, "iterations", d_total_i);
+  json_attr_double (&json_ctx, "time_per_iteration", d_total_s / d_total_i);
+  json_attr_double (&json_ctx, "max_rss", usage.ru_maxrss);
+  json_attr_double (&json_ctx, "voluntary_context_switches", usage.ru_nvcsw);
+
+  json_attr_double (&json_ctx, "pairs", num_pairs);
+  json_attr_double (&json_ctx, "min_size", MIN_ALLOCATION_SIZE);
+  json_attr_double (&json_ctx, "max_size", MAX_ALLOCATION_SIZE);
+  json_attr_double (&json_ctx, "random_seed", RAND_SEED);
+
+  json_attr_object_end (&json_ctx);
+
+  json_attr_object_end (&json_ctx);
+
+  json_attr_object_end (&json_ctx);
+
+  json_document_end (&json_ctx);
+
+  return 0;
+}
@@ -0,0 +1,521 @@
+/* Benchmark malloc by replaying an allocation trace.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bench-timing.h"
+#include "json-lib.h"
+#include "../malloc/malloc-trace.h"
+
+/* Replay a trace recorded by running a program with
+   LD_PRELOAD=libc_malloc_debug.so and MALLOC_BINARY_TRACE set to a
+   file name (see malloc/malloc-trace.h).  Each traced thread is
+   replayed by a thread of its own, which makes the calls of the traced
+   thread in their original order.  A thread which frees or reallocates
+   a block allocated by another thread first waits until that
+   allocation has been replayed, so the cross-thread frees of the trace
+   are preserved and the threads otherwise run as fast as they can.
+   Frees of blocks allocated before the trace started are dropped.
+
+   The benchmark reports the time per call, the peak RSS reached during
+   the replay, the peak number of bytes the traced program had
+   allocated, and the ratio of the two, which shows the fragmentation
+   and overhead of the allocator.  All memory of the benchmark itself
+   is allocated with mmap, so that the heap only holds the replayed
+   blocks.  */
+
+#define NO_SLOT UINT32_MAX
+
+/* A call to replay.  Blocks are identified by slots, which are
+   assigned in the order of the allocations of the trace.  */
+struct replay_op
+{
+  uint32_t type;		/* An enum malloc_trace_op value.  */
+  uint32_t slot;		/* Slot of the allocated block.  */
+  uint32_t old_slot;		/* Slot of the freed or reallocated block.  */
+  uint64_t size;
+  uint64_t align;
+};
+
+struct replay_thread
+{
+  struct replay_op *ops;
+  size_t nops;
+  pthread_t tid;
+};
+
+static struct replay_thread *threads;
+static size_t nthreads;
+static size_t ncalls;
+/* The replayed blocks, NULL until they are allocated.  */
+static void **slots;
+static uint64_t peak_live_bytes;
+
+static void *
+xmmap (size_t size)
+{
+  void *p = mmap (NULL, size > 0 ? size : 1, PROT_READ | PROT_WRITE,
+		  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    {
+      perror ("mmap");
+      exit (1);
+    }
+  return p;
+}
+
+/* Map from the addresses of the trace to the slots of the blocks live
+   at that point of the trace, with linear probing.  */
+struct map_entry
+{
+  uint64_t ptr;			/* 0 if the entry is empty.  */
+  uint32_t slot;
+};
+
+static struct map_entry *map;
+static size_t map_mask;
+
+static size_t
+map_hash (uint64_t ptr)
+{
+  return ((ptr >> 4) * 0x9e3779b97f4a7c15ULL) & map_mask;
+}
+
+static struct map_entry *
+map_find (uint64_t ptr)
+{
+  for (size_t i = map_hash (ptr); ; i = (i + 1) & map_mask)
+    if (map[i].ptr == ptr || map[i].ptr == 0)
+      return &map[i];
+}
+
+/* Remove the entry E found by map_find, moving the following entries
+   of its cluster back so that lookups still find them.  */
+static void
+map_remove (struct map_entry *e)
+{
+  size_t i = e - map;
+  size_t j = i;
+  while (true)
+    {
+      j = (j + 1) & map_mask;
+      if (map[j].ptr == 0)
+	break;
+      size_t k = map_hash (map[j].ptr);
+      /* Move the entry at J to I unless its home K lies cyclically
+	 in (I, J].  */
+      if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j))
+	{
+	  map[i] = map[j];
+	  i = j;
+	}
+    }
+  map[i].ptr = 0;
+}
+
+/* Return the slot of the block at PTR in the trace and forget it, or
+   NO_SLOT if the block was allocated before the trace started.  */
+static uint32_t
+map_take (uint64_t ptr)
+{
+  if (ptr == 0)
+    return NO_SLOT;
+  struct map_entry *e = map_find (ptr);
+  if (e->ptr == 0)
+    return NO_SLOT;
+  uint32_t slot = e->slot;
+  map_remove (e);
+  return slot;
+}
+
+/* Read the trace in FILE and convert it into the calls of each
+   thread.  */
+static void
+load_trace (const char *file)
+{
+  int fd = open (file, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat (fd, &st) != 0)
+    {
+      perror (file);
+      exit (1);
+    }
+  size_t length = st.st_size;
+  const struct malloc_trace_header *header = NULL;
+  if (length >= sizeof (*header))
+    header = mmap (NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (header == NULL || header == MAP_FAILED
+      || memcmp (header->magic, MALLOC_TRACE_MAGIC, sizeof (header->magic))
+      || header->version != MALLOC_TRACE_VERSION
+      || header->record_size != sizeof (struct malloc_trace_record))
+    {
+      fprintf (stderr, "%s: not a malloc trace\n", file);
+      exit (1);
+    }
+  const struct malloc_trace_record *records = (const void *) (header + 1);
+  size_t nrecords = (length - sizeof (*header)) / sizeof (*records);
+
+  /* Group the records by thread, keeping their order.  */
+  for (size_t i = 0; i < nrecords; ++i)
+    {
+      if (records[i].thread == 0)
+	{
+	  fprintf (stderr, "%s: invalid thread number\n", file);
+	  exit (1);
+	}
+      if (records[i].thread > nthreads)
+	nthreads = records[i].thread;
+    }
+  size_t *counts = xmmap ((nthreads + 1) * sizeof (*counts));
+  for (size_t i = 0; i < nrecords; ++i)
+    ++counts[records[i].thread - 1];
+  size_t *starts = xmmap ((nthreads + 1) * sizeof (*starts));
+  for (size_t t = 0; t < nthreads; ++t)
+    starts[t + 1] = starts[t] + counts[t];
+  size_t *order = xmmap (nrecords * sizeof (*order));
+  for (size_t i = 0; i < nrecords; ++i)
+    {
+      uint32_t t = records[i].thread - 1;
+      order[starts[t + 1] - counts[t]--] = i;
+    }
+
+  threads = xmmap (nthreads * sizeof (*threads));
+  struct replay_op *ops = xmmap (nrecords * sizeof (*ops));
+  for (size_t t = 0; t < nthreads; ++t)
+    threads[t].ops = ops + starts[t];
+
+  size_t map_size = 16;
+  while (map_size < 2 * nrecords)
+    map_size *= 2;
+  map = xmmap (map_size * sizeof (*map));
+  map_mask = map_size - 1;
+  uint64_t *slot_sizes = xmmap (nrecords * sizeof (*slot_sizes));
+  uint32_t nslots = 0;
+  uint64_t live_bytes = 0;
+  /* The slot of the block passed to the realloc call which each thread
+     has started, if any.  */
+  uint32_t *realloc_slots = xmmap (nthreads * sizeof (*realloc_slots));
+  for (size_t t = 0; t < nthreads; ++t)
+    realloc_slots[t] = NO_SLOT;
+
+  /* Merge the records of the threads by time with a heap of the next
+     record of each thread, and convert them in that order.  NEXT[T]
+     is the position of the next record of thread T in ORDER.  */
+  size_t *next = counts;
+  size_t *heap = xmmap (nthreads * sizeof (*heap));
+  size_t heap_size = 0;
+#define HEAP_TIME(h) (records[order[next[heap[h]]]].time)
+  for (size_t t = 0; t < nthreads; ++t)
+    {
+      next[t] = starts[t];
+      if (next[t] == starts[t + 1])
+	continue;
+      size_t h = heap_size++;
+      heap[h] = t;
+      while (h > 0 && HEAP_TIME ((h - 1) / 2) > HEAP_TIME (h))
+	{
+	  size_t parent = (h - 1) / 2;
+	  size_t tmp = heap[h];
+	  heap[h] = heap[parent];
+	  heap[parent] = tmp;
+	  h = parent;
+	}
+    }
+
+  while (heap_size > 0)
+    {
+      size_t t = heap[0];
+      const struct malloc_trace_record *r = &records[order[next[t]++]];
+      if (next[t] == starts[t + 1])
+	heap[0] = heap[--heap_size];
+      for (size_t h = 0; ; )
+	{
+	  size_t min = h, l = 2 * h + 1;
+	  if (l < heap_size && HEAP_TIME (l) < HEAP_TIME (min))
+	    min = l;
+	  if (l + 1 < heap_size && HEAP_TIME (l + 1) < HEAP_TIME (min))
+	    min = l + 1;
+	  if (min == h)
+	    break;
+	  size_t tmp = heap[h];
+	  heap[h] = heap[min];
+	  heap[min] = tmp;
+	  h = min;
+	}
+
+      struct replay_op op =
+	{
+	  .type = r->op,
+	  .slot = NO_SLOT,
+	  .old_slot = NO_SLOT,
+	  .size = r->size,
+	};
+      switch (r->op)
+	{
+	case MALLOC_TRACE_FREE:
+	  op.old_slot = map_take (r->ptr);
+	  if (op.old_slot == NO_SLOT)
+	    continue;
+	  break;
+	case MALLOC_TRACE_REALLOC_START:
+	  /* Forget the address now, since another thread may allocate
+	     it once realloc has freed the block.  */
+	  realloc_slots[t] = map_take (r->ptr);
+	  continue;
+	case MALLOC_TRACE_REALLOC:
+	  op.old_slot = realloc_slots[t];
+	  realloc_slots[t] = NO_SLOT;
+	  if (r->ptr == 0 && r->size != 0)
+	    {
+	      /* A failed realloc, which leaves the old block alone.  */
+	      if (op.old_slot != NO_SLOT)
+		{
+		  struct map_entry *e = map_find (r->arg);
+		  e->ptr = r->arg;
+		  e->slot = op.old_slot;
+		}
+	      continue;
+	    }
+	  if (r->ptr == 0)
+	    {
+	      /* realloc (P, 0) frees P.  */
+	      if (op.old_slot == NO_SLOT)
+		continue;
+	      op.type = MALLOC_TRACE_FREE;
+	    }
+	  else if (op.old_slot == NO_SLOT)
+	    op.type = MALLOC_TRACE_MALLOC;
+	  break;
+	case MALLOC_TRACE_MEMALIGN:
+	  op.align = r->arg;
+	  /* Fall through.  */
+	case MALLOC_TRACE_MALLOC:
+	case MALLOC_TRACE_CALLOC:
+	  if (r->ptr == 0)
+	    continue;
+	  break;
+	default:
+	  fprintf (stderr, "%s: invalid record type %u\n", file,
+		   (unsigned int) r->op);
+	  exit (1);
+	}
+
+      if (op.old_slot != NO_SLOT)
+	live_bytes -= slot_sizes[op.old_slot];
+      if (op.type != MALLOC_TRACE_FREE)
+	{
+	  op.slot = nslots++;
+	  slot_sizes[op.slot] = op.size;
+	  live_bytes += op.size;
+	  if (live_bytes > peak_live_bytes)
+	    peak_live_bytes = live_bytes;
+	  /* A block which was not freed in the trace, perhaps because
+	     the free happened in a thread which was still running at
+	     exit, is leaked.  */
+	  struct map_entry *e = map_find (r->ptr);
+	  e->ptr = r->ptr;
+	  e->slot = op.slot;
+	}
+      threads[t].ops[threads[t].nops++] = op;
+      ++ncalls;
+    }
+#undef HEAP_TIME
+
+  slots = xmmap (nslots * sizeof (*slots));
+
+  munmap (realloc_slots, nthreads * sizeof (*realloc_slots));
+  munmap (heap, nthreads * sizeof (*heap));
+  munmap (slot_sizes, nrecords * sizeof (*slot_sizes));
+  munmap (map, map_size * sizeof (*map));
+  munmap (order, nrecords * sizeof (*order));
+  munmap (starts, (nthreads + 1) * sizeof (*starts));
+  munmap (counts, (nthreads + 1) * sizeof (*counts));
+  munmap ((void *) header, length);
+}
+
+/* Return the block in SLOT, waiting until another thread has
+   allocated it.  */
+static void *
+wait_slot (uint32_t slot)
+{
+  void *p;
+  while ((p = __atomic_load_n (&slots[slot], __ATOMIC_ACQUIRE)) == NULL)
+    sched_yield ();
+  return p;
+}
+
+static void *
+replay_thread (void *closure)
+{
+  struct replay_thread *thread = closure;
+  for (size_t i = 0; i < thread->nops; ++i)
+    {
+      struct replay_op *op = &thread->ops[i];
+      char *p;
+      switch (op->type)
+	{
+	case MALLOC_TRACE_FREE:
+	  free (wait_slot (op->old_slot));
+	  continue;
+	case MALLOC_TRACE_MALLOC:
+	  p = malloc (op->size);
+	  break;
+	case MALLOC_TRACE_CALLOC:
+	  p = calloc (1, op->size);
+	  break;
+	case MALLOC_TRACE_MEMALIGN:
+	  p = memalign (op->align, op->size);
+	  break;
+	case MALLOC_TRACE_REALLOC:
+	  p = realloc (wait_slot (op->old_slot), op->size);
+	  break;
+	default:
+	  abort ();
+	}
+      if (p == NULL)
+	{
+	  fprintf (stderr, "allocation of %llu bytes failed\n",
+		   (unsigned long long int) op->size);
+	  exit (1);
+	}
+      /* Use the pages of the block, as the traced program did.  */
+      for (size_t j = 0; j < op->size; j += 4096)
+	p[j] = 1;
+      __atomic_store_n (&slots[op->slot], p, __ATOMIC_RELEASE);
+    }
+  return NULL;
+}
+
+/* Return the resident set size in kilobytes.  */
+static long
+current_rss (void)
+{
+  long pages = 0;
+  FILE *f = fopen ("/proc/self/statm", "r");
+  if (f != NULL)
+    {
+      if (fscanf (f, "%*s %ld", &pages) != 1)
+	pages = 0;
+      fclose (f);
+    }
+  return pages * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+/* Reset the peak RSS reported by getrusage to the current RSS, so
+   that it does not include the trace which was just unmapped.  Return
+   false if this is not supported.  */
+static bool
+reset_peak_rss (void)
+{
+  int fd = open ("/proc/self/clear_refs", O_WRONLY);
+  if (fd < 0)
+    return false;
+  bool ok = write (fd, "5", 1) == 1;
+  close (fd);
+  return ok;
+}
+
+static void
+usage (const char *name)
+{
+  fprintf (stderr, "%s: <trace file>\n", name);
+  exit (1);
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc != 2)
+    usage (argv[0]);
+
+  load_trace (argv[1]);
+
+  /* The FILE of current_rss is allocated with malloc, which is done
+     once before the replay so that its memory is reused after.  */
+  bool peak_valid = reset_peak_rss ();
+  long base_rss = current_rss ();
+
+  timing_t start, stop, elapsed;
+  TIMING_NOW (start);
+  for (size_t t = 0; t < nthreads; ++t)
+    if (pthread_create (&threads[t].tid, NULL, replay_thread, &threads[t])
+	!= 0)
+      {
+	perror ("pthread_create");
+	exit (1);
+      }
+  for (size_t t = 0; t < nthreads; ++t)
+    pthread_join (threads[t].tid, NULL);
+  TIMING_NOW (stop);
+  TIMING_DIFF (elapsed, start, stop);
+
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  long max_rss = usage.ru_maxrss - base_rss;
+  struct mallinfo2 info = mallinfo2 ();
+
+  json_ctx_t json_ctx;
+
+  json_init (&json_ctx, 0, stdout);
+
+  json_document_begin (&json_ctx);
+
+  json_attr_string (&json_ctx, "timing_type", TIMING_TYPE);
+
+  json_attr_object_begin (&json_ctx, "functions");
+
+  json_attr_object_begin (&json_ctx, "malloc_replay");
+
+  json_attr_object_begin (&json_ctx, "");
+  json_attr_string (&json_ctx, "trace", argv[1]);
+  json_attr_double (&json_ctx, "threads", nthreads);
+  json_attr_double (&json_ctx, "calls", ncalls);
+  json_attr_double (&json_ctx, "time_per_call",
+		    ncalls > 0 ? (double) elapsed / ncalls : 0);
+  if (peak_valid)
+    json_attr_double (&json_ctx, "max_rss", max_rss);
+  json_attr_double (&json_ctx, "peak_live_bytes", peak_live_bytes);
+  if (peak_valid && peak_live_bytes > 0)
+    json_attr_double (&json_ctx, "rss_per_live_byte",
+		      max_rss * 1024.0 / peak_live_bytes);
+  json_attr_double (&json_ctx, "final_system_bytes",
+		    info.arena + info.hblkhd);
+  json_attr_double (&json_ctx, "final_in_use_bytes",
+		    info.uordblks + info.hblkhd);
+  json_attr_object_end (&json_ctx);
+
+  json_attr_object_end (&json_ctx);
+
+  json_attr_object_end (&json_ctx);
+
+  json_document_end (&json_ctx);
+
+  return 0;
+}
@@ -0,0 +1,25 @@
+/* Benchmark malloc and free_sized functions.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* This is the same workload as bench-malloc-simple, but blocks are
+   freed with free_sized, which does not need to read the chunk header
+   to find the tcache bin.  Compare the results with bench-malloc-simple
+   for the same block size.  */
+
+#define FREE(p, size) free_sized (p, size)
+#include "bench-malloc-simple.c"
@@ -34,6 +34,24 @@
 #define NUM_ALLOCS 4
 #define MAX_ALLOCS 1600
 
+/* The function used to free a block P of SIZE bytes.  */
+#ifndef FREE
+# define FREE(p, size) free (p)
+#endif
+
+/* The functions used to allocate and free the N blocks of SIZE bytes
+   in ARR.  */
+#ifndef ALLOC_BLOCKS
+# define ALLOC_BLOCKS(arr, n, size)		\
+  for (int i = 0; i < n; i++)			\
+    arr[i] = malloc (size)
+#endif
+#ifndef FREE_BLOCKS
+# define FREE_BLOCKS(arr, n, size)		\
+  for (int i = 0; i < n; i++)			\
+    FREE (arr[i], size)
+#endif
+
 typedef struct
 {
   size_t iters;
@@ -54,11 +72,9 @@ do_benchmark (malloc_args *args, int **arr)
 
   for (int j = 0; j < iters; j++)
     {
-      for (int i = 0; i < n; i++)
-	arr[i] = malloc (size);
+      ALLOC_BLOCKS (arr, n, size);
 
-      for (int i = 0; i < n; i++)
-	free (arr[i]);
+      FREE_BLOCKS (arr, n, size);
     }
 
   TIMING_NOW (stop);
@@ -0,0 +1,25 @@
+/* Benchmark malloc and free functions with per-CPU arenas.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* This is the same workload as bench-malloc-thread.  The bench-malloc
+   target runs it with GLIBC_TUNABLES=glibc.malloc.percpu=1 and with
+   four times as many threads as there are CPUs online, so that the
+   results can be compared with bench-malloc-thread at the same thread
+   counts.  */
+
+#include "bench-malloc-thread.c"
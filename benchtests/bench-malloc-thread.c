@@ -49,6 +49,10 @@
 #define MIN_ALLOCATION_SIZE	4
 #define MAX_ALLOCATION_SIZE	32768
 
+/* Number of blocks of the same size allocated in a row, and then freed
+   in a row, in bursty mode.  */
+#define BURST_SIZE		256
+
 /* Get a random block size with an inverse square distribution.  */
 static unsigned int
 get_block_size (unsigned int rand_data)
@@ -117,6 +121,10 @@ get_random_offset (unsigned int *state)
 
 static volatile bool timeout;
 
+/* Whether to allocate and free in bursts instead of in a random
+   order.  */
+static bool bursty;
+
 static void
 alarm_handler (int signum)
 {
@@ -145,6 +153,30 @@ malloc_benchmark_loop (void **ptr_arr)
   return iters;
 }
 
+/* Allocate BURST_SIZE blocks of the same size and then free them all,
+   as a server handling a batch of requests does.  */
+static size_t
+malloc_benchmark_loop_bursty (void **ptr_arr)
+{
+  unsigned int block_state = 0;
+  size_t iters = 0;
+
+  while (!timeout)
+    {
+      unsigned int next_block = get_random_block_size (&block_state);
+
+      for (size_t i = 0; i < BURST_SIZE; i++)
+	ptr_arr[i] = malloc (next_block);
+
+      for (size_t i = 0; i < BURST_SIZE; i++)
+	free (ptr_arr[i]);
+
+      iters += 2 * BURST_SIZE;
+    }
+
+  return iters;
+}
+
 struct thread_args
 {
   size_t iters;
@@ -161,7 +193,10 @@ benchmark_thread (void *arg)
   timing_t start, stop;
 
   TIMING_NOW (start);
-  iters = malloc_benchmark_loop (thread_set);
+  if (bursty)
+    iters = malloc_benchmark_loop_bursty (thread_set);
+  else
+    iters = malloc_benchmark_loop (thread_set);
   TIMING_NOW (stop);
 
   TIMING_DIFF (args->elapsed, start, stop);
@@ -183,7 +218,10 @@ do_benchmark (size_t num_threads, size_t *iters)
       memset (working_set, 0, sizeof (working_set));
 
       TIMING_NOW (start);
-      *iters = malloc_benchmark_loop (working_set);
+      if (bursty)
+	*iters = malloc_benchmark_loop_bursty (working_set);
+      else
+	*iters = malloc_benchmark_loop (working_set);
       TIMING_NOW (stop);
 
       TIMING_DIFF (elapsed, start, stop);
@@ -216,7 +254,7 @@ do_benchmark (size_t num_threads, size_t *iters)
 
 static void usage(const char *name)
 {
-  fprintf (stderr, "%s: <num_threads>\n", name);
+  fprintf (stderr, "%s: <num_threads> [bursty]\n", name);
   exit (1);
 }
 
@@ -231,7 +269,7 @@ main (int argc, char **argv)
 
   if (argc == 1)
     num_threads = 1;
-  else if (argc == 2)
+  else if (argc == 2 || argc == 3)
     {
       long ret;
 
@@ -242,6 +280,13 @@ main (int argc, char **argv)
 	usage(argv[0]);
 
       num_threads = ret;
+
+      if (argc == 3)
+	{
+	  if (strcmp (argv[2], "bursty") != 0)
+	    usage(argv[0]);
+	  bursty = true;
+	}
     }
   else
     usage(argv[0]);
@@ -258,7 +303,7 @@ main (int argc, char **argv)
 
   json_attr_object_begin (&json_ctx, "malloc");
 
-  json_attr_object_begin (&json_ctx, "");
+  json_attr_object_begin (&json_ctx, bursty ? "bursty" : "");
 
   memset (&act, 0, sizeof (act));
   act.sa_handler = &alarm_handler;
@@ -279,6 +324,9 @@ main (int argc, char **argv)
   json_attr_double (&json_ctx, "iterations", d_total_i);
   json_attr_double (&json_ctx, "time_per_iteration", d_total_s / d_total_i);
   json_attr_double (&json_ctx, "max_rss", usage.ru_maxrss);
+  /* Threads blocking on contended arena locks show up as voluntary
+     context switches.  */
+  json_attr_double (&json_ctx, "voluntary_context_switches", usage.ru_nvcsw);
 
   json_attr_double (&json_ctx, "threads", num_threads);
   json_attr_double (&json_ctx, "min_size", MIN_ALLOCATION_SIZE);
@@ -18,6 +18,7 @@
 
 #define TEST_MAIN
 #define TEST_NAME "pthread-locks"
+#define TIMEOUT (20 * 60)
 
 #include <stdio.h>
 #include <string.h>
@@ -103,6 +104,70 @@ test_mutex (long iters, int filler)
   return cur;
 }
 
+/* The mutex type or rwlock kind and the number of threads of the
+   contended tests.  */
+static int contended_type;
+static int contended_threads;
+static pthread_barrier_t contended_barrier;
+
+typedef struct Contended_Params {
+  long iters;
+  int filler;
+} Contended_Params;
+
+static void *
+test_mutex_contended_thread (void *v)
+{
+  Contended_Params *p = (Contended_Params *) v;
+  long iters = p->iters;
+  int filler = p->filler;
+
+  pthread_barrier_wait (&contended_barrier);
+  for (long j = iters; j >= 0; --j)
+    {
+      pthread_mutex_lock (&m);
+      FILLER_GOES_HERE;
+      pthread_mutex_unlock (&m);
+    }
+
+  return NULL;
+}
+
+/* All threads lock and unlock the same mutex.  The iterations are
+   divided among the threads, so the result is the time per lock
+   and unlock pair of the whole process.  */
+static timing_t
+test_mutex_contended (long iters, int filler)
+{
+  timing_t start, stop, cur;
+  pthread_mutexattr_t attr;
+  pthread_t threads[contended_threads];
+  Contended_Params p;
+
+  p.iters = iters / contended_threads;
+  p.filler = filler;
+
+  pthread_mutexattr_init (&attr);
+  pthread_mutexattr_settype (&attr, contended_type);
+  pthread_mutex_init (&m, &attr);
+  pthread_mutexattr_destroy (&attr);
+  pthread_barrier_init (&contended_barrier, NULL, contended_threads + 1);
+
+  for (int i = 0; i < contended_threads; i++)
+    pthread_create (&threads[i], NULL, test_mutex_contended_thread, &p);
+
+  pthread_barrier_wait (&contended_barrier);
+  TIMING_NOW (start);
+  for (int i = 0; i < contended_threads; i++)
+    pthread_join (threads[i], NULL);
+  TIMING_NOW (stop);
+  TIMING_DIFF (cur, start, stop);
+
+  pthread_barrier_destroy (&contended_barrier);
+  pthread_mutex_destroy (&m);
+  return cur;
+}
+
 static timing_t
 test_mutex_trylock (long iters, int filler)
 {
@@ -332,6 +397,190 @@ test_condvar (long iters, int filler)
 /* How many items are "queued" in our pretend queue.  */
 static int queued = 0;
 
+static void *
+test_rwlock_read_contended_thread (void *v)
+{
+  Contended_Params *p = (Contended_Params *) v;
+  long iters = p->iters;
+  int filler = p->filler;
+
+  pthread_barrier_wait (&contended_barrier);
+  for (long j = iters; j >= 0; --j)
+    {
+      pthread_rwlock_rdlock (&rw);
+      FILLER_GOES_HERE;
+      pthread_rwlock_unlock (&rw);
+    }
+
+  return NULL;
+}
+
+/* All threads read-lock and unlock the same rwlock of kind
+   contended_type, like test_mutex_contended.  */
+static timing_t
+test_rwlock_read_contended (long iters, int filler)
+{
+  timing_t start, stop, cur;
+  pthread_rwlockattr_t attr;
+  pthread_t threads[contended_threads];
+  Contended_Params p;
+
+  p.iters = iters / contended_threads;
+  p.filler = filler;
+
+  pthread_rwlockattr_init (&attr);
+  pthread_rwlockattr_setkind_np (&attr, contended_type);
+  pthread_rwlock_init (&rw, &attr);
+  pthread_rwlockattr_destroy (&attr);
+  pthread_barrier_init (&contended_barrier, NULL, contended_threads + 1);
+
+  for (int i = 0; i < contended_threads; i++)
+    pthread_create (&threads[i], NULL, test_rwlock_read_contended_thread, &p);
+
+  pthread_barrier_wait (&contended_barrier);
+  TIMING_NOW (start);
+  for (int i = 0; i < contended_threads; i++)
+    pthread_join (threads[i], NULL);
+  TIMING_NOW (stop);
+  TIMING_DIFF (cur, start, stop);
+
+  pthread_barrier_destroy (&contended_barrier);
+  pthread_rwlock_destroy (&rw);
+  return cur;
+}
+
+/* Broadcast round and number of waiters that have seen it, protected
+   by m.  */
+static long broadcast_round;
+static int broadcast_seen;
+
+static void *
+test_condvar_broadcast_thread (void *v)
+{
+  Contended_Params *p = (Contended_Params *) v;
+  long seen = 0;
+  int filler = p->filler;
+
+  pthread_mutex_lock (&m);
+  while (1)
+    {
+      while (broadcast_round == seen)
+	pthread_cond_wait (&cv, &m);
+      seen = broadcast_round;
+      if (seen < 0)
+	break;
+      FILLER_GOES_HERE;
+      if (++broadcast_seen == contended_threads)
+	pthread_cond_signal (&producer_c);
+    }
+  pthread_mutex_unlock (&m);
+
+  return NULL;
+}
+
+/* Wake contended_threads waiters with a broadcast while holding the
+   mutex, and wait until each of them has reacquired it.  The result is
+   the time per broadcast.  */
+static timing_t
+test_condvar_broadcast (long iters, int filler)
+{
+  timing_t start, stop, cur;
+  pthread_t threads[contended_threads];
+  Contended_Params p;
+
+  p.iters = iters;
+  p.filler = filler;
+
+  pthread_mutex_init (&m, NULL);
+  pthread_cond_init (&cv, NULL);
+  pthread_cond_init (&producer_c, NULL);
+  broadcast_round = 0;
+  broadcast_seen = 0;
+
+  for (int i = 0; i < contended_threads; i++)
+    pthread_create (&threads[i], NULL, test_condvar_broadcast_thread, &p);
+
+  pthread_mutex_lock (&m);
+  TIMING_NOW (start);
+  for (long j = iters; j >= 0; --j)
+    {
+      broadcast_seen = 0;
+      ++broadcast_round;
+      pthread_cond_broadcast (&cv);
+      while (broadcast_seen < contended_threads)
+	pthread_cond_wait (&producer_c, &m);
+    }
+  TIMING_NOW (stop);
+  TIMING_DIFF (cur, start, stop);
+
+  broadcast_round = -1;
+  pthread_cond_broadcast (&cv);
+  pthread_mutex_unlock (&m);
+  for (int i = 0; i < contended_threads; i++)
+    pthread_join (threads[i], NULL);
+
+  pthread_cond_destroy (&producer_c);
+  pthread_cond_destroy (&cv);
+  return cur;
+}
+
+static pthread_barrier_t bar;
+
+static void *
+test_barrier_contended_thread (void *v)
+{
+  Contended_Params *p = (Contended_Params *) v;
+  long iters = p->iters;
+  int filler = p->filler;
+
+  for (long j = iters; j >= 0; --j)
+    {
+      FILLER_GOES_HERE;
+      pthread_barrier_wait (&bar);
+    }
+
+  return NULL;
+}
+
+/* The main thread and contended_threads other threads wait on a barrier
+   of kind contended_type.  The result is the time per round.  */
+static timing_t
+test_barrier_contended (long iters, int filler)
+{
+  timing_t start, stop, cur;
+  pthread_barrierattr_t attr;
+  pthread_t threads[contended_threads];
+  Contended_Params p;
+
+  p.iters = iters;
+  p.filler = filler;
+
+  pthread_barrierattr_init (&attr);
+  pthread_barrierattr_setkind_np (&attr, contended_type);
+  pthread_barrier_init (&bar, &attr, contended_threads + 1);
+  pthread_barrierattr_destroy (&attr);
+
+  for (int i = 0; i < contended_threads; i++)
+    pthread_create (&threads[i], NULL, test_barrier_contended_thread, &p);
+
+  /* Wait until all threads have started.  */
+  pthread_barrier_wait (&bar);
+  TIMING_NOW (start);
+  for (long j = iters; j > 0; --j)
+    {
+      FILLER_GOES_HERE;
+      pthread_barrier_wait (&bar);
+    }
+  TIMING_NOW (stop);
+  TIMING_DIFF (cur, start, stop);
+
+  for (int i = 0; i < contended_threads; i++)
+    pthread_join (threads[i], NULL);
+
+  pthread_barrier_destroy (&bar);
+  return cur;
+}
+
 typedef struct Producer_Params {
   long iters;
   int filler;
@@ -542,6 +791,89 @@ do_bench (void)
   BENCH (condvar);
   BENCH (consumer_producer);
 
+  /* Contended adaptive mutexes, spinning on the lock word or in a
+     queue.  The thread counts go beyond the number of CPUs of most
+     machines on purpose.  */
+  static const struct
+  {
+    const char *name;
+    int type;
+  } contended_types[] =
+    {
+      { "adaptive", PTHREAD_MUTEX_ADAPTIVE_NP },
+      { "queued", PTHREAD_MUTEX_QUEUED_NP },
+    };
+  static const int contended_thread_counts[] = { 2, 4, 8, 16, 32, 64, 128 };
+  for (int i = 0; i < sizeof (contended_types) / sizeof (contended_types[0]);
+       i++)
+    for (int j = 0;
+	 j < sizeof (contended_thread_counts) / sizeof (int); j++)
+      {
+	char name[64];
+	contended_type = contended_types[i].type;
+	contended_threads = contended_thread_counts[j];
+	snprintf (name, sizeof name, "mutex_%s_threads_%d",
+		  contended_types[i].name, contended_threads);
+	rv += do_bench_1 (name, test_mutex_contended, &json_ctx);
+      }
+
+  /* Concurrent readers, which share the reader count of default
+     rwlocks, but not of reader-biased ones.  */
+  static const struct
+  {
+    const char *name;
+    int kind;
+  } rwlock_kinds[] =
+    {
+      { "default", PTHREAD_RWLOCK_DEFAULT_NP },
+      { "biased", PTHREAD_RWLOCK_READER_BIASED_NP },
+    };
+  for (int i = 0; i < sizeof (rwlock_kinds) / sizeof (rwlock_kinds[0]); i++)
+    for (int j = 0;
+	 j < sizeof (contended_thread_counts) / sizeof (int); j++)
+      {
+	char name[64];
+	contended_type = rwlock_kinds[i].kind;
+	contended_threads = contended_thread_counts[j];
+	snprintf (name, sizeof name, "rwlock_read_%s_threads_%d",
+		  rwlock_kinds[i].name, contended_threads);
+	rv += do_bench_1 (name, test_rwlock_read_contended, &json_ctx);
+      }
+
+  /* Broadcasts to waiters which all reacquire the mutex.  */
+  for (int j = 0; j < sizeof (contended_thread_counts) / sizeof (int); j++)
+    {
+      char name[64];
+      contended_threads = contended_thread_counts[j];
+      snprintf (name, sizeof name, "condvar_broadcast_threads_%d",
+		contended_threads);
+      rv += do_bench_1 (name, test_condvar_broadcast, &json_ctx);
+    }
+
+  /* Barriers, on which all threads increment the same counter or which
+     spread the threads over a combining tree.  */
+  static const struct
+  {
+    const char *name;
+    int kind;
+  } barrier_kinds[] =
+    {
+      { "default", PTHREAD_BARRIER_DEFAULT_NP },
+      { "tree", PTHREAD_BARRIER_TREE_NP },
+    };
+  for (int i = 0; i < sizeof (barrier_kinds) / sizeof (barrier_kinds[0]);
+       i++)
+    for (int j = 0;
+	 j < sizeof (contended_thread_counts) / sizeof (int); j++)
+      {
+	char name[64];
+	contended_type = barrier_kinds[i].kind;
+	contended_threads = contended_thread_counts[j];
+	snprintf (name, sizeof name, "barrier_%s_threads_%d",
+		  barrier_kinds[i].name, contended_threads);
+	rv += do_bench_1 (name, test_barrier_contended, &json_ctx);
+      }
+
   json_attr_object_end (&json_ctx);
 
   return rv;
@@ -0,0 +1,26 @@
+#include <nptl/sys/waitaddr.h>
+
+#ifndef _ISOMAC
+
+# include <struct___timespec64.h>
+
+# if __TIMESIZE == 64
+#  define __wait_on_address64 __wait_on_address
+#  define __wait_on_any_address64 __wait_on_any_address
+libc_hidden_proto (__wait_on_address)
+libc_hidden_proto (__wait_on_any_address)
+# else
+extern int __wait_on_address64 (const unsigned int *addr,
+				unsigned int expected, int flags,
+				clockid_t clockid,
+				const struct __timespec64 *abstime);
+libc_hidden_proto (__wait_on_address64)
+extern int __wait_on_any_address64 (const struct wait_address *addrs,
+				    unsigned int count, int flags,
+				    clockid_t clockid,
+				    const struct __timespec64 *abstime,
+				    unsigned int *index);
+libc_hidden_proto (__wait_on_any_address64)
+# endif
+
+#endif
@@ -92,6 +92,21 @@ extern int sanity_check_heap_info_alignment[(sizeof (heap_info)
                                              + 2 * SIZE_SZ) % MALLOC_ALIGNMENT
                                             ? -1 : 1];
 
+/* Return the unit in which heap H grows and shrinks.  With transparent
+   huge pages, this is the huge page size, so that the heap consists of
+   whole huge pages and trimming it does not split them.  Heaps are
+   aligned to heap_max_size, so the units are naturally aligned.  */
+
+static inline size_t
+heap_grow_unit (heap_info *h)
+{
+#if HAVE_TUNABLES
+  if (mp_.thp_pagesize > h->pagesize && mp_.thp_pagesize < heap_max_size ())
+    return mp_.thp_pagesize;
+#endif
+  return h->pagesize;
+}
+
 /* Thread specific data.  */
 
 static __thread mstate thread_arena attribute_tls_model_ie;
@@ -121,12 +136,56 @@ static mstate free_list;
    acquired.  */
 __libc_lock_define_initialized (static, list_lock);
 
+#if IS_IN (libc)
+/* Per-CPU arenas, used if the glibc.malloc.percpu tunable is set.
+   percpu_arenas[N] is the arena which serves allocations from threads
+   running on CPU N, or NULL if no thread has allocated on that CPU
+   yet.  A slot is filled at most once, under percpu_lock, and never
+   changes afterwards, so lookups only need an acquire load.  */
+static mstate *percpu_arenas;
+static size_t percpu_narenas;
+__libc_lock_define_initialized (static, percpu_lock);
+
+/* The NUMA node of each CPU plus one, or 0 if not known yet, used if
+   the glibc.malloc.numa tunable is set and glibc.malloc.numa_nodes is
+   not.  Entries are filled lazily by numa_current_node.  */
+static int *numa_cpu_nodes;
+static size_t numa_ncpus;
+
+/* The NUMA node the calling thread ran on when it last selected an
+   arena, or -1 if it is not known or the glibc.malloc.numa tunable is
+   not set.  */
+static __thread int thread_numa_node attribute_tls_model_ie = -1;
+
+/* Arenas created by malloc_arena_create, linked through their next
+   member.  They are kept off the main_arena.next list, so that
+   reused_arena never hands them out and malloc_arena_destroy can
+   unlink them.  Access is serialized by list_lock.  */
+static mstate user_arenas;
+
+/* The user arena which serves malloc in the calling thread, set by
+   malloc_arena_set_thread_default, or NULL.  */
+static __thread mstate thread_user_arena attribute_tls_model_ie;
+#endif
+
 /* Already initialized? */
 static bool __malloc_initialized = false;
 
 /**************************************************************************/
 
 
+/* Lock the mutex of arena AV, and count the acquisitions which have to
+   wait for another thread for malloc_stats_snapshot.  */
+static __always_inline void
+arena_mutex_lock (mstate av)
+{
+  if (__glibc_unlikely (__libc_lock_trylock (av->mutex) != 0))
+    {
+      atomic_fetch_add_relaxed (&av->stats.contentions, 1);
+      __libc_lock_lock (av->mutex);
+    }
+}
+
 /* arena_get() acquires an arena and locks the corresponding mutex.
    First, try the one last locked successfully by this thread.  (This
    is the common case and handled with a macro for speed.)  Then, loop
@@ -137,12 +196,16 @@ static bool __malloc_initialized = false;
 
 #define arena_get(ptr, size) do { \
       ptr = thread_arena;						      \
+      if (__glibc_unlikely (mp_.percpu))				      \
+        ptr = arena_get_percpu (ptr);					      \
+      else if (__glibc_unlikely (mp_.numa))				      \
+        ptr = arena_get_numa (ptr);					      \
       arena_lock (ptr, size);						      \
   } while (0)
 
 #define arena_lock(ptr, size) do {					      \
       if (ptr)								      \
-        __libc_lock_lock (ptr->mutex);					      \
+        arena_mutex_lock (ptr);						      \
       else								      \
         ptr = arena_get2 ((size), NULL);				      \
   } while (0)
@@ -191,6 +254,19 @@ __malloc_fork_lock_parent (void)
       if (ar_ptr == &main_arena)
         break;
     }
+#if IS_IN (libc)
+  for (mstate ar_ptr = user_arenas; ar_ptr != NULL; ar_ptr = ar_ptr->next)
+    __libc_lock_lock (ar_ptr->mutex);
+#endif
+#if USE_TCACHE
+  __libc_lock_lock (tcache_list_lock);
+#endif
+#if IS_IN (libc)
+  __libc_lock_lock (profile_lock);
+#endif
+#if USE_SLAB
+  __libc_lock_lock (slab_lock);
+#endif
 }
 
 void
@@ -199,6 +275,19 @@ __malloc_fork_unlock_parent (void)
   if (!__malloc_initialized)
     return;
 
+#if USE_SLAB
+  __libc_lock_unlock (slab_lock);
+#endif
+#if IS_IN (libc)
+  __libc_lock_unlock (profile_lock);
+#endif
+#if USE_TCACHE
+  __libc_lock_unlock (tcache_list_lock);
+#endif
+#if IS_IN (libc)
+  for (mstate ar_ptr = user_arenas; ar_ptr != NULL; ar_ptr = ar_ptr->next)
+    __libc_lock_unlock (ar_ptr->mutex);
+#endif
   for (mstate ar_ptr = &main_arena;; )
     {
       __libc_lock_unlock (ar_ptr->mutex);
@@ -237,6 +326,18 @@ __malloc_fork_unlock_child (void)
     }
 
   __libc_lock_init (list_lock);
+#if IS_IN (libc)
+  for (mstate ar_ptr = user_arenas; ar_ptr != NULL; ar_ptr = ar_ptr->next)
+    __libc_lock_init (ar_ptr->mutex);
+  __libc_lock_init (percpu_lock);
+  __libc_lock_init (profile_lock);
+#endif
+#if USE_SLAB
+  __libc_lock_init (slab_lock);
+#endif
+#if USE_TCACHE
+  tcache_list_fork_child ();
+#endif
 }
 
 #if HAVE_TUNABLES
@@ -256,10 +357,21 @@ TUNABLE_CALLBACK_FNDECL (set_perturb_byte, int32_t)
 TUNABLE_CALLBACK_FNDECL (set_trim_threshold, size_t)
 TUNABLE_CALLBACK_FNDECL (set_arena_max, size_t)
 TUNABLE_CALLBACK_FNDECL (set_arena_test, size_t)
+TUNABLE_CALLBACK_FNDECL (set_percpu, int32_t)
+TUNABLE_CALLBACK_FNDECL (set_numa, int32_t)
+TUNABLE_CALLBACK_FNDECL (set_numa_nodes, size_t)
+TUNABLE_CALLBACK_FNDECL (set_decay_ms, size_t)
+TUNABLE_CALLBACK_FNDECL (set_profile_sample_bytes, size_t)
+TUNABLE_CALLBACK_FNDECL (set_slab, int32_t)
+TUNABLE_CALLBACK_FNDECL (set_tlsf, int32_t)
 #if USE_TCACHE
 TUNABLE_CALLBACK_FNDECL (set_tcache_max, size_t)
 TUNABLE_CALLBACK_FNDECL (set_tcache_count, size_t)
 TUNABLE_CALLBACK_FNDECL (set_tcache_unsorted_limit, size_t)
+TUNABLE_CALLBACK_FNDECL (set_tcache_batch, size_t)
+TUNABLE_CALLBACK_FNDECL (set_tcache_large_max, size_t)
+TUNABLE_CALLBACK_FNDECL (set_tcache_large_budget, size_t)
+TUNABLE_CALLBACK_FNDECL (set_tcache_large_count, size_t)
 #endif
 TUNABLE_CALLBACK_FNDECL (set_mxfast, size_t)
 TUNABLE_CALLBACK_FNDECL (set_hugetlb, size_t)
@@ -304,6 +416,101 @@ next_env_entry (char ***position)
 static void tcache_key_initialize (void);
 #endif
 
+#if IS_IN (libc)
+/* Allocate the per-CPU arena table.  The arenas themselves are
+   created lazily by arena_get_percpu.  Per-CPU arenas are disabled if
+   the number of CPUs cannot be determined.  */
+static void
+percpu_init (void)
+{
+  int n = __get_nprocs_conf ();
+  if (n <= 0)
+    {
+      mp_.percpu = 0;
+      return;
+    }
+
+  size_t size = ALIGN_UP (n * sizeof (mstate), GLRO (dl_pagesize));
+  void *p = MMAP (NULL, size, PROT_READ | PROT_WRITE, 0);
+  if (p == MAP_FAILED)
+    {
+      mp_.percpu = 0;
+      return;
+    }
+  percpu_arenas = p;
+  percpu_narenas = n;
+}
+
+/* Return the NUMA node of the CPU the calling thread currently runs
+   on, or -1 if it cannot be determined.  With a simulated topology,
+   CPU N belongs to node N modulo glibc.malloc.numa_nodes.  Otherwise
+   the node of each CPU is asked from the kernel once and cached.  */
+static inline int
+numa_current_node (void)
+{
+  int cpu = malloc_getcpu ();
+  if (__glibc_unlikely (cpu < 0))
+    return -1;
+  if (mp_.numa_nodes != 0)
+    return cpu % mp_.numa_nodes;
+  if (__glibc_unlikely ((size_t) cpu >= numa_ncpus))
+    return -1;
+
+  int node = atomic_load_relaxed (&numa_cpu_nodes[cpu]) - 1;
+  if (__glibc_unlikely (node < 0))
+    {
+      node = malloc_getnode (cpu);
+      if (node >= 0)
+	atomic_store_relaxed (&numa_cpu_nodes[cpu], node + 1);
+    }
+  return node;
+}
+
+/* Allocate the table of CPU nodes unless the topology is simulated,
+   and tag the main arena with the node of the initial thread.  NUMA
+   arenas are disabled if the number of CPUs cannot be determined, or
+   if per-CPU arenas are used, which are node-local anyway.  */
+static void
+numa_init (void)
+{
+  if (mp_.percpu)
+    {
+      mp_.numa = 0;
+      return;
+    }
+
+  if (mp_.numa_nodes == 0)
+    {
+      int n = __get_nprocs_conf ();
+      if (n <= 0)
+	{
+	  mp_.numa = 0;
+	  return;
+	}
+
+      size_t size = ALIGN_UP (n * sizeof (int), GLRO (dl_pagesize));
+      void *p = MMAP (NULL, size, PROT_READ | PROT_WRITE, 0);
+      if (p == MAP_FAILED)
+	{
+	  mp_.numa = 0;
+	  return;
+	}
+      numa_cpu_nodes = p;
+      numa_ncpus = n;
+    }
+
+  thread_numa_node = main_arena.numa_node = numa_current_node ();
+}
+
+/* Return whether arena A may serve threads running on NODE, which is
+   always the case if NODE is not known.  */
+static inline bool
+arena_on_node (mstate a, int node)
+{
+  return node < 0 || a->numa_node == node;
+}
+#endif
+
 static void
 ptmalloc_init (void)
 {
@@ -356,6 +563,13 @@ ptmalloc_init (void)
   TUNABLE_GET (tcache_count, size_t, TUNABLE_CALLBACK (set_tcache_count));
   TUNABLE_GET (tcache_unsorted_limit, size_t,
 	       TUNABLE_CALLBACK (set_tcache_unsorted_limit));
+  TUNABLE_GET (tcache_batch, size_t, TUNABLE_CALLBACK (set_tcache_batch));
+  TUNABLE_GET (tcache_large_max, size_t,
+	       TUNABLE_CALLBACK (set_tcache_large_max));
+  TUNABLE_GET (tcache_large_budget, size_t,
+	       TUNABLE_CALLBACK (set_tcache_large_budget));
+  TUNABLE_GET (tcache_large_count, size_t,
+	       TUNABLE_CALLBACK (set_tcache_large_count));
 # endif
   TUNABLE_GET (mxfast, size_t, TUNABLE_CALLBACK (set_mxfast));
   TUNABLE_GET (hugetlb, size_t, TUNABLE_CALLBACK (set_hugetlb));
@@ -363,6 +577,26 @@ ptmalloc_init (void)
     /* Force mmap for main arena instead of sbrk, so hugepages are explicitly
        used.  */
     __always_fail_morecore = true;
+  TUNABLE_GET (percpu, int32_t, TUNABLE_CALLBACK (set_percpu));
+  TUNABLE_GET (numa, int32_t, TUNABLE_CALLBACK (set_numa));
+  TUNABLE_GET (numa_nodes, size_t, TUNABLE_CALLBACK (set_numa_nodes));
+  TUNABLE_GET (decay_ms, size_t, TUNABLE_CALLBACK (set_decay_ms));
+  TUNABLE_GET (profile_sample_bytes, size_t,
+	       TUNABLE_CALLBACK (set_profile_sample_bytes));
+  TUNABLE_GET (slab, int32_t, TUNABLE_CALLBACK (set_slab));
+  TUNABLE_GET (tlsf, int32_t, TUNABLE_CALLBACK (set_tlsf));
+  if (mp_.tlsf)
+    tlsf_init_main_arena ();
+# if IS_IN (libc)
+  if (mp_.percpu)
+    percpu_init ();
+  if (mp_.numa)
+    numa_init ();
+# endif
+# if USE_SLAB
+  if (mp_.slab)
+    slab_init ();
+# endif
 #else
   if (__glibc_likely (_environ != NULL))
     {
@@ -476,11 +710,12 @@ dump_heap (heap_info *heap)
 static char *aligned_heap_area;
 
 /* Create a new heap.  size is automatically rounded up to a multiple
-   of the page size. */
+   of the page size.  If NODE is not negative, the pages of the heap
+   are placed on that NUMA node.  */
 
 static heap_info *
 alloc_new_heap  (size_t size, size_t top_pad, size_t pagesize,
-		 int mmap_flags)
+		 int mmap_flags, int node)
 {
   char *p1, *p2;
   unsigned long ul;
@@ -496,6 +731,10 @@ alloc_new_heap  (size_t size, size_t top_pad, size_t pagesize,
     return 0;
   else
     size = max_size;
+#if HAVE_TUNABLES
+  if (mp_.thp_pagesize > pagesize && mp_.thp_pagesize < max_size)
+    size = ALIGN_UP (size, mp_.thp_pagesize);
+#endif
   size = ALIGN_UP (size, pagesize);
 
   /* A memory region aligned to a multiple of max_size is needed.
@@ -542,6 +781,12 @@ alloc_new_heap  (size_t size, size_t top_pad, size_t pagesize,
             }
         }
     }
+  /* The policy covers the whole reservation, so it also applies to
+     the parts made accessible by grow_heap later.  It is set before
+     the first page is touched.  A simulated topology has no nodes to
+     bind to.  */
+  if (node >= 0 && mp_.numa_nodes == 0)
+    malloc_bind_node (p2, max_size, node);
   if (__mprotect (p2, size, mtag_mmap_flags | PROT_READ | PROT_WRITE) != 0)
     {
       __munmap (p2, max_size);
@@ -559,18 +804,18 @@ alloc_new_heap  (size_t size, size_t top_pad, size_t pagesize,
 }
 
 static heap_info *
-new_heap (size_t size, size_t top_pad)
+new_heap (size_t size, size_t top_pad, int node)
 {
 #if HAVE_TUNABLES
   if (__glibc_unlikely (mp_.hp_pagesize != 0))
     {
       heap_info *h = alloc_new_heap (size, top_pad, mp_.hp_pagesize,
-				     mp_.hp_flags);
+				     mp_.hp_flags, node);
       if (h != NULL)
 	return h;
     }
 #endif
-  return alloc_new_heap (size, top_pad, GLRO (dl_pagesize), 0);
+  return alloc_new_heap (size, top_pad, GLRO (dl_pagesize), 0, node);
 }
 
 /* Grow a heap.  size is automatically rounded up to a
@@ -579,12 +824,12 @@ new_heap (size_t size, size_t top_pad)
 static int
 grow_heap (heap_info *h, long diff)
 {
-  size_t pagesize = h->pagesize;
   size_t max_size = heap_max_size ();
   long new_size;
 
-  diff = ALIGN_UP (diff, pagesize);
-  new_size = (long) h->size + diff;
+  /* Round the end of the heap, which may not be aligned after
+     malloc_trim, up to the next unit.  */
+  new_size = ALIGN_UP (h->size + diff, heap_grow_unit (h));
   if ((unsigned long) new_size > (unsigned long) max_size)
     return -1;
 
@@ -595,6 +840,8 @@ grow_heap (heap_info *h, long diff)
                       mtag_mmap_flags | PROT_READ | PROT_WRITE) != 0)
         return -2;
 
+      madvise_thp ((char *) h + h->mprotect_size,
+		   new_size - h->mprotect_size);
       h->mprotect_size = new_size;
     }
 
@@ -633,6 +880,41 @@ shrink_heap (heap_info *h, long diff)
   return 0;
 }
 
+/* Recompute the part of the system memory of AV which lies in naturally
+   aligned huge pages: all heaps of hugetlb pages, the whole transparent
+   huge pages of the other heaps, and for the main arena, those of the
+   sbrk heap while it is contiguous.  The lock of AV must be held.  */
+
+static void
+arena_update_huge_mem (mstate av)
+{
+#if HAVE_TUNABLES
+  if (mp_.thp_pagesize == 0 && mp_.hp_pagesize == 0)
+    return;
+
+  size_t huge = 0;
+  if (av != &main_arena)
+    for (heap_info *h = heap_for_ptr (top (av)); h != NULL; h = h->prev)
+      {
+	if (h->pagesize > GLRO (dl_pagesize))
+	  huge += h->size;
+	else if (mp_.thp_pagesize != 0)
+	  huge += ALIGN_DOWN (h->size, mp_.thp_pagesize);
+      }
+  else if (mp_.thp_pagesize != 0 && contiguous (av)
+	   && mp_.sbrk_base != NULL)
+    {
+      uintptr_t start = ALIGN_UP ((uintptr_t) mp_.sbrk_base,
+				  mp_.thp_pagesize);
+      uintptr_t end = ALIGN_DOWN ((uintptr_t) av->top + chunksize (av->top),
+				  mp_.thp_pagesize);
+      if (end > start)
+	huge = end - start;
+    }
+  atomic_store_relaxed (&av->huge_mem, huge);
+#endif
+}
+
 /* Delete a heap. */
 
 static int
@@ -679,6 +961,7 @@ heap_trim (heap_info *heap, size_t pad)
       assert (((char *) p + new_size) == ((char *) heap + heap->size));
       top (ar_ptr) = top_chunk = p;
       set_head (top_chunk, new_size | PREV_INUSE);
+      arena_update_huge_mem (ar_ptr);
       /*check_chunk(ar_ptr, top_chunk);*/
     }
 
@@ -694,9 +977,11 @@ heap_trim (heap_info *heap, size_t pad)
   if (top_area < 0 || (size_t) top_area <= pad)
     return 0;
 
-  /* Release in pagesize units and round down to the nearest page.  */
-  extra = ALIGN_DOWN(top_area - pad, heap->pagesize);
-  if (extra == 0)
+  /* Release in units of heap_grow_unit, keeping the end of the heap
+     aligned to the unit.  */
+  extra = (long) heap->size - (long) ALIGN_UP (heap->size - (top_area - pad),
+					      heap_grow_unit (heap));
+  if (extra <= 0)
     return 0;
 
   /* Try to shrink. */
@@ -704,6 +989,7 @@ heap_trim (heap_info *heap, size_t pad)
     return 0;
 
   ar_ptr->system_mem -= extra;
+  arena_update_huge_mem (ar_ptr);
 
   /* Success. Adjust top accordingly. */
   set_head (top_chunk, (top_size - extra) | PREV_INUSE);
@@ -730,43 +1016,71 @@ detach_arena (mstate replaced_arena)
     }
 }
 
+/* Allocate the first heap of a new arena, large enough for a request
+   of SIZE bytes if possible, and set up the arena state in it.  The
+   arena serves threads on NUMA node NODE, or is not tied to a node if
+   NODE is negative.  It is not linked into any list.  Its mutex is
+   initialized but not locked.  */
 static mstate
-_int_new_arena (size_t size)
+alloc_new_arena (size_t size, int node)
 {
   mstate a;
   heap_info *h;
   char *ptr;
   unsigned long misalign;
 
-  h = new_heap (size + (sizeof (*h) + sizeof (*a) + MALLOC_ALIGNMENT),
-                mp_.top_pad);
+  /* The segregated lists follow the arena.  */
+  size_t tlsf_size = mp_.tlsf ? sizeof (struct malloc_tlsf) : 0;
+
+  h = new_heap (size + (sizeof (*h) + sizeof (*a) + tlsf_size
+			+ MALLOC_ALIGNMENT),
+                mp_.top_pad, node);
   if (!h)
     {
       /* Maybe size is too large to fit in a single heap.  So, just try
          to create a minimally-sized arena and let _int_malloc() attempt
          to deal with the large request via mmap_chunk().  */
-      h = new_heap (sizeof (*h) + sizeof (*a) + MALLOC_ALIGNMENT, mp_.top_pad);
+      h = new_heap (sizeof (*h) + sizeof (*a) + tlsf_size + MALLOC_ALIGNMENT,
+		    mp_.top_pad, node);
       if (!h)
         return 0;
     }
   a = h->ar_ptr = (mstate) (h + 1);
+  ptr = (char *) (a + 1);
+  if (tlsf_size != 0)
+    {
+      a->tlsf = (struct malloc_tlsf *) ptr;
+      ptr += tlsf_size;
+    }
   malloc_init_state (a);
-  a->attached_threads = 1;
   /*a->next = NULL;*/
+  a->numa_node = node;
   a->system_mem = a->max_system_mem = h->size;
 
   /* Set up the top chunk, with proper alignment. */
-  ptr = (char *) (a + 1);
   misalign = (uintptr_t) chunk2mem (ptr) & MALLOC_ALIGN_MASK;
   if (misalign > 0)
     ptr += MALLOC_ALIGNMENT - misalign;
   top (a) = (mchunkptr) ptr;
   set_head (top (a), (((char *) h + h->size) - ptr) | PREV_INUSE);
+  arena_update_huge_mem (a);
 
   LIBC_PROBE (memory_arena_new, 2, a, size);
+  __libc_lock_init (a->mutex);
+
+  return a;
+}
+
+static mstate
+_int_new_arena (size_t size, int node)
+{
+  mstate a = alloc_new_arena (size, node);
+  if (a == NULL)
+    return NULL;
+
+  a->attached_threads = 1;
   mstate replaced_arena = thread_arena;
   thread_arena = a;
-  __libc_lock_init (a->mutex);
 
   __libc_lock_lock (list_lock);
 
@@ -800,19 +1114,25 @@ _int_new_arena (size_t size)
 }
 
 
-/* Remove an arena from free_list.  */
+/* Remove an arena which may serve threads on NUMA node NODE from
+   free_list.  */
 static mstate
-get_free_list (void)
+get_free_list (int node)
 {
   mstate replaced_arena = thread_arena;
   mstate result = free_list;
   if (result != NULL)
     {
       __libc_lock_lock (free_list_lock);
-      result = free_list;
+      mstate *previous = &free_list;
+      for (result = free_list; result != NULL; result = result->next_free)
+	if (arena_on_node (result, node))
+	  break;
+	else
+	  previous = &result->next_free;
       if (result != NULL)
 	{
-	  free_list = result->next_free;
+	  *previous = result->next_free;
 
 	  /* The arena will be attached to this thread.  */
 	  assert (result->attached_threads == 0);
@@ -825,7 +1145,7 @@ get_free_list (void)
       if (result != NULL)
         {
           LIBC_PROBE (memory_arena_reuse_free_list, 1, result);
-          __libc_lock_lock (result->mutex);
+          arena_mutex_lock (result);
 	  thread_arena = result;
         }
     }
@@ -853,11 +1173,12 @@ remove_from_free_list (mstate arena)
     }
 }
 
-/* Lock and return an arena that can be reused for memory allocation.
-   Avoid AVOID_ARENA as we have already failed to allocate memory in
-   it and it is currently locked.  */
+/* Lock and return an arena that can be reused for memory allocation
+   by threads on NUMA node NODE.  Avoid AVOID_ARENA as we have already
+   failed to allocate memory in it and it is currently locked.  Return
+   NULL if no arena serves NODE.  */
 static mstate
-reused_arena (mstate avoid_arena)
+reused_arena (mstate avoid_arena, int node)
 {
   mstate result;
   /* FIXME: Access to next_to_use suffers from data races.  */
@@ -866,26 +1187,34 @@ reused_arena (mstate avoid_arena)
     next_to_use = &main_arena;
 
   /* Iterate over all arenas (including those linked from
-     free_list).  */
+     free_list).  Remember the first arena of NODE other than
+     AVOID_ARENA, to wait for it if all are locked.  */
+  mstate candidate = NULL;
   result = next_to_use;
   do
     {
-      if (!__libc_lock_trylock (result->mutex))
-        goto out;
+      if (arena_on_node (result, node))
+	{
+	  if (!__libc_lock_trylock (result->mutex))
+	    goto out;
+	  /* Avoid AVOID_ARENA as we have already failed to allocate
+	     memory in that arena and it is currently locked.  */
+	  if (candidate == NULL || candidate == avoid_arena)
+	    candidate = result;
+	}
 
       /* FIXME: This is a data race, see _int_new_arena.  */
       result = result->next;
     }
   while (result != next_to_use);
 
-  /* Avoid AVOID_ARENA as we have already failed to allocate memory
-     in that arena and it is currently locked.   */
-  if (result == avoid_arena)
-    result = result->next;
+  if (candidate == NULL)
+    return NULL;
+  result = candidate;
 
   /* No arena available without contention.  Wait for the next in line.  */
   LIBC_PROBE (memory_arena_reuse_wait, 3, &result->mutex, result, avoid_arena);
-  __libc_lock_lock (result->mutex);
+  arena_mutex_lock (result);
 
 out:
   /* Attach the arena to the current thread.  */
@@ -924,7 +1253,8 @@ arena_get2 (size_t size, mstate avoid_arena)
 
   static size_t narenas_limit;
 
-  a = get_free_list ();
+  int node = thread_numa_node;
+  a = get_free_list (node);
   if (a == NULL)
     {
       /* Nothing immediately available, so generate a new arena.  */
@@ -957,16 +1287,137 @@ arena_get2 (size_t size, mstate avoid_arena)
         {
           if (catomic_compare_and_exchange_bool_acq (&narenas, n + 1, n))
             goto repeat;
-          a = _int_new_arena (size);
+          a = _int_new_arena (size, node);
 	  if (__glibc_unlikely (a == NULL))
             catomic_decrement (&narenas);
         }
       else
-        a = reused_arena (avoid_arena);
+	{
+	  a = reused_arena (avoid_arena, node);
+	  if (a == NULL)
+	    {
+	      /* No arena serves the NUMA node of this thread yet.  Go
+		 over the limit rather than allocate from a remote
+		 node, which happens at most once per node.  */
+	      catomic_increment (&narenas);
+	      a = _int_new_arena (size, node);
+	      if (__glibc_unlikely (a == NULL))
+		{
+		  catomic_decrement (&narenas);
+		  a = reused_arena (avoid_arena, -1);
+		}
+	    }
+	}
     }
   return a;
 }
 
+/* Attach the calling thread to RESULT, detaching it from CURRENT.  */
+static void
+percpu_attach (mstate current, mstate result)
+{
+  __libc_lock_lock (free_list_lock);
+  detach_arena (current);
+  /* RESULT may have been put on the free list when the last thread
+     attached to it exited.  */
+  remove_from_free_list (result);
+  ++result->attached_threads;
+  __libc_lock_unlock (free_list_lock);
+
+  thread_arena = result;
+}
+
+/* Fill the per-CPU arena slot for CPU and attach the calling thread
+   to the arena in it.  The first CPU to allocate takes over the main
+   arena, all others get a new arena.  CURRENT is the arena the thread
+   is attached to.  Return NULL if no arena could be created.  */
+static mstate
+percpu_arena_create (mstate current, int cpu)
+{
+  static bool main_arena_used;
+  bool created = false;
+  mstate result;
+
+  __libc_lock_lock (percpu_lock);
+  /* Another thread running on the same CPU may have raced with us.  */
+  result = percpu_arenas[cpu];
+  if (result == NULL)
+    {
+      if (!main_arena_used)
+	{
+	  main_arena_used = true;
+	  result = &main_arena;
+	}
+      else
+	{
+	  catomic_increment (&narenas);
+	  /* This attaches the new arena to the current thread and
+	     returns it locked.  */
+	  result = _int_new_arena (0, -1);
+	  if (__glibc_unlikely (result == NULL))
+	    {
+	      catomic_decrement (&narenas);
+	      __libc_lock_unlock (percpu_lock);
+	      return NULL;
+	    }
+	  __libc_lock_unlock (result->mutex);
+	  created = true;
+	}
+      atomic_store_release (&percpu_arenas[cpu], result);
+    }
+  __libc_lock_unlock (percpu_lock);
+
+  if (!created && result != current)
+    percpu_attach (current, result);
+
+  return result;
+}
+
+/* Return the arena for the CPU the calling thread currently runs on,
+   re-attaching the thread to it if it migrated since its last
+   allocation.  CURRENT is the arena the thread is attached to, which
+   is returned unchanged if the CPU cannot be determined.  Once each
+   CPU has its arena, the common case is a single load from the rseq
+   area and from the table, and the arena lock taken afterwards is
+   only contended if a thread is preempted or migrated in the middle
+   of an allocation.  */
+static mstate
+arena_get_percpu (mstate current)
+{
+  int cpu = malloc_getcpu ();
+  if (__glibc_unlikely (cpu < 0 || (size_t) cpu >= percpu_narenas))
+    return current;
+
+  mstate result = atomic_load_acquire (&percpu_arenas[cpu]);
+  if (__glibc_likely (result != NULL && result == current))
+    return result;
+
+  if (result == NULL)
+    return percpu_arena_create (current, cpu) ?: current;
+
+  percpu_attach (current, result);
+  return result;
+}
+
+/* Return CURRENT, the arena the calling thread is attached to, unless
+   the thread has moved to another NUMA node since it selected it.  In
+   that case, return NULL so that arena_get2 selects an arena of the
+   new node.  This check is a load from the rseq area and from the
+   CPU node table, and a new selection only happens when the thread
+   migrates across nodes.  */
+static mstate
+arena_get_numa (mstate current)
+{
+  int node = numa_current_node ();
+  if (__glibc_likely (node == thread_numa_node))
+    return current;
+
+  thread_numa_node = node;
+  if (current != NULL && current->numa_node == node)
+    return current;
+  return NULL;
+}
+
 /* If we don't have the main arena, then maybe the failure is due to running
    out of mmapped areas, so we can try allocating on the main arena.
    Otherwise, it is likely that sbrk() has failed and there is still a chance
@@ -979,7 +1430,7 @@ arena_get_retry (mstate ar_ptr, size_t bytes)
     {
       __libc_lock_unlock (ar_ptr->mutex);
       ar_ptr = &main_arena;
-      __libc_lock_lock (ar_ptr->mutex);
+      arena_mutex_lock (ar_ptr);
     }
   else
     {
@@ -989,6 +1440,62 @@ arena_get_retry (mstate ar_ptr, size_t bytes)
 
   return ar_ptr;
 }
+
+/* Create a user arena (see malloc_arena_create).  Return NULL if no
+   heap could be allocated for it.  */
+static mstate
+user_arena_create (void)
+{
+  mstate a = alloc_new_arena (0, -1);
+  if (a == NULL)
+    return NULL;
+
+  a->flags |= USER_ARENA_BIT;
+#if USE_TCACHE
+  atomic_store_relaxed (&mp_.user_arenas, 1);
+#endif
+
+  __libc_lock_lock (list_lock);
+  a->next = user_arenas;
+  user_arenas = a;
+  __libc_lock_unlock (list_lock);
+
+  return a;
+}
+
+/* Unmap all the heaps of the user arena A, including the one holding
+   A itself.  */
+static void
+user_arena_destroy (mstate a)
+{
+  __libc_lock_lock (list_lock);
+  mstate *prev = &user_arenas;
+  while (*prev != a)
+    {
+      if (*prev == NULL)
+	malloc_printerr ("malloc_arena_destroy(): invalid arena");
+      prev = &(*prev)->next;
+    }
+  *prev = a->next;
+  __libc_lock_unlock (list_lock);
+
+  if (thread_user_arena == a)
+    thread_user_arena = NULL;
+
+  /* The heaps are chained from the one holding the top chunk back to
+     the first one, whose prev pointer is NULL.  */
+  size_t max_size = heap_max_size ();
+  heap_info *heap = heap_for_ptr (top (a));
+  while (heap != NULL)
+    {
+      heap_info *prev_heap = heap->prev;
+      LIBC_PROBE (memory_heap_free, 2, heap, heap->size);
+      if ((char *) heap + max_size == aligned_heap_area)
+	aligned_heap_area = NULL;
+      __munmap (heap, max_size);
+      heap = prev_heap;
+    }
+}
 #endif
 
 void
@@ -52,6 +52,7 @@ enum malloc_debug_hooks
   MALLOC_MCHECK_HOOK = 1 << 0, /* mcheck()  */
   MALLOC_MTRACE_HOOK = 1 << 1, /* mtrace()  */
   MALLOC_CHECK_HOOK = 1 << 2,  /* MALLOC_CHECK_ or glibc.malloc.check.  */
+  MALLOC_BTRACE_HOOK = 1 << 3, /* MALLOC_BINARY_TRACE.  */
 };
 static unsigned __malloc_debugging_hooks;
 
@@ -76,6 +77,7 @@ __malloc_debug_disable (enum malloc_debug_hooks flag)
 #include "mcheck.c"
 #include "mtrace.c"
 #include "malloc-check.c"
+#include "malloc-trace.c"
 
 #if SHLIB_COMPAT (libc_malloc_debug, GLIBC_2_0, GLIBC_2_24)
 extern void (*__malloc_initialize_hook) (void);
@@ -118,6 +120,8 @@ generic_hook_ini (void)
        will not try to optimize it away.  */
     __libc_free (__libc_malloc (0));
 
+  initialize_btrace ();
+
 #if SHLIB_COMPAT (libc_malloc_debug, GLIBC_2_0, GLIBC_2_24)
   void (*hook) (void) = __malloc_initialize_hook;
   if (hook != NULL)
@@ -184,6 +188,8 @@ __debug_malloc (size_t bytes)
     victim = malloc_mcheck_after (victim, orig_bytes);
   if (__is_malloc_debug_enabled (MALLOC_MTRACE_HOOK))
     malloc_mtrace_after (victim, orig_bytes, RETURN_ADDRESS (0));
+  if (__is_malloc_debug_enabled (MALLOC_BTRACE_HOOK))
+    btrace_record (MALLOC_TRACE_MALLOC, victim, 0, orig_bytes);
 
   return victim;
 }
@@ -199,6 +205,9 @@ __debug_free (void *mem)
       return;
     }
 
+  if (__is_malloc_debug_enabled (MALLOC_BTRACE_HOOK) && mem != NULL)
+    btrace_record (MALLOC_TRACE_FREE, mem, 0, 0);
+
   if (__is_malloc_debug_enabled (MALLOC_MCHECK_HOOK))
     mem = free_mcheck (mem);
 
@@ -213,6 +222,54 @@ __debug_free (void *mem)
 }
 strong_alias (__debug_free, free)
 
+/* In the checking modes, the size passed to free_sized is compared
+   with the size recorded at allocation.  */
+static void
+check_free_size (void *mem, size_t size)
+{
+  if (mem != NULL
+      && (__is_malloc_debug_enabled (MALLOC_MCHECK_HOOK)
+	  || __is_malloc_debug_enabled (MALLOC_CHECK_HOOK))
+      && !DUMPED_MAIN_ARENA_CHUNK (mem2chunk (mem))
+      && malloc_usable_size (mem) != size)
+    malloc_printerr ("free_sized(): invalid size");
+}
+
+static void
+__debug_free_sized (void *mem, size_t size)
+{
+  check_free_size (mem, size);
+  __debug_free (mem);
+}
+strong_alias (__debug_free_sized, free_sized)
+
+static void
+__debug_free_aligned_sized (void *mem, size_t alignment, size_t size)
+{
+  check_free_size (mem, size);
+  __debug_free (mem);
+}
+strong_alias (__debug_free_aligned_sized, free_aligned_sized)
+
+static size_t
+__debug_malloc_bulk (size_t bytes, size_t n, void **ptrs)
+{
+  size_t i;
+  for (i = 0; i < n; ++i)
+    if ((ptrs[i] = __debug_malloc (bytes)) == NULL)
+      break;
+  return i;
+}
+strong_alias (__debug_malloc_bulk, malloc_bulk)
+
+static void
+__debug_free_bulk (size_t n, void **ptrs)
+{
+  for (size_t i = 0; i < n; ++i)
+    __debug_free (ptrs[i]);
+}
+strong_alias (__debug_free_bulk, free_bulk)
+
 static void *
 __debug_realloc (void *oldmem, size_t bytes)
 {
@@ -222,7 +279,10 @@ __debug_realloc (void *oldmem, size_t bytes)
     return (*hook)(oldmem, bytes, RETURN_ADDRESS (0));
 
   size_t orig_bytes = bytes, oldsize = 0;
-  void *victim = NULL;
+  void *victim = NULL, *orig_oldmem = oldmem;
+
+  if (__is_malloc_debug_enabled (MALLOC_BTRACE_HOOK) && oldmem != NULL)
+    btrace_record (MALLOC_TRACE_REALLOC_START, oldmem, 0, bytes);
 
   if ((!__is_malloc_debug_enabled (MALLOC_MCHECK_HOOK)
        || !realloc_mcheck_before (&oldmem, &bytes, &oldsize, &victim)))
@@ -262,6 +322,9 @@ __debug_realloc (void *oldmem, size_t bytes)
 				   oldsize);
   if (__is_malloc_debug_enabled (MALLOC_MTRACE_HOOK))
     realloc_mtrace_after (victim, oldmem, orig_bytes, RETURN_ADDRESS (0));
+  if (__is_malloc_debug_enabled (MALLOC_BTRACE_HOOK))
+    btrace_record (MALLOC_TRACE_REALLOC, victim, (uintptr_t) orig_oldmem,
+		   orig_bytes);
 
   return victim;
 }
@@ -289,6 +352,8 @@ _debug_mid_memalign (size_t alignment, size_t bytes, const void *address)
     victim = memalign_mcheck_after (victim, alignment, orig_bytes);
   if (__is_malloc_debug_enabled (MALLOC_MTRACE_HOOK))
     memalign_mtrace_after (victim, orig_bytes, address);
+  if (__is_malloc_debug_enabled (MALLOC_BTRACE_HOOK))
+    btrace_record (MALLOC_TRACE_MEMALIGN, victim, alignment, orig_bytes);
 
   return victim;
 }
@@ -391,11 +456,23 @@ __debug_calloc (size_t nmemb, size_t size)
     }
   if (__is_malloc_debug_enabled (MALLOC_MTRACE_HOOK))
     malloc_mtrace_after (victim, orig_bytes, RETURN_ADDRESS (0));
+  if (__is_malloc_debug_enabled (MALLOC_BTRACE_HOOK))
+    btrace_record (MALLOC_TRACE_CALLOC, victim, 0, orig_bytes);
 
   return victim;
 }
 strong_alias (__debug_calloc, calloc)
 
+#define LIBC_SYMBOL(sym) libc_ ## sym
+#define SYMHANDLE(sym) sym ## _handle
+
+#define LOAD_SYM(sym) ({ \
+  static void *SYMHANDLE (sym);						      \
+  if (SYMHANDLE (sym) == NULL)						      \
+    SYMHANDLE (sym) = dlsym (RTLD_NEXT, #sym);				      \
+  SYMHANDLE (sym);							      \
+})
+
 size_t
 malloc_usable_size (void *mem)
 {
@@ -411,18 +488,15 @@ malloc_usable_size (void *mem)
   if (DUMPED_MAIN_ARENA_CHUNK (p))
     return chunksize (p) - SIZE_SZ;
 
-  return musable (mem);
-}
-
-#define LIBC_SYMBOL(sym) libc_ ## sym
-#define SYMHANDLE(sym) sym ## _handle
+  /* Other blocks come from libc, which may have allocated them from
+     slabs without chunk headers.  */
+  size_t (*LIBC_SYMBOL (malloc_usable_size)) (void *)
+    = LOAD_SYM (malloc_usable_size);
+  if (LIBC_SYMBOL (malloc_usable_size) == NULL)
+    return musable (mem);
 
-#define LOAD_SYM(sym) ({ \
-  static void *SYMHANDLE (sym);						      \
-  if (SYMHANDLE (sym) == NULL)						      \
-    SYMHANDLE (sym) = dlsym (RTLD_NEXT, #sym);				      \
-  SYMHANDLE (sym);							      \
-})
+  return LIBC_SYMBOL (malloc_usable_size) (mem);
+}
 
 int
 malloc_info (int options, FILE *fp)
@@ -643,10 +717,15 @@ compat_symbol (libc_malloc_debug, malloc_set_state, malloc_set_state,
 compat_symbol (libc_malloc_debug, aligned_alloc, aligned_alloc, GLIBC_2_16);
 compat_symbol (libc_malloc_debug, calloc, calloc, GLIBC_2_0);
 compat_symbol (libc_malloc_debug, free, free, GLIBC_2_0);
+compat_symbol (libc_malloc_debug, free_aligned_sized, free_aligned_sized,
+	       GLIBC_2_38);
+compat_symbol (libc_malloc_debug, free_bulk, free_bulk, GLIBC_2_38);
+compat_symbol (libc_malloc_debug, free_sized, free_sized, GLIBC_2_38);
 compat_symbol (libc_malloc_debug, mallinfo2, mallinfo2, GLIBC_2_33);
 compat_symbol (libc_malloc_debug, mallinfo, mallinfo, GLIBC_2_0);
 compat_symbol (libc_malloc_debug, malloc_info, malloc_info, GLIBC_2_10);
 compat_symbol (libc_malloc_debug, malloc, malloc, GLIBC_2_0);
+compat_symbol (libc_malloc_debug, malloc_bulk, malloc_bulk, GLIBC_2_38);
 compat_symbol (libc_malloc_debug, malloc_stats, malloc_stats, GLIBC_2_0);
 compat_symbol (libc_malloc_debug, malloc_trim, malloc_trim, GLIBC_2_0);
 compat_symbol (libc_malloc_debug, malloc_usable_size, malloc_usable_size,
@@ -0,0 +1,250 @@
+/* Binary allocation trace recorder for libc_malloc_debug.so.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* Unlike mtrace, which formats every call as text under a global lock,
+   this records fixed-size binary records (see malloc-trace.h) into a
+   per-thread buffer, so that the only costs of a call in the common
+   case are a clock read and a few stores.  The buffer of a thread is
+   written to the file under a lock when it is full or the thread
+   exits, and all buffers are written when the process exits.  */
+
+#include <dso_handle.h>
+#include <fcntl.h>
+#include <not-cancel.h>
+#include <register-atfork.h>
+#include <time.h>
+#include "malloc-trace.h"
+
+static const char btrace_env[] = "MALLOC_BINARY_TRACE";
+
+/* Number of records in a thread buffer.  */
+enum { btrace_buffer_records = 4096 };
+
+struct btrace_buffer
+{
+  /* All buffers, linked through this member.  Buffers are never
+     unmapped, so that they can be written out at process exit
+     without synchronizing with their threads.  */
+  struct btrace_buffer *next;
+  /* True while a thread records into the buffer.  */
+  bool in_use;
+  uint32_t thread;
+  /* Number of records in the buffer, only stored by the thread which
+     uses it.  */
+  size_t count;
+  struct malloc_trace_record records[btrace_buffer_records];
+};
+
+/* Serializes access to btrace_fd, btrace_buffers, btrace_threads and
+   the in_use members of the buffers.  */
+__libc_lock_define_initialized (static, btrace_lock);
+static int btrace_fd = -1;
+static struct btrace_buffer *btrace_buffers;
+static uint32_t btrace_threads;
+static struct timespec btrace_start;
+
+static __thread struct btrace_buffer *btrace_current
+  attribute_tls_model_ie;
+/* The number of the thread after its buffer was released at thread
+   exit, or 0.  */
+static __thread uint32_t btrace_exited attribute_tls_model_ie;
+
+static uint64_t
+btrace_now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) (ts.tv_sec - btrace_start.tv_sec) * 1000000000
+	  + ts.tv_nsec - btrace_start.tv_nsec);
+}
+
+/* Write LENGTH bytes at DATA to the trace file.  Must be called with
+   btrace_lock held.  Stop tracing on errors.  */
+static void
+btrace_write (const void *data, size_t length)
+{
+  const char *p = data;
+  while (length > 0 && btrace_fd >= 0)
+    {
+      ssize_t n = __write_nocancel (btrace_fd, p, length);
+      if (n <= 0)
+	{
+	  if (n < 0 && errno == EINTR)
+	    continue;
+	  __malloc_debug_disable (MALLOC_BTRACE_HOOK);
+	  __close_nocancel_nostatus (btrace_fd);
+	  btrace_fd = -1;
+	  break;
+	}
+      p += n;
+      length -= n;
+    }
+}
+
+/* Write out the records in B and empty it.  */
+static void
+btrace_flush (struct btrace_buffer *b)
+{
+  __libc_lock_lock (btrace_lock);
+  btrace_write (b->records, b->count * sizeof (b->records[0]));
+  __libc_lock_unlock (btrace_lock);
+  b->count = 0;
+}
+
+/* Called when a thread which has recorded calls exits.  */
+static void
+btrace_thread_exit (void *closure)
+{
+  struct btrace_buffer *b = closure;
+  btrace_current = NULL;
+  btrace_exited = b->thread;
+  btrace_flush (b);
+  __libc_lock_lock (btrace_lock);
+  b->in_use = false;
+  __libc_lock_unlock (btrace_lock);
+}
+
+/* Attach an unused buffer to the calling thread, which has not
+   recorded any calls yet or only before its previous buffer was
+   released at thread exit.  Return NULL if none could be
+   allocated.  */
+static struct btrace_buffer *
+btrace_buffer_get (void)
+{
+  __libc_lock_lock (btrace_lock);
+  struct btrace_buffer *b;
+  for (b = btrace_buffers; b != NULL; b = b->next)
+    if (!b->in_use)
+      break;
+  if (b == NULL)
+    {
+      b = MMAP (NULL, sizeof (*b), PROT_READ | PROT_WRITE, 0);
+      if (b == MAP_FAILED)
+	{
+	  __libc_lock_unlock (btrace_lock);
+	  return NULL;
+	}
+      b->next = btrace_buffers;
+      btrace_buffers = b;
+    }
+  b->in_use = true;
+  b->thread = ++btrace_threads;
+  b->count = 0;
+  __libc_lock_unlock (btrace_lock);
+
+  /* This allocates memory, which is recorded into the buffer.  */
+  btrace_current = b;
+  __cxa_thread_atexit_impl (btrace_thread_exit, b, __dso_handle);
+  return b;
+}
+
+static void
+btrace_record (enum malloc_trace_op op, const void *ptr, uintptr_t arg,
+	       size_t size)
+{
+  struct btrace_buffer *b = btrace_current;
+  if (__glibc_unlikely (b == NULL))
+    {
+      /* Calls made by the remaining TLS destructors and the thread
+	 exit code are written one by one.  Attaching a new buffer
+	 would register another destructor.  */
+      if (btrace_exited != 0)
+	{
+	  struct malloc_trace_record r =
+	    {
+	      .op = op,
+	      .thread = btrace_exited,
+	      .time = btrace_now (),
+	      .ptr = (uintptr_t) ptr,
+	      .arg = arg,
+	      .size = size,
+	    };
+	  __libc_lock_lock (btrace_lock);
+	  btrace_write (&r, sizeof (r));
+	  __libc_lock_unlock (btrace_lock);
+	  return;
+	}
+      b = btrace_buffer_get ();
+      if (b == NULL)
+	return;
+    }
+
+  struct malloc_trace_record *r = &b->records[b->count];
+  r->op = op;
+  r->thread = b->thread;
+  r->time = btrace_now ();
+  r->ptr = (uintptr_t) ptr;
+  r->arg = arg;
+  r->size = size;
+  if (++b->count == btrace_buffer_records)
+    btrace_flush (b);
+}
+
+/* Write out all buffers and stop tracing at process exit.  Threads
+   which are still running may record further calls into their
+   buffers, which are not written.  */
+static void
+btrace_finish (void *closure)
+{
+  __malloc_debug_disable (MALLOC_BTRACE_HOOK);
+  __libc_lock_lock (btrace_lock);
+  for (struct btrace_buffer *b = btrace_buffers; b != NULL; b = b->next)
+    btrace_write (b->records, b->count * sizeof (b->records[0]));
+  if (btrace_fd >= 0)
+    __close_nocancel_nostatus (btrace_fd);
+  btrace_fd = -1;
+  __libc_lock_unlock (btrace_lock);
+}
+
+/* The trace describes the parent process only.  */
+static void
+btrace_fork_child (void)
+{
+  __malloc_debug_disable (MALLOC_BTRACE_HOOK);
+  __libc_lock_init (btrace_lock);
+  btrace_fd = -1;
+}
+
+/* Start tracing if the environment variable MALLOC_BINARY_TRACE names
+   a file which can be created.  Called before the first allocation,
+   while the process is still single-threaded.  */
+static void
+initialize_btrace (void)
+{
+  const char *file = secure_getenv (btrace_env);
+  if (file == NULL || file[0] == '\0')
+    return;
+
+  btrace_fd = __open_nocancel (file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			       0666);
+  if (btrace_fd < 0)
+    return;
+
+  struct malloc_trace_header header;
+  memcpy (header.magic, MALLOC_TRACE_MAGIC, sizeof (header.magic));
+  header.version = MALLOC_TRACE_VERSION;
+  header.record_size = sizeof (struct malloc_trace_record);
+  btrace_write (&header, sizeof (header));
+  if (btrace_fd < 0)
+    return;
+
+  clock_gettime (CLOCK_MONOTONIC, &btrace_start);
+  __cxa_atexit (btrace_finish, NULL, __dso_handle);
+  __register_atfork (NULL, NULL, btrace_fork_child, __dso_handle);
+  __malloc_debug_enable (MALLOC_BTRACE_HOOK);
+}
@@ -0,0 +1,87 @@
+/* Binary allocation trace format.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MALLOC_TRACE_H
+#define _MALLOC_TRACE_H
+
+/* The trace written by libc_malloc_debug.so if the environment
+   variable MALLOC_BINARY_TRACE names a file, and read by
+   benchtests/bench-malloc-replay.  It consists of a header followed
+   by fixed-size records in the byte order of the traced process.
+
+   Each thread collects its records in a buffer which is appended to
+   the file when it is full, when the thread exits, and when the
+   process exits.  The records of one thread are therefore in the
+   order of its calls, but those of different threads are interleaved
+   in blocks, and readers have to sort them by time.  */
+
+#include <stdint.h>
+
+#define MALLOC_TRACE_MAGIC "GLIBCMTR"
+#define MALLOC_TRACE_VERSION 2
+
+struct malloc_trace_header
+{
+  char magic[8];		/* MALLOC_TRACE_MAGIC, not terminated.  */
+  uint32_t version;		/* MALLOC_TRACE_VERSION.  */
+  uint32_t record_size;		/* sizeof (struct malloc_trace_record).  */
+};
+
+enum malloc_trace_op
+{
+  /* malloc, and each block of malloc_bulk.  */
+  MALLOC_TRACE_MALLOC = 1,
+  /* free, free_sized, free_aligned_sized, and each block of
+     free_bulk.  Frees of null pointers are not recorded.  */
+  MALLOC_TRACE_FREE,
+  /* realloc, preceded by a MALLOC_TRACE_REALLOC_START record of the
+     same thread unless the old pointer is null.  */
+  MALLOC_TRACE_REALLOC,
+  /* memalign, aligned_alloc, posix_memalign, valloc and pvalloc.  */
+  MALLOC_TRACE_MEMALIGN,
+  MALLOC_TRACE_CALLOC,
+  /* The start of a realloc call, recorded before the call like a free,
+     because realloc may free the old block and another thread may
+     allocate it again before the call returns.  */
+  MALLOC_TRACE_REALLOC_START,
+};
+
+struct malloc_trace_record
+{
+  /* The function, an enum malloc_trace_op value.  */
+  uint32_t op;
+  /* The calling thread.  Threads are numbered from 1 in the order of
+     their first call.  Numbers are not reused.  */
+  uint32_t thread;
+  /* Nanoseconds since the trace was started, taken before the call
+     for MALLOC_TRACE_FREE and MALLOC_TRACE_REALLOC_START and after it
+     for the others.  */
+  uint64_t time;
+  /* The returned pointer, the freed one for MALLOC_TRACE_FREE, or the
+     old one for MALLOC_TRACE_REALLOC_START.  Null if the allocation
+     failed, or if realloc freed the block because SIZE was 0.  */
+  uint64_t ptr;
+  /* The old pointer for MALLOC_TRACE_REALLOC, the alignment for
+     MALLOC_TRACE_MEMALIGN, and 0 otherwise.  */
+  uint64_t arg;
+  /* The requested size, NMEMB * SIZE for MALLOC_TRACE_CALLOC, and 0
+     for MALLOC_TRACE_FREE.  */
+  uint64_t size;
+};
+
+#endif /* _MALLOC_TRACE_H */
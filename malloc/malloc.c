@@ -256,6 +256,9 @@
 #include <sys/random.h>
 #include <not-cancel.h>
 
+/* For the decay clock.  */
+#include <time.h>
+
 /*
   Debugging:
 
@@ -314,7 +317,34 @@
 /* Maximum chunks in tcache bins for tunables.  This value must fit the range
    of tcache->counts[] entries, else they may overflow.  */
 # define MAX_TCACHE_COUNT UINT16_MAX
+
+/* Number of chunks moved between a tcache bin and the arena per lock
+   acquisition when the bin is empty on malloc or full on free.  Zero
+   disables batching: a tcache miss returns a single chunk and an
+   overflowing free releases a single chunk.  */
+# define TCACHE_BATCH_COUNT 0
+
+/* Chunks larger than those of the last regular bin can be cached in up
+   to TCACHE_LARGE_BINS large bins, with four size classes per power of
+   two, if the glibc.malloc.tcache_large_max tunable is set.  The chunks
+   in the large bins of a thread take at most tcache_large_budget bytes,
+   and those in one large bin at most a quarter of it.  Each large bin
+   holds at most tcache_large_count chunks.  */
+# define TCACHE_LARGE_BINS	64
+# define TCACHE_LARGE_BUDGET	(1024 * 1024)
+#endif
+
+/* The slab tier (see slab.c) serves requests of up to SLAB_MAX_SIZE
+   bytes from header-less slots in SLAB_NCLASSES size classes, which
+   are the multiples of MALLOC_ALIGNMENT.  Its per-thread caches are
+   part of the tcache.  */
+#if USE_TCACHE && IS_IN (libc)
+# define USE_SLAB 1
+#else
+# define USE_SLAB 0
 #endif
+#define SLAB_MAX_SIZE 64
+#define SLAB_NCLASSES (SLAB_MAX_SIZE / MALLOC_ALIGNMENT)
 
 /* Safe-Linking:
    Use randomness from ASLR (mmap_base) to protect single-linked lists
@@ -610,6 +640,7 @@ libc_hidden_proto (__libc_free)
   set to zero.
 */
 void*  __libc_calloc(size_t, size_t);
+libc_hidden_proto (__libc_calloc)
 
 /*
   realloc(void* p, size_t n)
@@ -1086,6 +1117,11 @@ typedef struct malloc_chunk* mchunkptr;
 
 static void*  _int_malloc(mstate, size_t);
 static void     _int_free(mstate, mchunkptr, int);
+static void     _int_free_chunk(mstate, mchunkptr, INTERNAL_SIZE_T, int);
+static void     _int_free_merge_chunk(mstate, mchunkptr, INTERNAL_SIZE_T);
+static bool     remote_free_push(mstate, mchunkptr);
+static void     remote_free_drain(mstate);
+static void     decay_tick(mstate);
 static void*  _int_realloc(mstate, mchunkptr, INTERNAL_SIZE_T,
 			   INTERNAL_SIZE_T);
 static void*  _int_memalign(mstate, size_t, size_t);
@@ -1699,6 +1735,77 @@ unlink_chunk (mstate av, mchunkptr p)
 #define unmark_bin(m, i)  ((m)->binmap[idx2block (i)] &= ~(idx2bit (i)))
 #define get_binmap(m, i)  ((m)->binmap[idx2block (i)] & idx2bit (i))
 
+/*
+   Segregated lists
+
+    If glibc.malloc.tlsf is set, chunks of large bin sizes are not
+    kept in the sorted large bins, but in a two-level segregated-fit
+    index as in TLSF: the first level is the position of the highest
+    bit of the size, the second level splits each power of two into
+    TLSF_SL_COUNT lists of equal width.  The lists are not sorted, and
+    two levels of bitmaps find the first non-empty list at or above a
+    given one, so that inserting, removing and finding a chunk take
+    bounded time whatever the number of free chunks.
+
+    The lists and their bitmaps are kept in a struct malloc_tlsf, which
+    only arenas created with the tunable set have, so that the other
+    arenas do not grow by its size.  Code walking all bins uses the
+    indices from NBINS on for the lists (see any_bin_at).  As for the
+    binmap, the bits of lists emptied by unlink_chunk are only cleared
+    when a search finds them empty.
+ */
+
+#define TLSF_SL_SHIFT     3
+#define TLSF_SL_COUNT     (1U << TLSF_SL_SHIFT)
+#define TLSF_FL_COUNT     24
+#define TLSF_NBINS        (TLSF_FL_COUNT * TLSF_SL_COUNT)
+
+/* First level of the smallest large chunk.  */
+#define TLSF_MIN_SHIFT \
+  ((int) (8 * sizeof (long) - 1 - __builtin_clzl (MIN_LARGE_SIZE)))
+
+/* Chunks freed into a list may be smaller than the sizes served from
+   it.  Number of chunks a request looks at in the list of its own
+   size before moving to the next list, in which all chunks fit.  */
+#define TLSF_SCAN         8
+
+/* Return the index of the list of chunks of SIZE bytes, which must be
+   outside the small bin range.  Sizes beyond the last first level go
+   to the last list.  */
+static __always_inline unsigned int
+tlsf_index (INTERNAL_SIZE_T size)
+{
+  int fl = 8 * sizeof (long) - 1 - __builtin_clzl (size);
+  if (fl >= TLSF_MIN_SHIFT + TLSF_FL_COUNT)
+    return TLSF_NBINS - 1;
+  return ((fl - TLSF_MIN_SHIFT) << TLSF_SL_SHIFT)
+	 + ((size >> (fl - TLSF_SL_SHIFT)) & (TLSF_SL_COUNT - 1));
+}
+
+struct malloc_tlsf
+{
+  /* The lists, packed like the normal bins.  */
+  mchunkptr bins[TLSF_NBINS * 2];
+
+  /* Bit I of flmap is set if slmap[I] may be nonzero.  */
+  unsigned int flmap;
+  unsigned int slmap[TLSF_FL_COUNT];
+};
+
+#define tlsf_bin_at(m, i) \
+  (mbinptr) (((char *) &((m)->tlsf->bins[(i) * 2]))			      \
+             - offsetof (struct malloc_chunk, fd))
+
+#define mark_tlsf(m, i)						      \
+  ((m)->tlsf->slmap[(i) >> TLSF_SL_SHIFT] |= 1U << ((i) % TLSF_SL_COUNT),     \
+   (m)->tlsf->flmap |= 1U << ((i) >> TLSF_SL_SHIFT))
+
+/* Bin I of M, where the indices from NBINS on designate the segregated
+   lists, and the number of such indices of M.  */
+#define any_bin_at(m, i) \
+  ((i) < NBINS ? bin_at (m, i) : tlsf_bin_at (m, (i) - NBINS))
+#define all_bins(m)  (NBINS + ((m)->tlsf != NULL ? TLSF_NBINS : 0))
+
 /*
    Fastbins
 
@@ -1742,6 +1849,22 @@ typedef struct malloc_chunk *mfastbinptr;
 
 #define FASTBIN_CONSOLIDATION_THRESHOLD  (65536UL)
 
+/*
+   REMOTE_FREE_MAX is the number of chunks threads not attached to an
+   arena may queue on it without taking its lock.  Once the queue is
+   full, they fall back to taking the arena lock, which also drains the
+   queue.  This bounds the memory held in the queue of an arena that
+   no thread allocates from any more.
+
+   A queued chunk is still in use as far as its neighbours are
+   concerned, so the checks of _int_free_merge_chunk cannot detect a
+   second free of it.  Queued chunks are marked by pointing their bk
+   field at the queue, and a chunk carrying the mark is freed under the
+   arena lock after draining the queue, where a double free is caught.
+ */
+
+#define REMOTE_FREE_MAX 64
+
 /*
    NONCONTIGUOUS_BIT indicates that MORECORE does not return contiguous
    regions.  Otherwise, contiguity is exploited in merging together,
@@ -1758,6 +1881,17 @@ typedef struct malloc_chunk *mfastbinptr;
 #define set_noncontiguous(M)   ((M)->flags |= NONCONTIGUOUS_BIT)
 #define set_contiguous(M)      ((M)->flags &= ~NONCONTIGUOUS_BIT)
 
+/*
+   USER_ARENA_BIT marks the arenas created by malloc_arena_create.  All
+   the memory of such an arena is released at once by
+   malloc_arena_destroy, so its chunks are never put into a thread
+   cache and are never allocated with mmap.
+ */
+
+#define USER_ARENA_BIT        (4U)
+
+#define user_arena(M)          (((M)->flags & USER_ARENA_BIT) != 0)
+
 /* Maximum size of memory handled in fastbins.  */
 static uint8_t global_max_fast;
 
@@ -1803,6 +1937,25 @@ get_max_fast (void)
  */
 
 
+/* Statistics of an arena, reported by malloc_stats_snapshot, which
+   reads them with relaxed atomic loads without taking the arena
+   lock.  */
+struct malloc_arena_counters
+{
+  /* Updated with the arena lock held (see arena_stat_add).  */
+  INTERNAL_SIZE_T allocs;
+  INTERNAL_SIZE_T alloc_bytes;
+  INTERNAL_SIZE_T frees;
+  INTERNAL_SIZE_T free_bytes;
+  INTERNAL_SIZE_T slow_path;
+
+  /* Updated with atomic read-modify-write operations, without the
+     arena lock.  */
+  INTERNAL_SIZE_T fast_frees;
+  INTERNAL_SIZE_T fast_free_bytes;
+  INTERNAL_SIZE_T contentions;
+};
+
 struct malloc_state
 {
   /* Serialize access.  */
@@ -1815,6 +1968,13 @@ struct malloc_state
   /* Note this is a bool but not all targets support atomics on booleans.  */
   int have_fastchunks;
 
+  /* Chunks freed by threads not attached to this arena, linked through
+     fd, and waiting to be merged into the bins by a thread holding
+     the lock (see remote_free_push).  */
+  mchunkptr remote_free;
+  /* Approximate number of chunks in remote_free.  */
+  unsigned int remote_free_count;
+
   /* Fastbins */
   mfastbinptr fastbinsY[NFASTBINS];
 
@@ -1830,6 +1990,10 @@ struct malloc_state
   /* Bitmap of bins */
   unsigned int binmap[BINMAPSIZE];
 
+  /* The segregated lists, or NULL if glibc.malloc.tlsf was not set when
+     the arena was created.  */
+  struct malloc_tlsf *tlsf;
+
   /* Linked list */
   struct malloc_state *next;
 
@@ -1845,6 +2009,32 @@ struct malloc_state
   /* Memory allocated from the system in this arena.  */
   INTERNAL_SIZE_T system_mem;
   INTERNAL_SIZE_T max_system_mem;
+
+  /* Part of system_mem in naturally aligned huge pages, maintained by
+     arena_update_huge_mem if huge pages are enabled.  */
+  INTERNAL_SIZE_T huge_mem;
+
+  /* NUMA node whose threads this arena serves, or -1 if it is not
+     tied to a node.  Set before the arena is published and never
+     changed afterwards.  */
+  int numa_node;
+
+  /* Decay purging state, used if mp_.decay_ms is nonzero: the current
+     time in milliseconds, the time of the next purge step, the next
+     bin to scan and the number of chunks at its tail which the
+     previous step has scanned already.  */
+  uint64_t decay_now;
+  uint64_t decay_next;
+  unsigned int decay_bin;
+  unsigned int decay_skip;
+
+  /* Statistics for malloc_stats_snapshot.  */
+  struct malloc_arena_counters stats;
+
+#if USE_SLAB
+  /* Slabs of this arena with free slots, per size class.  */
+  struct slab *slab_partial[SLAB_NCLASSES];
+#endif
 };
 
 struct malloc_par
@@ -1855,6 +2045,25 @@ struct malloc_par
   INTERNAL_SIZE_T mmap_threshold;
   INTERNAL_SIZE_T arena_test;
   INTERNAL_SIZE_T arena_max;
+  /* Nonzero if arenas are selected by the CPU the thread runs on.  */
+  int percpu;
+  /* Nonzero if threads prefer the arenas of the NUMA node they run
+     on.  */
+  int numa;
+  /* Number of nodes of the simulated NUMA topology, or 0 to use the
+     topology of the system.  */
+  size_t numa_nodes;
+  /* Milliseconds after which the pages of free chunks are purged, or
+     0 to never purge them.  */
+  size_t decay_ms;
+  /* Mean number of bytes allocated between two samples of the heap
+     profiler, or 0 if the profiler is disabled.  */
+  size_t profile_sample_bytes;
+  /* Nonzero if small requests are served from slabs.  */
+  int slab;
+  /* Nonzero if large free chunks are kept in the segregated lists
+     instead of the large bins.  */
+  int tlsf;
 
 #if HAVE_TUNABLES
   /* Transparent Large Page support.  */
@@ -1890,6 +2099,22 @@ struct malloc_par
   /* Maximum number of chunks to remove from the unsorted list, which
      aren't used to prefill the cache.  */
   size_t tcache_unsorted_limit;
+  /* Number of chunks to move between the cache and the arena at once.  */
+  size_t tcache_batch;
+  /* Nonzero once an mmapped chunk small enough for the tcache has been
+     allocated.  Until then, free_sized can find the tcache bin of a
+     chunk without reading its header.  */
+  int tcache_small_mmapped;
+  /* Nonzero once a user arena has been created.  From then on,
+     free_sized has to read the chunk header to keep the chunks of user
+     arenas out of the tcache.  */
+  int user_arenas;
+  /* Number of large bins in use, the per-thread limit of the size of
+     the chunks in them, and the maximum number of chunks per large
+     bin.  */
+  size_t tcache_large_bins;
+  size_t tcache_large_budget;
+  size_t tcache_large_count;
 #endif
 };
 
@@ -1921,10 +2146,173 @@ static struct malloc_par mp_ =
   .tcache_count = TCACHE_FILL_COUNT,
   .tcache_bins = TCACHE_MAX_BINS,
   .tcache_max_bytes = tidx2usize (TCACHE_MAX_BINS-1),
-  .tcache_unsorted_limit = 0 /* No limit.  */
+  .tcache_unsorted_limit = 0, /* No limit.  */
+  .tcache_batch = TCACHE_BATCH_COUNT,
+  .tcache_large_budget = TCACHE_LARGE_BUDGET,
+  .tcache_large_count = TCACHE_FILL_COUNT
 #endif
 };
 
+/* Helpers for decay purging, see decay_purge.  */
+
+/* Chunks smaller than this are never purged.  */
+#define DECAY_MIN_SIZE (2 * GLRO (dl_pagesize))
+
+/* Number of purge steps per decay period.  */
+#define DECAY_STEPS 16
+
+/* Maximum number of chunks examined, and of bytes purged, in a single
+   step.  */
+#define DECAY_SCAN_MAX 64
+#define DECAY_PURGE_MAX (4 * 1024 * 1024)
+
+#ifndef MADV_FREE
+# define MADV_FREE MADV_DONTNEED
+#endif
+
+/* Time of a purged chunk.  */
+#define DECAY_PURGED UINT64_MAX
+
+#define decay_time(p) \
+  (*(uint64_t *) ((char *) (p) + sizeof (struct malloc_chunk)))
+
+/* Record that chunk P of SIZE bytes has just been freed.  */
+static __always_inline void
+decay_stamp (mstate av, mchunkptr p, INTERNAL_SIZE_T size)
+{
+  if (mp_.decay_ms != 0 && size >= DECAY_MIN_SIZE)
+    decay_time (p) = av->decay_now;
+}
+
+/* Record that REMAINDER of REMAINDER_SIZE bytes was split off the free
+   chunk VICTIM.  */
+static __always_inline void
+decay_split (mchunkptr victim, mchunkptr remainder,
+	     INTERNAL_SIZE_T remainder_size)
+{
+  if (mp_.decay_ms != 0 && remainder_size >= DECAY_MIN_SIZE)
+    decay_time (remainder) = decay_time (victim);
+}
+
+/* Add N to the statistics counter FIELD of arena AV.  The counter is
+   only written by the thread holding the lock of AV, so it does not
+   need an atomic read-modify-write operation.  */
+#define arena_stat_add(av, field, n) \
+  atomic_store_relaxed (&(av)->stats.field, (av)->stats.field + (n))
+
+/* Record that a chunk of SIZE bytes was taken from the bins or the top
+   chunk of AV.  */
+static __always_inline void
+arena_stats_alloc (mstate av, INTERNAL_SIZE_T size)
+{
+  arena_stat_add (av, allocs, 1);
+  arena_stat_add (av, alloc_bytes, size);
+}
+
+/* Record that an mmapped chunk is used for a request of NB bytes,
+   including the overhead.  free_sized derives the tcache bin from the
+   request size, so it must not be passed such a chunk if NB is small,
+   even though the chunk itself is at least a page.  */
+static __always_inline void
+note_mmapped_chunk (INTERNAL_SIZE_T nb)
+{
+#if USE_TCACHE
+  if (csize2tidx (nb) < TCACHE_MAX_BINS
+      && !atomic_load_relaxed (&mp_.tcache_small_mmapped))
+    atomic_store_relaxed (&mp_.tcache_small_mmapped, 1);
+#endif
+}
+
+/* Put the free chunk P of SIZE bytes, which is outside the small bin
+   range, at the head of its segregated list.  */
+static void
+tlsf_insert (mstate av, mchunkptr p, INTERNAL_SIZE_T size)
+{
+  unsigned int idx = tlsf_index (size);
+  mbinptr bck = tlsf_bin_at (av, idx);
+  mchunkptr fwd = bck->fd;
+  if (__glibc_unlikely (fwd->bk != bck))
+    malloc_printerr ("malloc(): corrupted segregated list");
+  p->fd = fwd;
+  p->bk = bck;
+  p->fd_nextsize = NULL;
+  p->bk_nextsize = NULL;
+  bck->fd = p;
+  fwd->bk = p;
+  mark_tlsf (av, idx);
+}
+
+/* Return the size of chunk P, taken from segregated list IDX of AV,
+   after checking that it belongs there.  */
+static __always_inline INTERNAL_SIZE_T
+tlsf_chunksize (mstate av, mchunkptr p, unsigned int idx)
+{
+  INTERNAL_SIZE_T size = chunksize (p);
+  if (__glibc_unlikely (in_smallbin_range (size) || size > av->system_mem
+			|| tlsf_index (size) != idx))
+    malloc_printerr ("malloc(): invalid size (segregated list)");
+  return size;
+}
+
+/* Remove a chunk of at least NB bytes from the segregated lists of AV
+   and return it, or return NULL if there is none.  */
+static mchunkptr
+tlsf_take (mstate av, INTERNAL_SIZE_T nb)
+{
+  unsigned int idx = 0;
+  if (!in_smallbin_range (nb))
+    {
+      idx = tlsf_index (nb);
+      mbinptr bin = tlsf_bin_at (av, idx);
+      /* The last list has no upper bound, so it is searched fully.  */
+      int n = 0;
+      for (mchunkptr p = first (bin);
+	   p != bin && (n < TLSF_SCAN || idx == TLSF_NBINS - 1);
+	   p = p->fd, ++n)
+	if (tlsf_chunksize (av, p, idx) >= nb)
+	  {
+	    unlink_chunk (av, p);
+	    return p;
+	  }
+      if (++idx == TLSF_NBINS)
+	return NULL;
+    }
+
+  unsigned int fl = idx >> TLSF_SL_SHIFT;
+  unsigned int slmap = av->tlsf->slmap[fl] & (~0U << (idx % TLSF_SL_COUNT));
+  for (;;)
+    {
+      while (slmap == 0)
+	{
+	  /* No list at or above IDX in this first level.  */
+	  if (av->tlsf->slmap[fl] == 0)
+	    av->tlsf->flmap &= ~(1U << fl);
+	  unsigned int flmap = av->tlsf->flmap & (~0U << fl) & ~(1U << fl);
+	  if (flmap == 0)
+	    return NULL;
+	  fl = __builtin_ctz (flmap);
+	  slmap = av->tlsf->slmap[fl];
+	}
+
+      unsigned int sl = __builtin_ctz (slmap);
+      idx = (fl << TLSF_SL_SHIFT) + sl;
+      mbinptr bin = tlsf_bin_at (av, idx);
+      mchunkptr p = first (bin);
+      if (p != bin)
+	{
+	  tlsf_chunksize (av, p, idx);
+	  unlink_chunk (av, p);
+	  if (first (bin) == bin)
+	    av->tlsf->slmap[fl] &= ~(1U << sl);
+	  return p;
+	}
+
+      /* A false alarm; clear the bit.  */
+      av->tlsf->slmap[fl] &= ~(1U << sl);
+      slmap &= ~(1U << sl);
+    }
+}
+
 /*
    Initialize a malloc_state struct.
 
@@ -1938,10 +2326,10 @@ malloc_init_state (mstate av)
   int i;
   mbinptr bin;
 
-  /* Establish circular links for normal bins */
-  for (i = 1; i < NBINS; ++i)
+  /* Establish circular links for normal bins and segregated lists */
+  for (i = 1; i < all_bins (av); ++i)
     {
-      bin = bin_at (av, i);
+      bin = any_bin_at (av, i);
       bin->fd = bin->bk = bin;
     }
 
@@ -1952,10 +2340,32 @@ malloc_init_state (mstate av)
   if (av == &main_arena)
     set_max_fast (DEFAULT_MXFAST);
   atomic_store_relaxed (&av->have_fastchunks, false);
+  av->numa_node = -1;
 
   av->top = initial_top (av);
 }
 
+/* Give the main arena, which is initialized before the tunables are
+   read, its segregated lists.  The other arenas have them in their
+   first heap (see alloc_new_arena).  */
+static void
+tlsf_init_main_arena (void)
+{
+  void *p = MMAP (NULL, sizeof (struct malloc_tlsf), PROT_READ | PROT_WRITE, 0);
+  if (p == MAP_FAILED)
+    {
+      mp_.tlsf = 0;
+      return;
+    }
+
+  main_arena.tlsf = p;
+  for (unsigned int i = 0; i < TLSF_NBINS; ++i)
+    {
+      mbinptr bin = tlsf_bin_at (&main_arena, i);
+      bin->fd = bin->bk = bin;
+    }
+}
+
 /*
    Other internal utilities operating on mstates
  */
@@ -1970,6 +2380,18 @@ static void     malloc_consolidate (mstate);
 /* This function is called from the arena shutdown hook, to free the
    thread cache (if it exists).  */
 static void tcache_thread_shutdown (void);
+#if USE_TCACHE
+/* Protects the list of thread caches used by malloc_stats_snapshot.  */
+__libc_lock_define_initialized (static, tcache_list_lock);
+static void tcache_list_fork_child (void);
+#endif
+#if USE_SLAB
+/* Protects the slab region, see slab.c.  */
+__libc_lock_define_initialized (static, slab_lock);
+struct tcache_perthread_struct;
+static void slab_init (void);
+static void slab_thread_shutdown (struct tcache_perthread_struct *);
+#endif
 
 /* ------------------ Testing support ----------------------------------*/
 
@@ -2017,6 +2439,11 @@ madvise_thp (void *p, INTERNAL_SIZE_T size)
 #endif
 }
 
+/* ------------------------ Heap profiling ---------------------------- */
+#if IS_IN (libc)
+# include "profile.c"
+#endif
+
 /* ------------------- Support for multiple arenas -------------------- */
 #include "arena.c"
 
@@ -2371,6 +2798,29 @@ do_check_malloc_state (mstate av)
         }
     }
 
+  /* check segregated lists */
+  for (i = 0; i < all_bins (av) - NBINS; ++i)
+    {
+      b = tlsf_bin_at (av, i);
+
+      /* a list with chunks has its bits set */
+      if (last (b) != b)
+        {
+          assert (av->tlsf->flmap & (1U << (i >> TLSF_SL_SHIFT)));
+          assert (av->tlsf->slmap[i >> TLSF_SL_SHIFT]
+                  & (1U << (i % TLSF_SL_COUNT)));
+        }
+
+      for (p = last (b); p != b; p = p->bk)
+        {
+          do_check_free_chunk (av, p);
+          size = chunksize (p);
+          total += size;
+          assert (tlsf_index (size) == i);
+          assert (p->fd_nextsize == NULL && p->bk_nextsize == NULL);
+        }
+    }
+
   /* top chunk is OK */
   check_chunk (av, av->top);
 }
@@ -2460,6 +2910,7 @@ sysmalloc_mmap (INTERNAL_SIZE_T nb, size_t pagesize, int extra_flags, mstate av)
       set_prev_size (p, 0);
       set_head (p, size | IS_MMAPPED);
     }
+  note_mmapped_chunk (nb);
 
   /* update statistics */
   int new = atomic_fetch_add_relaxed (&mp_.n_mmaps, 1) + 1;
@@ -2554,7 +3005,8 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
 
   if (av == NULL
       || ((unsigned long) (nb) >= (unsigned long) (mp_.mmap_threshold)
-	  && (mp_.n_mmaps < mp_.n_mmaps_max)))
+	  && (mp_.n_mmaps < mp_.n_mmaps_max)
+	  && !user_arena (av)))
     {
       char *mm;
 #if HAVE_TUNABLES
@@ -2614,7 +3066,8 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
           set_head (old_top, (((char *) old_heap + old_heap->size) - (char *) old_top)
                     | PREV_INUSE);
         }
-      else if ((heap = new_heap (nb + (MINSIZE + sizeof (*heap)), mp_.top_pad)))
+      else if ((heap = new_heap (nb + (MINSIZE + sizeof (*heap)), mp_.top_pad,
+			       av->numa_node)))
         {
           /* Use a newly allocated heap.  */
           heap->ar_ptr = av;
@@ -2646,7 +3099,7 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
               set_foot (old_top, (old_size + CHUNK_HDR_SZ));
             }
         }
-      else if (!tried_mmap)
+      else if (!tried_mmap && !user_arena (av))
 	{
 	  /* We can at least try to use to mmap memory.  If new_heap fails
 	     it is unlikely that trying to allocate huge pages will
@@ -2916,6 +3369,7 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
 
   if ((unsigned long) av->system_mem > (unsigned long) (av->max_system_mem))
     av->max_system_mem = av->system_mem;
+  arena_update_huge_mem (av);
   check_malloc_state (av);
 
   /* finally, do the allocation */
@@ -3007,6 +3461,7 @@ systrim (size_t pad, mstate av)
               /* Success. Adjust top. */
               av->system_mem -= released;
               set_head (av->top, (top_size - released) | PREV_INUSE);
+              arena_update_huge_mem (av);
               check_malloc_state (av);
               return 1;
             }
@@ -3115,11 +3570,53 @@ typedef struct tcache_perthread_struct
 {
   uint16_t counts[TCACHE_MAX_BINS];
   tcache_entry *entries[TCACHE_MAX_BINS];
+
+  /* Statistics for malloc_stats_snapshot.  They are only written by
+     the thread owning the cache, and read by other threads with
+     relaxed atomic loads.  */
+  struct tcache_bin_counters
+  {
+    size_t allocs;
+    size_t frees;
+    size_t misses;
+  } stats[TCACHE_MAX_BINS];
+
+  /* Links in the list of all thread caches, protected by
+     tcache_list_lock.  */
+  struct tcache_perthread_struct *list_next;
+  struct tcache_perthread_struct *list_prev;
+
+  /* Chunks larger than the regular bins can hold, see
+     tcache_large_put.  LARGE_BYTES is the total size of the chunks in
+     LARGE_ENTRIES.  */
+  uint16_t large_counts[TCACHE_LARGE_BINS];
+  tcache_entry *large_entries[TCACHE_LARGE_BINS];
+  size_t large_bytes;
+
+#if USE_SLAB
+  /* Free slots of the slab size classes.  */
+  uint16_t slab_counts[SLAB_NCLASSES];
+  tcache_entry *slab_entries[SLAB_NCLASSES];
+#endif
 } tcache_perthread_struct;
 
 static __thread bool tcache_shutting_down = false;
 static __thread tcache_perthread_struct *tcache = NULL;
 
+/* All thread caches, and the statistics of the threads which have
+   exited.  Protected by tcache_list_lock.  */
+static tcache_perthread_struct *tcache_list;
+static struct tcache_bin_counters tcache_exited_stats[TCACHE_MAX_BINS];
+
+_Static_assert (TCACHE_MAX_BINS <= MALLOC_STATS_TCACHE_BINS,
+		"struct malloc_stats has room for all tcache bins");
+
+/* Add 1 to the statistics counter FIELD of tcache bin TC_IDX of the
+   current thread.  */
+#define tcache_stat_inc(tc_idx, field) \
+  atomic_store_relaxed (&tcache->stats[tc_idx].field, \
+			tcache->stats[tc_idx].field + 1)
+
 /* Process-wide key to try and catch a double-free in the same thread.  */
 static uintptr_t tcache_key;
 
@@ -3175,6 +3672,251 @@ tcache_get (size_t tc_idx)
   return (void *) e;
 }
 
+/* Return the smallest chunk size in large bin IDX.  The first large
+   bin starts at 1280 bytes, above the chunks of the last regular bin,
+   and there are four bins per power of two.  */
+static __always_inline size_t
+tcache_large_size (size_t idx)
+{
+  size_t n = idx + 1;
+  return (size_t) (4 + n % 4) << (n / 4 + 8);
+}
+
+/* Return the index of the large bin for a free chunk of SIZE bytes,
+   which must be at least tcache_large_size (0).  */
+static __always_inline size_t
+tcache_large_floor (size_t size)
+{
+  int k = sizeof (unsigned long) * CHAR_BIT - 1 - __builtin_clzl (size);
+  return (k - 10) * 4 + ((size >> (k - 2)) & 3) - 1;
+}
+
+/* Return the index of the first large bin whose chunks all have at
+   least NB bytes, which must be larger than the chunks of the regular
+   bins.  */
+static __always_inline size_t
+tcache_large_ceil (size_t nb)
+{
+  return tcache_large_floor (nb - 1) + 1;
+}
+
+/* Caller must ensure that large bin IDX is not empty.  */
+static __always_inline void *
+tcache_large_get (size_t idx)
+{
+  tcache_entry *e = tcache->large_entries[idx];
+  if (__glibc_unlikely (!aligned_OK (e)))
+    malloc_printerr ("malloc(): unaligned tcache chunk detected");
+  tcache->large_entries[idx] = REVEAL_PTR (e->next);
+  --tcache->large_counts[idx];
+  tcache->large_bytes -= chunksize (mem2chunk (e));
+  e->key = 0;
+  return (void *) e;
+}
+
+/* Unlink and return the first entry of the tcache list at *HEAD whose
+   address is a multiple of ALIGNMENT, or NULL if there is none.  The
+   caller updates the count of the bin.  */
+static tcache_entry *
+tcache_take_aligned (tcache_entry **head, size_t alignment)
+{
+  tcache_entry *prev = NULL;
+  for (tcache_entry *e = *head; e != NULL; prev = e, e = REVEAL_PTR (e->next))
+    {
+      if (__glibc_unlikely (!aligned_OK (e)))
+	malloc_printerr ("malloc(): unaligned tcache chunk detected");
+      if (((uintptr_t) e & (alignment - 1)) == 0)
+	{
+	  tcache_entry *next = REVEAL_PTR (e->next);
+	  if (prev == NULL)
+	    *head = next;
+	  else
+	    prev->next = PROTECT_PTR (&prev->next, next);
+	  e->key = 0;
+	  return e;
+	}
+    }
+  return NULL;
+}
+
+/* Return a cached chunk of at least NB bytes whose user memory is
+   aligned to ALIGNMENT, or NULL.  Chunks of aligned allocations are
+   cached by size like all others once they are freed, so scanning the
+   bin usually finds them again.  _int_memalign leaves a chunk one bin
+   larger than NB if the trailing space is too small to be split off,
+   so the next bin is scanned as well.  */
+static void *
+tcache_get_aligned (size_t nb, size_t alignment)
+{
+  size_t tc_idx = csize2tidx (nb);
+  tcache_entry *e = NULL;
+  if (tc_idx < mp_.tcache_bins)
+    {
+      for (size_t i = tc_idx; i <= tc_idx + 1 && i < mp_.tcache_bins; ++i)
+	if (tcache->counts[i] > 0)
+	  {
+	    e = tcache_take_aligned (&tcache->entries[i], alignment);
+	    if (e != NULL)
+	      {
+		--tcache->counts[i];
+		tcache_stat_inc (i, allocs);
+		return e;
+	      }
+	  }
+      tcache_stat_inc (tc_idx, misses);
+      return NULL;
+    }
+  else if (tc_idx >= TCACHE_MAX_BINS && mp_.tcache_large_bins > 0)
+    {
+      size_t idx = tcache_large_ceil (nb);
+      if (idx >= mp_.tcache_large_bins || tcache->large_counts[idx] == 0)
+	return NULL;
+      e = tcache_take_aligned (&tcache->large_entries[idx], alignment);
+      if (e == NULL)
+	return NULL;
+      --tcache->large_counts[idx];
+      tcache->large_bytes -= chunksize (mem2chunk (e));
+    }
+  return e;
+}
+
+/* Try to cache chunk P of SIZE bytes, which may be mmapped, in a large
+   bin.  Return false if the chunk does not belong to a large bin in
+   use, or if the bin or the budget of the thread is full.  */
+static bool
+tcache_large_put (mchunkptr p, INTERNAL_SIZE_T size)
+{
+  if (mp_.tcache_large_bins == 0 || tcache == NULL
+      || size < tcache_large_size (0))
+    return false;
+  size_t idx = tcache_large_floor (size);
+  if (idx >= mp_.tcache_large_bins)
+    return false;
+
+  tcache_entry *e = (tcache_entry *) chunk2mem (p);
+  if (__glibc_unlikely (e->key == tcache_key))
+    for (tcache_entry *tmp = tcache->large_entries[idx]; tmp != NULL;
+	 tmp = REVEAL_PTR (tmp->next))
+      {
+	if (__glibc_unlikely (!aligned_OK (tmp)))
+	  malloc_printerr ("free(): unaligned chunk detected in tcache 2");
+	if (tmp == e)
+	  malloc_printerr ("free(): double free detected in tcache 2");
+      }
+
+  /* The bin may hold at least one chunk, even one larger than its
+     share of the budget.  */
+  size_t budget = mp_.tcache_large_budget;
+  size_t count = tcache->large_counts[idx];
+  if (tcache->large_bytes + size > budget
+      || (count > 0 && (count + 1) * size > budget / 4)
+      || count >= mp_.tcache_large_count)
+    return false;
+
+  e->key = tcache_key;
+  e->next = PROTECT_PTR (&e->next, tcache->large_entries[idx]);
+  tcache->large_entries[idx] = e;
+  tcache->large_counts[idx] = count + 1;
+  tcache->large_bytes += size;
+  return true;
+}
+
+/* Called with the lock of AV held after a tcache miss for bin TC_IDX
+   was served by _int_malloc (AV, BYTES), or by _int_memalign (AV,
+   ALIGNMENT, BYTES) if ALIGNMENT is not zero.  Allocate further chunks
+   of the same size and alignment while the lock is held, so that the
+   next mp_.tcache_batch - 1 requests of this kind do not need to take
+   it.  */
+static void
+tcache_refill (mstate av, size_t alignment, size_t bytes, size_t tc_idx)
+{
+  for (size_t n = 1;
+       n < mp_.tcache_batch && tcache->counts[tc_idx] < mp_.tcache_count;
+       ++n)
+    {
+      void *mem = (alignment == 0 ? _int_malloc (av, bytes)
+		   : _int_memalign (av, alignment, bytes));
+      if (mem == NULL)
+	break;
+
+      mchunkptr p = mem2chunk (mem);
+      if (__glibc_unlikely (chunk_is_mmapped (p)))
+	{
+	  /* This only happens with a very low mmap threshold.  */
+	  munmap_chunk (p);
+	  break;
+	}
+      if (__glibc_unlikely (csize2tidx (chunksize (p)) != tc_idx))
+	{
+	  /* The chunk was not split because the remainder would have
+	     been too small, and it belongs to a larger bin.  */
+	  _int_free_chunk (av, p, chunksize (p), 1);
+	  break;
+	}
+      tcache_put (p, tc_idx);
+    }
+}
+
+/* Called when freeing P finds tcache bin TC_IDX full.  Put P into the
+   bin and release the mp_.tcache_batch least recently freed chunks of
+   the bin to their arenas, taking each arena lock once for a run of
+   chunks from the same arena.  The caller must not hold any arena
+   lock.  */
+static void
+tcache_flush (mchunkptr p, size_t tc_idx)
+{
+  size_t count = tcache->counts[tc_idx];
+  size_t n = MIN (mp_.tcache_batch, count);
+
+  /* Keep the most recently freed chunks, which are more likely to be
+     in the CPU cache, and cut the oldest N off the end of the bin.  */
+  tcache_entry *flush;
+  if (n == count)
+    {
+      flush = tcache->entries[tc_idx];
+      tcache->entries[tc_idx] = NULL;
+    }
+  else
+    {
+      tcache_entry *last = tcache->entries[tc_idx];
+      for (size_t i = 1; i < count - n; ++i)
+	{
+	  if (__glibc_unlikely (!aligned_OK (last)))
+	    malloc_printerr ("free(): unaligned chunk detected in tcache 3");
+	  last = REVEAL_PTR (last->next);
+	}
+      if (__glibc_unlikely (!aligned_OK (last)))
+	malloc_printerr ("free(): unaligned chunk detected in tcache 3");
+      flush = REVEAL_PTR (last->next);
+      last->next = PROTECT_PTR (&last->next, NULL);
+    }
+  tcache->counts[tc_idx] = count - n;
+  tcache_put (p, tc_idx);
+
+  mstate locked = NULL;
+  while (flush != NULL)
+    {
+      if (__glibc_unlikely (!aligned_OK (flush)))
+	malloc_printerr ("free(): unaligned chunk detected in tcache 3");
+      tcache_entry *next = REVEAL_PTR (flush->next);
+      flush->key = 0;
+
+      mchunkptr fp = mem2chunk (flush);
+      mstate av = arena_for_chunk (fp);
+      if (av != locked && !SINGLE_THREAD_P)
+	{
+	  if (locked != NULL)
+	    __libc_lock_unlock (locked->mutex);
+	  arena_mutex_lock (av);
+	  locked = av;
+	}
+      _int_free_chunk (av, fp, chunksize (fp), 1);
+      flush = next;
+    }
+  if (locked != NULL)
+    __libc_lock_unlock (locked->mutex);
+}
+
 static void
 tcache_thread_shutdown (void)
 {
@@ -3189,6 +3931,26 @@ tcache_thread_shutdown (void)
   /* Disable the tcache and prevent it from being reinitialized.  */
   tcache = NULL;
 
+  /* Keep the statistics of this thread after it exits.  */
+  __libc_lock_lock (tcache_list_lock);
+  for (i = 0; i < TCACHE_MAX_BINS; ++i)
+    {
+      tcache_exited_stats[i].allocs += tcache_tmp->stats[i].allocs;
+      tcache_exited_stats[i].frees += tcache_tmp->stats[i].frees;
+      tcache_exited_stats[i].misses += tcache_tmp->stats[i].misses;
+    }
+  if (tcache_tmp->list_prev != NULL)
+    tcache_tmp->list_prev->list_next = tcache_tmp->list_next;
+  else
+    tcache_list = tcache_tmp->list_next;
+  if (tcache_tmp->list_next != NULL)
+    tcache_tmp->list_next->list_prev = tcache_tmp->list_prev;
+  __libc_lock_unlock (tcache_list_lock);
+
+#if USE_SLAB
+  slab_thread_shutdown (tcache_tmp);
+#endif
+
   /* Free all of the entries and the tcache itself back to the arena
      heap for coalescing.  */
   for (i = 0; i < TCACHE_MAX_BINS; ++i)
@@ -3203,6 +3965,18 @@ tcache_thread_shutdown (void)
 	  __libc_free (e);
 	}
     }
+  for (i = 0; i < TCACHE_LARGE_BINS; ++i)
+    {
+      while (tcache_tmp->large_entries[i])
+	{
+	  tcache_entry *e = tcache_tmp->large_entries[i];
+	  if (__glibc_unlikely (!aligned_OK (e)))
+	    malloc_printerr ("tcache_thread_shutdown(): "
+			     "unaligned tcache chunk detected");
+	  tcache_tmp->large_entries[i] = REVEAL_PTR (e->next);
+	  __libc_free (e);
+	}
+    }
 
   __libc_free (tcache_tmp);
 }
@@ -3238,10 +4012,39 @@ tcache_init(void)
     {
       tcache = (tcache_perthread_struct *) victim;
       memset (tcache, 0, sizeof (tcache_perthread_struct));
+
+      __libc_lock_lock (tcache_list_lock);
+      tcache->list_next = tcache_list;
+      if (tcache_list != NULL)
+	tcache_list->list_prev = tcache;
+      tcache_list = tcache;
+      __libc_lock_unlock (tcache_list_lock);
     }
 
 }
 
+/* Called in the child after fork.  Only the thread cache of the
+   current thread is still in use, the others belong to threads which
+   do not exist in the child.  */
+static void
+tcache_list_fork_child (void)
+{
+  __libc_lock_init (tcache_list_lock);
+
+  for (tcache_perthread_struct *t = tcache_list; t != NULL; t = t->list_next)
+    if (t != tcache)
+      for (int i = 0; i < TCACHE_MAX_BINS; ++i)
+	{
+	  tcache_exited_stats[i].allocs += t->stats[i].allocs;
+	  tcache_exited_stats[i].frees += t->stats[i].frees;
+	  tcache_exited_stats[i].misses += t->stats[i].misses;
+	}
+
+  tcache_list = tcache;
+  if (tcache != NULL)
+    tcache->list_next = tcache->list_prev = NULL;
+}
+
 # define MAYBE_INIT_TCACHE() \
   if (__glibc_unlikely (tcache == NULL)) \
     tcache_init();
@@ -3257,7 +4060,28 @@ tcache_thread_shutdown (void)
 
 #endif /* !USE_TCACHE  */
 
+/* ---------------------------- Slab tier ----------------------------- */
+#include "slab.c"
+
 #if IS_IN (libc)
+/* Allocate BYTES bytes from the user arena AV, aligned to ALIGNMENT if
+   it is larger than MALLOC_ALIGNMENT.  */
+static void *
+user_arena_malloc (mstate av, size_t alignment, size_t bytes)
+{
+  void *victim;
+
+  arena_mutex_lock (av);
+  if (alignment <= MALLOC_ALIGNMENT)
+    victim = _int_malloc (av, bytes);
+  else
+    victim = _int_memalign (av, alignment, bytes);
+  __libc_lock_unlock (av->mutex);
+
+  assert (!victim || av == arena_for_chunk (mem2chunk (victim)));
+  return tag_new_usable (victim);
+}
+
 void *
 __libc_malloc (size_t bytes)
 {
@@ -3269,6 +4093,20 @@ __libc_malloc (size_t bytes)
 
   if (!__malloc_initialized)
     ptmalloc_init ();
+
+  if (__glibc_unlikely (thread_user_arena != NULL))
+    return user_arena_malloc (thread_user_arena, 0, bytes);
+
+  if (__glibc_unlikely (profile_due (bytes)))
+    return profile_record (__libc_malloc (bytes), bytes);
+
+  if (slab_wanted (bytes))
+    {
+      victim = slab_malloc (bytes);
+      if (victim != NULL)
+	return victim;
+    }
+
 #if USE_TCACHE
   /* int_free also calls request2size, be careful to not pad twice.  */
   size_t tbytes = checked_request2size (bytes);
@@ -3283,11 +4121,27 @@ __libc_malloc (size_t bytes)
 
   DIAG_PUSH_NEEDS_COMMENT;
   if (tc_idx < mp_.tcache_bins
-      && tcache
-      && tcache->counts[tc_idx] > 0)
+      && tcache)
+    {
+      if (tcache->counts[tc_idx] > 0)
+	{
+	  tcache_stat_inc (tc_idx, allocs);
+	  victim = tcache_get (tc_idx);
+	  return tag_new_usable (victim);
+	}
+      tcache_stat_inc (tc_idx, misses);
+    }
+  else if (tc_idx >= TCACHE_MAX_BINS && mp_.tcache_large_bins > 0 && tcache)
     {
-      victim = tcache_get (tc_idx);
-      return tag_new_usable (victim);
+      size_t idx = tcache_large_ceil (tbytes);
+      if (idx < mp_.tcache_large_bins)
+	{
+	  if (tcache->large_counts[idx] > 0)
+	    return tag_new_usable (tcache_large_get (idx));
+	  /* Allocate a chunk of the smallest size of the bin, so that
+	     it can serve all requests of the bin once it is freed.  */
+	  bytes = tcache_large_size (idx) - SIZE_SZ;
+	}
     }
   DIAG_POP_NEEDS_COMMENT;
 #endif
@@ -3312,6 +4166,12 @@ __libc_malloc (size_t bytes)
       victim = _int_malloc (ar_ptr, bytes);
     }
 
+#if USE_TCACHE
+  if (mp_.tcache_batch > 1 && victim != NULL && ar_ptr != NULL
+      && tc_idx < mp_.tcache_bins && tcache != NULL)
+    tcache_refill (ar_ptr, 0, bytes, tc_idx);
+#endif
+
   if (ar_ptr != NULL)
     __libc_lock_unlock (ar_ptr->mutex);
 
@@ -3337,8 +4197,17 @@ __libc_free (void *mem)
   if (__glibc_unlikely (mtag_enabled))
     *(volatile char *)mem;
 
+  profile_forget (mem);
+
   int err = errno;
 
+  if (slab_contains (mem))
+    {
+      slab_free (mem);
+      __set_errno (err);
+      return;
+    }
+
   p = mem2chunk (mem);
 
   if (chunk_is_mmapped (p))                       /* release mmapped memory. */
@@ -3354,8 +4223,16 @@ __libc_free (void *mem)
           LIBC_PROBE (memory_mallopt_free_dyn_thresholds, 2,
                       mp_.mmap_threshold, mp_.trim_threshold);
         }
-      munmap_chunk (p);
-    }
+#if USE_TCACHE
+      /* Tagged memory would have to be retagged first.  */
+      if (!mtag_enabled && tcache_large_put (p, chunksize (p)))
+	{
+	  __set_errno (err);
+	  return;
+	}
+#endif
+      munmap_chunk (p);
+    }
   else
     {
       MAYBE_INIT_TCACHE ();
@@ -3371,6 +4248,225 @@ __libc_free (void *mem)
 }
 libc_hidden_def (__libc_free)
 
+/* Try to put MEM, which was allocated with a request of SIZE bytes,
+   into the tcache without reading its chunk header, which is often no
+   longer in the CPU cache when an object is freed.  The chunk can be
+   larger than SIZE implies, in which case it is cached in a bin for
+   smaller chunks, which is harmless as long as it is less than MINSIZE
+   larger, which malloc, memalign and realloc ensure for requests of tcache
+   size.  This is only valid as long as no mmapped chunk has been used for
+   a request of tcache size (see note_mmapped_chunk).  Return false if the
+   chunk has to be freed by __libc_free.  */
+static __always_inline bool
+tcache_free_sized (void *mem, size_t size)
+{
+#if USE_TCACHE
+  if (slab_contains (mem)
+      || __glibc_unlikely (mtag_enabled)
+      || __glibc_unlikely (atomic_load_relaxed (&mp_.tcache_small_mmapped))
+      || __glibc_unlikely (atomic_load_relaxed (&mp_.user_arenas))
+      || size > mp_.tcache_max_bytes
+      || tcache == NULL
+      || __glibc_unlikely (!aligned_OK (mem)))
+    return false;
+
+  size_t tc_idx = csize2tidx (request2size (size));
+  tcache_entry *e = mem;
+  /* Leave the detection of double frees to _int_free.  */
+  if (tcache->counts[tc_idx] >= mp_.tcache_count
+      || __glibc_unlikely (e->key == tcache_key))
+    return false;
+
+  profile_forget (mem);
+  tcache_stat_inc (tc_idx, frees);
+  tcache_put (mem2chunk (mem), tc_idx);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+__libc_free_sized (void *mem, size_t size)
+{
+  if (mem != NULL && tcache_free_sized (mem, size))
+    return;
+  __libc_free (mem);
+}
+
+void
+__libc_free_aligned_sized (void *mem, size_t alignment, size_t size)
+{
+  /* The chunk of an aligned allocation is at least as large as for an
+     unaligned one of the same size.  */
+  if (mem != NULL && tcache_free_sized (mem, size))
+    return;
+  __libc_free (mem);
+}
+
+size_t
+__libc_malloc_bulk (size_t bytes, size_t n, void **ptrs)
+{
+  mstate ar_ptr;
+  size_t i = 0;
+
+  if (!__malloc_initialized)
+    ptmalloc_init ();
+
+  /* Let malloc handle the allocations which do not come from the
+     tcache or the current arena.  */
+  if (__glibc_unlikely (thread_user_arena != NULL
+			|| mp_.profile_sample_bytes != 0)
+      || slab_wanted (bytes))
+    {
+      for (; i < n; ++i)
+	if ((ptrs[i] = __libc_malloc (bytes)) == NULL)
+	  break;
+      return i;
+    }
+
+#if USE_TCACHE
+  size_t tbytes = checked_request2size (bytes);
+  if (tbytes == 0)
+    {
+      __set_errno (ENOMEM);
+      return 0;
+    }
+  size_t tc_idx = csize2tidx (tbytes);
+
+  MAYBE_INIT_TCACHE ();
+
+  if (tc_idx >= mp_.tcache_bins || tcache == NULL)
+    tc_idx = TCACHE_MAX_BINS;
+
+  for (; tc_idx < TCACHE_MAX_BINS && i < n && tcache->counts[tc_idx] > 0; ++i)
+    {
+      tcache_stat_inc (tc_idx, allocs);
+      ptrs[i] = tag_new_usable (tcache_get (tc_idx));
+    }
+  if (i == n)
+    return i;
+#endif
+
+  /* Allocate the other blocks under a single acquisition of the arena
+     lock.  */
+  bool locked = !SINGLE_THREAD_P;
+  if (locked)
+    arena_get (ar_ptr, bytes);
+  else
+    ar_ptr = &main_arena;
+
+  size_t first = i;
+  while (i < n)
+    {
+#if USE_TCACHE
+      /* The tcache bin is empty, as for a miss in malloc.  */
+      if (tc_idx < TCACHE_MAX_BINS)
+	tcache_stat_inc (tc_idx, misses);
+#endif
+      if ((ptrs[i] = _int_malloc (ar_ptr, bytes)) == NULL)
+	break;
+      ++i;
+#if USE_TCACHE
+      /* _int_malloc moves the other chunks of the size it finds in the
+	 bins to the tcache.  */
+      for (; tc_idx < TCACHE_MAX_BINS && i < n && tcache->counts[tc_idx] > 0;
+	   ++i)
+	{
+	  tcache_stat_inc (tc_idx, allocs);
+	  ptrs[i] = tcache_get (tc_idx);
+	}
+#endif
+    }
+
+  if (locked && ar_ptr != NULL)
+    __libc_lock_unlock (ar_ptr->mutex);
+
+  for (size_t j = first; j < i; ++j)
+    ptrs[j] = tag_new_usable (ptrs[j]);
+
+  /* After a failure, malloc retries with another arena.  */
+  for (; i < n; ++i)
+    if ((ptrs[i] = __libc_malloc (bytes)) == NULL)
+      break;
+  return i;
+}
+
+/* Number of blocks which free_bulk groups by arena at once.  */
+#define FREE_BULK_BATCH 64
+
+void
+__libc_free_bulk (size_t n, void **ptrs)
+{
+  mchunkptr chunks[FREE_BULK_BATCH];
+  mstate arenas[FREE_BULK_BATCH];
+
+  int err = errno;
+
+  while (n > 0)
+    {
+      size_t batch = MIN (n, FREE_BULK_BATCH);
+      size_t count = 0;
+
+      for (size_t i = 0; i < batch; ++i)
+	{
+	  void *mem = ptrs[i];
+	  if (mem == NULL)
+	    continue;
+
+	  /* Let free handle the blocks which do not belong to the bins
+	     of an arena.  */
+	  mchunkptr p = mem2chunk (mem);
+	  if (__glibc_unlikely (mtag_enabled) || slab_contains (mem)
+	      || chunk_is_mmapped (p))
+	    {
+	      __libc_free (mem);
+	      continue;
+	    }
+
+	  profile_forget (mem);
+	  MAYBE_INIT_TCACHE ();
+
+	  mstate av = arena_for_chunk (p);
+#if USE_TCACHE
+	  /* Chunks which fit into the tcache do not need the lock.  */
+	  size_t tc_idx = csize2tidx (chunksize (p));
+	  if (tcache != NULL && tc_idx < mp_.tcache_bins
+	      && tcache->counts[tc_idx] < mp_.tcache_count
+	      && !user_arena (av))
+	    {
+	      _int_free (av, p, 0);
+	      continue;
+	    }
+#endif
+	  chunks[count] = p;
+	  arenas[count] = av;
+	  ++count;
+	}
+
+      /* Free the other chunks, taking the lock of each arena once.  */
+      for (size_t i = 0; i < count; ++i)
+	{
+	  mstate av = arenas[i];
+	  if (av == NULL)
+	    continue;
+	  arena_mutex_lock (av);
+	  for (size_t j = i; j < count; ++j)
+	    if (arenas[j] == av)
+	      {
+		_int_free (av, chunks[j], 1);
+		arenas[j] = NULL;
+	      }
+	  __libc_lock_unlock (av->mutex);
+	}
+
+      ptrs += batch;
+      n -= batch;
+    }
+
+  __set_errno (err);
+}
+
 void *
 __libc_realloc (void *oldmem, size_t bytes)
 {
@@ -3398,13 +4494,38 @@ __libc_realloc (void *oldmem, size_t bytes)
   if (__glibc_unlikely (mtag_enabled))
     *(volatile char*) oldmem;
 
+  /* The profiler treats realloc as a free of OLDMEM followed by a new
+     allocation, even if the block does not move.  If realloc fails,
+     OLDMEM is no longer counted as live.  */
+  profile_forget (oldmem);
+  if (__glibc_unlikely (profile_due (bytes)))
+    return profile_record (__libc_realloc (oldmem, bytes), bytes);
+
+  if (slab_contains (oldmem))
+    return slab_realloc (oldmem, bytes);
+
   /* Return the chunk as is whenever possible, i.e. there's enough usable space
      but not so much that we end up fragmenting the block.  We use the trim
      threshold as the heuristic to decide the latter.  */
   size_t usable = musable (oldmem);
   if (bytes <= usable
       && (unsigned long) (usable - bytes) <= mp_.trim_threshold)
-    return oldmem;
+    {
+      mchunkptr p = mem2chunk (oldmem);
+      if (chunk_is_mmapped (p))
+	{
+	  note_mmapped_chunk (request2size (bytes));
+	  return oldmem;
+	}
+#if USE_TCACHE
+      /* free_sized puts the chunk into the tcache bin that BYTES implies
+	 (see tcache_free_sized), so leave a chunk for a request of tcache
+	 size no larger than _int_realloc would.  */
+      if (bytes > mp_.tcache_max_bytes
+	  || chunksize (p) < request2size (bytes) + MINSIZE)
+#endif
+	return oldmem;
+    }
 
   /* chunk corresponding to oldmem */
   const mchunkptr oldp = mem2chunk (oldmem);
@@ -3438,6 +4559,9 @@ __libc_realloc (void *oldmem, size_t bytes)
     {
       void *newmem;
 
+      /* The chunk may stay mmapped.  */
+      note_mmapped_chunk (nb);
+
 #if HAVE_MREMAP
       newp = mremap_chunk (oldp, nb);
       if (newp)
@@ -3474,7 +4598,7 @@ __libc_realloc (void *oldmem, size_t bytes)
       return newp;
     }
 
-  __libc_lock_lock (ar_ptr->mutex);
+  arena_mutex_lock (ar_ptr);
 
   newp = _int_realloc (ar_ptr, oldp, oldsize, nb);
 
@@ -3482,7 +4606,9 @@ __libc_realloc (void *oldmem, size_t bytes)
   assert (!newp || chunk_is_mmapped (mem2chunk (newp)) ||
           ar_ptr == arena_for_chunk (mem2chunk (newp)));
 
-  if (newp == NULL)
+  /* _int_realloc already tried the whole of a user arena, and its blocks
+     must not move to another one.  */
+  if (newp == NULL && !user_arena (ar_ptr))
     {
       /* Try harder to allocate memory in other arenas.  */
       LIBC_PROBE (memory_realloc_retry, 2, bytes, oldmem);
@@ -3542,6 +4668,41 @@ _mid_memalign (size_t alignment, size_t bytes, void *address)
       alignment = a;
     }
 
+  if (__glibc_unlikely (thread_user_arena != NULL))
+    return user_arena_malloc (thread_user_arena, alignment, bytes);
+
+  if (__glibc_unlikely (profile_due (bytes)))
+    return profile_record (_mid_memalign (alignment, bytes, address), bytes);
+
+#if USE_TCACHE
+  size_t tc_idx = TCACHE_MAX_BINS;
+  size_t nb = checked_request2size (bytes);
+  if (nb == 0)
+    {
+      __set_errno (ENOMEM);
+      return 0;
+    }
+
+  MAYBE_INIT_TCACHE ();
+
+  if (tcache != NULL)
+    {
+      p = tcache_get_aligned (nb, alignment);
+      if (p != NULL)
+	return tag_new_usable (p);
+
+      tc_idx = csize2tidx (nb);
+      if (tc_idx >= TCACHE_MAX_BINS && mp_.tcache_large_bins > 0)
+	{
+	  /* As in malloc, allocate the smallest chunk of the large
+	     bin, so that the chunk can be found again there.  */
+	  size_t idx = tcache_large_ceil (nb);
+	  if (idx < mp_.tcache_large_bins)
+	    bytes = tcache_large_size (idx) - SIZE_SZ;
+	}
+    }
+#endif
+
   if (SINGLE_THREAD_P)
     {
       p = _int_memalign (&main_arena, alignment, bytes);
@@ -3560,6 +4721,12 @@ _mid_memalign (size_t alignment, size_t bytes, void *address)
       p = _int_memalign (ar_ptr, alignment, bytes);
     }
 
+#if USE_TCACHE
+  if (mp_.tcache_batch > 1 && p != NULL && ar_ptr != NULL
+      && tc_idx < mp_.tcache_bins && tcache != NULL)
+    tcache_refill (ar_ptr, alignment, bytes, tc_idx);
+#endif
+
   if (ar_ptr != NULL)
     __libc_lock_unlock (ar_ptr->mutex);
 
@@ -3627,6 +4794,24 @@ __libc_calloc (size_t n, size_t elem_size)
   if (!__malloc_initialized)
     ptmalloc_init ();
 
+  if (__glibc_unlikely (thread_user_arena != NULL))
+    {
+      mem = user_arena_malloc (thread_user_arena, 0, sz);
+      if (mem == NULL)
+	return NULL;
+      return memset (mem, 0, sz);
+    }
+
+  if (__glibc_unlikely (profile_due (sz)))
+    return profile_record (__libc_calloc (n, elem_size), sz);
+
+  if (slab_wanted (sz))
+    {
+      mem = slab_malloc (sz);
+      if (mem != NULL)
+	return memset (mem, 0, sz);
+    }
+
   MAYBE_INIT_TCACHE ();
 
   if (SINGLE_THREAD_P)
@@ -3745,6 +4930,46 @@ __libc_calloc (size_t n, size_t elem_size)
 
   return mem;
 }
+libc_hidden_def (__libc_calloc)
+
+struct malloc_arena *
+__malloc_arena_create (unsigned int flags)
+{
+  if (flags != 0)
+    {
+      __set_errno (EINVAL);
+      return NULL;
+    }
+
+  if (!__malloc_initialized)
+    ptmalloc_init ();
+
+  mstate a = user_arena_create ();
+  if (a == NULL)
+    __set_errno (ENOMEM);
+  return (struct malloc_arena *) a;
+}
+
+void *
+__malloc_arena_alloc (struct malloc_arena *arena, size_t bytes)
+{
+  return user_arena_malloc ((mstate) arena, 0, bytes);
+}
+
+struct malloc_arena *
+__malloc_arena_set_thread_default (struct malloc_arena *arena)
+{
+  mstate old = thread_user_arena;
+  thread_user_arena = (mstate) arena;
+  return (struct malloc_arena *) old;
+}
+
+void
+__malloc_arena_destroy (struct malloc_arena *arena)
+{
+  if (arena != NULL)
+    user_arena_destroy ((mstate) arena);
+}
 #endif /* IS_IN (libc) */
 
 /*
@@ -3802,6 +5027,11 @@ _int_malloc (mstate av, size_t bytes)
       return p;
     }
 
+  /* Merge the chunks other threads freed to this arena, so that they
+     can be reused for this request.  */
+  remote_free_drain (av);
+  decay_tick (av);
+
   /*
      If the size qualifies as a fastbin, first check corresponding bin.
      This code is safe to execute even if av is not yet initialized, so we
@@ -3847,7 +5077,7 @@ _int_malloc (mstate av, size_t bytes)
 	      /* While we're here, if we see other chunks of the same size,
 		 stash them in the tcache.  */
 	      size_t tc_idx = csize2tidx (nb);
-	      if (tcache && tc_idx < mp_.tcache_bins)
+	      if (tcache && tc_idx < mp_.tcache_bins && !user_arena (av))
 		{
 		  mchunkptr tc_victim;
 
@@ -3865,10 +5095,12 @@ _int_malloc (mstate av, size_t bytes)
 			  if (__glibc_unlikely (tc_victim == NULL))
 			    break;
 			}
+		      arena_stats_alloc (av, nb);
 		      tcache_put (tc_victim, tc_idx);
 		    }
 		}
 #endif
+	      arena_stats_alloc (av, chunksize (victim));
 	      void *p = chunk2mem (victim);
 	      alloc_perturb (p, bytes);
 	      return p;
@@ -3905,7 +5137,7 @@ _int_malloc (mstate av, size_t bytes)
 	  /* While we're here, if we see other chunks of the same size,
 	     stash them in the tcache.  */
 	  size_t tc_idx = csize2tidx (nb);
-	  if (tcache && tc_idx < mp_.tcache_bins)
+	  if (tcache && tc_idx < mp_.tcache_bins && !user_arena (av))
 	    {
 	      mchunkptr tc_victim;
 
@@ -3922,11 +5154,13 @@ _int_malloc (mstate av, size_t bytes)
 		      bin->bk = bck;
 		      bck->fd = bin;
 
+		      arena_stats_alloc (av, nb);
 		      tcache_put (tc_victim, tc_idx);
 	            }
 		}
 	    }
 #endif
+          arena_stats_alloc (av, chunksize (victim));
           void *p = chunk2mem (victim);
           alloc_perturb (p, bytes);
           return p;
@@ -3967,7 +5201,7 @@ _int_malloc (mstate av, size_t bytes)
 #if USE_TCACHE
   INTERNAL_SIZE_T tcache_nb = 0;
   size_t tc_idx = csize2tidx (nb);
-  if (tcache && tc_idx < mp_.tcache_bins)
+  if (tcache && tc_idx < mp_.tcache_bins && !user_arena (av))
     tcache_nb = nb;
   int return_cached = 0;
 
@@ -4013,6 +5247,7 @@ _int_malloc (mstate av, size_t bytes)
               /* split and reattach remainder */
               remainder_size = size - nb;
               remainder = chunk_at_offset (victim, nb);
+              decay_split (victim, remainder, remainder_size);
               unsorted_chunks (av)->bk = unsorted_chunks (av)->fd = remainder;
               av->last_remainder = remainder;
               remainder->bk = remainder->fd = unsorted_chunks (av);
@@ -4028,6 +5263,7 @@ _int_malloc (mstate av, size_t bytes)
               set_foot (remainder, remainder_size);
 
               check_malloced_chunk (av, victim, nb);
+              arena_stats_alloc (av, chunksize (victim));
               void *p = chunk2mem (victim);
               alloc_perturb (p, bytes);
               return p;
@@ -4052,6 +5288,7 @@ _int_malloc (mstate av, size_t bytes)
 	      if (tcache_nb
 		  && tcache->counts[tc_idx] < mp_.tcache_count)
 		{
+		  arena_stats_alloc (av, size);
 		  tcache_put (victim, tc_idx);
 		  return_cached = 1;
 		  continue;
@@ -4060,6 +5297,7 @@ _int_malloc (mstate av, size_t bytes)
 		{
 #endif
               check_malloced_chunk (av, victim, nb);
+              arena_stats_alloc (av, chunksize (victim));
               void *p = chunk2mem (victim);
               alloc_perturb (p, bytes);
               return p;
@@ -4076,6 +5314,13 @@ _int_malloc (mstate av, size_t bytes)
               bck = bin_at (av, victim_index);
               fwd = bck->fd;
             }
+          else if (av->tlsf != NULL)
+            {
+              /* The segregated lists are not sorted.  */
+              victim_index = NBINS + tlsf_index (size);
+              bck = any_bin_at (av, victim_index);
+              fwd = bck->fd;
+            }
           else
             {
               victim_index = largebin_index (size);
@@ -4130,7 +5375,10 @@ _int_malloc (mstate av, size_t bytes)
                 victim->fd_nextsize = victim->bk_nextsize = victim;
             }
 
-          mark_bin (av, victim_index);
+          if (victim_index < NBINS)
+            mark_bin (av, victim_index);
+          else
+            mark_tlsf (av, victim_index - NBINS);
           victim->bk = bck;
           victim->fd = fwd;
           fwd->bk = victim;
@@ -4166,7 +5414,7 @@ _int_malloc (mstate av, size_t bytes)
          sorted order to find smallest that fits.  Use the skip list for this.
        */
 
-      if (!in_smallbin_range (nb))
+      if (!in_smallbin_range (nb) && av->tlsf == NULL)
         {
           bin = bin_at (av, idx);
 
@@ -4201,6 +5449,7 @@ _int_malloc (mstate av, size_t bytes)
               else
                 {
                   remainder = chunk_at_offset (victim, nb);
+                  decay_split (victim, remainder, remainder_size);
                   /* We cannot assume the unsorted list is empty and therefore
                      have to perform a complete insert here.  */
                   bck = unsorted_chunks (av);
@@ -4222,6 +5471,7 @@ _int_malloc (mstate av, size_t bytes)
                   set_foot (remainder, remainder_size);
                 }
               check_malloced_chunk (av, victim, nb);
+              arena_stats_alloc (av, chunksize (victim));
               void *p = chunk2mem (victim);
               alloc_perturb (p, bytes);
               return p;
@@ -4304,6 +5554,7 @@ _int_malloc (mstate av, size_t bytes)
               else
                 {
                   remainder = chunk_at_offset (victim, nb);
+                  decay_split (victim, remainder, remainder_size);
 
                   /* We cannot assume the unsorted list is empty and therefore
                      have to perform a complete insert here.  */
@@ -4330,6 +5581,7 @@ _int_malloc (mstate av, size_t bytes)
                   set_foot (remainder, remainder_size);
                 }
               check_malloced_chunk (av, victim, nb);
+              arena_stats_alloc (av, chunksize (victim));
               void *p = chunk2mem (victim);
               alloc_perturb (p, bytes);
               return p;
@@ -4337,6 +5589,57 @@ _int_malloc (mstate av, size_t bytes)
         }
 
     use_top:
+      /*
+         With glibc.malloc.tlsf, large chunks are in the segregated
+         lists rather than in the bins searched above.
+       */
+
+      if (av->tlsf != NULL && (victim = tlsf_take (av, nb)) != NULL)
+        {
+          size = chunksize (victim);
+          remainder_size = size - nb;
+
+          /* Exhaust */
+          if (remainder_size < MINSIZE)
+            {
+              set_inuse_bit_at_offset (victim, size);
+              if (av != &main_arena)
+                set_non_main_arena (victim);
+            }
+
+          /* Split */
+          else
+            {
+              remainder = chunk_at_offset (victim, nb);
+              decay_split (victim, remainder, remainder_size);
+              set_head (victim, nb | PREV_INUSE |
+                        (av != &main_arena ? NON_MAIN_ARENA : 0));
+              set_head (remainder, remainder_size | PREV_INUSE);
+              set_foot (remainder, remainder_size);
+
+              if (!in_smallbin_range (remainder_size))
+                tlsf_insert (av, remainder, remainder_size);
+              else
+                {
+                  bck = unsorted_chunks (av);
+                  fwd = bck->fd;
+                  if (__glibc_unlikely (fwd->bk != bck))
+                    malloc_printerr ("malloc(): corrupted unsorted chunks 4");
+                  remainder->bk = bck;
+                  remainder->fd = fwd;
+                  bck->fd = remainder;
+                  fwd->bk = remainder;
+                  if (in_smallbin_range (nb))
+                    av->last_remainder = remainder;
+                }
+            }
+          check_malloced_chunk (av, victim, nb);
+          arena_stats_alloc (av, chunksize (victim));
+          void *p = chunk2mem (victim);
+          alloc_perturb (p, bytes);
+          return p;
+        }
+
       /*
          If large enough, split off the chunk bordering the end of memory
          (held in av->top). Note that this is in accord with the best-fit
@@ -4368,6 +5671,7 @@ _int_malloc (mstate av, size_t bytes)
           set_head (remainder, remainder_size | PREV_INUSE);
 
           check_malloced_chunk (av, victim, nb);
+          arena_stats_alloc (av, chunksize (victim));
           void *p = chunk2mem (victim);
           alloc_perturb (p, bytes);
           return p;
@@ -4390,9 +5694,14 @@ _int_malloc (mstate av, size_t bytes)
        */
       else
         {
+          arena_stat_add (av, slow_path, 1);
           void *p = sysmalloc (nb, av);
           if (p != NULL)
-            alloc_perturb (p, bytes);
+            {
+              if (!chunk_is_mmapped (mem2chunk (p)))
+                arena_stats_alloc (av, chunksize (mem2chunk (p)));
+              alloc_perturb (p, bytes);
+            }
           return p;
         }
     }
@@ -4406,13 +5715,6 @@ static void
 _int_free (mstate av, mchunkptr p, int have_lock)
 {
   INTERNAL_SIZE_T size;        /* its size */
-  mfastbinptr *fb;             /* associated fastbin */
-  mchunkptr nextchunk;         /* next contiguous chunk */
-  INTERNAL_SIZE_T nextsize;    /* its size */
-  int nextinuse;               /* true if nextchunk is used */
-  INTERNAL_SIZE_T prevsize;    /* size of previous contiguous chunk */
-  mchunkptr bck;               /* misc temp for linking */
-  mchunkptr fwd;               /* misc temp for linking */
 
   size = chunksize (p);
 
@@ -4432,8 +5734,10 @@ _int_free (mstate av, mchunkptr p, int have_lock)
 
 #if USE_TCACHE
   {
+    /* The chunks of user arenas bypass the tcache, see USER_ARENA_BIT.  */
+    bool cacheable = !user_arena (av);
     size_t tc_idx = csize2tidx (size);
-    if (tcache != NULL && tc_idx < mp_.tcache_bins)
+    if (tcache != NULL && tc_idx < mp_.tcache_bins && cacheable)
       {
 	/* Check to see if it's already in the tcache.  */
 	tcache_entry *e = (tcache_entry *) chunk2mem (p);
@@ -4464,13 +5768,36 @@ _int_free (mstate av, mchunkptr p, int have_lock)
 
 	if (tcache->counts[tc_idx] < mp_.tcache_count)
 	  {
+	    tcache_stat_inc (tc_idx, frees);
 	    tcache_put (p, tc_idx);
 	    return;
 	  }
+
+	/* The bin is full.  Rather than freeing just this chunk to the
+	   arena, release a batch of cached chunks at once.  */
+	if (mp_.tcache_batch > 0 && !have_lock && mp_.tcache_count > 0)
+	  {
+	    tcache_stat_inc (tc_idx, frees);
+	    tcache_flush (p, tc_idx);
+	    return;
+	  }
       }
+    else if (cacheable && tcache_large_put (p, size))
+      return;
   }
 #endif
 
+  _int_free_chunk (av, p, size, have_lock);
+}
+
+/* Free chunk P of SIZE bytes, which belongs to arena AV, bypassing the
+   tcache.  If HAVE_LOCK is zero, the lock of AV is acquired if
+   needed.  */
+static void
+_int_free_chunk (mstate av, mchunkptr p, INTERNAL_SIZE_T size, int have_lock)
+{
+  mfastbinptr *fb;             /* associated fastbin */
+
   /*
     If eligible, place chunk on a fastbin so it can be found
     and used quickly in malloc.
@@ -4510,6 +5837,8 @@ _int_free (mstate av, mchunkptr p, int have_lock)
 
     free_perturb (chunk2mem(p), size - CHUNK_HDR_SZ);
 
+    atomic_fetch_add_relaxed (&av->stats.fast_frees, 1);
+    atomic_fetch_add_relaxed (&av->stats.fast_free_bytes, size);
     atomic_store_relaxed (&av->have_fastchunks, true);
     unsigned int idx = fastbin_index(size);
     fb = &fastbin (av, idx);
@@ -4558,135 +5887,348 @@ _int_free (mstate av, mchunkptr p, int have_lock)
     if (SINGLE_THREAD_P)
       have_lock = true;
 
-    if (!have_lock)
-      __libc_lock_lock (av->mutex);
-
-    nextchunk = chunk_at_offset(p, size);
-
-    /* Lightweight tests: check whether the block is already the
-       top block.  */
-    if (__glibc_unlikely (p == av->top))
-      malloc_printerr ("double free or corruption (top)");
-    /* Or whether the next chunk is beyond the boundaries of the arena.  */
-    if (__builtin_expect (contiguous (av)
-			  && (char *) nextchunk
-			  >= ((char *) av->top + chunksize(av->top)), 0))
-	malloc_printerr ("double free or corruption (out)");
-    /* Or whether the block is actually not marked used.  */
-    if (__glibc_unlikely (!prev_inuse(nextchunk)))
-      malloc_printerr ("double free or corruption (!prev)");
-
-    nextsize = chunksize(nextchunk);
-    if (__builtin_expect (chunksize_nomask (nextchunk) <= CHUNK_HDR_SZ, 0)
-	|| __builtin_expect (nextsize >= av->system_mem, 0))
-      malloc_printerr ("free(): invalid next size (normal)");
-
-    free_perturb (chunk2mem(p), size - CHUNK_HDR_SZ);
+    /* If the chunk belongs to an arena this thread is not attached
+       to, queue it for the threads using that arena instead of
+       competing with them for its lock.  */
+    if (!have_lock && av != thread_arena && remote_free_push (av, p))
+      return;
 
-    /* consolidate backward */
-    if (!prev_inuse(p)) {
-      prevsize = prev_size (p);
-      size += prevsize;
-      p = chunk_at_offset(p, -((long) prevsize));
-      if (__glibc_unlikely (chunksize(p) != prevsize))
-        malloc_printerr ("corrupted size vs. prev_size while consolidating");
-      unlink_chunk (av, p);
-    }
-
-    if (nextchunk != av->top) {
-      /* get and clear inuse bit */
-      nextinuse = inuse_bit_at_offset(nextchunk, nextsize);
+    if (!have_lock)
+      arena_mutex_lock (av);
 
-      /* consolidate forward */
-      if (!nextinuse) {
-	unlink_chunk (av, nextchunk);
-	size += nextsize;
-      } else
-	clear_inuse_bit_at_offset(nextchunk, 0);
+    remote_free_drain (av);
+    decay_tick (av);
+    _int_free_merge_chunk (av, p, size);
 
-      /*
-	Place the chunk in unsorted chunk list. Chunks are
-	not placed into regular bins until after they have
-	been given one chance to be used in malloc.
-      */
+    if (!have_lock)
+      __libc_lock_unlock (av->mutex);
+  }
+  /*
+    If the chunk was allocated via mmap, release via munmap().
+  */
 
-      bck = unsorted_chunks(av);
-      fwd = bck->fd;
-      if (__glibc_unlikely (fwd->bk != bck))
-	malloc_printerr ("free(): corrupted unsorted chunks");
-      p->fd = fwd;
-      p->bk = bck;
-      if (!in_smallbin_range(size))
-	{
-	  p->fd_nextsize = NULL;
-	  p->bk_nextsize = NULL;
-	}
-      bck->fd = p;
-      fwd->bk = p;
+  else {
+    munmap_chunk (p);
+  }
+}
 
-      set_head(p, size | PREV_INUSE);
-      set_foot(p, size);
+/* Free chunk P of SIZE bytes to the bins of arena AV, merging it with
+   its free neighbours.  The lock of AV must be held.  */
+static void
+_int_free_merge_chunk (mstate av, mchunkptr p, INTERNAL_SIZE_T size)
+{
+  mchunkptr nextchunk;         /* next contiguous chunk */
+  INTERNAL_SIZE_T nextsize;    /* its size */
+  int nextinuse;               /* true if nextchunk is used */
+  INTERNAL_SIZE_T prevsize;    /* size of previous contiguous chunk */
+  mchunkptr bck;               /* misc temp for linking */
+  mchunkptr fwd;               /* misc temp for linking */
 
-      check_free_chunk(av, p);
-    }
+  arena_stat_add (av, frees, 1);
+  arena_stat_add (av, free_bytes, size);
+
+  nextchunk = chunk_at_offset(p, size);
+
+  /* Lightweight tests: check whether the block is already the
+     top block.  */
+  if (__glibc_unlikely (p == av->top))
+    malloc_printerr ("double free or corruption (top)");
+  /* Or whether the next chunk is beyond the boundaries of the arena.  */
+  if (__builtin_expect (contiguous (av)
+			&& (char *) nextchunk
+			>= ((char *) av->top + chunksize(av->top)), 0))
+      malloc_printerr ("double free or corruption (out)");
+  /* Or whether the block is actually not marked used.  */
+  if (__glibc_unlikely (!prev_inuse(nextchunk)))
+    malloc_printerr ("double free or corruption (!prev)");
+
+  nextsize = chunksize(nextchunk);
+  if (__builtin_expect (chunksize_nomask (nextchunk) <= CHUNK_HDR_SZ, 0)
+      || __builtin_expect (nextsize >= av->system_mem, 0))
+    malloc_printerr ("free(): invalid next size (normal)");
+
+  free_perturb (chunk2mem(p), size - CHUNK_HDR_SZ);
+
+  /* consolidate backward */
+  if (!prev_inuse(p)) {
+    prevsize = prev_size (p);
+    size += prevsize;
+    p = chunk_at_offset(p, -((long) prevsize));
+    if (__glibc_unlikely (chunksize(p) != prevsize))
+      malloc_printerr ("corrupted size vs. prev_size while consolidating");
+    unlink_chunk (av, p);
+  }
 
-    /*
-      If the chunk borders the current high end of memory,
-      consolidate into top
-    */
+  if (nextchunk != av->top) {
+    /* get and clear inuse bit */
+    nextinuse = inuse_bit_at_offset(nextchunk, nextsize);
 
-    else {
+    /* consolidate forward */
+    if (!nextinuse) {
+      unlink_chunk (av, nextchunk);
       size += nextsize;
-      set_head(p, size | PREV_INUSE);
-      av->top = p;
-      check_chunk(av, p);
-    }
+    } else
+      clear_inuse_bit_at_offset(nextchunk, 0);
 
     /*
-      If freeing a large space, consolidate possibly-surrounding
-      chunks. Then, if the total unused topmost memory exceeds trim
-      threshold, ask malloc_trim to reduce top.
-
-      Unless max_fast is 0, we don't know if there are fastbins
-      bordering top, so we cannot tell for sure whether threshold
-      has been reached unless fastbins are consolidated.  But we
-      don't want to consolidate on each free.  As a compromise,
-      consolidation is performed if FASTBIN_CONSOLIDATION_THRESHOLD
-      is reached.
+      Place the chunk in unsorted chunk list. Chunks are
+      not placed into regular bins until after they have
+      been given one chance to be used in malloc.  Large
+      chunks go straight to the segregated lists if they are
+      used, which bounds the work of the next malloc.
     */
 
-    if ((unsigned long)(size) >= FASTBIN_CONSOLIDATION_THRESHOLD) {
-      if (atomic_load_relaxed (&av->have_fastchunks))
-	malloc_consolidate(av);
-
-      if (av == &main_arena) {
-#ifndef MORECORE_CANNOT_TRIM
-	if ((unsigned long)(chunksize(av->top)) >=
-	    (unsigned long)(mp_.trim_threshold))
-	  systrim(mp_.top_pad, av);
-#endif
-      } else {
-	/* Always try heap_trim(), even if the top chunk is not
-	   large, because the corresponding heap might go away.  */
-	heap_info *heap = heap_for_ptr(top(av));
-
-	assert(heap->ar_ptr == av);
-	heap_trim(heap, mp_.top_pad);
+    if (av->tlsf != NULL && !in_smallbin_range (size))
+      tlsf_insert (av, p, size);
+    else
+      {
+	bck = unsorted_chunks(av);
+	fwd = bck->fd;
+	if (__glibc_unlikely (fwd->bk != bck))
+	  malloc_printerr ("free(): corrupted unsorted chunks");
+	p->fd = fwd;
+	p->bk = bck;
+	if (!in_smallbin_range(size))
+	  {
+	    p->fd_nextsize = NULL;
+	    p->bk_nextsize = NULL;
+	  }
+	bck->fd = p;
+	fwd->bk = p;
       }
-    }
 
-    if (!have_lock)
-      __libc_lock_unlock (av->mutex);
+    set_head(p, size | PREV_INUSE);
+    set_foot(p, size);
+    decay_stamp (av, p, size);
+
+    check_free_chunk(av, p);
   }
+
   /*
-    If the chunk was allocated via mmap, release via munmap().
+    If the chunk borders the current high end of memory,
+    consolidate into top
   */
 
   else {
-    munmap_chunk (p);
+    size += nextsize;
+    set_head(p, size | PREV_INUSE);
+    av->top = p;
+    check_chunk(av, p);
+  }
+
+  /*
+    If freeing a large space, consolidate possibly-surrounding
+    chunks. Then, if the total unused topmost memory exceeds trim
+    threshold, ask malloc_trim to reduce top.
+
+    Unless max_fast is 0, we don't know if there are fastbins
+    bordering top, so we cannot tell for sure whether threshold
+    has been reached unless fastbins are consolidated.  But we
+    don't want to consolidate on each free.  As a compromise,
+    consolidation is performed if FASTBIN_CONSOLIDATION_THRESHOLD
+    is reached.
+  */
+
+  if ((unsigned long)(size) >= FASTBIN_CONSOLIDATION_THRESHOLD) {
+    if (atomic_load_relaxed (&av->have_fastchunks))
+      malloc_consolidate(av);
+
+    if (av == &main_arena) {
+#ifndef MORECORE_CANNOT_TRIM
+      if ((unsigned long)(chunksize(av->top)) >=
+	  (unsigned long)(mp_.trim_threshold))
+	systrim(mp_.top_pad, av);
+#endif
+    } else {
+      /* Always try heap_trim(), even if the top chunk is not
+	 large, because the corresponding heap might go away.  */
+      heap_info *heap = heap_for_ptr(top(av));
+
+      assert(heap->ar_ptr == av);
+      heap_trim(heap, mp_.top_pad);
+    }
   }
 }
 
+/* Queue chunk P for freeing to arena AV by a thread holding its lock.
+   Return false if the queue is full, in which case the caller has to
+   free P itself.  */
+static bool
+remote_free_push (mstate av, mchunkptr p)
+{
+  /* The bound is approximate: concurrent pushes may all see a count
+     just below it.  */
+  if (atomic_load_relaxed (&av->remote_free_count) >= REMOTE_FREE_MAX)
+    return false;
+
+  /* P may already be queued (i.e., double free).  The mark may also be
+     left over in user data, so do not report an error here.  */
+  if (__glibc_unlikely (p->bk == (mchunkptr) &av->remote_free))
+    return false;
+
+  p->bk = (mchunkptr) &av->remote_free;
+  mchunkptr old = atomic_load_relaxed (&av->remote_free);
+  do
+    p->fd = PROTECT_PTR (&p->fd, old);
+  while (!atomic_compare_exchange_weak_release (&av->remote_free, &old, p));
+  atomic_fetch_add_relaxed (&av->remote_free_count, 1);
+
+  return true;
+}
+
+/* Free the chunks queued on AV by remote_free_push.  The lock of AV
+   must be held.  */
+static void
+remote_free_drain (mstate av)
+{
+  if (__glibc_likely (atomic_load_relaxed (&av->remote_free) == NULL))
+    return;
+
+  mchunkptr p = atomic_exchange_acquire (&av->remote_free, NULL);
+  atomic_store_relaxed (&av->remote_free_count, 0);
+  while (p != NULL)
+    {
+      if (__glibc_unlikely (misaligned_chunk (p)))
+	malloc_printerr ("malloc(): unaligned remote free chunk detected");
+      mchunkptr next = REVEAL_PTR (p->fd);
+      /* Clear the mark, which may otherwise remain in the data of a
+	 later allocation.  */
+      p->bk = NULL;
+      _int_free_merge_chunk (av, p, chunksize (p));
+      p = next;
+    }
+}
+
+/*
+  ------------------------------ decay ------------------------------
+
+  If the glibc.malloc.decay_ms tunable is set, the pages inside free
+  chunks of at least DECAY_MIN_SIZE bytes are returned to the system
+  with MADV_FREE once the chunk has been free for decay_ms
+  milliseconds.  The time a chunk was freed is kept in the chunk,
+  after the fields used by the bins.  A chunk split off a free chunk
+  inherits its time, and a chunk merged with its neighbours gets the
+  current time.  Purging happens in small steps, each scanning a few
+  bins, from the slow paths of malloc and free, so that there is no
+  pause comparable to malloc_trim.
+*/
+
+/* Return the range of pages of free chunk P of SIZE bytes which can be
+   purged, i.e. which do not contain the chunk header or time.  With
+   transparent huge pages, only whole huge pages are purged, so that
+   purging does not split them; malloc_trim still releases all free
+   pages.  */
+static void
+decay_range (mchunkptr p, INTERNAL_SIZE_T size, char **start, size_t *len)
+{
+  size_t pagesize = GLRO (dl_pagesize);
+#if HAVE_TUNABLES
+  if (mp_.thp_pagesize != 0)
+    pagesize = mp_.thp_pagesize;
+#endif
+  char *begin = PTR_ALIGN_UP ((char *) &decay_time (p) + sizeof (uint64_t),
+			      pagesize);
+  char *end = PTR_ALIGN_DOWN ((char *) p + size, pagesize);
+  *start = begin;
+  *len = end > begin ? end - begin : 0;
+}
+
+/* madvise advice used to purge pages.  Switched to MADV_DONTNEED if the
+   kernel does not support MADV_FREE.  */
+static int decay_advice = MADV_FREE;
+
+/* Purge the pages of the chunks of AV which have been free for at
+   least decay_ms milliseconds, scanning at most DECAY_SCAN_MAX chunks
+   of the unsorted and large bins and the segregated lists, starting at
+   av->decay_bin.  A bin which holds more chunks than one step can scan
+   is continued by the next step after the chunks already scanned, so
+   that the chunks towards its head are reached as well.  The large
+   bins are sorted, so their chunks cannot be rotated to the tail
+   instead.  */
+static void
+decay_purge (mstate av, uint64_t now)
+{
+  size_t scanned = 0;
+  size_t purged = 0;
+  unsigned int idx = av->decay_bin;
+  unsigned int skip = av->decay_skip;
+  unsigned int end = all_bins (av);
+
+  for (unsigned int n = 0; n <= end - NSMALLBINS; n++)
+    {
+      /* Bin 1 is the unsorted bin, the large bins follow the small
+	 ones, and the segregated lists follow the large bins.  */
+      if (idx != 1 && (idx < NSMALLBINS || idx >= end))
+	{
+	  idx = 1;
+	  skip = 0;
+	}
+
+      mbinptr bin = any_bin_at (av, idx);
+      mchunkptr p = bin->bk;
+      /* Chunks freed or allocated since the previous step may shift
+	 the position, which only delays a chunk to the next pass.  */
+      for (unsigned int i = 0; i < skip && p != bin; i++)
+	p = p->bk;
+      for (; p != bin && scanned < DECAY_SCAN_MAX && purged < DECAY_PURGE_MAX;
+	   p = p->bk, scanned++, skip++)
+	{
+	  INTERNAL_SIZE_T size = chunksize (p);
+	  uint64_t freed;
+	  if (size < DECAY_MIN_SIZE
+	      || (freed = decay_time (p)) == DECAY_PURGED
+	      || now - freed < mp_.decay_ms)
+	    continue;
+
+	  char *start;
+	  size_t len;
+	  decay_range (p, size, &start, &len);
+	  if (len > 0)
+	    {
+	      if (__madvise (start, len, decay_advice) != 0
+		  && decay_advice != MADV_DONTNEED)
+		{
+		  decay_advice = MADV_DONTNEED;
+		  __madvise (start, len, decay_advice);
+		}
+	      purged += len;
+	    }
+	  decay_time (p) = DECAY_PURGED;
+	}
+
+      /* Continue in this bin if the limits stopped the scan.  */
+      if (p != bin)
+	break;
+
+      idx = idx == 1 ? NSMALLBINS : idx + 1;
+      skip = 0;
+      if (scanned >= DECAY_SCAN_MAX || purged >= DECAY_PURGE_MAX)
+	break;
+    }
+
+  av->decay_bin = idx;
+  av->decay_skip = skip;
+}
+
+/* Update the decay clock of AV, and run a purge step if one is due.
+   The lock of AV must be held.  */
+static void
+decay_tick (mstate av)
+{
+  if (__glibc_likely (mp_.decay_ms == 0))
+    return;
+
+  struct timespec ts;
+  __clock_gettime (CLOCK_MONOTONIC_COARSE, &ts);
+  uint64_t now = (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+  av->decay_now = now;
+
+  if (now < av->decay_next)
+    return;
+  av->decay_next = now + MAX (mp_.decay_ms / DECAY_STEPS, 1);
+  decay_purge (av, now);
+}
+
 /*
   ------------------------- malloc_consolidate -------------------------
 
@@ -4780,6 +6322,7 @@ static void malloc_consolidate(mstate av)
 	  p->bk = unsorted_bin;
 	  p->fd = first_unsorted;
 	  set_foot(p, size);
+	  decay_stamp (av, p, size);
 	}
 
 	else {
@@ -4842,6 +6385,7 @@ _int_realloc (mstate av, mchunkptr oldp, INTERNAL_SIZE_T oldsize,
           (unsigned long) (newsize = oldsize + nextsize) >=
           (unsigned long) (nb + MINSIZE))
         {
+          arena_stat_add (av, alloc_bytes, nb - oldsize);
           set_head_size (oldp, nb | (av != &main_arena ? NON_MAIN_ARENA : 0));
           av->top = chunk_at_offset (oldp, nb);
           set_head (av->top, (newsize - nb) | PREV_INUSE);
@@ -4857,6 +6401,7 @@ _int_realloc (mstate av, mchunkptr oldp, INTERNAL_SIZE_T oldsize,
         {
           newp = oldp;
           unlink_chunk (av, next);
+          arena_stat_add (av, alloc_bytes, nextsize);
         }
 
       /* allocate, copy, free */
@@ -4946,6 +6491,34 @@ _int_memalign (mstate av, size_t alignment, size_t bytes)
       return NULL;
     }
 
+  /* The chunks of earlier small aligned allocations of the same size
+     are usually back in the fastbin or small bin of that size.  If the
+     chunk which _int_malloc would take from there is aligned, use it
+     instead of splitting a larger one.  */
+  if (in_smallbin_range (nb))
+    {
+      p = NULL;
+      if (nb <= get_max_fast ())
+        p = fastbin (av, fastbin_index (nb));
+      if (p == NULL)
+        {
+          mbinptr bin = bin_at (av, smallbin_index (nb));
+          if (last (bin) != bin)
+            p = last (bin);
+        }
+      if (p != NULL && ((unsigned long) chunk2mem (p) & (alignment - 1)) == 0)
+        {
+          m = _int_malloc (av, bytes);
+          if (m == NULL)
+            return NULL;
+          /* A concurrent free may have added another chunk to the
+             fastbin.  */
+          if (((unsigned long) m & (alignment - 1)) == 0)
+            return m;
+          _int_free (av, mem2chunk (m), 1);
+        }
+    }
+
   /*
      Strategy: find a spot within that chunk that meets the alignment
      request, and then possibly free the leading and trailing space.
@@ -4983,6 +6556,7 @@ _int_memalign (mstate av, size_t alignment, size_t bytes)
         {
           set_prev_size (newp, prev_size (p) + leadsize);
           set_head (newp, newsize | IS_MMAPPED);
+          note_mmapped_chunk (nb);
           return chunk2mem (newp);
         }
 
@@ -4998,11 +6572,13 @@ _int_memalign (mstate av, size_t alignment, size_t bytes)
               (((unsigned long) (chunk2mem (p))) % alignment) == 0);
     }
 
-  /* Also give back spare room at the end */
+  /* Also give back spare room at the end, if it can form a chunk.  The
+     chunk then belongs to the tcache bin of NB or the next one, where
+     tcache_get_aligned looks for it once it is freed.  */
   if (!chunk_is_mmapped (p))
     {
       size = chunksize (p);
-      if ((unsigned long) (size) > (unsigned long) (nb + MINSIZE))
+      if ((unsigned long) (size) >= (unsigned long) (nb + MINSIZE))
         {
           remainder_size = size - nb;
           remainder = chunk_at_offset (p, nb);
@@ -5026,6 +6602,7 @@ static int
 mtrim (mstate av, size_t pad)
 {
   /* Ensure all blocks are consolidated.  */
+  remote_free_drain (av);
   malloc_consolidate (av);
 
   const size_t ps = GLRO (dl_pagesize);
@@ -5033,10 +6610,10 @@ mtrim (mstate av, size_t pad)
   const size_t psm1 = ps - 1;
 
   int result = 0;
-  for (int i = 1; i < NBINS; ++i)
+  for (int i = 1; i < all_bins (av); ++i)
     if (i == 1 || i >= psindex)
       {
-        mbinptr bin = bin_at (av, i);
+        mbinptr bin = any_bin_at (av, i);
 
         for (mchunkptr p = last (bin); p != bin; p = p->bk)
           {
@@ -5126,6 +6703,8 @@ __malloc_usable_size (void *m)
 {
   if (m == NULL)
     return 0;
+  if (slab_contains (m))
+    return slab_usable_size (m);
   return musable (m);
 }
 #endif
@@ -5145,6 +6724,7 @@ int_mallinfo (mstate av, struct mallinfo2 *m)
   int nblocks;
   int nfastblocks;
 
+  remote_free_drain (av);
   check_malloc_state (av);
 
   /* Account for top */
@@ -5171,10 +6751,10 @@ int_mallinfo (mstate av, struct mallinfo2 *m)
 
   avail += fastavail;
 
-  /* traverse regular bins */
-  for (i = 1; i < NBINS; ++i)
+  /* traverse regular bins and segregated lists */
+  for (i = 1; i < all_bins (av); ++i)
     {
-      b = bin_at (av, i);
+      b = any_bin_at (av, i);
       for (p = last (b); p != b; p = p->bk)
         {
           ++nblocks;
@@ -5365,6 +6945,57 @@ do_set_arena_max (size_t value)
   return 1;
 }
 
+static __always_inline int
+do_set_percpu (int32_t value)
+{
+  mp_.percpu = value != 0;
+  return 1;
+}
+
+static __always_inline int
+do_set_numa (int32_t value)
+{
+  mp_.numa = value != 0;
+  return 1;
+}
+
+static __always_inline int
+do_set_numa_nodes (size_t value)
+{
+  mp_.numa_nodes = value;
+  if (value != 0)
+    mp_.numa = 1;
+  return 1;
+}
+
+static __always_inline int
+do_set_decay_ms (size_t value)
+{
+  mp_.decay_ms = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_profile_sample_bytes (size_t value)
+{
+  mp_.profile_sample_bytes = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_slab (int32_t value)
+{
+  mp_.slab = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_tlsf (int32_t value)
+{
+  mp_.tlsf = value;
+  return 1;
+}
+
 #if USE_TCACHE
 static __always_inline int
 do_set_tcache_max (size_t value)
@@ -5398,6 +7029,47 @@ do_set_tcache_unsorted_limit (size_t value)
   mp_.tcache_unsorted_limit = value;
   return 1;
 }
+
+static __always_inline int
+do_set_tcache_batch (size_t value)
+{
+  if (value <= MAX_TCACHE_COUNT)
+    {
+      mp_.tcache_batch = value;
+      return 1;
+    }
+  return 0;
+}
+
+static __always_inline int
+do_set_tcache_large_max (size_t value)
+{
+  if (value > tcache_large_size (TCACHE_LARGE_BINS - 1) - SIZE_SZ)
+    return 0;
+  if (value <= MAX_TCACHE_SIZE)
+    mp_.tcache_large_bins = 0;
+  else
+    mp_.tcache_large_bins = tcache_large_ceil (request2size (value)) + 1;
+  return 1;
+}
+
+static __always_inline int
+do_set_tcache_large_budget (size_t value)
+{
+  mp_.tcache_large_budget = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_tcache_large_count (size_t value)
+{
+  if (value <= MAX_TCACHE_COUNT)
+    {
+      mp_.tcache_large_count = value;
+      return 1;
+    }
+  return 0;
+}
 #endif
 
 static __always_inline int
@@ -5704,6 +7376,11 @@ __malloc_info (int options, FILE *fp)
   size_t total_max_system = 0;
   size_t total_aspace = 0;
   size_t total_aspace_mprotect = 0;
+  size_t total_aspace_huge = 0;
+  size_t total_ndirty = 0;
+  size_t total_dirty = 0;
+  size_t total_npurged = 0;
+  size_t total_purged = 0;
 
 
 
@@ -5722,17 +7399,24 @@ __malloc_info (int options, FILE *fp)
       size_t nfastblocks = 0;
       size_t avail = 0;
       size_t fastavail = 0;
+      size_t ndirty = 0;
+      size_t dirty = 0;
+      size_t npurged = 0;
+      size_t purged = 0;
       struct
       {
 	size_t from;
 	size_t to;
 	size_t total;
 	size_t count;
-      } sizes[NFASTBINS + NBINS - 1];
+      } sizes[NFASTBINS + NBINS + TLSF_NBINS - 1];
 #define nsizes (sizeof (sizes) / sizeof (sizes[0]))
 
       __libc_lock_lock (ar_ptr->mutex);
 
+      /* Count the chunks other threads queued for freeing as free.  */
+      remote_free_drain (ar_ptr);
+
       /* Account for top chunk.  The top-most available chunk is
 	 treated specially and is never in any bin. See "initial_top"
 	 comments.  */
@@ -5772,10 +7456,11 @@ __malloc_info (int options, FILE *fp)
       mbinptr bin;
       struct malloc_chunk *r;
 
-      for (size_t i = 1; i < NBINS; ++i)
+      for (size_t i = 1; i < NBINS + TLSF_NBINS; ++i)
 	{
-	  bin = bin_at (ar_ptr, i);
-	  r = bin->fd;
+	  /* The arena may have no segregated lists.  */
+	  bin = i < all_bins (ar_ptr) ? any_bin_at (ar_ptr, i) : NULL;
+	  r = bin != NULL ? bin->fd : NULL;
 	  sizes[NFASTBINS - 1 + i].from = ~((size_t) 0);
 	  sizes[NFASTBINS - 1 + i].to = sizes[NFASTBINS - 1 + i].total
 					  = sizes[NFASTBINS - 1 + i].count = 0;
@@ -5791,6 +7476,24 @@ __malloc_info (int options, FILE *fp)
 		sizes[NFASTBINS - 1 + i].to = MAX (sizes[NFASTBINS - 1 + i].to,
 						   r_size);
 
+		/* Classify the pages decay purging may release.  */
+		if (mp_.decay_ms != 0 && chunksize (r) >= DECAY_MIN_SIZE)
+		  {
+		    char *start;
+		    size_t len;
+		    decay_range (r, chunksize (r), &start, &len);
+		    if (decay_time (r) == DECAY_PURGED)
+		      {
+			++npurged;
+			purged += len;
+		      }
+		    else
+		      {
+			++ndirty;
+			dirty += len;
+		      }
+		  }
+
 		r = r->fd;
 	      }
 
@@ -5848,6 +7551,16 @@ __malloc_info (int options, FILE *fp)
 	       nfastblocks, fastavail, nblocks, avail,
 	       ar_ptr->system_mem, ar_ptr->max_system_mem);
 
+      if (mp_.decay_ms != 0)
+	fprintf (fp,
+		 "<total type=\"dirty\" count=\"%zu\" size=\"%zu\"/>\n"
+		 "<total type=\"purged\" count=\"%zu\" size=\"%zu\"/>\n",
+		 ndirty, dirty, npurged, purged);
+      total_ndirty += ndirty;
+      total_dirty += dirty;
+      total_npurged += npurged;
+      total_purged += purged;
+
       if (ar_ptr != &main_arena)
 	{
 	  fprintf (fp,
@@ -5867,6 +7580,12 @@ __malloc_info (int options, FILE *fp)
 	  total_aspace += ar_ptr->system_mem;
 	  total_aspace_mprotect += ar_ptr->system_mem;
 	}
+#if HAVE_TUNABLES
+      if (mp_.thp_pagesize != 0 || mp_.hp_pagesize != 0)
+	fprintf (fp, "<aspace type=\"huge\" size=\"%zu\"/>\n",
+		 ar_ptr->huge_mem);
+#endif
+      total_aspace_huge += ar_ptr->huge_mem;
 
       fputs ("</heap>\n", fp);
       ar_ptr = ar_ptr->next;
@@ -5880,20 +7599,134 @@ __malloc_info (int options, FILE *fp)
 	   "<system type=\"current\" size=\"%zu\"/>\n"
 	   "<system type=\"max\" size=\"%zu\"/>\n"
 	   "<aspace type=\"total\" size=\"%zu\"/>\n"
-	   "<aspace type=\"mprotect\" size=\"%zu\"/>\n"
-	   "</malloc>\n",
+	   "<aspace type=\"mprotect\" size=\"%zu\"/>\n",
 	   total_nfastblocks, total_fastavail, total_nblocks, total_avail,
 	   mp_.n_mmaps, mp_.mmapped_mem,
 	   total_system, total_max_system,
 	   total_aspace, total_aspace_mprotect);
+#if HAVE_TUNABLES
+  if (mp_.thp_pagesize != 0 || mp_.hp_pagesize != 0)
+    fprintf (fp, "<aspace type=\"huge\" size=\"%zu\"/>\n",
+	     total_aspace_huge);
+#endif
+  if (mp_.decay_ms != 0)
+    fprintf (fp,
+	     "<total type=\"dirty\" count=\"%zu\" size=\"%zu\"/>\n"
+	     "<total type=\"purged\" count=\"%zu\" size=\"%zu\"/>\n",
+	     total_ndirty, total_dirty, total_npurged, total_purged);
+  slab_info (fp);
+  fputs ("</malloc>\n", fp);
+
+  return 0;
+}
+
+/* Store the counters of arena AR_PTR in S.  */
+static void
+arena_stats_store (mstate ar_ptr, struct malloc_arena_stats *s)
+{
+  struct malloc_arena_counters *c = &ar_ptr->stats;
+  size_t frees = atomic_load_relaxed (&c->frees);
+  size_t free_bytes = atomic_load_relaxed (&c->free_bytes);
+  size_t alloc_bytes = atomic_load_relaxed (&c->alloc_bytes);
+
+  frees += atomic_load_relaxed (&c->fast_frees);
+  free_bytes += atomic_load_relaxed (&c->fast_free_bytes);
+  s->allocs = atomic_load_relaxed (&c->allocs);
+  s->frees = frees;
+  s->bytes_in_use = alloc_bytes > free_bytes ? alloc_bytes - free_bytes : 0;
+  s->system_bytes = atomic_load_relaxed (&ar_ptr->system_mem);
+  s->huge_page_bytes = atomic_load_relaxed (&ar_ptr->huge_mem);
+  s->numa_node = ar_ptr->numa_node;
+  s->lock_contentions = atomic_load_relaxed (&c->contentions);
+  s->slow_path = atomic_load_relaxed (&c->slow_path);
+}
+
+int
+__malloc_stats_snapshot (struct malloc_stats *stats, size_t size)
+{
+  if (size < sizeof (*stats))
+    {
+      __set_errno (EINVAL);
+      return -1;
+    }
+
+  if (!__malloc_initialized)
+    ptmalloc_init ();
+
+  memset (stats, 0, sizeof (*stats));
+  size_t max_arenas = (size - sizeof (*stats)) / sizeof (stats->arenas[0]);
+
+  /* The counters are read without the arena locks, so the values of
+     different arenas (and of different fields of one arena) are not
+     necessarily consistent with each other.  */
+  size_t n = 0;
+  mstate ar_ptr = &main_arena;
+  do
+    {
+      if (n < max_arenas)
+	arena_stats_store (ar_ptr, &stats->arenas[n]);
+      ++n;
+      ar_ptr = atomic_load_acquire (&ar_ptr->next);
+    }
+  while (ar_ptr != &main_arena);
+
+#if IS_IN (libc)
+  /* The user arenas follow.  list_lock keeps malloc_arena_destroy from
+     unmapping them while they are read.  */
+  __libc_lock_lock (list_lock);
+  for (ar_ptr = user_arenas; ar_ptr != NULL; ar_ptr = ar_ptr->next)
+    {
+      if (n < max_arenas)
+	arena_stats_store (ar_ptr, &stats->arenas[n]);
+      ++n;
+    }
+  __libc_lock_unlock (list_lock);
+#endif
+  stats->narenas = n;
+
+  stats->mmapped_chunks = atomic_load_relaxed (&mp_.n_mmaps);
+  stats->mmapped_bytes = atomic_load_relaxed (&mp_.mmapped_mem);
+
+#if USE_TCACHE
+  stats->ntcache_bins = mp_.tcache_bins;
+  for (size_t i = 0; i < stats->ntcache_bins; ++i)
+    stats->tcache_bins[i].size = tidx2usize (i);
+
+  __libc_lock_lock (tcache_list_lock);
+  for (size_t i = 0; i < stats->ntcache_bins; ++i)
+    {
+      struct malloc_tcache_bin_stats *s = &stats->tcache_bins[i];
+      s->allocs = tcache_exited_stats[i].allocs;
+      s->frees = tcache_exited_stats[i].frees;
+      s->misses = tcache_exited_stats[i].misses;
+      for (tcache_perthread_struct *t = tcache_list; t != NULL;
+	   t = t->list_next)
+	{
+	  s->allocs += atomic_load_relaxed (&t->stats[i].allocs);
+	  s->frees += atomic_load_relaxed (&t->stats[i].frees);
+	  s->misses += atomic_load_relaxed (&t->stats[i].misses);
+	}
+    }
+  __libc_lock_unlock (tcache_list_lock);
+#endif
 
   return 0;
 }
 #if IS_IN (libc)
 weak_alias (__malloc_info, malloc_info)
+weak_alias (__malloc_stats_snapshot, malloc_stats_snapshot)
+weak_alias (__malloc_profile_dump, malloc_profile_dump)
+weak_alias (__malloc_arena_create, malloc_arena_create)
+weak_alias (__malloc_arena_alloc, malloc_arena_alloc)
+weak_alias (__malloc_arena_set_thread_default, malloc_arena_set_thread_default)
+weak_alias (__malloc_arena_destroy, malloc_arena_destroy)
 
 strong_alias (__libc_calloc, __calloc) weak_alias (__libc_calloc, calloc)
 strong_alias (__libc_free, __free) strong_alias (__libc_free, free)
+weak_alias (__libc_free_sized, free_sized)
+weak_alias (__libc_free_aligned_sized, free_aligned_sized)
+weak_alias (__libc_malloc_bulk, malloc_bulk)
+weak_alias (__libc_free_bulk, free_bulk)
 strong_alias (__libc_malloc, __malloc) strong_alias (__libc_malloc, malloc)
 strong_alias (__libc_memalign, __memalign)
 weak_alias (__libc_memalign, memalign)
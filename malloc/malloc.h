@@ -63,6 +63,16 @@ extern void *reallocarray (void *__ptr, size_t __nmemb, size_t __size)
 /* Free a block allocated by `malloc', `realloc' or `calloc'.  */
 extern void free (void *__ptr) __THROW;
 
+/* Free a block of SIZE bytes allocated by `malloc', `realloc' or
+   `calloc'.  SIZE must be the size requested when the block was
+   allocated.  */
+extern void free_sized (void *__ptr, size_t __size) __THROW;
+
+/* Free a block of SIZE bytes allocated by `aligned_alloc' with an
+   alignment of ALIGNMENT bytes.  */
+extern void free_aligned_sized (void *__ptr, size_t __alignment,
+				size_t __size) __THROW;
+
 /* Allocate SIZE bytes allocated to ALIGNMENT bytes.  */
 extern void *memalign (size_t __alignment, size_t __size)
   __THROW __attribute_malloc__ __attribute_alloc_align__ ((1))
@@ -157,5 +167,83 @@ extern void malloc_stats (void) __THROW;
 /* Output information about state of allocator to stream FP.  */
 extern int malloc_info (int __options, FILE *__fp) __THROW;
 
+/* Counters of one arena, returned by malloc_stats_snapshot.  */
+struct malloc_arena_stats
+{
+  size_t allocs;           /* chunks allocated from the arena */
+  size_t frees;            /* chunks freed to the arena */
+  size_t bytes_in_use;     /* bytes allocated from the arena and not freed */
+  size_t system_bytes;     /* memory obtained from the system */
+  size_t lock_contentions; /* lock acquisitions which had to wait */
+  size_t slow_path;        /* allocations which had to grow the arena */
+  size_t huge_page_bytes;  /* part of system_bytes in huge pages */
+  int numa_node;           /* NUMA node served by the arena, or -1 */
+};
+
+/* Counters of one per-thread cache bin, summed over all threads.  */
+struct malloc_tcache_bin_stats
+{
+  size_t size;             /* largest request size served by the bin */
+  size_t allocs;           /* allocations served from the bin */
+  size_t frees;            /* frees stored in the bin */
+  size_t misses;           /* allocations which found the bin empty */
+};
+
+#define MALLOC_STATS_TCACHE_BINS 64
+
+struct malloc_stats
+{
+  size_t mmapped_chunks;   /* chunks allocated with mmap */
+  size_t mmapped_bytes;    /* bytes in chunks allocated with mmap */
+  size_t ntcache_bins;     /* number of entries used in tcache_bins */
+  struct malloc_tcache_bin_stats tcache_bins[MALLOC_STATS_TCACHE_BINS];
+  size_t narenas;          /* number of arenas in the process */
+  struct malloc_arena_stats arenas __flexarr;
+};
+
+/* Store the allocator counters in the SIZE bytes at STATS, without
+   stopping other threads from allocating.  The counters of as many
+   arenas as fit are stored in STATS->arenas.  Return 0 on success, or
+   -1 if SIZE is too small.  */
+extern int malloc_stats_snapshot (struct malloc_stats *__stats,
+				  size_t __size) __THROW;
+
+/* Write the allocations sampled by the heap profiler to FP, in the
+   legacy heap profile format read by pprof.  OPTIONS must be 0.  */
+extern int malloc_profile_dump (int __options, FILE *__fp) __THROW;
+
+/* Allocate N blocks of SIZE bytes each, store pointers to them in PTRS
+   and return the number of blocks allocated.  This is less than N only
+   if not enough memory is available.  */
+extern size_t malloc_bulk (size_t __size, size_t __n, void **__ptrs)
+  __THROW __wur;
+
+/* Free the N blocks whose pointers are in PTRS, as free would.  Null
+   pointers are ignored.  */
+extern void free_bulk (size_t __n, void **__ptrs) __THROW;
+
+/* An arena created by malloc_arena_create.  */
+struct malloc_arena;
+
+/* Create an arena which only serves malloc_arena_alloc, and the
+   allocations of the threads which select it with
+   malloc_arena_set_thread_default.  FLAGS must be 0.  */
+extern struct malloc_arena *malloc_arena_create (unsigned int __flags)
+  __THROW __wur;
+
+/* Allocate SIZE bytes from ARENA.  The block can be freed with free, or
+   released with the whole arena by malloc_arena_destroy.  */
+extern void *malloc_arena_alloc (struct malloc_arena *__arena, size_t __size)
+  __THROW __attribute_malloc__ __attribute_alloc_size__ ((2)) __wur;
+
+/* Make malloc, calloc and the aligned allocation functions in the
+   calling thread allocate from ARENA, or from the default arenas if
+   ARENA is NULL.  Return the previously selected arena.  */
+extern struct malloc_arena *
+malloc_arena_set_thread_default (struct malloc_arena *__arena) __THROW;
+
+/* Release ARENA and all the memory allocated from it.  */
+extern void malloc_arena_destroy (struct malloc_arena *__arena) __THROW;
+
 __END_DECLS
 #endif /* malloc.h */
@@ -0,0 +1,405 @@
+/* Sampling heap profiler.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; see the file COPYING.LIB.  If
+   not, see <https://www.gnu.org/licenses/>.  */
+
+/* If the glibc.malloc.profile_sample_bytes tunable is set to N, about
+   one allocation per N bytes allocated is sampled.  The backtrace of a
+   sampled allocation is recorded in a bounded table of stacks, and the
+   pointer is remembered until it is freed, so that the table holds the
+   live and the cumulative sampled allocations of each stack.
+   malloc_profile_dump writes the table in the legacy heap profile
+   format ("heap_v2") that pprof reads.
+
+   The number of bytes between two samples is drawn from an exponential
+   distribution with mean N.  This is what pprof assumes when it scales
+   the sampled counts back to estimates of the real ones.
+
+   When the profiler is disabled, malloc and free only test
+   mp_.profile_sample_bytes and profile_tables respectively.  When it
+   is enabled, allocations decrement a per-thread byte counter, and free
+   looks up a small counting filter which tells, without a lock, that
+   most pointers were not sampled.  */
+
+#include <array_length.h>
+#include <execinfo.h>
+#include <inttypes.h>
+
+#ifndef SHARED
+/* Do not link the unwinder into every static program using malloc.
+   Statically linked programs only get backtraces in their profiles if
+   they use backtrace themselves.  */
+weak_extern (__backtrace)
+#endif
+
+/* Maximum number of frames recorded per sample.  */
+#define PROFILE_MAX_DEPTH 32
+/* The frames of profile_record and of the allocation function are not
+   recorded.  */
+#define PROFILE_SKIP_FRAMES 2
+/* Maximum number of distinct stacks.  Once the table is full, new
+   stacks are accounted to the last entry, which has no frames.  */
+#define PROFILE_MAX_STACKS 4096
+/* Maximum number of sampled allocations which are live at the same
+   time.  Further samples only count in the cumulative totals.  */
+#define PROFILE_MAX_LIVE 16384
+/* Number of counters in the filter used by free.  */
+#define PROFILE_FILTER_BITS 18
+#define PROFILE_FILTER_SIZE (1 << PROFILE_FILTER_BITS)
+
+struct profile_stack
+{
+  size_t live_count;
+  size_t live_bytes;
+  size_t total_count;
+  size_t total_bytes;
+  unsigned int depth;
+  void *frames[PROFILE_MAX_DEPTH];
+};
+
+struct profile_live
+{
+  void *mem;
+  size_t bytes;
+  unsigned int stack;
+};
+
+struct profile_tables
+{
+  /* Number of live sampled allocations whose address hashes to each
+     counter.  Written under profile_lock, read without it by free.  */
+  unsigned char filter[PROFILE_FILTER_SIZE];
+  /* Open addressing hash table of the stacks, storing the index in
+     stacks plus 1, or 0 for an empty slot.  */
+  uint32_t stack_index[2 * PROFILE_MAX_STACKS];
+  /* Open addressing hash table of the live sampled allocations.  */
+  struct profile_live live[2 * PROFILE_MAX_LIVE];
+  size_t nlive;
+  size_t nstacks;
+  struct profile_stack stacks[PROFILE_MAX_STACKS];
+};
+
+/* Allocated on the first sample and never freed.  */
+static struct profile_tables *profile_tables;
+__libc_lock_define_initialized (static, profile_lock);
+
+/* Bytes which the current thread can allocate before the next sample,
+   and the state of its random number generator (0 if the thread has
+   not started sampling yet).  */
+static __thread size_t profile_bytes_left;
+static __thread uint64_t profile_rng;
+/* True while the current thread is recording a sample.  Allocations
+   made in the meantime, including those of the unwinder, are not
+   sampled.  */
+static __thread bool profile_busy;
+
+static inline uint64_t
+profile_hash (uintptr_t value)
+{
+  return (uint64_t) value * 0x9e3779b97f4a7c15ULL;
+}
+
+static inline size_t
+profile_filter_index (void *mem)
+{
+  return profile_hash ((uintptr_t) mem) >> (64 - PROFILE_FILTER_BITS);
+}
+
+/* Return the number of bytes to allocate until the next sample.  */
+static size_t
+profile_interval (void)
+{
+  uint64_t x = profile_rng;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  profile_rng = x;
+
+  /* Compute -ln (Q / 2^26) * N for Q uniformly distributed in
+     [1, 2^26], using a quadratic approximation of log2 on [1, 2).  */
+  uint32_t q = (x >> 38) + 1;
+  int e = 31 - __builtin_clz (q);
+  double m = (double) q / (1U << e);
+  double log2q = e + (-0.34484843 * m + 2.02466578) * m - 1.67487759;
+  double interval = (26 - log2q) * 0.6931471805599453
+		    * mp_.profile_sample_bytes;
+  if (interval < 1)
+    return 1;
+  if (interval >= (double) SIZE_MAX)
+    return SIZE_MAX;
+  return interval;
+}
+
+/* Slow path of profile_due.  */
+static bool __attribute_noinline__
+profile_next (size_t bytes)
+{
+  if (profile_busy)
+    return false;
+
+  if (__glibc_unlikely (profile_rng == 0))
+    {
+      /* The first allocation of the thread starts the first
+	 interval.  */
+      profile_rng = ((uint64_t) random_bits () << 32
+		     | (uint32_t) (uintptr_t) &profile_rng) | 1;
+      profile_bytes_left = profile_interval ();
+      return false;
+    }
+
+  /* The sampled allocation is made again by a nested call, which
+     subtracts BYTES from the new interval.  */
+  profile_bytes_left = profile_interval () + bytes;
+  profile_busy = true;
+  return true;
+}
+
+/* Return true if an allocation of BYTES bytes is to be sampled.  The
+   caller then has to repeat the allocation and pass the result to
+   profile_record.  */
+static __always_inline bool
+profile_due (size_t bytes)
+{
+  if (__glibc_likely (mp_.profile_sample_bytes == 0))
+    return false;
+  if (__glibc_likely (profile_bytes_left > bytes))
+    {
+      profile_bytes_left -= bytes;
+      return false;
+    }
+  return profile_next (bytes);
+}
+
+/* Return the index of the stack with DEPTH FRAMES in T, adding it if
+   needed.  Called with profile_lock held.  */
+static unsigned int
+profile_find_stack (struct profile_tables *t, void **frames,
+		    unsigned int depth)
+{
+  uint64_t h = depth;
+  for (unsigned int i = 0; i < depth; ++i)
+    h = profile_hash (h ^ (uintptr_t) frames[i]);
+
+  size_t mask = array_length (t->stack_index) - 1;
+  for (size_t slot = h >> 32 & mask; ; slot = (slot + 1) & mask)
+    {
+      uint32_t index = t->stack_index[slot];
+      if (index == 0)
+	{
+	  if (t->nstacks == PROFILE_MAX_STACKS - 1)
+	    return PROFILE_MAX_STACKS - 1;
+	  index = t->nstacks++;
+	  t->stacks[index].depth = depth;
+	  memcpy (t->stacks[index].frames, frames, depth * sizeof (*frames));
+	  t->stack_index[slot] = index + 1;
+	  return index;
+	}
+
+      struct profile_stack *s = &t->stacks[index - 1];
+      if (s->depth == depth
+	  && memcmp (s->frames, frames, depth * sizeof (*frames)) == 0)
+	return index - 1;
+    }
+}
+
+/* Remove MEM from the live allocations of T, if it is there.  Called
+   with profile_lock held.  */
+static void
+profile_remove_locked (struct profile_tables *t, void *mem)
+{
+  size_t mask = array_length (t->live) - 1;
+  size_t slot = profile_hash ((uintptr_t) mem) >> 32 & mask;
+  while (t->live[slot].mem != mem)
+    {
+      if (t->live[slot].mem == NULL)
+	return;
+      slot = (slot + 1) & mask;
+    }
+
+  struct profile_stack *s = &t->stacks[t->live[slot].stack];
+  s->live_count--;
+  s->live_bytes -= t->live[slot].bytes;
+  size_t f = profile_filter_index (mem);
+  atomic_store_relaxed (&t->filter[f], t->filter[f] - 1);
+  t->nlive--;
+
+  /* Move back the entries which follow in the same cluster, so that
+     lookups do not need tombstones.  */
+  for (size_t next = (slot + 1) & mask; t->live[next].mem != NULL;
+       next = (next + 1) & mask)
+    {
+      size_t home = profile_hash ((uintptr_t) t->live[next].mem) >> 32 & mask;
+      if (((next - home) & mask) >= ((next - slot) & mask))
+	{
+	  t->live[slot] = t->live[next];
+	  slot = next;
+	}
+    }
+  t->live[slot].mem = NULL;
+}
+
+/* Record the sampled allocation MEM of BYTES bytes and return MEM.  */
+static void * __attribute_noinline__
+profile_record (void *mem, size_t bytes)
+{
+  if (mem == NULL)
+    {
+      profile_busy = false;
+      return mem;
+    }
+
+  void *frames[PROFILE_SKIP_FRAMES + PROFILE_MAX_DEPTH];
+  int depth = 0;
+#ifndef SHARED
+  if (__backtrace != NULL)
+#endif
+    depth = __backtrace (frames, array_length (frames));
+  depth = depth > PROFILE_SKIP_FRAMES ? depth - PROFILE_SKIP_FRAMES : 0;
+
+  __libc_lock_lock (profile_lock);
+  struct profile_tables *t = profile_tables;
+  if (t == NULL)
+    {
+      t = MMAP (NULL, ALIGN_UP (sizeof (*t), GLRO (dl_pagesize)),
+		PROT_READ | PROT_WRITE, 0);
+      if (t == MAP_FAILED)
+	{
+	  __libc_lock_unlock (profile_lock);
+	  profile_busy = false;
+	  return mem;
+	}
+      atomic_store_release (&profile_tables, t);
+    }
+
+  unsigned int index = profile_find_stack (t, frames + PROFILE_SKIP_FRAMES,
+					   depth);
+  struct profile_stack *s = &t->stacks[index];
+  s->total_count++;
+  s->total_bytes += bytes;
+
+  /* MEM is not in the table unless it was freed by a function which
+     does not report frees to the profiler.  */
+  size_t f = profile_filter_index (mem);
+  if (t->filter[f] != 0)
+    profile_remove_locked (t, mem);
+
+  if (t->nlive < PROFILE_MAX_LIVE && t->filter[f] < UCHAR_MAX)
+    {
+      size_t mask = array_length (t->live) - 1;
+      size_t slot = profile_hash ((uintptr_t) mem) >> 32 & mask;
+      while (t->live[slot].mem != NULL)
+	slot = (slot + 1) & mask;
+      t->live[slot].mem = mem;
+      t->live[slot].bytes = bytes;
+      t->live[slot].stack = index;
+      t->nlive++;
+      s->live_count++;
+      s->live_bytes += bytes;
+      atomic_store_relaxed (&t->filter[f], t->filter[f] + 1);
+    }
+  __libc_lock_unlock (profile_lock);
+
+  profile_busy = false;
+  return mem;
+}
+
+static void __attribute_noinline__
+profile_remove (struct profile_tables *t, void *mem)
+{
+  __libc_lock_lock (profile_lock);
+  profile_remove_locked (t, mem);
+  __libc_lock_unlock (profile_lock);
+}
+
+/* Tell the profiler that MEM is being freed.  */
+static __always_inline void
+profile_forget (void *mem)
+{
+  struct profile_tables *t = atomic_load_acquire (&profile_tables);
+  if (__glibc_unlikely (t != NULL)
+      && atomic_load_relaxed (&t->filter[profile_filter_index (mem)]) != 0)
+    profile_remove (t, mem);
+}
+
+int
+__malloc_profile_dump (int options, FILE *fp)
+{
+  /* For now, at least.  */
+  if (options != 0)
+    {
+      __set_errno (EINVAL);
+      return -1;
+    }
+
+  /* Work on a copy of the stacks, so that the lock is not held while
+     writing to FP, which can allocate memory.  */
+  size_t copy_size = ALIGN_UP (sizeof (profile_tables->stacks),
+			       GLRO (dl_pagesize));
+  struct profile_stack *stacks = NULL;
+  __libc_lock_lock (profile_lock);
+  if (profile_tables != NULL)
+    {
+      stacks = MMAP (NULL, copy_size, PROT_READ | PROT_WRITE, 0);
+      if (stacks == MAP_FAILED)
+	{
+	  __libc_lock_unlock (profile_lock);
+	  return -1;
+	}
+      memcpy (stacks, profile_tables->stacks, sizeof (profile_tables->stacks));
+    }
+  __libc_lock_unlock (profile_lock);
+
+  size_t live_count = 0, live_bytes = 0, total_count = 0, total_bytes = 0;
+  for (size_t i = 0; stacks != NULL && i < PROFILE_MAX_STACKS; ++i)
+    {
+      live_count += stacks[i].live_count;
+      live_bytes += stacks[i].live_bytes;
+      total_count += stacks[i].total_count;
+      total_bytes += stacks[i].total_bytes;
+    }
+
+  fprintf (fp, "heap profile: %6zu: %8zu [%6zu: %8zu] @ heap_v2/%zu\n",
+	   live_count, live_bytes, total_count, total_bytes,
+	   mp_.profile_sample_bytes);
+  for (size_t i = 0; stacks != NULL && i < PROFILE_MAX_STACKS; ++i)
+    {
+      struct profile_stack *s = &stacks[i];
+      if (s->total_count == 0)
+	continue;
+      fprintf (fp, "%6zu: %8zu [%6zu: %8zu] @",
+	       s->live_count, s->live_bytes, s->total_count, s->total_bytes);
+      for (unsigned int j = 0; j < s->depth; ++j)
+	fprintf (fp, " %#" PRIxPTR, (uintptr_t) s->frames[j]);
+      fputs ("\n", fp);
+    }
+
+  if (stacks != NULL)
+    __munmap (stacks, copy_size);
+
+  /* pprof uses the mappings to symbolize the addresses.  */
+  fputs ("\nMAPPED_LIBRARIES:\n", fp);
+  int fd = __open_nocancel ("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+  if (fd >= 0)
+    {
+      char buffer[1024];
+      ssize_t n;
+      while ((n = __read_nocancel (fd, buffer, sizeof (buffer))) > 0)
+	fwrite (buffer, 1, n, fp);
+      __close_nocancel_nostatus (fd);
+    }
+
+  return 0;
+}
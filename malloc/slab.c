@@ -0,0 +1,565 @@
+/* Slab tier for small allocations.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; see the file COPYING.LIB.  If
+   not, see <https://www.gnu.org/licenses/>.  */
+
+/* If the glibc.malloc.slab tunable is set, requests of up to
+   SLAB_MAX_SIZE bytes are served from slabs instead of chunks.  A slab
+   is a block of SLAB_SIZE bytes, aligned to SLAB_SIZE, which is carved
+   into slots of a single size class.  Slots have no chunk header: the
+   metadata lives in a descriptor at the start of the slab, which is
+   found by masking the address of a slot.  A 16 byte object thus
+   takes 16 bytes instead of a 32 byte chunk.
+
+   All slabs are carved from one region of address space reserved at
+   startup, so that free, realloc and malloc_usable_size can tell slab
+   memory apart from chunks with a range check.  Once the region is used
+   up, small requests are served by the arenas again.
+
+   Each slab belongs to an arena, whose lock protects the descriptor.
+   Threads cache free slots in per-class bins of the tcache, which are
+   refilled from the slabs of the thread's arena and flushed back
+   SLAB_BATCH slots at a time, so that the arena lock is rarely taken.
+   A slab which becomes empty is released with MADV_DONTNEED and can be
+   reused by any arena for any size class, except that an arena keeps
+   its last slab of each size class.  */
+
+#if USE_SLAB
+
+#include <sys/resource.h>
+
+/* Size and alignment of a slab.  */
+#define SLAB_SIZE (64 * 1024)
+
+/* Address space reserved for slabs, unless RLIMIT_AS is lower.  */
+#if __WORDSIZE == 64
+# define SLAB_REGION_SIZE ((size_t) 1024 * 1024 * 1024)
+#else
+# define SLAB_REGION_SIZE ((size_t) 64 * 1024 * 1024)
+#endif
+
+/* Space reserved for the descriptor at the start of each slab.  */
+#define SLAB_HEADER_SIZE SLAB_MAX_SIZE
+
+/* Maximum number of free slots of one size class in a tcache, and the
+   number of slots moved between a tcache and the slabs at once.  */
+#define SLAB_CACHE_COUNT 64
+#define SLAB_BATCH 32
+
+struct slab
+{
+  /* The arena owning the slab.  Its lock protects the other fields,
+     except while the slab is on slab_pool.  */
+  mstate arena;
+  /* Links in the list of slabs with free slots of the arena, or in
+     slab_pool.  */
+  struct slab *next;
+  struct slab *prev;
+  /* Free slots, linked with PROTECT_PTR.  */
+  tcache_entry *free;
+  unsigned int size_class;
+  unsigned int slot_size;
+  unsigned int nslots;
+  /* Number of slots handed out, including those in thread caches.  */
+  unsigned int used;
+  /* Slots from this index on have never been handed out, and are not
+     on the free list.  */
+  unsigned int touched;
+  /* True if the slab is on the list of its arena.  */
+  bool listed;
+};
+
+_Static_assert (sizeof (struct slab) <= SLAB_HEADER_SIZE,
+		"slab descriptor fits in the slab header");
+_Static_assert (SLAB_HEADER_SIZE % MALLOC_ALIGNMENT == 0,
+		"slots are aligned");
+_Static_assert (sizeof (tcache_entry) <= MALLOC_ALIGNMENT,
+		"a free slot can hold a tcache_entry");
+
+/* The region reserved for slabs.  Both are zero if the slab tier is
+   disabled.  They are set before the first allocation and not changed
+   later.  */
+static uintptr_t slab_region_start;
+static size_t slab_region_size;
+
+/* The slabs from slab_region_next to the end of the region have never
+   been used.  Slabs which have been used and released are on
+   slab_pool.  slab_count is the number of slabs owned by arenas.  All
+   three are protected by slab_lock.  */
+static char *slab_region_next;
+static struct slab *slab_pool;
+static size_t slab_count;
+
+/* Called from ptmalloc_init if the slab tier is enabled.  */
+static void
+slab_init (void)
+{
+  /* Tagged memory needs chunk headers.  */
+  if (mtag_enabled)
+    return;
+
+  /* The reservation counts against the address space limit, so leave
+     most of it to the rest of the program.  */
+  size_t region_size = SLAB_REGION_SIZE;
+  struct rlimit limit;
+  if (__getrlimit (RLIMIT_AS, &limit) == 0
+      && limit.rlim_cur != RLIM_INFINITY
+      && limit.rlim_cur / 8 < region_size)
+    region_size = ALIGN_DOWN (limit.rlim_cur / 8, SLAB_SIZE);
+  if (region_size == 0)
+    return;
+
+  /* Reserve the region without committing memory, and cut it down to
+     SLAB_SIZE alignment.  */
+  size_t size = region_size + SLAB_SIZE;
+  char *p = (char *) MMAP (NULL, size, PROT_NONE, MAP_NORESERVE);
+  if (p == MAP_FAILED)
+    return;
+  char *start = PTR_ALIGN_UP (p, SLAB_SIZE);
+  char *end = start + region_size;
+  if (start != p)
+    __munmap (p, start - p);
+  if (end != p + size)
+    __munmap (end, p + size - end);
+
+  slab_region_next = start;
+  slab_region_start = (uintptr_t) start;
+  slab_region_size = region_size;
+}
+
+/* Return true if a request of BYTES should be served from a slab.  */
+static __always_inline bool
+slab_wanted (size_t bytes)
+{
+  return bytes <= SLAB_MAX_SIZE && slab_region_size != 0;
+}
+
+/* Return true if MEM is in the slab region.  This is false for all
+   pointers if the slab tier is disabled.  */
+static __always_inline bool
+slab_contains (void *mem)
+{
+  return (uintptr_t) mem - slab_region_start < slab_region_size;
+}
+
+static __always_inline struct slab *
+slab_of (void *mem)
+{
+  return PTR_ALIGN_DOWN (mem, SLAB_SIZE);
+}
+
+static __always_inline size_t
+slab_class (size_t bytes)
+{
+  return (bytes - (bytes != 0)) / MALLOC_ALIGNMENT;
+}
+
+static __always_inline size_t
+slab_usable_size (void *mem)
+{
+  return slab_of (mem)->slot_size;
+}
+
+static void
+slab_link (mstate av, struct slab *s)
+{
+  struct slab *head = av->slab_partial[s->size_class];
+  s->prev = NULL;
+  s->next = head;
+  if (head != NULL)
+    head->prev = s;
+  av->slab_partial[s->size_class] = s;
+  s->listed = true;
+}
+
+static void
+slab_unlink (mstate av, struct slab *s)
+{
+  if (s->prev != NULL)
+    s->prev->next = s->next;
+  else
+    av->slab_partial[s->size_class] = s->next;
+  if (s->next != NULL)
+    s->next->prev = s->prev;
+  s->listed = false;
+}
+
+/* Return a new slab of size class CLS for AV, which is locked, on the
+   list of AV, or NULL if the slab region is used up.  */
+static struct slab *
+slab_new (mstate av, size_t cls)
+{
+  __libc_lock_lock (slab_lock);
+  struct slab *s = slab_pool;
+  if (s != NULL)
+    slab_pool = s->next;
+  else if (slab_region_next != (char *) slab_region_start + slab_region_size
+	   && __mprotect (slab_region_next, SLAB_SIZE,
+			  PROT_READ | PROT_WRITE) == 0)
+    {
+      s = (struct slab *) slab_region_next;
+      slab_region_next += SLAB_SIZE;
+    }
+  if (s != NULL)
+    ++slab_count;
+  __libc_lock_unlock (slab_lock);
+
+  if (s == NULL)
+    return NULL;
+
+  s->arena = av;
+  s->free = NULL;
+  s->size_class = cls;
+  s->slot_size = (cls + 1) * MALLOC_ALIGNMENT;
+  s->nslots = (SLAB_SIZE - SLAB_HEADER_SIZE) / s->slot_size;
+  s->used = 0;
+  s->touched = 0;
+  slab_link (av, s);
+  return s;
+}
+
+/* Give the empty slab S back to the system, and put it on slab_pool.
+   The descriptor is cleared by MADV_DONTNEED, which makes a later free
+   of one of its slots fail the checks in slab_free.  */
+static void
+slab_release (struct slab *s)
+{
+  __madvise (s, SLAB_SIZE, MADV_DONTNEED);
+
+  __libc_lock_lock (slab_lock);
+  s->next = slab_pool;
+  slab_pool = s;
+  --slab_count;
+  __libc_lock_unlock (slab_lock);
+}
+
+/* Move up to N free slots of size class CLS from the slabs of AV,
+   which is locked, to *LIST.  Return the number of slots moved.  */
+static size_t
+slab_take (mstate av, size_t cls, size_t n, tcache_entry **list)
+{
+  size_t taken = 0;
+  while (taken < n)
+    {
+      struct slab *s = av->slab_partial[cls];
+      if (s == NULL && (s = slab_new (av, cls)) == NULL)
+	break;
+
+      for (; taken < n && s->free != NULL; ++taken)
+	{
+	  tcache_entry *e = s->free;
+	  if (__glibc_unlikely (slab_of (e) != s || !aligned_OK (e)))
+	    malloc_printerr ("malloc(): corrupted slab free list");
+	  s->free = REVEAL_PTR (e->next);
+	  e->next = PROTECT_PTR (&e->next, *list);
+	  *list = e;
+	  ++s->used;
+	}
+      for (; taken < n && s->touched < s->nslots; ++taken)
+	{
+	  tcache_entry *e = (tcache_entry *) ((char *) s + SLAB_HEADER_SIZE
+					      + s->touched * s->slot_size);
+	  e->next = PROTECT_PTR (&e->next, *list);
+	  *list = e;
+	  ++s->touched;
+	  ++s->used;
+	}
+
+      if (s->free == NULL && s->touched == s->nslots)
+	slab_unlink (av, s);
+    }
+  return taken;
+}
+
+/* Return the slot E to its slab S, whose arena is locked.  */
+static void
+slab_put (struct slab *s, tcache_entry *e)
+{
+  mstate av = s->arena;
+
+  e->key = 0;
+  e->next = PROTECT_PTR (&e->next, s->free);
+  s->free = e;
+  --s->used;
+
+  if (!s->listed)
+    slab_link (av, s);
+  else if (s->used == 0 && (s->prev != NULL || s->next != NULL))
+    {
+      slab_unlink (av, s);
+      slab_release (s);
+    }
+}
+
+/* Return the slots on LIST to their slabs, taking each arena lock once
+   for a run of slots from the same arena.  The caller must not hold
+   any arena lock.  */
+static void
+slab_put_list (tcache_entry *list)
+{
+  mstate locked = NULL;
+  while (list != NULL)
+    {
+      if (__glibc_unlikely (!slab_contains (list) || !aligned_OK (list)))
+	malloc_printerr ("free(): invalid slot detected in slab cache");
+      tcache_entry *next = REVEAL_PTR (list->next);
+
+      struct slab *s = slab_of (list);
+      if (s->arena != locked && !SINGLE_THREAD_P)
+	{
+	  if (locked != NULL)
+	    __libc_lock_unlock (locked->mutex);
+	  arena_mutex_lock (s->arena);
+	  locked = s->arena;
+	}
+      slab_put (s, list);
+      list = next;
+    }
+  if (locked != NULL)
+    __libc_lock_unlock (locked->mutex);
+}
+
+/* Caller must ensure that there is room in the bin.  */
+static __always_inline void
+slab_cache_put (tcache_entry *e, size_t cls)
+{
+  e->key = tcache_key;
+  e->next = PROTECT_PTR (&e->next, tcache->slab_entries[cls]);
+  tcache->slab_entries[cls] = e;
+  ++tcache->slab_counts[cls];
+}
+
+/* Caller must ensure that the bin is not empty.  */
+static __always_inline void *
+slab_cache_get (size_t cls)
+{
+  tcache_entry *e = tcache->slab_entries[cls];
+  if (__glibc_unlikely (!aligned_OK (e)))
+    malloc_printerr ("malloc(): unaligned slab slot detected");
+  tcache->slab_entries[cls] = REVEAL_PTR (e->next);
+  --tcache->slab_counts[cls];
+  e->key = 0;
+  return e;
+}
+
+/* Called after a miss in the slab bin CLS of the tcache.  Take a batch
+   of slots from the slabs of the arena of the current thread, return
+   one and cache the others.  */
+static __attribute_noinline__ void *
+slab_malloc_refill (size_t bytes, size_t cls)
+{
+  mstate av;
+  bool locked = !SINGLE_THREAD_P;
+  if (!locked)
+    av = &main_arena;
+  else
+    {
+      arena_get (av, bytes);
+      if (av == NULL)
+	return NULL;
+    }
+
+  tcache_entry *list = NULL;
+  size_t n = slab_take (av, cls, tcache != NULL ? SLAB_BATCH : 1, &list);
+  if (locked)
+    __libc_lock_unlock (av->mutex);
+  if (n == 0)
+    return NULL;
+
+  tcache_entry *victim = list;
+  list = REVEAL_PTR (victim->next);
+  while (list != NULL)
+    {
+      tcache_entry *next = REVEAL_PTR (list->next);
+      slab_cache_put (list, cls);
+      list = next;
+    }
+  victim->key = 0;
+  return victim;
+}
+
+/* Allocate a slot for BYTES <= SLAB_MAX_SIZE.  Return NULL if there is
+   no slab memory left, in which case the request is served by the
+   arenas.  */
+static __always_inline void *
+slab_malloc (size_t bytes)
+{
+  size_t cls = slab_class (bytes);
+
+  MAYBE_INIT_TCACHE ();
+
+  if (tcache != NULL && tcache->slab_counts[cls] > 0)
+    return slab_cache_get (cls);
+  return slab_malloc_refill (bytes, cls);
+}
+
+/* Called when freeing E finds the slab bin CLS of the tcache full.
+   Put E into the bin and release the SLAB_BATCH least recently freed
+   slots of the bin.  */
+static __attribute_noinline__ void
+slab_flush (tcache_entry *e, size_t cls)
+{
+  tcache_entry *last = tcache->slab_entries[cls];
+  for (size_t i = 1; i < SLAB_CACHE_COUNT - SLAB_BATCH; ++i)
+    {
+      if (__glibc_unlikely (!aligned_OK (last)))
+	malloc_printerr ("free(): unaligned slot detected in slab cache");
+      last = REVEAL_PTR (last->next);
+    }
+  if (__glibc_unlikely (!aligned_OK (last)))
+    malloc_printerr ("free(): unaligned slot detected in slab cache");
+  tcache_entry *flush = REVEAL_PTR (last->next);
+  last->next = PROTECT_PTR (&last->next, NULL);
+  tcache->slab_counts[cls] = SLAB_CACHE_COUNT - SLAB_BATCH;
+  slab_cache_put (e, cls);
+
+  slab_put_list (flush);
+}
+
+/* E looks like a slot in a thread cache.  Abort if it is in the cache
+   of the current thread.  */
+static __attribute_noinline__ void
+slab_check_double_free (tcache_entry *e, size_t cls)
+{
+  if (tcache == NULL)
+    return;
+  for (tcache_entry *t = tcache->slab_entries[cls]; t != NULL;
+       t = REVEAL_PTR (t->next))
+    {
+      if (__glibc_unlikely (!aligned_OK (t)))
+	malloc_printerr ("free(): unaligned slot detected in slab cache");
+      if (t == e)
+	malloc_printerr ("free(): double free detected in slab cache");
+    }
+}
+
+/* Free MEM, which is in the slab region.  */
+static void
+slab_free (void *mem)
+{
+  struct slab *s = slab_of (mem);
+  size_t slot_size = s->slot_size;
+  size_t offset = (char *) mem - (char *) s - SLAB_HEADER_SIZE;
+  if (__glibc_unlikely (slot_size == 0
+			|| offset >= (size_t) s->nslots * slot_size
+			|| offset % slot_size != 0))
+    malloc_printerr ("free(): invalid pointer");
+
+  tcache_entry *e = mem;
+  size_t cls = s->size_class;
+  if (__glibc_unlikely (e->key == tcache_key))
+    slab_check_double_free (e, cls);
+
+  MAYBE_INIT_TCACHE ();
+
+  if (tcache == NULL)
+    {
+      e->next = PROTECT_PTR (&e->next, NULL);
+      slab_put_list (e);
+    }
+  else if (tcache->slab_counts[cls] < SLAB_CACHE_COUNT)
+    slab_cache_put (e, cls);
+  else
+    slab_flush (e, cls);
+}
+
+/* Reallocate MEM, which is in the slab region, to BYTES.  */
+static void *
+slab_realloc (void *mem, size_t bytes)
+{
+  size_t usable = slab_usable_size (mem);
+  if (bytes <= usable)
+    return mem;
+
+  void *newmem = __libc_malloc (bytes);
+  if (newmem != NULL)
+    {
+      memcpy (newmem, mem, usable);
+      slab_free (mem);
+    }
+  return newmem;
+}
+
+/* Return the free slots in the thread cache TC, whose thread exits, to
+   their slabs.  */
+static void
+slab_thread_shutdown (struct tcache_perthread_struct *tc)
+{
+  for (size_t cls = 0; cls < SLAB_NCLASSES; ++cls)
+    {
+      slab_put_list (tc->slab_entries[cls]);
+      tc->slab_entries[cls] = NULL;
+      tc->slab_counts[cls] = 0;
+    }
+}
+
+/* Write the slab statistics of malloc_info.  */
+static void
+slab_info (FILE *fp)
+{
+  if (slab_region_size == 0)
+    return;
+
+  __libc_lock_lock (slab_lock);
+  size_t count = slab_count;
+  __libc_lock_unlock (slab_lock);
+  fprintf (fp, "<total type=\"slab\" count=\"%zu\" size=\"%zu\"/>\n",
+	   count, count * SLAB_SIZE);
+}
+
+#else /* !USE_SLAB */
+
+static __always_inline bool
+slab_wanted (size_t bytes)
+{
+  return false;
+}
+
+static __always_inline bool
+slab_contains (void *mem)
+{
+  return false;
+}
+
+static __always_inline void *
+slab_malloc (size_t bytes)
+{
+  return NULL;
+}
+
+static __always_inline void
+slab_free (void *mem)
+{
+}
+
+static __always_inline void *
+slab_realloc (void *mem, size_t bytes)
+{
+  return NULL;
+}
+
+static __always_inline size_t
+slab_usable_size (void *mem)
+{
+  return 0;
+}
+
+static __always_inline void
+slab_info (FILE *fp)
+{
+}
+
+#endif /* !USE_SLAB */
@@ -0,0 +1,150 @@
+/* Test free_sized and free_aligned_sized.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <errno.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+
+enum
+  {
+    max_size = 2048,
+    block_count = 32,
+  };
+
+/* Allocate and free blocks of all sizes up to max_size, and check that
+   their contents are not disturbed by the other frees.  */
+static void
+check_sizes (void)
+{
+  for (size_t size = 0; size <= max_size; size += size < 64 ? 1 : 7)
+    {
+      unsigned char *blocks[block_count];
+      for (int i = 0; i < block_count; ++i)
+	{
+	  switch (i % 3)
+	    {
+	    case 0:
+	      blocks[i] = xmalloc (size);
+	      break;
+	    case 1:
+	      blocks[i] = xcalloc (1, size);
+	      break;
+	    default:
+	      blocks[i] = xrealloc (xmalloc (size / 2 + 1), size);
+	      break;
+	    }
+	  memset (blocks[i], i, size);
+	}
+      for (int i = 0; i < block_count; i += 2)
+	free_sized (blocks[i], size);
+      for (int i = 1; i < block_count; i += 2)
+	{
+	  for (size_t j = 0; j < size; ++j)
+	    TEST_COMPARE (blocks[i][j], i);
+	  free_sized (blocks[i], size);
+	}
+    }
+}
+
+static void
+check_aligned (void)
+{
+  static const size_t sizes[] = { 1, 16, 100, 1000, 100 * 1000 };
+  for (size_t alignment = 16; alignment <= 256 * 1024; alignment *= 4)
+    for (int i = 0; i < array_length (sizes); ++i)
+      {
+	size_t size = sizes[i];
+	void *p = aligned_alloc (alignment, size);
+	TEST_VERIFY_EXIT (p != NULL);
+	TEST_VERIFY (((uintptr_t) p & (alignment - 1)) == 0);
+	memset (p, 0xaa, size);
+	free_aligned_sized (p, alignment, size);
+      }
+}
+
+/* Check that blocks of SIZE bytes do not reuse a large chunk.  */
+static void
+check_small_blocks (size_t size)
+{
+  void *blocks[block_count];
+  for (int i = 0; i < block_count; ++i)
+    {
+      blocks[i] = xmalloc (size);
+      TEST_VERIFY (malloc_usable_size (blocks[i]) < size + 64);
+    }
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i]);
+}
+
+/* A block shrunk by realloc can be freed with free_sized and the new
+   size.  This must not put a large chunk into a bin for small ones.  Each
+   case uses its own size, whose tcache bin is not full yet.  */
+static void
+check_realloc_shrink (void)
+{
+  /* A chunk in an arena.  */
+  void *p = xrealloc (xmalloc (64 * 1024), 16);
+  free_sized (p, 16);
+  check_small_blocks (16);
+
+  /* An mmapped chunk.  This disables the tcache path of free_sized.  */
+  p = xrealloc (xmalloc (1024 * 1024), 100);
+  free_sized (p, 100);
+  check_small_blocks (100);
+}
+
+static int
+do_test (void)
+{
+  free_sized (NULL, 0);
+  free_sized (NULL, 100);
+  free_aligned_sized (NULL, 64, 64);
+
+  check_realloc_shrink ();
+
+  check_sizes ();
+
+  /* Blocks larger than the mmap threshold.  */
+  for (int i = 0; i < 4; ++i)
+    {
+      size_t size = (i + 1) * 256 * 1024;
+      void *p = xmalloc (size);
+      memset (p, 0x55, size);
+      free_sized (p, size);
+    }
+
+  /* Aligned allocations can produce small mmapped chunks, after which
+     free_sized has to look at the chunk headers.  */
+  check_aligned ();
+  check_sizes ();
+
+  /* Like free, free_sized preserves errno.  */
+  void *p = xmalloc (32);
+  errno = 1234;
+  free_sized (p, 32);
+  TEST_COMPARE (errno, 1234);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,170 @@
+/* Test malloc_bulk and free_bulk.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <errno.h>
+#include <libc-diag.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+enum
+  {
+    max_count = 1000,
+    thread_count = 4,
+  };
+
+static const size_t sizes[] =
+  { 0, 1, 24, 100, 1000, 5000, 40000, 300 * 1000 };
+
+static const size_t counts[] = { 0, 1, 7, 100, max_count };
+
+/* Allocate COUNT blocks of SIZE bytes and fill each with its index.  */
+static void
+alloc_blocks (void **blocks, size_t count, size_t size)
+{
+  TEST_COMPARE (malloc_bulk (size, count, blocks), count);
+  for (size_t i = 0; i < count; ++i)
+    {
+      TEST_VERIFY_EXIT (blocks[i] != NULL);
+      TEST_VERIFY (malloc_usable_size (blocks[i]) >= size);
+      memset (blocks[i], i, size);
+    }
+}
+
+/* Check that the blocks still contain their index, so that none of
+   them overlap.  Null pointers are skipped.  */
+static void
+check_blocks (void **blocks, size_t count, size_t size)
+{
+  for (size_t i = 0; i < count; ++i)
+    for (size_t j = 0; blocks[i] != NULL && j < size; ++j)
+      if (((unsigned char *) blocks[i])[j] != (unsigned char) i)
+	FAIL_EXIT1 ("block %zu of size %zu corrupted at offset %zu",
+		    i, size, j);
+}
+
+static void
+check_sizes (void)
+{
+  static void *blocks[max_count];
+  for (size_t i = 0; i < array_length (sizes); ++i)
+    for (size_t j = 0; j < array_length (counts); ++j)
+      {
+	size_t size = sizes[i];
+	size_t count = counts[j];
+	if (size > 100 * 1000 && count > 100)
+	  continue;
+
+	alloc_blocks (blocks, count, size);
+	check_blocks (blocks, count, size);
+
+	/* Free some blocks individually and the rest in bulk, with null
+	   pointers in place of the ones already freed.  */
+	for (size_t k = 0; k < count; k += 5)
+	  {
+	    free (blocks[k]);
+	    blocks[k] = NULL;
+	  }
+	check_blocks (blocks, count, size);
+	free_bulk (count, blocks);
+      }
+
+  /* Blocks freed in bulk are reused.  */
+  alloc_blocks (blocks, 100, 64);
+  free_bulk (100, blocks);
+  alloc_blocks (blocks, 100, 64);
+  check_blocks (blocks, 100, 64);
+  free_bulk (100, blocks);
+}
+
+static void
+check_failure (void)
+{
+  void *blocks[4];
+  errno = 0;
+  DIAG_PUSH_NEEDS_COMMENT;
+#if __GNUC_PREREQ (7, 0)
+  /* GCC 7 warns about too-large allocations; here we want to test
+     that they fail.  */
+  DIAG_IGNORE_NEEDS_COMMENT (7, "-Walloc-size-larger-than=");
+#endif
+  TEST_COMPARE (malloc_bulk (SIZE_MAX / 2, array_length (blocks), blocks), 0);
+  DIAG_POP_NEEDS_COMMENT;
+  TEST_COMPARE (errno, ENOMEM);
+}
+
+/* Each thread allocates blocks in bulk, and frees half of them
+   together with half of the blocks of the next thread, which come from
+   another arena, in one call.  */
+static void *thread_blocks[thread_count][max_count];
+static pthread_barrier_t barrier;
+
+static void *
+thread_func (void *closure)
+{
+  int self = (uintptr_t) closure;
+  void **blocks = thread_blocks[self];
+  void **other = thread_blocks[(self + 1) % thread_count];
+  void *mixed[max_count];
+
+  for (int round = 0; round < 50; ++round)
+    {
+      size_t size = 16 + round * 40;
+      alloc_blocks (blocks, max_count, size);
+      xpthread_barrier_wait (&barrier);
+
+      check_blocks (other, max_count / 2, size);
+      for (int i = 0; i < max_count; i += 2)
+	{
+	  mixed[i] = blocks[i];
+	  mixed[i + 1] = other[i + 1];
+	}
+      xpthread_barrier_wait (&barrier);
+
+      free_bulk (max_count, mixed);
+    }
+  return NULL;
+}
+
+static void
+check_threads (void)
+{
+  xpthread_barrier_init (&barrier, NULL, thread_count);
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, (void *) (uintptr_t) i);
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  xpthread_barrier_destroy (&barrier);
+}
+
+static int
+do_test (void)
+{
+  check_sizes ();
+  check_failure ();
+  check_threads ();
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,177 @@
+/* Test decay purging of free chunks (glibc.malloc.decay_ms).
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The test frees large blocks separated by live blocks, so that they
+   cannot be trimmed, and keeps calling malloc and free until
+   malloc_info reports their pages as purged.  It then checks that the
+   live blocks were not touched and that the purged memory can be
+   allocated again.  */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xstdio.h>
+
+enum
+  {
+    block_count = 16,
+    block_size = 64 * 1024,
+    guard_size = 64,
+  };
+
+/* Return the size reported by malloc_info for the global total of
+   type TYPE, or -1 if there is none.  Store the number of chunks in
+   *COUNTP if COUNTP is not null.  */
+static long
+info_total (const char *type, unsigned long *countp)
+{
+  char *buffer;
+  size_t length;
+  FILE *fp = open_memstream (&buffer, &length);
+  TEST_VERIFY_EXIT (fp != NULL);
+  TEST_COMPARE (malloc_info (0, fp), 0);
+  xfclose (fp);
+
+  /* The global totals follow the last heap.  */
+  char *p = strstr (buffer, "</heap>\n<total");
+  TEST_VERIFY_EXIT (p != NULL);
+  while (strstr (p + 1, "</heap>") != NULL)
+    p = strstr (p + 1, "</heap>");
+
+  char *pattern = xasprintf ("<total type=\"%s\" count=\"", type);
+  long result = -1;
+  p = strstr (p, pattern);
+  if (p != NULL)
+    {
+      unsigned long count, size;
+      TEST_COMPARE (sscanf (p + strlen (pattern), "%lu\" size=\"%lu\"",
+			    &count, &size), 2);
+      result = size;
+      if (countp != NULL)
+	*countp = count;
+    }
+  free (pattern);
+  free (buffer);
+  return result;
+}
+
+/* All chunks of a bin are purged, even if it holds more chunks than
+   a purge step scans.  */
+enum
+  {
+    many_count = 200,
+    many_size = 3 * 4096,
+    /* Too large for the tcache and the fastbins, so that the guards
+       are allocated between the blocks.  */
+    many_guard_size = 1100,
+  };
+
+static void
+check_many_chunks (void)
+{
+  static void *blocks[many_count];
+  static void *guards[many_count];
+
+  for (int i = 0; i < many_count; ++i)
+    {
+      blocks[i] = xmalloc (many_size);
+      memset (blocks[i], 0xaa, many_size);
+      guards[i] = xmalloc (many_guard_size);
+    }
+  for (int i = 0; i < many_count; ++i)
+    free (blocks[i]);
+
+  /* The chunks are sorted into the same large bin by the first
+     malloc.  The chunk allocated and freed in each iteration, and the
+     remainder it is split from, are stamped with the current time
+     again.  */
+  unsigned long dirty = many_count;
+  for (int i = 0; i < 2000 && dirty > 2; ++i)
+    {
+      struct timespec ts = { 0, 1000 * 1000 };
+      nanosleep (&ts, NULL);
+      free (xmalloc (2048));
+      info_total ("dirty", &dirty);
+    }
+  printf ("info: %lu chunks not purged\n", dirty);
+  TEST_VERIFY (dirty <= 2);
+
+  for (int i = 0; i < many_count; ++i)
+    free (guards[i]);
+}
+
+static int
+do_test (void)
+{
+  void *blocks[block_count];
+  void *guards[block_count];
+
+  for (int i = 0; i < block_count; ++i)
+    {
+      blocks[i] = xmalloc (block_size);
+      memset (blocks[i], 0xaa, block_size);
+      guards[i] = xmalloc (guard_size);
+      memset (guards[i], i, guard_size);
+    }
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i]);
+
+  TEST_VERIFY (info_total ("dirty", NULL) >= block_count * (block_size / 2));
+  TEST_COMPARE (info_total ("purged", NULL), 0);
+
+  /* The blocks are purged by the slow paths of malloc and free.  Use
+     requests larger than the tcache and fastbin limits to reach
+     them.  */
+  long purged = 0;
+  for (int i = 0; i < 2000 && purged < block_count * (block_size / 2); ++i)
+    {
+      struct timespec ts = { 0, 1000 * 1000 };
+      nanosleep (&ts, NULL);
+      free (xmalloc (2048));
+      purged = info_total ("purged", NULL);
+    }
+  printf ("info: %ld bytes purged\n", purged);
+  TEST_VERIFY (purged >= block_count * (block_size / 2));
+
+  for (int i = 0; i < block_count; ++i)
+    for (int j = 0; j < guard_size; ++j)
+      TEST_COMPARE (((unsigned char *) guards[i])[j], i);
+
+  /* The purged memory is reused.  */
+  for (int i = 0; i < block_count; ++i)
+    {
+      blocks[i] = xmalloc (block_size);
+      memset (blocks[i], 0x55, block_size);
+    }
+  for (int i = 0; i < block_count; ++i)
+    {
+      for (int j = 0; j < block_size; j += 512)
+	TEST_COMPARE (((unsigned char *) blocks[i])[j], 0x55);
+      free (blocks[i]);
+      free (guards[i]);
+    }
+
+  check_many_chunks ();
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,137 @@
+/* Test that arena heaps grow and shrink in huge page units.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xstdio.h>
+#include <support/xthread.h>
+
+enum
+  {
+    max_arenas = 64,
+    block_count = 100,
+    block_size = 100 * 1000,
+  };
+
+/* The huge page size used by malloc, or 0 if transparent huge pages
+   are not used in madvise mode.  */
+static size_t thp_pagesize;
+
+static size_t snapshot_size
+  = sizeof (struct malloc_stats) + max_arenas * sizeof (struct malloc_arena_stats);
+
+static size_t
+read_thp_pagesize (void)
+{
+  FILE *f = fopen ("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  if (f == NULL)
+    return 0;
+  char mode[128];
+  bool madvise = fgets (mode, sizeof (mode), f) != NULL
+		 && strstr (mode, "[madvise]") != NULL;
+  xfclose (f);
+  if (!madvise)
+    return 0;
+
+  f = fopen ("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+  if (f == NULL)
+    return 0;
+  unsigned long size;
+  if (fscanf (f, "%lu", &size) != 1)
+    size = 0;
+  xfclose (f);
+  return size;
+}
+
+/* Check that every arena other than the main arena is made of whole
+   huge pages, all of which are counted as such.  Return the memory of
+   the largest one.  */
+static size_t
+check_arenas (void)
+{
+  struct malloc_stats *stats = xmalloc (snapshot_size);
+  TEST_COMPARE (malloc_stats_snapshot (stats, snapshot_size), 0);
+  size_t count = stats->narenas < max_arenas ? stats->narenas : max_arenas;
+  TEST_VERIFY (count >= 1);
+
+  /* The main arena is only partly covered by huge pages.  */
+  TEST_VERIFY (stats->arenas[0].huge_page_bytes
+	       <= stats->arenas[0].system_bytes);
+  TEST_COMPARE (stats->arenas[0].huge_page_bytes % thp_pagesize, 0);
+
+  size_t largest = 0;
+  for (size_t i = 1; i < count; ++i)
+    {
+      size_t system = stats->arenas[i].system_bytes;
+      if (system % thp_pagesize != 0)
+	FAIL_EXIT1 ("arena %zu: system_bytes %zu not a multiple of %zu",
+	      i, system, thp_pagesize);
+      TEST_COMPARE (stats->arenas[i].huge_page_bytes, system);
+      if (system > largest)
+	largest = system;
+    }
+  free (stats);
+  return largest;
+}
+
+static void *
+thread_func (void *closure)
+{
+  void *blocks[block_count];
+  for (int i = 0; i < block_count; ++i)
+    {
+      blocks[i] = xmalloc (block_size);
+      memset (blocks[i], i, block_size);
+    }
+  TEST_VERIFY (check_arenas () >= block_count * block_size);
+
+  /* Freeing the blocks shrinks the heap, but only by whole huge
+     pages.  */
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i]);
+  check_arenas ();
+
+  /* malloc_info reports the huge page coverage of each heap.  */
+  char *buffer;
+  size_t length;
+  FILE *f = open_memstream (&buffer, &length);
+  TEST_VERIFY_EXIT (f != NULL);
+  TEST_COMPARE (malloc_info (0, f), 0);
+  xfclose (f);
+  TEST_VERIFY (strstr (buffer, "<aspace type=\"huge\"") != NULL);
+  free (buffer);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  thp_pagesize = read_thp_pagesize ();
+  if (thp_pagesize == 0)
+    FAIL_UNSUPPORTED ("transparent huge pages not in madvise mode");
+
+  xpthread_join (xpthread_create (NULL, thread_func, NULL));
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,159 @@
+/* Test NUMA node local arenas with a simulated topology.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <malloc.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+/* The test runs with glibc.malloc.numa_nodes set to this value, so
+   CPU N is on node N % nodes, and glibc.malloc.arena_max=1.  */
+enum
+  {
+    nodes = 2,
+    max_arenas = 64,
+    max_cpus = 8,
+    block_count = 50,
+    block_size = 2000,
+  };
+
+static size_t snapshot_size
+  = sizeof (struct malloc_stats) + max_arenas * sizeof (struct malloc_arena_stats);
+
+static struct malloc_stats *
+snapshot (void)
+{
+  struct malloc_stats *stats = xmalloc (snapshot_size);
+  TEST_COMPARE (malloc_stats_snapshot (stats, snapshot_size), 0);
+  TEST_VERIFY_EXIT (stats->narenas <= max_arenas);
+  return stats;
+}
+
+/* Allocate some blocks and return the NUMA node of the arena which
+   served them.  */
+static int
+allocation_node (void)
+{
+  void *blocks[block_count];
+  struct malloc_stats *before = snapshot ();
+  for (int i = 0; i < block_count; ++i)
+    blocks[i] = xmalloc (block_size);
+  struct malloc_stats *after = snapshot ();
+
+  int node = -2;
+  for (size_t i = 0; i < before->narenas; ++i)
+    if (after->arenas[i].allocs - before->arenas[i].allocs >= block_count)
+      node = after->arenas[i].numa_node;
+  /* An arena may have been created for the blocks.  */
+  for (size_t i = before->narenas; i < after->narenas; ++i)
+    if (after->arenas[i].allocs >= block_count)
+      node = after->arenas[i].numa_node;
+  if (node == -2)
+    FAIL_EXIT1 ("no arena served the allocations");
+
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i]);
+  free (after);
+  free (before);
+  return node;
+}
+
+static void
+pin (int cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO (&set);
+  CPU_SET (cpu, &set);
+  TEST_COMPARE (sched_setaffinity (0, sizeof (set), &set), 0);
+  TEST_COMPARE (sched_getcpu (), cpu);
+}
+
+static void *
+thread_func (void *closure)
+{
+  int cpu = (int) (intptr_t) closure;
+  pin (cpu);
+  TEST_COMPARE (allocation_node (), cpu % nodes);
+  return NULL;
+}
+
+/* CLOSURE is the pair of CPUs on different nodes to run on.  */
+static void *
+migrate_func (void *closure)
+{
+  int *cpus = closure;
+  pin (cpus[0]);
+  TEST_COMPARE (allocation_node (), cpus[0] % nodes);
+  pin (cpus[1]);
+  TEST_COMPARE (allocation_node (), cpus[1] % nodes);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  if (sched_getcpu () < 0)
+    FAIL_UNSUPPORTED ("sched_getcpu not supported");
+
+  cpu_set_t set;
+  TEST_COMPARE (sched_getaffinity (0, sizeof (set), &set), 0);
+  int cpus[max_cpus];
+  int ncpus = 0;
+  for (int cpu = 0; cpu < CPU_SETSIZE && ncpus < max_cpus; ++cpu)
+    if (CPU_ISSET (cpu, &set))
+      cpus[ncpus++] = cpu;
+  TEST_VERIFY_EXIT (ncpus > 0);
+
+  /* The main arena serves the node of the initial thread.  */
+  pin (cpus[0]);
+  TEST_COMPARE (allocation_node (), cpus[0] % nodes);
+
+  /* Each thread uses an arena of its node, even if arena_max is
+     reached.  */
+  for (int i = 0; i < ncpus; ++i)
+    xpthread_join (xpthread_create (NULL, thread_func,
+				    (void *) (intptr_t) cpus[i]));
+
+  /* A thread which moves to another node switches arenas.  */
+  for (int i = 1; i < ncpus; ++i)
+    if (cpus[i] % nodes != cpus[0] % nodes)
+      {
+	int pair[2] = { cpus[0], cpus[i] };
+	xpthread_join (xpthread_create (NULL, migrate_func, pair));
+	break;
+      }
+
+  /* All arenas are tagged with a simulated node.  */
+  struct malloc_stats *stats = snapshot ();
+  for (size_t i = 0; i < stats->narenas; ++i)
+    {
+      TEST_VERIFY (stats->arenas[i].numa_node >= 0);
+      TEST_VERIFY (stats->arenas[i].numa_node < nodes);
+    }
+  if (ncpus == 1)
+    TEST_COMPARE (stats->narenas, 1);
+  else
+    TEST_VERIFY (stats->narenas <= nodes);
+  free (stats);
+  return 0;
+}
+
+#include <support/test-driver.c>
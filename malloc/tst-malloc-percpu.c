@@ -0,0 +1,159 @@
+/* Test per-CPU arena selection (glibc.malloc.percpu=1).
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The test pins several threads to each of a few CPUs and has them
+   allocate concurrently.  With per-CPU arenas, the number of arenas
+   must be bounded by the number of CPUs used, not by the number of
+   threads.  The threads then migrate between CPUs and free memory
+   allocated on a different CPU, to exercise arena re-attachment.  */
+
+#include <malloc.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/rseq.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xstdio.h>
+#include <support/xthread.h>
+
+enum
+  {
+    /* Maximum number of CPUs the test uses.  */
+    max_cpus = 8,
+
+    /* Number of threads pinned to each CPU.  */
+    threads_per_cpu = 4,
+
+    /* Number of live allocations per thread.  */
+    allocations = 256,
+  };
+
+static int cpus[max_cpus];
+static int cpu_count;
+
+static pthread_barrier_t barrier;
+
+static void
+pin (int cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO (&set);
+  CPU_SET (cpu, &set);
+  int ret = pthread_setaffinity_np (pthread_self (), sizeof (set), &set);
+  if (ret != 0)
+    FAIL_EXIT1 ("pthread_setaffinity_np (%d): %d", cpu, ret);
+}
+
+static void *
+thread_function (void *closure)
+{
+  int index = (uintptr_t) closure;
+  void *blocks[allocations];
+
+  pin (cpus[index % cpu_count]);
+
+  /* Wait until all threads have been pinned, so that the allocations
+     below happen concurrently.  */
+  xpthread_barrier_wait (&barrier);
+  for (int i = 0; i < allocations; ++i)
+    {
+      blocks[i] = xmalloc (16 + (i % 64) * 16);
+      memset (blocks[i], index, 16);
+    }
+
+  /* The main thread counts the arenas here.  */
+  xpthread_barrier_wait (&barrier);
+  xpthread_barrier_wait (&barrier);
+
+  /* Move to another CPU, and free the blocks allocated on the
+     previous one there, interleaved with new allocations.  */
+  pin (cpus[(index + 1) % cpu_count]);
+  for (int i = 0; i < allocations; ++i)
+    {
+      TEST_VERIFY (*(unsigned char *) blocks[i] == (unsigned char) index);
+      free (blocks[i]);
+      blocks[i] = xmalloc (i + 1);
+    }
+  for (int i = 0; i < allocations; ++i)
+    free (blocks[i]);
+
+  return NULL;
+}
+
+/* Return the number of arenas reported by malloc_info.  */
+static int
+count_arenas (void)
+{
+  char *buffer;
+  size_t length;
+  FILE *fp = open_memstream (&buffer, &length);
+  TEST_VERIFY_EXIT (fp != NULL);
+  TEST_COMPARE (malloc_info (0, fp), 0);
+  xfclose (fp);
+
+  int count = 0;
+  for (const char *p = buffer; (p = strstr (p, "<heap nr=")) != NULL; ++p)
+    ++count;
+  free (buffer);
+  return count;
+}
+
+static int
+do_test (void)
+{
+  if (__rseq_size == 0 || sched_getcpu () < 0)
+    FAIL_UNSUPPORTED ("restartable sequences not available");
+
+  cpu_set_t set;
+  if (sched_getaffinity (0, sizeof (set), &set) != 0)
+    FAIL_EXIT1 ("sched_getaffinity: %m");
+  for (int cpu = 0; cpu < CPU_SETSIZE && cpu_count < max_cpus; ++cpu)
+    if (CPU_ISSET (cpu, &set))
+      cpus[cpu_count++] = cpu;
+  TEST_VERIFY_EXIT (cpu_count > 0);
+  printf ("info: using %d CPUs\n", cpu_count);
+
+  int thread_count = cpu_count * threads_per_cpu;
+  xpthread_barrier_init (&barrier, NULL, thread_count + 1);
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_function,
+				  (void *) (uintptr_t) i);
+
+  xpthread_barrier_wait (&barrier);
+  xpthread_barrier_wait (&barrier);
+
+  /* One arena per CPU used by the allocating threads, plus possibly
+     one for the CPU the main thread runs on.  Without per-CPU arenas,
+     each thread would get its own arena.  */
+  int arenas = count_arenas ();
+  printf ("info: %d threads, %d arenas\n", thread_count, arenas);
+  TEST_VERIFY (arenas <= cpu_count + 1);
+
+  xpthread_barrier_wait (&barrier);
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+
+  TEST_VERIFY (count_arenas () <= cpu_count + 1);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
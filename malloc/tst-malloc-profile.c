@@ -0,0 +1,137 @@
+/* Test the heap profiler (glibc.malloc.profile_sample_bytes).
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The test runs with a sample period of 4096 bytes, allocates about
+   1 MB, and checks that the profile reports the expected number of
+   live samples with backtraces, and that they are gone once the
+   memory is freed.  */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xstdio.h>
+
+enum
+  {
+    block_count = 1000,
+    block_size = 1000,
+  };
+
+struct profile
+{
+  unsigned long live_count, live_bytes, total_count, total_bytes;
+  unsigned long period;
+  int stacks;
+  int stacks_with_frames;
+};
+
+static struct profile
+dump (void)
+{
+  char *buffer;
+  size_t length;
+  FILE *fp = open_memstream (&buffer, &length);
+  TEST_VERIFY_EXIT (fp != NULL);
+  TEST_COMPARE (malloc_profile_dump (0, fp), 0);
+  xfclose (fp);
+
+  struct profile result = { 0 };
+  TEST_COMPARE (sscanf (buffer,
+			"heap profile: %lu: %lu [%lu: %lu] @ heap_v2/%lu\n",
+			&result.live_count, &result.live_bytes,
+			&result.total_count, &result.total_bytes,
+			&result.period), 5);
+
+  char *maps = strstr (buffer, "\nMAPPED_LIBRARIES:\n");
+  TEST_VERIFY_EXIT (maps != NULL);
+  *maps = '\0';
+  for (char *line = strchr (buffer, '\n'); line != NULL && line[1] != '\0';
+       line = strchr (line + 1, '\n'))
+    {
+      char *at = strchr (line, '@');
+      TEST_VERIFY_EXIT (at != NULL);
+      ++result.stacks;
+      if (strncmp (at, "@ 0x", 4) == 0)
+	++result.stacks_with_frames;
+    }
+
+  free (buffer);
+  return result;
+}
+
+static void * __attribute__ ((noinline, noclone))
+allocate_block (void)
+{
+  void *p = xmalloc (block_size);
+  memset (p, 0xaa, block_size);
+  return p;
+}
+
+static int
+do_test (void)
+{
+  FILE *fp = xfopen ("/dev/null", "w");
+  errno = 0;
+  TEST_COMPARE (malloc_profile_dump (1, fp), -1);
+  TEST_COMPARE (errno, EINVAL);
+  xfclose (fp);
+
+  static void *blocks[block_count];
+  for (int i = 0; i < block_count; ++i)
+    blocks[i] = allocate_block ();
+
+  struct profile before = dump ();
+  printf ("info: %lu live samples of %lu bytes, %d stacks\n",
+	  before.live_count, before.live_bytes, before.stacks);
+  TEST_COMPARE (before.period, 4096);
+  /* About 1000 * 1000 / 4096 samples are expected.  */
+  TEST_VERIFY (before.live_count >= 100);
+  TEST_VERIFY (before.live_bytes >= 100 * block_size);
+  TEST_VERIFY (before.total_count >= before.live_count);
+  TEST_VERIFY (before.total_bytes >= before.live_bytes);
+  TEST_VERIFY (before.stacks_with_frames > 0);
+
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i]);
+
+  struct profile after = dump ();
+  printf ("info: %lu live samples of %lu bytes after free\n",
+	  after.live_count, after.live_bytes);
+  TEST_VERIFY (after.live_bytes < before.live_bytes - 100 * block_size);
+  TEST_VERIFY (after.total_count >= before.total_count);
+  TEST_VERIFY (after.total_bytes >= before.total_bytes);
+
+  /* Samples are also taken from the other allocation functions.  */
+  for (int i = 0; i < block_count; ++i)
+    {
+      blocks[i] = xcalloc (1, block_size);
+      blocks[i] = xrealloc (blocks[i], 2 * block_size);
+    }
+  struct profile more = dump ();
+  TEST_VERIFY (more.live_bytes >= after.live_bytes + 100 * block_size);
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i]);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,61 @@
+/* Test that a double free of a chunk queued on a remote arena aborts.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+/* Too large for the tcache and the fastbins.  */
+enum { size = 2000 };
+
+static void *blocks[5];
+
+static void *
+thread_function (void *closure)
+{
+  /* Attach this thread to an arena of its own, so that the frees below
+     are queued on the arena of the main thread.  */
+  free (xmalloc (1));
+
+  free (blocks[1]);
+  free (blocks[3]);
+  /* BLOCKS[1] is queued, but not at the head of the queue.  */
+  free (blocks[1]);
+  /* Merge the queue.  */
+  blocks[0] = malloc (size);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  /* The blocks in between keep the others from being merged.  */
+  for (int i = 0; i < 5; ++i)
+    blocks[i] = xmalloc (size);
+
+  xpthread_join (xpthread_create (NULL, thread_function, NULL));
+  free (malloc (size));
+
+  printf ("FAIL: remote double free not detected\n");
+  return 1;
+}
+
+#define EXPECTED_SIGNAL SIGABRT
+#include <support/test-driver.c>
@@ -0,0 +1,143 @@
+/* Test frees of blocks allocated from another thread's arena.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* Producer threads allocate blocks too large for the tcache and the
+   fastbins, and consumer threads free them.  Such frees are queued on
+   the remote free list of the producer's arena and merged by the
+   producer on its next allocation.  The producers keep some blocks
+   alive and check that they are not overwritten by the merging of
+   neighbouring chunks.  */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+enum
+  {
+    pair_count = 3,
+    batch = 200,
+    rounds = 100,
+  };
+
+static pthread_barrier_t barrier;
+
+/* Blocks handed from producer I to consumer I.  */
+static void *handoff[pair_count][batch];
+
+static size_t
+block_size (int round, int i)
+{
+  return 1100 + ((round * batch + i) % 37) * 64;
+}
+
+static void
+check (const unsigned char *p, size_t size, unsigned char value)
+{
+  for (size_t i = 0; i < size; ++i)
+    if (p[i] != value)
+      FAIL_EXIT1 ("block %p corrupted at offset %zu: %d != %d",
+		  p, i, p[i], value);
+}
+
+static void *
+producer_function (void *closure)
+{
+  int self = (uintptr_t) closure;
+  void *kept[batch / 2];
+
+  for (int round = 0; round < rounds; ++round)
+    {
+      unsigned char value = self * rounds + round;
+      for (int i = 0; i < batch; ++i)
+	{
+	  size_t size = block_size (round, i);
+	  void *p = xmalloc (size);
+	  memset (p, value, size);
+	  /* Keep every other block, so that the chunks freed remotely
+	     have in-use neighbours.  */
+	  if (i % 2 == 0)
+	    kept[i / 2] = p;
+	  else
+	    handoff[self][i] = p;
+	}
+
+      xpthread_barrier_wait (&barrier);
+      /* The consumers free the handed-off blocks here.  */
+      xpthread_barrier_wait (&barrier);
+
+      for (int i = 0; i < batch; i += 2)
+	{
+	  check (kept[i / 2], block_size (round, i), value);
+	  free (kept[i / 2]);
+	}
+    }
+
+  return NULL;
+}
+
+static void *
+consumer_function (void *closure)
+{
+  int self = (uintptr_t) closure;
+
+  /* Attach this thread to an arena of its own.  */
+  free (xmalloc (1));
+
+  for (int round = 0; round < rounds; ++round)
+    {
+      unsigned char value = self * rounds + round;
+      xpthread_barrier_wait (&barrier);
+      for (int i = 1; i < batch; i += 2)
+	{
+	  check (handoff[self][i], block_size (round, i), value);
+	  free (handoff[self][i]);
+	}
+      xpthread_barrier_wait (&barrier);
+    }
+
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  xpthread_barrier_init (&barrier, NULL, 2 * pair_count);
+
+  pthread_t threads[2 * pair_count];
+  for (int i = 0; i < pair_count; ++i)
+    {
+      threads[2 * i] = xpthread_create (NULL, producer_function,
+					(void *) (uintptr_t) i);
+      threads[2 * i + 1] = xpthread_create (NULL, consumer_function,
+					    (void *) (uintptr_t) i);
+    }
+  for (int i = 0; i < 2 * pair_count; ++i)
+    xpthread_join (threads[i]);
+
+  /* Merge the chunks still queued on the producer arenas.  */
+  TEST_COMPARE (malloc_trim (0) >= 0, 1);
+  struct mallinfo2 mi = mallinfo2 ();
+  TEST_VERIFY (mi.uordblks < 1024 * 1024);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,203 @@
+/* Test the slab tier for small allocations (glibc.malloc.slab).
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The test runs with glibc.malloc.slab=1.  */
+
+#include <malloc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+enum
+  {
+    max_size = 64,
+    alignment = __alignof__ (max_align_t),
+    block_count = 1000,
+    /* Enough blocks to use many slabs.  */
+    many_count = 100 * 1000,
+    thread_count = 4,
+  };
+
+/* Return the number of slabs reported by malloc_info.  */
+static size_t
+slab_count (void)
+{
+  char *buffer;
+  size_t length;
+  FILE *fp = open_memstream (&buffer, &length);
+  TEST_VERIFY_EXIT (fp != NULL);
+  TEST_COMPARE (malloc_info (0, fp), 0);
+  TEST_COMPARE (fclose (fp), 0);
+
+  size_t count = 0;
+  char *slab = strstr (buffer, "<total type=\"slab\"");
+  TEST_VERIFY (slab != NULL);
+  if (slab != NULL)
+    TEST_COMPARE (sscanf (slab, "<total type=\"slab\" count=\"%zu\"", &count),
+		  1);
+  free (buffer);
+  return count;
+}
+
+static void
+check_sizes (void)
+{
+  for (size_t size = 0; size <= max_size; ++size)
+    {
+      unsigned char *blocks[block_count];
+      for (int i = 0; i < block_count; ++i)
+	{
+	  blocks[i] = xmalloc (size);
+	  TEST_VERIFY (((uintptr_t) blocks[i] & (alignment - 1)) == 0);
+	  /* Slots are rounded up to the alignment only.  */
+	  size_t usable = malloc_usable_size (blocks[i]);
+	  TEST_VERIFY (usable >= size);
+	  TEST_VERIFY (usable < size + alignment || usable == alignment);
+	  memset (blocks[i], i, usable);
+	}
+      for (int i = 0; i < block_count; i += 2)
+	free (blocks[i]);
+      for (int i = 1; i < block_count; i += 2)
+	{
+	  for (size_t j = 0; j < malloc_usable_size (blocks[i]); ++j)
+	    TEST_COMPARE (blocks[i][j], i & 0xff);
+	  free_sized (blocks[i], size);
+	}
+    }
+}
+
+static void
+check_calloc_realloc (void)
+{
+  /* calloc clears slots which have been used before.  */
+  unsigned char *p = xmalloc (48);
+  memset (p, 0xff, 48);
+  free (p);
+  for (int i = 0; i < block_count; ++i)
+    {
+      p = xcalloc (1, 48);
+      for (int j = 0; j < 48; ++j)
+	TEST_COMPARE (p[j], 0);
+      memset (p, 0xff, 48);
+      free (p);
+    }
+
+  /* realloc keeps the slot if the new size fits, and moves the
+     contents out of the slab otherwise.  */
+  p = xmalloc (20);
+  memset (p, 0x5a, 20);
+  TEST_VERIFY (xrealloc (p, 10) == p);
+  TEST_VERIFY (xrealloc (p, 32) == p);
+  unsigned char *q = xrealloc (p, 1000);
+  for (int j = 0; j < 20; ++j)
+    TEST_COMPARE (q[j], 0x5a);
+  TEST_VERIFY (malloc_usable_size (q) >= 1000);
+  q = xrealloc (q, 8);
+  TEST_COMPARE (q[0], 0x5a);
+  free (q);
+}
+
+static void
+check_many (void)
+{
+  size_t before = slab_count ();
+  static void *blocks[many_count];
+  for (int i = 0; i < many_count; ++i)
+    blocks[i] = xmalloc (i % max_size + 1);
+  size_t during = slab_count ();
+  printf ("info: %zu slabs before, %zu slabs during\n", before, during);
+  /* 100000 blocks of 32 bytes on average need more than 50 slabs of
+     64 KiB.  */
+  TEST_VERIFY (during >= before + 50);
+  for (int i = 0; i < many_count; ++i)
+    free (blocks[i]);
+  size_t after = slab_count ();
+  printf ("info: %zu slabs after\n", after);
+  TEST_VERIFY (after < during);
+}
+
+/* Blocks allocated by one thread and freed by another.  */
+static void *exchange[thread_count][block_count];
+
+static void *
+thread_func (void *closure)
+{
+  int index = (uintptr_t) closure;
+  for (int i = 0; i < block_count; ++i)
+    {
+      exchange[index][i] = xmalloc (i % max_size);
+      memset (exchange[index][i], index, i % max_size);
+    }
+  /* Leave blocks in the thread cache when the thread exits.  */
+  for (int i = 0; i < 10; ++i)
+    free (xmalloc (16));
+  return NULL;
+}
+
+static void
+check_threads (void)
+{
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, (void *) (uintptr_t) i);
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  for (int t = 0; t < thread_count; ++t)
+    for (int i = 0; i < block_count; ++i)
+      {
+	unsigned char *p = exchange[t][i];
+	for (int j = 0; j < i % max_size; ++j)
+	  TEST_COMPARE (p[j], t);
+	free (p);
+      }
+}
+
+static int
+do_test (void)
+{
+  /* The header-less slots are smaller than the smallest chunk.  */
+  void *p = xmalloc (1);
+  TEST_COMPARE (malloc_usable_size (p), alignment);
+  free (p);
+
+  check_sizes ();
+  check_calloc_realloc ();
+  check_many ();
+  check_threads ();
+
+  /* The slab tier keeps working in a forked child.  */
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      check_sizes ();
+      _exit (0);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,167 @@
+/* Test malloc_stats_snapshot.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+enum
+  {
+    max_arenas = 64,
+    thread_count = 4,
+    iterations = 1000,
+    small_size = 40,
+    large_size = 100 * 1000,
+    bulk_size = 200,
+    bulk_count = 30,
+  };
+
+static size_t snapshot_size
+  = sizeof (struct malloc_stats) + max_arenas * sizeof (struct malloc_arena_stats);
+
+static struct malloc_stats *
+snapshot (void)
+{
+  struct malloc_stats *stats = xmalloc (snapshot_size);
+  TEST_COMPARE (malloc_stats_snapshot (stats, snapshot_size), 0);
+  TEST_VERIFY (stats->narenas >= 1);
+  TEST_VERIFY (stats->ntcache_bins <= MALLOC_STATS_TCACHE_BINS);
+  return stats;
+}
+
+/* Return the number of allocations served by the thread caches for
+   requests of SIZE bytes.  */
+static size_t
+tcache_allocs (struct malloc_stats *stats, size_t size)
+{
+  for (size_t i = 0; i < stats->ntcache_bins; ++i)
+    if (stats->tcache_bins[i].size >= size)
+      return stats->tcache_bins[i].allocs;
+  return 0;
+}
+
+/* Likewise for the allocations which found the thread cache empty.  */
+static size_t
+tcache_misses (struct malloc_stats *stats, size_t size)
+{
+  for (size_t i = 0; i < stats->ntcache_bins; ++i)
+    if (stats->tcache_bins[i].size >= size)
+      return stats->tcache_bins[i].misses;
+  return 0;
+}
+
+static void *
+thread_func (void *closure)
+{
+  for (int i = 0; i < iterations; ++i)
+    {
+      void *p = xmalloc (small_size);
+      /* Avoid optimizing out the allocation.  */
+      memset (p, 0, small_size);
+      free (p);
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  /* A buffer which is too small is rejected.  */
+  struct malloc_stats small;
+  errno = 0;
+  TEST_COMPARE (malloc_stats_snapshot (&small, sizeof (small) - 1), -1);
+  TEST_COMPARE (errno, EINVAL);
+
+  /* A buffer without room for the arenas still reports their number.  */
+  TEST_COMPARE (malloc_stats_snapshot (&small, sizeof (small)), 0);
+  TEST_VERIFY (small.narenas >= 1);
+
+  struct malloc_stats *before = snapshot ();
+
+  /* Allocations from the main arena are visible in its counters.  */
+  void *large = xmalloc (large_size);
+  memset (large, 0, large_size);
+  struct malloc_stats *during = snapshot ();
+  TEST_VERIFY (during->arenas[0].allocs > before->arenas[0].allocs);
+  TEST_VERIFY (during->arenas[0].bytes_in_use >= large_size);
+  TEST_VERIFY (during->arenas[0].system_bytes >= large_size);
+  free (large);
+  struct malloc_stats *after = snapshot ();
+  TEST_VERIFY (after->arenas[0].frees > during->arenas[0].frees);
+  TEST_VERIFY (after->arenas[0].bytes_in_use
+	       < during->arenas[0].bytes_in_use);
+
+  /* The thread cache counters of threads are kept after they exit.  */
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, NULL);
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  struct malloc_stats *joined = snapshot ();
+  TEST_VERIFY (joined->narenas >= 1);
+  if (joined->ntcache_bins > 0)
+    TEST_VERIFY (tcache_allocs (joined, small_size)
+		 >= tcache_allocs (after, small_size)
+		    + thread_count * (iterations - 1));
+
+  /* Each block allocated by malloc_bulk is either taken from the
+     thread cache or allocated after a miss, including the blocks taken
+     from the cache after _int_malloc refilled it.  */
+  void *blocks[bulk_count];
+  TEST_COMPARE (malloc_bulk (bulk_size, bulk_count, blocks), bulk_count);
+  free_bulk (bulk_count, blocks);
+  struct malloc_stats *freed = snapshot ();
+  TEST_COMPARE (malloc_bulk (bulk_size, bulk_count, blocks), bulk_count);
+  struct malloc_stats *bulk = snapshot ();
+  free_bulk (bulk_count, blocks);
+  if (bulk->ntcache_bins > 0)
+    TEST_COMPARE (tcache_allocs (bulk, bulk_size)
+		  + tcache_misses (bulk, bulk_size)
+		  - tcache_allocs (freed, bulk_size)
+		  - tcache_misses (freed, bulk_size), bulk_count);
+  free (bulk);
+  free (freed);
+
+  /* Only the forking thread's cache remains in the child.  */
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      struct malloc_stats *child = snapshot ();
+      TEST_VERIFY (tcache_allocs (child, small_size)
+		   >= tcache_allocs (joined, small_size));
+      free (child);
+      thread_func (NULL);
+      _exit (0);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+
+  free (joined);
+  free (after);
+  free (during);
+  free (before);
+  return 0;
+}
+
+#include <support/test-driver.c>
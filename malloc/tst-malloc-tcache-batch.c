@@ -0,0 +1,131 @@
+/* Test batched tcache refill and flush (glibc.malloc.tcache_batch).
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The test runs with a tcache batch size smaller than the tcache
+   count, so that both partial and complete flushes happen.  Each
+   thread allocates and frees bursts of blocks of the same size, and
+   also frees blocks allocated by its neighbour, so that flushed
+   batches contain chunks from several arenas.  */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+enum
+  {
+    thread_count = 4,
+    burst = 100,
+    rounds = 200,
+  };
+
+static pthread_barrier_t barrier;
+
+/* Blocks handed from thread I to thread I + 1.  */
+static void *handoff[thread_count][burst];
+
+static void
+fill (unsigned char *p, size_t size, unsigned char value)
+{
+  memset (p, value, size);
+}
+
+static void
+check (const unsigned char *p, size_t size, unsigned char value)
+{
+  for (size_t i = 0; i < size; ++i)
+    if (p[i] != value)
+      FAIL_EXIT1 ("block %p corrupted at offset %zu: %d != %d",
+		  p, i, p[i], value);
+}
+
+static void *
+thread_function (void *closure)
+{
+  int self = (uintptr_t) closure;
+  void *blocks[burst];
+
+  for (int round = 0; round < rounds; ++round)
+    {
+      size_t size = 8 + (round % 32) * 16;
+      unsigned char value = self * rounds + round;
+
+      for (int i = 0; i < burst; ++i)
+	{
+	  blocks[i] = xmalloc (size);
+	  fill (blocks[i], size, value);
+	}
+      for (int i = 0; i < burst; ++i)
+	check (blocks[i], size, value);
+
+      /* Free every other block locally, and hand the rest to the
+	 next thread.  */
+      for (int i = 0; i < burst; i += 2)
+	free (blocks[i]);
+      for (int i = 1; i < burst; i += 2)
+	handoff[self][i] = blocks[i];
+
+      xpthread_barrier_wait (&barrier);
+      int prev = (self + thread_count - 1) % thread_count;
+      unsigned char prev_value = prev * rounds + round;
+      for (int i = 1; i < burst; i += 2)
+	{
+	  check (handoff[prev][i], size, prev_value);
+	  free (handoff[prev][i]);
+	}
+      xpthread_barrier_wait (&barrier);
+    }
+
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  xpthread_barrier_init (&barrier, NULL, thread_count);
+
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_function,
+				  (void *) (uintptr_t) i);
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+
+  /* Also exercise the path with a single thread, which does not take
+     arena locks.  */
+  void *blocks[burst];
+  for (int round = 0; round < 10; ++round)
+    {
+      for (int i = 0; i < burst; ++i)
+	{
+	  blocks[i] = xmalloc (48);
+	  fill (blocks[i], 48, round);
+	}
+      for (int i = 0; i < burst; ++i)
+	{
+	  check (blocks[i], 48, round);
+	  free (blocks[i]);
+	}
+    }
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,197 @@
+/* Test the large tcache bins (glibc.malloc.tcache_large_max).
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The test runs with a limit of 256 KiB for the requests and a budget
+   of 256 KiB per thread, so each large bin holds up to 64 KiB.  Each
+   check runs in a new thread, which starts with empty bins, and uses
+   the arena counters of malloc_stats_snapshot to tell whether an
+   allocation was served by the tcache.  */
+
+#include <array_length.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+enum { max_arenas = 64 };
+
+/* Return the number of allocations served by all arenas.  */
+static size_t
+arena_allocs (void)
+{
+  static union
+  {
+    struct malloc_stats stats;
+    char buffer[sizeof (struct malloc_stats)
+		+ max_arenas * sizeof (struct malloc_arena_stats)];
+  } u;
+  TEST_COMPARE (malloc_stats_snapshot (&u.stats, sizeof (u)), 0);
+  size_t n = u.stats.narenas < max_arenas ? u.stats.narenas : max_arenas;
+  size_t allocs = 0;
+  for (size_t i = 0; i < n; ++i)
+    allocs += u.stats.arenas[i].allocs;
+  return allocs;
+}
+
+static void *
+xmalloc_filled (size_t size)
+{
+  void *p = xmalloc (size);
+  memset (p, 0xa5, size);
+  return p;
+}
+
+/* Blocks which are freed and allocated again do not reach the arena,
+   even if the sizes differ but fall into the same bin.  */
+static void *
+check_steady_state (void *closure)
+{
+  static const size_t sizes[] = { 2000, 5000, 20000, 60000, 100000 };
+  for (int i = 0; i < array_length (sizes); ++i)
+    {
+      free (xmalloc_filled (sizes[i]));
+      size_t before = arena_allocs ();
+      for (int j = 0; j < 1000; ++j)
+	free (xmalloc_filled (sizes[i] - j % 100));
+      TEST_COMPARE (arena_allocs (), before);
+    }
+
+  void *p = xmalloc (5000);
+  free (p);
+  void *q = xmalloc (4500);
+  TEST_VERIFY (p == q);
+  free (q);
+  return NULL;
+}
+
+/* A bin holds at most a quarter of the budget.  */
+static void *
+check_bin_limit (void *closure)
+{
+  /* Chunks of 20480 bytes, three of which fit into 64 KiB.  */
+  void *blocks[4];
+  for (int i = 0; i < array_length (blocks); ++i)
+    blocks[i] = xmalloc_filled (20000);
+  for (int i = 0; i < array_length (blocks); ++i)
+    free (blocks[i]);
+
+  size_t before = arena_allocs ();
+  for (int i = 0; i < 3; ++i)
+    blocks[i] = xmalloc_filled (20000);
+  TEST_COMPARE (arena_allocs (), before);
+  blocks[3] = xmalloc_filled (20000);
+  TEST_COMPARE (arena_allocs (), before + 1);
+
+  for (int i = 0; i < array_length (blocks); ++i)
+    free (blocks[i]);
+  return NULL;
+}
+
+/* A bin holds at most glibc.malloc.tcache_large_count chunks, 7 by
+   default, even if more would fit into its share of the budget.  */
+static void *
+check_count_limit (void *closure)
+{
+  /* Chunks of 2048 bytes, 32 of which fit into 64 KiB.  */
+  void *blocks[8];
+  for (int i = 0; i < array_length (blocks); ++i)
+    blocks[i] = xmalloc_filled (2000);
+  for (int i = 0; i < array_length (blocks); ++i)
+    free (blocks[i]);
+
+  size_t before = arena_allocs ();
+  for (int i = 0; i < 7; ++i)
+    blocks[i] = xmalloc_filled (2000);
+  TEST_COMPARE (arena_allocs (), before);
+  blocks[7] = xmalloc_filled (2000);
+  TEST_COMPARE (arena_allocs (), before + 1);
+
+  for (int i = 0; i < array_length (blocks); ++i)
+    free (blocks[i]);
+  return NULL;
+}
+
+/* The chunks in all bins of a thread take at most the budget.  A bin
+   always accepts its first chunk, even if it is larger than a quarter
+   of the budget.  */
+static void *
+check_budget (void *closure)
+{
+  /* Chunks of 40960, 57344, 65536, 81920 and 98304 bytes.  The first
+     four take 240 KiB, and the last one exceeds the budget.  */
+  static const size_t sizes[] = { 40000, 50000, 60000, 70000, 90000 };
+  void *blocks[array_length (sizes)];
+  for (int i = 0; i < array_length (sizes); ++i)
+    blocks[i] = xmalloc_filled (sizes[i]);
+  for (int i = 0; i < array_length (sizes); ++i)
+    free (blocks[i]);
+
+  size_t before = arena_allocs ();
+  for (int i = 0; i < array_length (sizes) - 1; ++i)
+    blocks[i] = xmalloc_filled (sizes[i]);
+  TEST_COMPARE (arena_allocs (), before);
+  blocks[4] = xmalloc_filled (sizes[4]);
+  TEST_COMPARE (arena_allocs (), before + 1);
+
+  for (int i = 0; i < array_length (sizes); ++i)
+    free (blocks[i]);
+  return NULL;
+}
+
+/* mmapped chunks are cached as well.  */
+static void *
+check_mmapped (void *closure)
+{
+  size_t size = 200 * 1000;
+  void *p = xmalloc_filled (size);
+  size_t mmapped = mallinfo2 ().hblks;
+  free (p);
+  TEST_COMPARE (mallinfo2 ().hblks, mmapped);
+  void *q = xmalloc_filled (size);
+  TEST_VERIFY (p == q);
+  free (q);
+  return NULL;
+}
+
+static void
+run (void *(*func) (void *))
+{
+  xpthread_join (xpthread_create (NULL, func, NULL));
+}
+
+static int
+do_test (void)
+{
+  run (check_steady_state);
+  run (check_bin_limit);
+  run (check_count_limit);
+  run (check_budget);
+  run (check_mmapped);
+
+  /* Requests above the limit are not cached.  */
+  void *p = xmalloc_filled (400 * 1000);
+  size_t mmapped = mallinfo2 ().hblks;
+  free (p);
+  TEST_COMPARE (mallinfo2 ().hblks, mmapped - 1);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,188 @@
+/* Test the segregated-fit lists for large chunks (glibc.malloc.tlsf).
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The test runs with glibc.malloc.tlsf=1.  It fragments the heap with
+   free chunks of many sizes between small allocated blocks, and checks
+   that requests are served from the free chunks without growing the
+   heap, and that the contents of the live blocks are not disturbed.  */
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+enum
+  {
+    block_count = 2000,
+    min_size = 1024,
+    max_size = 64 * 1024,
+    thread_count = 4,
+  };
+
+struct block
+{
+  unsigned char *ptr;
+  size_t size;
+};
+
+static struct block blocks[block_count];
+/* Small blocks between the large ones, so that the large ones are not
+   merged when they are freed.  */
+static void *pins[block_count];
+
+static size_t
+random_size (unsigned int *seed)
+{
+  return min_size + rand_r (seed) % (max_size - min_size);
+}
+
+static void
+fill (struct block *b, size_t size, unsigned char value)
+{
+  b->ptr = xmalloc (size);
+  b->size = size;
+  memset (b->ptr, value, size);
+}
+
+static void
+check (const struct block *b, unsigned char value)
+{
+  for (size_t i = 0; i < b->size; ++i)
+    if (b->ptr[i] != value)
+      FAIL_EXIT1 ("block %p corrupted at offset %zu: %d != %d",
+		  b->ptr, i, b->ptr[i], value);
+}
+
+static void
+check_fragmented (void)
+{
+  unsigned int seed = 1;
+  for (int i = 0; i < block_count; ++i)
+    {
+      fill (&blocks[i], random_size (&seed), i);
+      pins[i] = xmalloc (16);
+    }
+
+  /* Free every other block, leaving free chunks of random sizes.  */
+  for (int i = 0; i < block_count; i += 2)
+    free (blocks[i].ptr);
+  size_t arena = mallinfo2 ().arena;
+
+  /* The free chunks hold about twice the memory requested here, so
+     the requests are served from them, after splitting them, without
+     growing the heap.  */
+  for (int i = 0; i < block_count; i += 2)
+    fill (&blocks[i], random_size (&seed) / 2, i + 1);
+  TEST_COMPARE (mallinfo2 ().arena, arena);
+
+  for (int i = 0; i < block_count; ++i)
+    {
+      check (&blocks[i], i % 2 == 0 ? i + 1 : i);
+      TEST_VERIFY (malloc_usable_size (blocks[i].ptr) >= blocks[i].size);
+    }
+
+  /* A freed chunk is reused for a request of its size.  */
+  void *p = blocks[1].ptr;
+  free (p);
+  void *q = xmalloc (blocks[1].size);
+  TEST_VERIFY (p == q);
+  blocks[1].ptr = q;
+  memset (q, 1, blocks[1].size);
+
+  /* mallinfo2 and malloc_trim see the chunks in the lists.  */
+  struct mallinfo2 before = mallinfo2 ();
+  for (int i = 0; i < block_count; i += 2)
+    free (blocks[i].ptr);
+  struct mallinfo2 after = mallinfo2 ();
+  TEST_VERIFY (after.fordblks > before.fordblks + block_count / 2 * 512);
+  TEST_VERIFY (after.ordblks > before.ordblks);
+  malloc_trim (0);
+
+  for (int i = 1; i < block_count; i += 2)
+    {
+      check (&blocks[i], i);
+      free (blocks[i].ptr);
+    }
+  for (int i = 0; i < block_count; ++i)
+    free (pins[i]);
+}
+
+/* Small requests are served from large free chunks as well.  */
+static void
+check_small (void)
+{
+  void *large = xmalloc (100 * 1000);
+  void *pin = xmalloc (16);
+  free (large);
+  size_t arena = mallinfo2 ().arena;
+  void *small[100];
+  for (int i = 0; i < 100; ++i)
+    small[i] = xmalloc (200 + i);
+  TEST_COMPARE (mallinfo2 ().arena, arena);
+  for (int i = 0; i < 100; ++i)
+    free (small[i]);
+  free (pin);
+}
+
+static void *
+thread_func (void *closure)
+{
+  unsigned int seed = (uintptr_t) closure;
+  struct block local[100];
+  for (int round = 0; round < 200; ++round)
+    {
+      for (int i = 0; i < 100; ++i)
+	fill (&local[i], random_size (&seed), round + i);
+      for (int i = 0; i < 100; i += 1 + rand_r (&seed) % 3)
+	{
+	  check (&local[i], round + i);
+	  free (local[i].ptr);
+	  fill (&local[i], random_size (&seed) / 4, round + i);
+	}
+      for (int i = 0; i < 100; ++i)
+	{
+	  check (&local[i], round + i);
+	  free (local[i].ptr);
+	}
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  check_fragmented ();
+  check_small ();
+
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_func,
+				  (void *) (uintptr_t) (i + 1));
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+
+  /* The heap is still consistent after the threads are gone.  */
+  check_fragmented ();
+
+  return 0;
+}
+
+#include <support/test-driver.c>
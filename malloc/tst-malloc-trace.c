@@ -0,0 +1,239 @@
+/* Test the binary allocation trace of libc_malloc_debug.so.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <support/capture_subprocess.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/temp_file.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+#include "malloc-trace.h"
+
+static int restart;
+#define CMDLINE_OPTIONS \
+  { "restart", no_argument, &restart, 1 },
+
+/* The blocks allocated by the traced process, in the order in which
+   it prints them.  The marker block is allocated first, and the calls
+   which happened before it are skipped.  */
+enum
+  {
+    marker_size = 12345,
+  };
+
+enum
+  {
+    block_marker,
+    block_malloc,
+    block_realloc_old,
+    block_realloc,
+    block_memalign,
+    block_calloc,
+    block_thread,
+    block_count
+  };
+
+static void *
+thread_func (void *closure)
+{
+  void **result = closure;
+  *result = xmalloc (300);
+  free (*result);
+  return NULL;
+}
+
+/* Make the calls which the parent looks for in the trace, and print
+   the pointers.  */
+static int
+handle_restart (void)
+{
+  void *blocks[block_count];
+  blocks[block_marker] = xmalloc (marker_size);
+  free (blocks[block_marker]);
+  blocks[block_realloc_old] = xmalloc (100);
+  blocks[block_realloc] = xrealloc (blocks[block_realloc_old], 5000);
+  blocks[block_malloc] = xmalloc (17);
+  blocks[block_memalign] = memalign (64, 50);
+  TEST_VERIFY_EXIT (blocks[block_memalign] != NULL);
+  blocks[block_calloc] = xcalloc (10, 20);
+  xpthread_join (xpthread_create (NULL, thread_func,
+				  &blocks[block_thread]));
+  free (blocks[block_malloc]);
+  free (blocks[block_realloc]);
+  free (blocks[block_memalign]);
+  free (blocks[block_calloc]);
+
+  for (int i = 0; i < block_count; ++i)
+    printf ("%" PRIxPTR "\n", (uintptr_t) blocks[i]);
+  return 0;
+}
+
+/* Return the index of the first record in R[0..COUNT) at or after
+   START with operation OP and pointer PTR.  Fail if there is none.  */
+static size_t
+find_record (const struct malloc_trace_record *r, size_t count,
+	     size_t start, enum malloc_trace_op op, uintptr_t ptr)
+{
+  for (size_t i = start; i < count; ++i)
+    if (r[i].op == op && r[i].ptr == ptr)
+      return i;
+  FAIL_EXIT1 ("no record with op %d for pointer 0x%" PRIxPTR, op, ptr);
+}
+
+static int
+do_test (int argc, char *argv[])
+{
+  /* We must have either:
+     - One or four parameters left if called initially:
+       + path to ld.so         optional
+       + "--library-path"      optional
+       + the library path      optional
+       + the application name  */
+  if (restart)
+    return handle_restart ();
+
+  char *spargv[9];
+  TEST_VERIFY_EXIT (argc <= array_length (spargv) - 2);
+  int i = 0;
+  for (; i < argc - 1; i++)
+    spargv[i] = argv[i + 1];
+  spargv[i++] = (char *) "--direct";
+  spargv[i++] = (char *) "--restart";
+  spargv[i] = NULL;
+
+  char *trace_file;
+  int fd = create_temp_file ("tst-malloc-trace-", &trace_file);
+  TEST_VERIFY_EXIT (fd >= 0);
+  setenv ("MALLOC_BINARY_TRACE", trace_file, 1);
+  struct support_capture_subprocess result
+    = support_capture_subprogram (spargv[0], spargv);
+  support_capture_subprocess_check (&result, "tst-malloc-trace", 0,
+				    sc_allow_stdout);
+
+  uintptr_t blocks[block_count];
+  FILE *out = fmemopen (result.out.buffer, result.out.length, "r");
+  TEST_VERIFY_EXIT (out != NULL);
+  for (i = 0; i < block_count; ++i)
+    TEST_COMPARE (fscanf (out, "%" SCNxPTR, &blocks[i]), 1);
+  fclose (out);
+  support_capture_subprocess_free (&result);
+
+  struct stat64 st;
+  xfstat (fd, &st);
+  TEST_VERIFY_EXIT (st.st_size > sizeof (struct malloc_trace_header));
+  const char *data = xmmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd);
+  xclose (fd);
+
+  const struct malloc_trace_header *header = (const void *) data;
+  TEST_VERIFY (memcmp (header->magic, MALLOC_TRACE_MAGIC,
+		       sizeof (header->magic)) == 0);
+  TEST_COMPARE (header->version, MALLOC_TRACE_VERSION);
+  TEST_COMPARE (header->record_size, sizeof (struct malloc_trace_record));
+  TEST_COMPARE ((st.st_size - sizeof (*header)) % header->record_size, 0);
+
+  const struct malloc_trace_record *r
+    = (const void *) (data + sizeof (*header));
+  size_t count = (st.st_size - sizeof (*header)) / sizeof (*r);
+
+  /* The records of each thread are in the order of its calls.  */
+  uint32_t threads = 0;
+  for (size_t j = 0; j < count; ++j)
+    {
+      TEST_VERIFY (r[j].op >= MALLOC_TRACE_MALLOC
+		   && r[j].op <= MALLOC_TRACE_REALLOC_START);
+      TEST_VERIFY (r[j].thread >= 1);
+      if (r[j].thread > threads)
+	threads = r[j].thread;
+      for (size_t k = j + 1; k < count; ++k)
+	if (r[k].thread == r[j].thread)
+	  {
+	    TEST_VERIFY (r[k].time >= r[j].time);
+	    break;
+	  }
+    }
+  TEST_VERIFY (threads >= 2);
+
+  size_t start = find_record (r, count, 0, MALLOC_TRACE_MALLOC,
+			      blocks[block_marker]);
+  while (r[start].size != marker_size)
+    start = find_record (r, count, start + 1, MALLOC_TRACE_MALLOC,
+			 blocks[block_marker]);
+  uint32_t main_thread = r[start].thread;
+  ++start;
+
+  size_t j = find_record (r, count, start, MALLOC_TRACE_MALLOC,
+			  blocks[block_realloc_old]);
+  size_t k;
+  TEST_COMPARE (r[j].size, 100);
+  TEST_COMPARE (r[j].thread, main_thread);
+  /* realloc is recorded before the call, like free, and after it.  */
+  j = find_record (r, count, j, MALLOC_TRACE_REALLOC_START,
+		   blocks[block_realloc_old]);
+  TEST_COMPARE (r[j].size, 5000);
+  TEST_COMPARE (r[j].thread, main_thread);
+  k = find_record (r, count, j, MALLOC_TRACE_REALLOC, blocks[block_realloc]);
+  TEST_COMPARE (r[k].arg, blocks[block_realloc_old]);
+  TEST_COMPARE (r[k].size, 5000);
+  TEST_COMPARE (r[k].thread, main_thread);
+  TEST_VERIFY (r[k].time >= r[j].time);
+  j = k;
+  find_record (r, count, j, MALLOC_TRACE_FREE, blocks[block_realloc]);
+
+  j = find_record (r, count, start, MALLOC_TRACE_MALLOC,
+		   blocks[block_malloc]);
+  TEST_COMPARE (r[j].size, 17);
+  find_record (r, count, j, MALLOC_TRACE_FREE, blocks[block_malloc]);
+
+  j = find_record (r, count, start, MALLOC_TRACE_MEMALIGN,
+		   blocks[block_memalign]);
+  TEST_COMPARE (r[j].arg, 64);
+  TEST_COMPARE (r[j].size, 50);
+  find_record (r, count, j, MALLOC_TRACE_FREE, blocks[block_memalign]);
+
+  j = find_record (r, count, start, MALLOC_TRACE_CALLOC,
+		   blocks[block_calloc]);
+  TEST_COMPARE (r[j].size, 200);
+  find_record (r, count, j, MALLOC_TRACE_FREE, blocks[block_calloc]);
+
+  /* The second thread has its own number.  Its records are written
+     when it exits, before those of the main thread.  */
+  j = find_record (r, count, 0, MALLOC_TRACE_MALLOC, blocks[block_thread]);
+  while (r[j].thread == main_thread || r[j].size != 300)
+    j = find_record (r, count, j + 1, MALLOC_TRACE_MALLOC,
+		     blocks[block_thread]);
+  k = find_record (r, count, j, MALLOC_TRACE_FREE, blocks[block_thread]);
+  TEST_COMPARE (r[k].thread, r[j].thread);
+  TEST_VERIFY (r[k].time >= r[j].time);
+
+  xmunmap ((void *) data, st.st_size);
+  free (trace_file);
+  return 0;
+}
+
+#define TEST_FUNCTION_ARGV do_test
+#include <support/test-driver.c>
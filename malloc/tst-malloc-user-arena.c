@@ -0,0 +1,341 @@
+/* Test the user arenas (malloc_arena_create and related functions).
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+enum
+  {
+    block_count = 1000,
+    thread_count = 4,
+  };
+
+/* Return true if the page containing P is mapped.  */
+static bool
+is_mapped (void *p)
+{
+  uintptr_t page = (uintptr_t) p & -(uintptr_t) getpagesize ();
+  unsigned char vec;
+  return mincore ((void *) page, 1, &vec) == 0;
+}
+
+static struct malloc_arena *
+xmalloc_arena_create (void)
+{
+  struct malloc_arena *arena = malloc_arena_create (0);
+  if (arena == NULL)
+    FAIL_EXIT1 ("malloc_arena_create: %m");
+  return arena;
+}
+
+static void *
+xmalloc_arena_alloc (struct malloc_arena *arena, size_t size)
+{
+  void *p = malloc_arena_alloc (arena, size);
+  if (p == NULL)
+    FAIL_EXIT1 ("malloc_arena_alloc (%zu): %m", size);
+  return p;
+}
+
+static void
+check_flags (void)
+{
+  errno = 0;
+  TEST_VERIFY (malloc_arena_create (1) == NULL);
+  TEST_COMPARE (errno, EINVAL);
+  malloc_arena_destroy (NULL);
+}
+
+/* Blocks of all sizes, including sizes which malloc would allocate
+   with mmap, can be freed, reallocated and released with the arena.  */
+static void
+check_alloc (void)
+{
+  struct malloc_arena *arena = xmalloc_arena_create ();
+  unsigned char *blocks[block_count];
+  size_t sizes[block_count];
+  size_t hblks = mallinfo2 ().hblks;
+
+  for (int i = 0; i < block_count; ++i)
+    {
+      sizes[i] = i % 100 == 99 ? 1024 * 1024 : 1 + i * 7 % 2000;
+      blocks[i] = xmalloc_arena_alloc (arena, sizes[i]);
+      TEST_VERIFY (malloc_usable_size (blocks[i]) >= sizes[i]);
+      memset (blocks[i], i, sizes[i]);
+    }
+  TEST_COMPARE (mallinfo2 ().hblks, hblks);
+
+  for (int i = 0; i < block_count; i += 3)
+    {
+      free (blocks[i]);
+      blocks[i] = NULL;
+    }
+  for (int i = 1; i < block_count; i += 3)
+    {
+      blocks[i] = xrealloc (blocks[i], sizes[i] * 2);
+      memset (blocks[i] + sizes[i], i, sizes[i]);
+      sizes[i] *= 2;
+    }
+  for (int i = 0; i < block_count; ++i)
+    if (blocks[i] != NULL)
+      for (size_t j = 0; j < sizes[i]; ++j)
+	if (blocks[i][j] != (unsigned char) i)
+	  FAIL_EXIT1 ("block %d corrupted at offset %zu", i, j);
+
+  /* Blocks freed to the arena are reused by it.  */
+  void *p = blocks[2];
+  free (p);
+  void *q = xmalloc_arena_alloc (arena, sizes[2]);
+  TEST_VERIFY (p == q);
+
+  malloc_arena_destroy (arena);
+  TEST_VERIFY (!is_mapped (q));
+  TEST_VERIFY (!is_mapped (blocks[99]));
+}
+
+/* Blocks of a user arena do not end up in the thread cache, from
+   which they would be handed out after the arena is gone.  */
+static void
+check_no_cache (void)
+{
+  struct malloc_arena *arena = xmalloc_arena_create ();
+  void *blocks[200];
+  for (int i = 0; i < 200; ++i)
+    blocks[i] = xmalloc_arena_alloc (arena, 8 + i * 8);
+  for (int i = 0; i < 200; ++i)
+    if (i % 2 == 0)
+      free (blocks[i]);
+    else
+      free_sized (blocks[i], 8 + i * 8);
+  malloc_arena_destroy (arena);
+
+  for (int round = 0; round < 2; ++round)
+    for (int i = 0; i < 200; ++i)
+      {
+	blocks[i] = xmalloc (8 + i * 8);
+	memset (blocks[i], 0xa5, 8 + i * 8);
+      }
+  for (int i = 0; i < 200; ++i)
+    free (blocks[i]);
+}
+
+/* The thread default arena serves malloc, calloc and the aligned
+   allocation functions.  */
+static void
+check_thread_default (void)
+{
+  struct malloc_arena *arena = xmalloc_arena_create ();
+  void *blocks[block_count];
+  size_t uordblks = mallinfo2 ().uordblks;
+
+  TEST_VERIFY (malloc_arena_set_thread_default (arena) == NULL);
+  for (int i = 0; i < block_count; ++i)
+    {
+      switch (i % 4)
+	{
+	case 0:
+	  blocks[i] = xmalloc (100);
+	  break;
+	case 1:
+	  blocks[i] = xcalloc (10, 10);
+	  for (int j = 0; j < 100; ++j)
+	    TEST_COMPARE (((unsigned char *) blocks[i])[j], 0);
+	  break;
+	case 2:
+	  blocks[i] = aligned_alloc (256, 100);
+	  TEST_VERIFY_EXIT (blocks[i] != NULL);
+	  TEST_COMPARE ((uintptr_t) blocks[i] % 256, 0);
+	  break;
+	default:
+	  blocks[i] = xposix_memalign (64, 100);
+	  TEST_COMPARE ((uintptr_t) blocks[i] % 64, 0);
+	  break;
+	}
+      memset (blocks[i], i, 100);
+    }
+  TEST_VERIFY (malloc_arena_set_thread_default (NULL) == arena);
+
+  /* The default arenas did not provide the memory.  */
+  TEST_COMPARE (mallinfo2 ().uordblks, uordblks);
+
+  for (int i = 0; i < block_count; i += 2)
+    free (blocks[i]);
+
+  /* Destroying the arena also resets the thread default.  */
+  malloc_arena_set_thread_default (arena);
+  malloc_arena_destroy (arena);
+  TEST_VERIFY (malloc_arena_set_thread_default (NULL) == NULL);
+  TEST_VERIFY (!is_mapped (blocks[1]));
+}
+
+/* Each thread allocates from its own arena, and frees blocks of the
+   arena of the next thread.  */
+static struct malloc_arena *thread_arenas[thread_count];
+static void *thread_blocks[thread_count][block_count];
+static pthread_barrier_t barrier;
+
+static void *
+thread_func (void *closure)
+{
+  int self = (uintptr_t) closure;
+  struct malloc_arena *arena = thread_arenas[self];
+  void **blocks = thread_blocks[self];
+
+  malloc_arena_set_thread_default (arena);
+  for (int round = 0; round < 20; ++round)
+    {
+      for (int i = 0; i < block_count; ++i)
+	{
+	  blocks[i] = xmalloc (16 + (i + round) % 500);
+	  memset (blocks[i], self, 16);
+	}
+      xpthread_barrier_wait (&barrier);
+
+      void **other = thread_blocks[(self + 1) % thread_count];
+      for (int i = 0; i < block_count; i += 2)
+	{
+	  TEST_COMPARE (*(unsigned char *) other[i],
+			(self + 1) % thread_count);
+	  free (other[i]);
+	}
+      xpthread_barrier_wait (&barrier);
+
+      for (int i = 1; i < block_count; i += 2)
+	free (blocks[i]);
+    }
+  malloc_arena_set_thread_default (NULL);
+  return NULL;
+}
+
+static void
+check_threads (void)
+{
+  xpthread_barrier_init (&barrier, NULL, thread_count);
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    thread_arenas[i] = xmalloc_arena_create ();
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, (void *) (uintptr_t) i);
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  for (int i = 0; i < thread_count; ++i)
+    malloc_arena_destroy (thread_arenas[i]);
+  xpthread_barrier_destroy (&barrier);
+}
+
+/* If a block of a user arena cannot grow within the arena, realloc
+   fails instead of moving it to a default arena.  */
+static void
+check_realloc_failure (void)
+{
+  struct malloc_arena *arena = xmalloc_arena_create ();
+  unsigned char *p = xmalloc_arena_alloc (arena, 100);
+  memset (p, 0x5a, 100);
+  size_t uordblks = mallinfo2 ().uordblks;
+  size_t hblks = mallinfo2 ().hblks;
+
+  /* Larger than any heap of an arena.  */
+  errno = 0;
+  TEST_VERIFY (realloc (p, (size_t) 1 << 30) == NULL);
+  TEST_COMPARE (errno, ENOMEM);
+  TEST_COMPARE (mallinfo2 ().uordblks, uordblks);
+  TEST_COMPARE (mallinfo2 ().hblks, hblks);
+  for (int i = 0; i < 100; ++i)
+    TEST_COMPARE (p[i], 0x5a);
+
+  malloc_arena_destroy (arena);
+  TEST_VERIFY (!is_mapped (p));
+}
+
+/* malloc_stats_snapshot reports the user arenas after the others.  */
+static void
+check_stats (void)
+{
+  enum { max_arenas = 64 };
+  static union
+  {
+    struct malloc_stats stats;
+    char buffer[sizeof (struct malloc_stats)
+		+ max_arenas * sizeof (struct malloc_arena_stats)];
+  } u;
+  TEST_COMPARE (malloc_stats_snapshot (&u.stats, sizeof (u)), 0);
+  size_t narenas = u.stats.narenas;
+  TEST_VERIFY_EXIT (narenas < max_arenas);
+
+  struct malloc_arena *arena = xmalloc_arena_create ();
+  void *p = xmalloc_arena_alloc (arena, 100);
+  TEST_COMPARE (malloc_stats_snapshot (&u.stats, sizeof (u)), 0);
+  TEST_COMPARE (u.stats.narenas, narenas + 1);
+  struct malloc_arena_stats *s = &u.stats.arenas[narenas];
+  TEST_COMPARE (s->allocs, 1);
+  TEST_VERIFY (s->bytes_in_use >= 100);
+  TEST_VERIFY (s->system_bytes > 0);
+  TEST_COMPARE (s->numa_node, -1);
+
+  free (p);
+  malloc_arena_destroy (arena);
+  TEST_COMPARE (malloc_stats_snapshot (&u.stats, sizeof (u)), 0);
+  TEST_COMPARE (u.stats.narenas, narenas);
+}
+
+/* A user arena remains usable in a forked child.  */
+static void
+check_fork (void)
+{
+  struct malloc_arena *arena = xmalloc_arena_create ();
+  void *p = xmalloc_arena_alloc (arena, 100);
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      free (p);
+      TEST_VERIFY (xmalloc_arena_alloc (arena, 100) == p);
+      malloc_arena_destroy (arena);
+      _exit (0);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+  malloc_arena_destroy (arena);
+}
+
+static int
+do_test (void)
+{
+  check_flags ();
+  check_alloc ();
+  check_no_cache ();
+  check_thread_default ();
+  check_threads ();
+  /* After check_threads, so that realloc does not take the
+     single-threaded path.  */
+  check_realloc_failure ();
+  check_stats ();
+  check_fork ();
+  return 0;
+}
+
+#include <support/test-driver.c>
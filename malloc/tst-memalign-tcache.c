@@ -0,0 +1,153 @@
+/* Test that aligned allocations are served from the thread cache.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+enum
+  {
+    block_count = 500,
+    thread_count = 4,
+  };
+
+static const size_t alignments[] = { 32, 64, 128, 4096 };
+static const size_t sizes[] = { 1, 64, 100, 256, 1000 };
+
+static void *
+xaligned_alloc (size_t alignment, size_t size)
+{
+  void *p = aligned_alloc (alignment, size);
+  if (p == NULL)
+    FAIL_EXIT1 ("aligned_alloc (%zu, %zu): %m", alignment, size);
+  TEST_COMPARE ((uintptr_t) p % alignment, 0);
+  TEST_VERIFY (malloc_usable_size (p) >= size);
+  return p;
+}
+
+/* A freed aligned block is handed out again by the next allocation
+   with the same size and alignment, by all aligned allocation
+   functions.  */
+static void
+check_reuse (void)
+{
+  for (size_t i = 0; i < array_length (alignments); ++i)
+    for (size_t j = 0; j < array_length (sizes); ++j)
+      {
+	size_t alignment = alignments[i];
+	size_t size = sizes[j];
+	void *p = xaligned_alloc (alignment, size);
+	free (p);
+	void *q = xaligned_alloc (alignment, size);
+	TEST_VERIFY (p == q);
+	free (q);
+	q = xposix_memalign (alignment, size);
+	TEST_VERIFY (p == q);
+	free (q);
+	q = memalign (alignment, size);
+	TEST_VERIFY (p == q);
+	free (q);
+      }
+
+  /* The cached block is found behind unaligned ones.  A block from
+     malloc may happen to be aligned as well, and the most recently
+     freed aligned block comes first.  */
+  void *p = xaligned_alloc (128, 100);
+  void *expected = p;
+  void *blocks[3];
+  for (int i = 0; i < array_length (blocks); ++i)
+    blocks[i] = xmalloc (100);
+  free (p);
+  for (int i = 0; i < array_length (blocks); ++i)
+    {
+      if ((uintptr_t) blocks[i] % 128 == 0)
+	expected = blocks[i];
+      free (blocks[i]);
+    }
+  void *q = xaligned_alloc (128, 100);
+  TEST_VERIFY (q == expected);
+  free (q);
+
+  /* valloc uses the page size as alignment.  */
+  p = valloc (64);
+  TEST_VERIFY_EXIT (p != NULL);
+  free (p);
+  q = valloc (64);
+  TEST_VERIFY (p == q);
+  free (q);
+}
+
+/* Allocate aligned and unaligned blocks of the same sizes, and free
+   them in an order which mixes them in the cache.  No block is handed
+   out twice.  */
+static void
+check_mixed (unsigned int seed)
+{
+  unsigned char *blocks[block_count];
+  size_t lengths[block_count];
+  for (int round = 0; round < 20; ++round)
+    {
+      for (int i = 0; i < block_count; ++i)
+	{
+	  size_t size = sizes[(i + round) % array_length (sizes)];
+	  if (i % 3 == 0)
+	    blocks[i] = xmalloc (size);
+	  else
+	    blocks[i] = xaligned_alloc (alignments[i % array_length (alignments)],
+					size);
+	  lengths[i] = size;
+	  memset (blocks[i], i + seed, size);
+	}
+      for (int i = 0; i < block_count; ++i)
+	for (size_t j = 0; j < lengths[i]; ++j)
+	  if (blocks[i][j] != (unsigned char) (i + seed))
+	    FAIL_EXIT1 ("block %d corrupted at offset %zu", i, j);
+      for (int i = 0; i < block_count; i += 2)
+	free (blocks[i]);
+      for (int i = 1; i < block_count; i += 2)
+	free (blocks[i]);
+    }
+}
+
+static void *
+thread_func (void *closure)
+{
+  check_mixed ((uintptr_t) closure);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  check_reuse ();
+  check_mixed (0);
+
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, (void *) (uintptr_t) i);
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  return 0;
+}
+
+#include <support/test-driver.c>
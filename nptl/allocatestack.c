@@ -53,9 +53,10 @@
 #endif
 
 /* Get a stack frame from the cache.  We have to match by size since
-   some blocks might be too small or far too large.  */
+   some blocks might be too small or far too large.  We prefer a stack
+   with a guard area of GUARDSIZE, which does not need to be changed.  */
 static struct pthread *
-get_cached_stack (size_t *sizep, void **memp)
+get_cached_stack (size_t *sizep, void **memp, size_t guardsize)
 {
   size_t size = *sizep;
   struct pthread *result = NULL;
@@ -63,48 +64,75 @@ get_cached_stack (size_t *sizep, void **memp)
 
   lll_lock (GL (dl_stack_cache_lock), LLL_PRIVATE);
 
-  /* Search the cache for a matching entry.  We search for the
-     smallest stack which has at least the required size.  Note that
-     in normal situations the size of all allocated stacks is the
-     same.  As the very least there are only a few different sizes.
-     Therefore this loop will exit early most of the time with an
-     exact match.  */
-  list_for_each (entry, &GL (dl_stack_cache))
+  /* A thread which creates threads in a loop usually gets the stack
+     freed last on its CPU, so try that first, and only use it if it
+     matches exactly.  The slot is emptied under the lock, so that a
+     fork can lose the stack only in the same short windows as a stack
+     moved between the lists.  */
+  struct pthread **slotp = __nptl_stack_slot ();
+  struct pthread *slot = *slotp;
+  *slotp = NULL;
+
+  if (slot != NULL)
     {
-      struct pthread *curr;
+      if (__nptl_stack_in_use (slot) && slot->stackblock_size == size
+	  && slot->guardsize == guardsize)
+	{
+	  result = slot;
+	  /* See __nptl_stack_slot_evict.  */
+	  if (__glibc_unlikely (GL(dl_stack_flags) & PF_X))
+	    __nptl_change_stack_perm (result);
+	}
+      else
+	__nptl_stack_slot_evict (slot);
+    }
 
-      curr = list_entry (entry, struct pthread, list);
-      if (__nptl_stack_in_use (curr) && curr->stackblock_size >= size)
+  if (result == NULL)
+    {
+      /* Search the cache for a matching entry.  We search for the
+	 smallest stack which has at least the required size.  Note that
+	 in normal situations the size of all allocated stacks is the
+	 same.  As the very least there are only a few different sizes.
+	 Therefore this loop will exit early most of the time with an
+	 exact match.  */
+      list_for_each (entry, &GL (dl_stack_cache))
 	{
-	  if (curr->stackblock_size == size)
+	  struct pthread *curr;
+
+	  curr = list_entry (entry, struct pthread, list);
+	  if (__nptl_stack_in_use (curr) && curr->stackblock_size >= size)
 	    {
-	      result = curr;
-	      break;
-	    }
+	      if (curr->stackblock_size == size
+		  && curr->guardsize == guardsize)
+		{
+		  result = curr;
+		  break;
+		}
 
-	  if (result == NULL
-	      || result->stackblock_size > curr->stackblock_size)
-	    result = curr;
+	      if (result == NULL
+		  || result->stackblock_size > curr->stackblock_size)
+		result = curr;
+	    }
 	}
-    }
 
-  if (__builtin_expect (result == NULL, 0)
-      /* Make sure the size difference is not too excessive.  In that
-	 case we do not use the block.  */
-      || __builtin_expect (result->stackblock_size > 4 * size, 0))
-    {
-      /* Release the lock.  */
-      lll_unlock (GL (dl_stack_cache_lock), LLL_PRIVATE);
+      if (__builtin_expect (result == NULL, 0)
+	  /* Make sure the size difference is not too excessive.  In that
+	     case we do not use the block.  */
+	  || __builtin_expect (result->stackblock_size > 4 * size, 0))
+	{
+	  /* Release the lock.  */
+	  lll_unlock (GL (dl_stack_cache_lock), LLL_PRIVATE);
+
+	  return NULL;
+	}
 
-      return NULL;
+      /* Dequeue the entry.  */
+      __nptl_stack_list_del (&result->list);
     }
 
   /* Don't allow setxid until cloned.  */
   result->setxid_futex = -1;
 
-  /* Dequeue the entry.  */
-  __nptl_stack_list_del (&result->list);
-
   /* And add to the list of stacks in use.  */
   __nptl_stack_list_add (&result->list, &GL (dl_stack_used));
 
@@ -357,7 +385,7 @@ allocate_stack (const struct pthread_attr *attr, struct pthread **pdp,
 
       /* Try to get a stack from the cache.  */
       reqsize = size;
-      pd = get_cached_stack (&size, &mem);
+      pd = get_cached_stack (&size, &mem, guardsize);
       if (pd == NULL)
 	{
 	  /* If a guard page is required, avoid committing memory by first
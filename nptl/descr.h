@@ -402,6 +402,17 @@ struct pthread
   bool exiting;
   int exit_lock; /* A low-level lock (for use with __libc_lock_init etc).  */
 
+  /* Read locks of PTHREAD_RWLOCK_READER_BIASED_NP rwlocks which this
+     thread holds through the reader indicator table, and how often it
+     holds each of them.  Entries with a zero count are free.  See
+     pthread_rwlock_common.c.  */
+#define PTHREAD_RWLOCK_BIAS_HELD 4
+  struct
+  {
+    pthread_rwlock_t *rwlock;
+    unsigned int count;
+  } rwlock_bias[PTHREAD_RWLOCK_BIAS_HELD];
+
   /* Used on strsignal.  */
   struct tls_internal_t tls_state;
 
@@ -141,6 +141,83 @@ __futex_abstimed_wait_cancelable64 (unsigned int* futex_word,
 }
 libc_hidden_def (__futex_abstimed_wait_cancelable64)
 
+static int
+__futex_abstimed_waitv_common (struct futex_waiter *waiters,
+			       unsigned int count, unsigned int *woken,
+			       clockid_t clockid,
+			       const struct __timespec64 *abstime, bool cancel)
+{
+  /* See __futex_abstimed_wait_common.  */
+  if (__glibc_unlikely ((abstime != NULL) && (abstime->tv_sec < 0)))
+    return ETIMEDOUT;
+
+  if (! lll_futex_supported_clockid (clockid))
+    return EINVAL;
+
+  /* The kernel takes a struct __kernel_timespec, whose tv_nsec is 64 bits
+     wide even where the one of struct __timespec64 is not.  */
+  struct
+  {
+    int64_t tv_sec;
+    int64_t tv_nsec;
+  } ts, *pts = NULL;
+  if (abstime != NULL)
+    {
+      ts.tv_sec = abstime->tv_sec;
+      ts.tv_nsec = abstime->tv_nsec;
+      pts = &ts;
+    }
+
+  long int err;
+  if (cancel)
+    err = INTERNAL_SYSCALL_CANCEL (futex_waitv, waiters, count, 0, pts,
+				   clockid);
+  else
+    err = INTERNAL_SYSCALL_CALL (futex_waitv, waiters, count, 0, pts,
+				 clockid);
+
+  if (err >= 0)
+    {
+      *woken = err;
+      return 0;
+    }
+  switch (err)
+    {
+    case -EAGAIN:
+    case -EINTR:
+    case -ETIMEDOUT:
+    case -EINVAL:
+    case -ENOSYS:
+      return -err;
+
+    case -EFAULT: /* Must have been caused by a glibc or application bug.  */
+    /* No other errors are documented at this time.  */
+    default:
+      futex_fatal_error ();
+    }
+}
+
+int
+__futex_abstimed_waitv64 (struct futex_waiter *waiters, unsigned int count,
+			  unsigned int *woken, clockid_t clockid,
+			  const struct __timespec64 *abstime)
+{
+  return __futex_abstimed_waitv_common (waiters, count, woken, clockid,
+					abstime, false);
+}
+libc_hidden_def (__futex_abstimed_waitv64)
+
+int
+__futex_abstimed_waitv_cancelable64 (struct futex_waiter *waiters,
+				     unsigned int count, unsigned int *woken,
+				     clockid_t clockid,
+				     const struct __timespec64 *abstime)
+{
+  return __futex_abstimed_waitv_common (waiters, count, woken, clockid,
+					abstime, true);
+}
+libc_hidden_def (__futex_abstimed_waitv_cancelable64)
+
 int
 __futex_lock_pi64 (int *futex_word, clockid_t clockid,
 		   const struct __timespec64 *abstime, int private)
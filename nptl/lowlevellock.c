@@ -20,10 +20,13 @@
 #include <futex-internal.h>
 #include <atomic.h>
 #include <stap-probe.h>
+#include <pthreadP.h>
 
 void
 __lll_lock_wait_private (int *futex)
 {
+  uint64_t start = __mutex_profile_start ();
+
   if (atomic_load_relaxed (futex) == 2)
     goto futex;
 
@@ -33,12 +36,16 @@ __lll_lock_wait_private (int *futex)
       LIBC_PROBE (lll_lock_wait_private, 1, futex);
       futex_wait ((unsigned int *) futex, 2, LLL_PRIVATE); /* Wait if *futex == 2.  */
     }
+
+  __mutex_profile_end (futex, __builtin_return_address (0), start);
 }
 libc_hidden_def (__lll_lock_wait_private)
 
 void
-__lll_lock_wait (int *futex, int private)
+__lll_lock_wait_caller (int *futex, int private, const void *caller)
 {
+  uint64_t start = caller != NULL ? __mutex_profile_start () : 0;
+
   if (atomic_load_relaxed (futex) == 2)
     goto futex;
 
@@ -48,6 +55,14 @@ __lll_lock_wait (int *futex, int private)
       LIBC_PROBE (lll_lock_wait, 1, futex);
       futex_wait ((unsigned int *) futex, 2, private); /* Wait if *futex == 2.  */
     }
+
+  __mutex_profile_end (futex, caller, start);
+}
+
+void
+__lll_lock_wait (int *futex, int private)
+{
+  __lll_lock_wait_caller (futex, private, __builtin_return_address (0));
 }
 libc_hidden_def (__lll_lock_wait)
 
@@ -498,6 +498,8 @@ class RWLockPrinter(object):
 
         if self.flags == PTHREAD_RWLOCK_PREFER_READER_NP:
             self.values.append(('Prefers', 'Readers'))
+        elif self.flags == PTHREAD_RWLOCK_READER_BIASED_NP:
+            self.values.append(('Prefers', 'Readers, biased'))
         elif self.flags == PTHREAD_RWLOCK_PREFER_WRITER_NP:
             self.values.append(('Prefers', 'Writers'))
         else:
@@ -564,6 +566,8 @@ class RWLockAttributesPrinter(object):
 
         if rwlock_type == PTHREAD_RWLOCK_PREFER_READER_NP:
             self.values.append(('Prefers', 'Readers'))
+        elif rwlock_type == PTHREAD_RWLOCK_READER_BIASED_NP:
+            self.values.append(('Prefers', 'Readers, biased'))
         elif rwlock_type == PTHREAD_RWLOCK_PREFER_WRITER_NP:
             self.values.append(('Prefers', 'Writers'))
         else:
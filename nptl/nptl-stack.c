@@ -22,6 +22,8 @@
 
 size_t __nptl_stack_cache_maxsize = 40 * 1024 * 1024;
 
+struct pthread *__nptl_stack_slots[NPTL_STACK_SLOTS];
+
 void
 __nptl_stack_list_del (list_t *elem)
 {
@@ -52,6 +54,34 @@ __nptl_stack_list_add (list_t *elem, list_t *list)
 }
 libc_hidden_def (__nptl_stack_list_add)
 
+/* Free the memory of the unused stack PD, which is on no list.  Must be
+   called with the cache lock held.  */
+static void
+free_stack (struct pthread *pd)
+{
+  /* Account for the freed memory.  */
+  GL (dl_stack_cache_actsize) -= pd->stackblock_size;
+
+  /* Free the memory associated with the ELF TLS.  */
+  _dl_deallocate_tls (TLS_TPADJ (pd), false);
+
+  /* Remove this block.  This should never fail.  If it does
+     something is really wrong.  */
+  if (__munmap (pd->stackblock, pd->stackblock_size) != 0)
+    abort ();
+}
+
+void
+__nptl_stack_slot_evict (struct pthread *pd)
+{
+  /* _dl_make_stacks_executable only changes the stacks on the lists, so
+     it may have missed PD.  */
+  if (__glibc_unlikely (GL(dl_stack_flags) & PF_X))
+    __nptl_change_stack_perm (pd);
+
+  __nptl_stack_list_add (&pd->list, &GL (dl_stack_cache));
+}
+
 void
 __nptl_free_stacks (size_t limit)
 {
@@ -71,22 +101,30 @@ __nptl_free_stacks (size_t limit)
 	  /* Unlink the block.  */
 	  __nptl_stack_list_del (entry);
 
-	  /* Account for the freed memory.  */
-	  GL (dl_stack_cache_actsize) -= curr->stackblock_size;
-
-	  /* Free the memory associated with the ELF TLS.  */
-	  _dl_deallocate_tls (TLS_TPADJ (curr), false);
-
-	  /* Remove this block.  This should never fail.  If it does
-	     something is really wrong.  */
-	  if (__munmap (curr->stackblock, curr->stackblock_size) != 0)
-	    abort ();
+	  free_stack (curr);
 
 	  /* Maybe we have freed enough.  */
 	  if (GL (dl_stack_cache_actsize) <= limit)
-	    break;
+	    return;
 	}
     }
+
+  /* The recently freed stacks in the slots go last.  */
+  for (int i = 0; i < NPTL_STACK_SLOTS; i++)
+    {
+      struct pthread *curr = __nptl_stack_slots[i];
+      __nptl_stack_slots[i] = NULL;
+      if (curr == NULL)
+	continue;
+      if (__nptl_stack_in_use (curr))
+	free_stack (curr);
+      else
+	/* The thread has not exited yet.  */
+	__nptl_stack_slot_evict (curr);
+
+      if (GL (dl_stack_cache_actsize) <= limit)
+	break;
+    }
 }
 
 /* Add a stack frame which is not used anymore to the stack.  Must be
@@ -95,12 +133,20 @@ static inline void
 __attribute ((always_inline))
 queue_stack (struct pthread *stack)
 {
-  /* We unconditionally add the stack to the list.  The memory may
+  GL (dl_stack_cache_actsize) += stack->stackblock_size;
+
+  /* We unconditionally add the stack to the cache.  The memory may
      still be in use but it will not be reused until the kernel marks
-     the stack as not used anymore.  */
-  __nptl_stack_list_add (&stack->list, &GL (dl_stack_cache));
+     the stack as not used anymore.  The stack goes into the slot of
+     this CPU, so that the next thread created here gets it without a
+     search of the cache list, and the previous stack of the slot is
+     moved to the list.  */
+  struct pthread **slotp = __nptl_stack_slot ();
+  struct pthread *prev = *slotp;
+  *slotp = stack;
+  if (prev != NULL)
+    __nptl_stack_slot_evict (prev);
 
-  GL (dl_stack_cache_actsize) += stack->stackblock_size;
   if (__glibc_unlikely (GL (dl_stack_cache_actsize)
 			> __nptl_stack_cache_maxsize))
     __nptl_free_stacks (__nptl_stack_cache_maxsize);
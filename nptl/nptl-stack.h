@@ -23,10 +23,33 @@
 #include <ldsodefs.h>
 #include <list.h>
 #include <stdbool.h>
+#include <tls.h>
 
 /* Maximum size of the cache, in bytes.  40 MiB by default.  */
 extern size_t __nptl_stack_cache_maxsize attribute_hidden;
 
+/* Number of per-CPU stack cache slots.  */
+#define NPTL_STACK_SLOTS 32
+
+/* The stack last freed on each CPU, or NULL.  These stacks are part of
+   the cache, but are on neither GL (dl_stack_cache) nor
+   GL (dl_stack_used).  The slots are only accessed with the cache lock
+   held.  */
+extern struct pthread *__nptl_stack_slots[NPTL_STACK_SLOTS] attribute_hidden;
+
+/* Return the stack cache slot of the CPU the calling thread runs on.
+   Threads without rseq registration share a slot.  */
+static inline struct pthread **
+__nptl_stack_slot (void)
+{
+  unsigned int cpu = THREAD_GETMEM_VOLATILE (THREAD_SELF, rseq_area.cpu_id);
+  return &__nptl_stack_slots[cpu % NPTL_STACK_SLOTS];
+}
+
+/* Move PD, which was taken out of a stack cache slot, to the cache list.
+   Must be called with the cache lock held.  */
+void __nptl_stack_slot_evict (struct pthread *pd) attribute_hidden;
+
 /* Check whether the stack is still used or not.  */
 static inline bool
 __nptl_stack_in_use (struct pthread *pd)
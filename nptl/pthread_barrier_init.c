@@ -23,7 +23,8 @@
 
 static const struct pthread_barrierattr default_barrierattr =
   {
-    .pshared = PTHREAD_PROCESS_PRIVATE
+    .pshared = PTHREAD_PROCESS_PRIVATE,
+    .kind = PTHREAD_BARRIER_DEFAULT_NP
   };
 
 
@@ -50,6 +51,20 @@ ___pthread_barrier_init (pthread_barrier_t *barrier,
 
   ibarrier = (struct pthread_barrier *) barrier;
 
+  /* The tree is allocated from the heap and thus cannot be shared with
+     other processes.  Process-shared barriers use the default kind.  */
+  if (iattr->kind == PTHREAD_BARRIER_TREE_NP
+      && iattr->pshared == PTHREAD_PROCESS_PRIVATE)
+    {
+      ibarrier->tree = __pthread_barrier_tree_init (count);
+      if (ibarrier->tree == NULL)
+	return ENOMEM;
+      ibarrier->out = 0;
+      ibarrier->count = 0;
+      ibarrier->shared = FUTEX_PRIVATE;
+      return 0;
+    }
+
   /* Initialize the individual fields.  */
   ibarrier->in = 0;
   ibarrier->out = 0;
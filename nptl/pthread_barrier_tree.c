@@ -0,0 +1,310 @@
+/* Combining-tree barriers.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/sysinfo.h>
+#include <futex-internal.h>
+#include <libc-pointer-arith.h>
+#include <pthreadP.h>
+
+/* With the default algorithm (see pthread_barrier_wait.c), all threads
+   update IN and OUT of the barrier in each round, so their cache line
+   becomes the bottleneck with many threads.  Barriers of kind
+   PTHREAD_BARRIER_TREE_NP spread the arrivals over the nodes of a
+   combining tree instead, which is allocated by pthread_barrier_init.
+
+   Each leaf of the tree expects at most BARRIER_TREE_FANIN threads per
+   round.  A thread arrives at the leaf of the CPU it runs on or, if that
+   leaf is full, at the next leaf which still expects threads in the
+   current round.  The last thread to arrive at a node arrives at its
+   parent, and the last thread to arrive at the root completes the round
+   by advancing PHASE.  All other threads spin on PHASE, which is written
+   once per round only, and then block on it with futex_wait.  If there
+   are more threads than CPUs the calling thread may run on, some of the
+   threads of a round cannot run while the others spin, so they block
+   right away.
+
+   The ARRIVE word of a leaf contains the round besides the number of
+   threads which arrived in it, so that threads can tell a leaf that is
+   full in the current round from one that is not.  Inner nodes are only
+   arrived at by the threads which complete one of their children, so the
+   thread completing an inner node simply resets its ARRIVE word: the
+   next round starts after the current one has been completed.  If more
+   than COUNT threads wait concurrently, the extra ones find all leaves
+   full and wait for the round to complete before trying again.
+
+   As for the default algorithm, pthread_barrier_destroy may be called as
+   soon as one thread returned from the last round.  Threads confirm that
+   they left the barrier in the LEFT word of their leaf, and
+   pthread_barrier_destroy waits until all threads of all rounds have left
+   before freeing the tree.  */
+
+/* Maximum number of threads or child nodes arriving at a node per
+   round.  */
+#define BARRIER_TREE_FANIN 4
+
+/* The ARRIVE word of a leaf contains the round, truncated, shifted by
+   BARRIER_TREE_ROUND_SHIFT.  */
+#define BARRIER_TREE_ROUND_SHIFT 8
+#define BARRIER_TREE_ROUND_MASK (UINT_MAX >> BARRIER_TREE_ROUND_SHIFT)
+
+/* Set in PHASE if a thread blocks on it, and in the LEFT word of a leaf
+   if pthread_barrier_destroy blocks on it.  The counters are in the
+   remaining bits.  */
+#define BARRIER_TREE_WAITING 1
+
+/* The PARENT of the root.  */
+#define BARRIER_TREE_NONE UINT_MAX
+
+/* Nodes are written by different threads, so each has its own cache
+   line.  */
+#define BARRIER_TREE_ALIGN 64
+
+struct barrier_tree_node
+{
+  /* Number of threads or nodes which arrived in the current round, plus
+     the round for leaves.  */
+  unsigned int arrive;
+  /* Twice the number of threads which left the barrier after arriving at
+     this leaf, plus BARRIER_TREE_WAITING.  */
+  unsigned int left;
+  /* Number of threads or nodes arriving per round.  */
+  unsigned int width;
+  /* Index of the parent in NODES, or BARRIER_TREE_NONE.  */
+  unsigned int parent;
+} __attribute__ ((aligned (BARRIER_TREE_ALIGN)));
+
+struct pthread_barrier_tree
+{
+  /* The block allocated for the tree.  It is allocated with malloc and
+     released with free, so that an interposed malloc gets both calls,
+     and the tree is aligned within it.  */
+  void *block;
+  unsigned int nleaves;
+  /* Whether threads spin before blocking.  */
+  bool spin;
+  /* Twice the number of completed rounds, plus BARRIER_TREE_WAITING.  */
+  unsigned int phase __attribute__ ((aligned (BARRIER_TREE_ALIGN)));
+  /* The leaves, followed by the inner nodes level by level.  The root is
+     the last node.  */
+  struct barrier_tree_node nodes[];
+};
+
+struct pthread_barrier_tree *
+__pthread_barrier_tree_init (unsigned int count)
+{
+  unsigned int nleaves = ((count + BARRIER_TREE_FANIN - 1)
+			  / BARRIER_TREE_FANIN);
+  unsigned int nnodes = nleaves;
+  for (unsigned int n = nleaves; n > 1; )
+    {
+      n = (n + BARRIER_TREE_FANIN - 1) / BARRIER_TREE_FANIN;
+      nnodes += n;
+    }
+
+  size_t size;
+  if (__builtin_mul_overflow (nnodes, sizeof (struct barrier_tree_node),
+			      &size)
+      || __builtin_add_overflow (size, (sizeof (struct pthread_barrier_tree)
+					+ BARRIER_TREE_ALIGN - 1), &size))
+    return NULL;
+  void *block = malloc (size);
+  if (block == NULL)
+    return NULL;
+  struct pthread_barrier_tree *tree = PTR_ALIGN_UP (block, BARRIER_TREE_ALIGN);
+
+  tree->block = block;
+  tree->nleaves = nleaves;
+  tree->spin = count <= __get_nprocs_sched ();
+  tree->phase = 0;
+  for (unsigned int i = 0; i < nnodes; i++)
+    {
+      tree->nodes[i].arrive = 0;
+      tree->nodes[i].left = 0;
+      tree->nodes[i].width = 0;
+    }
+  /* Spread the threads evenly over the leaves.  */
+  for (unsigned int i = 0; i < nleaves; i++)
+    tree->nodes[i].width = count / nleaves + (i < count % nleaves);
+  /* Group the nodes of each level under the nodes of the next one.  */
+  unsigned int first = 0;
+  for (unsigned int n = nleaves; n > 1; )
+    {
+      unsigned int up = first + n;
+      for (unsigned int i = 0; i < n; i++)
+	{
+	  tree->nodes[first + i].parent = up + i / BARRIER_TREE_FANIN;
+	  ++tree->nodes[up + i / BARRIER_TREE_FANIN].width;
+	}
+      first = up;
+      n = (n + BARRIER_TREE_FANIN - 1) / BARRIER_TREE_FANIN;
+    }
+  tree->nodes[first].parent = BARRIER_TREE_NONE;
+
+  return tree;
+}
+
+/* Wait until the round which PHASE designates has been completed.  */
+static void
+barrier_tree_wait_phase (struct pthread_barrier_tree *tree, unsigned int phase)
+{
+  unsigned int p;
+  for (int cnt = tree->spin ? max_adaptive_count () : 0; cnt > 0; cnt--)
+    {
+      p = atomic_load_relaxed (&tree->phase);
+      if ((p & ~BARRIER_TREE_WAITING) != phase)
+	goto done;
+      atomic_spin_nop ();
+    }
+
+  p = atomic_load_relaxed (&tree->phase);
+  while ((p & ~BARRIER_TREE_WAITING) == phase)
+    {
+      if ((p & BARRIER_TREE_WAITING) == 0
+	  && !atomic_compare_exchange_weak_relaxed (&tree->phase, &p,
+						    p | BARRIER_TREE_WAITING))
+	continue;
+      futex_wait_simple (&tree->phase, phase | BARRIER_TREE_WAITING,
+			 FUTEX_PRIVATE);
+      p = atomic_load_relaxed (&tree->phase);
+    }
+
+ done:
+  /* Synchronize with the thread which completed the round.  */
+  atomic_thread_fence_acquire ();
+}
+
+int
+__pthread_barrier_tree_wait (struct pthread_barrier_tree *tree)
+{
+  /* Acquire MO so that the leaves we look at have been completed for
+     all previous rounds.  */
+  unsigned int phase = (atomic_load_acquire (&tree->phase)
+			& ~BARRIER_TREE_WAITING);
+  unsigned int cpu = THREAD_GETMEM_VOLATILE (THREAD_SELF, rseq_area.cpu_id);
+  unsigned int start = cpu % tree->nleaves;
+  struct barrier_tree_node *leaf;
+  unsigned int arrived;
+
+  for (;;)
+    {
+      unsigned int round = (phase >> 1) & BARRIER_TREE_ROUND_MASK;
+      unsigned int i = start;
+      do
+	{
+	  leaf = &tree->nodes[i];
+	  unsigned int a = atomic_load_relaxed (&leaf->arrive);
+	  while (a >> BARRIER_TREE_ROUND_SHIFT == round)
+	    {
+	      arrived = (a & ((1U << BARRIER_TREE_ROUND_SHIFT) - 1)) + 1;
+	      unsigned int new_a = (arrived == leaf->width
+				    ? (((round + 1) & BARRIER_TREE_ROUND_MASK)
+				       << BARRIER_TREE_ROUND_SHIFT)
+				    : a + 1);
+	      /* Release MO so that our accesses before the barrier happen
+		 before the completion of the round.  */
+	      if (atomic_compare_exchange_weak_release (&leaf->arrive, &a,
+							new_a))
+		goto arrived;
+	    }
+	  i = i + 1 == tree->nleaves ? 0 : i + 1;
+	}
+      while (i != start);
+
+      /* All leaves are full, so more than COUNT threads are waiting.
+	 Wait for the next round.  */
+      barrier_tree_wait_phase (tree, phase);
+      phase = (atomic_load_acquire (&tree->phase)
+	       & ~BARRIER_TREE_WAITING);
+    }
+
+ arrived:;
+  int result = 0;
+  if (arrived == leaf->width)
+    {
+      /* We completed the leaf.  Synchronize with the other threads which
+	 arrived at it, and arrive at its ancestors until we are not the
+	 last one to arrive at one of them.  */
+      atomic_thread_fence_acquire ();
+      struct barrier_tree_node *node = leaf;
+      result = PTHREAD_BARRIER_SERIAL_THREAD;
+      while (node->parent != BARRIER_TREE_NONE)
+	{
+	  node = &tree->nodes[node->parent];
+	  if (atomic_fetch_add_acq_rel (&node->arrive, 1) + 1 != node->width)
+	    {
+	      result = 0;
+	      break;
+	    }
+	  /* Nobody arrives at NODE again before we complete the round.  */
+	  atomic_store_relaxed (&node->arrive, 0);
+	}
+    }
+
+  if (result == PTHREAD_BARRIER_SERIAL_THREAD)
+    {
+      /* We completed the root, and thus the round.  Release MO so that
+	 the arrivals and the resets of the inner nodes happen before the
+	 next round.  */
+      if (atomic_exchange_release (&tree->phase, phase + 2)
+	  & BARRIER_TREE_WAITING)
+	futex_wake (&tree->phase, INT_MAX, FUTEX_PRIVATE);
+    }
+  else
+    barrier_tree_wait_phase (tree, phase);
+
+  /* Confirm that we left the barrier.  Release MO so that our use of the
+     tree happens before pthread_barrier_destroy frees it.  Like the reset
+     in pthread_barrier_wait, the futex_wake may happen after the tree has
+     been freed.  */
+  if (atomic_fetch_add_release (&leaf->left, 2) & BARRIER_TREE_WAITING)
+    futex_wake (&leaf->left, INT_MAX, FUTEX_PRIVATE);
+
+  return result;
+}
+
+void
+__pthread_barrier_tree_destroy (struct pthread_barrier_tree *tree)
+{
+  /* No thread is blocked on the barrier, so the last round has been
+     completed, and its completion happened before this load (see
+     pthread_barrier_destroy).  Each leaf has been arrived at WIDTH times
+     per round.  */
+  unsigned int rounds = atomic_load_relaxed (&tree->phase) >> 1;
+  for (unsigned int i = 0; i < tree->nleaves; i++)
+    {
+      struct barrier_tree_node *leaf = &tree->nodes[i];
+      unsigned int left = (rounds * leaf->width) << 1;
+      unsigned int l = atomic_load_relaxed (&leaf->left);
+      while ((l & ~BARRIER_TREE_WAITING) != left)
+	{
+	  if ((l & BARRIER_TREE_WAITING) == 0
+	      && !atomic_compare_exchange_weak_relaxed (&leaf->left, &l,
+							l | BARRIER_TREE_WAITING))
+	    continue;
+	  futex_wait_simple (&leaf->left, l | BARRIER_TREE_WAITING,
+			     FUTEX_PRIVATE);
+	  l = atomic_load_relaxed (&leaf->left);
+	}
+    }
+
+  /* Synchronize with the threads which left the barrier.  */
+  atomic_thread_fence_acquire ();
+  free (tree->block);
+}
@@ -90,12 +90,19 @@
    TODO We should add spinning with back-off.  Once we do that, we could also
    try to avoid the futex_wake syscall when a round is detected as finished.
    If we do not spin, it is quite likely that at least some other threads will
-   have called futex_wait already.  */
+   have called futex_wait already.
+
+   Barriers of kind PTHREAD_BARRIER_TREE_NP use a different algorithm, see
+   pthread_barrier_tree.c.  */
 int
 ___pthread_barrier_wait (pthread_barrier_t *barrier)
 {
   struct pthread_barrier *bar = (struct pthread_barrier *) barrier;
 
+  /* COUNT is zero for tree barriers only and does not change.  */
+  if (bar->count == 0)
+    return __pthread_barrier_tree_wait (bar->tree);
+
   /* How many threads entered so far, including ourself.  */
   unsigned int i;
 
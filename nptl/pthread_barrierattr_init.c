@@ -25,7 +25,9 @@ __pthread_barrierattr_init (pthread_barrierattr_t *attr)
   ASSERT_PTHREAD_INTERNAL_SIZE (pthread_barrierattr_t,
 				struct pthread_barrierattr);
 
-  ((struct pthread_barrierattr *) attr)->pshared = PTHREAD_PROCESS_PRIVATE;
+  struct pthread_barrierattr *iattr = (struct pthread_barrierattr *) attr;
+  iattr->pshared = PTHREAD_PROCESS_PRIVATE;
+  iattr->kind = PTHREAD_BARRIER_DEFAULT_NP;
 
   return 0;
 }
@@ -60,11 +60,14 @@ ___pthread_cond_broadcast (pthread_cond_t *cond)
 				cond->__data.__g_size[g1] << 1);
       cond->__data.__g_size[g1] = 0;
 
-      /* We need to wake G1 waiters before we quiesce G1 below.  */
+      /* Wake one waiter, which hands the wake-up over to the next waiter
+	 once it has acquired the mutex (see __pthread_cond_wait_common).
+	 If we have to quiesce G1 below, __condvar_quiesce_and_switch_g1
+	 wakes the remaining G1 waiters.  */
       /* TODO Only set it if there are indeed futex waiters.  We could
 	 also try to move this out of the critical section in cases when
 	 G2 is empty (and we don't need to quiesce).  */
-      futex_wake (cond->__data.__g_signals + g1, INT_MAX, private);
+      futex_wake (cond->__data.__g_signals + g1, 1, private);
     }
 
   /* G1 is complete.  Step (2) is next unless there are no waiters in G2, in
@@ -81,8 +84,9 @@ ___pthread_cond_broadcast (pthread_cond_t *cond)
 
   __condvar_release_lock (cond, private);
 
+  /* See step (1).  */
   if (do_futex_wake)
-    futex_wake (cond->__data.__g_signals + g1, INT_MAX, private);
+    futex_wake (cond->__data.__g_signals + g1, 1, private);
 
   return 0;
 }
@@ -254,6 +254,14 @@ __condvar_quiesce_and_switch_g1 (pthread_cond_t *cond, uint64_t wseq,
      or the later update to __g1_start.  New waiters will never arrive here
      but instead continue to go into the still current G2.  */
   unsigned r = atomic_fetch_or_release (cond->__data.__g_refs + g1, 0);
+
+  /* A broadcast wakes just one waiter, and the remaining waiters are only
+     woken one after the other as each of them acquires the mutex (see
+     __pthread_cond_wait_common).  We may hold the mutex, so wake all of
+     them; they will notice the closed flag and leave the group.  */
+  if ((r >> 1) > 0)
+    futex_wake (cond->__data.__g_signals + g1, INT_MAX, private);
+
   while ((r >> 1) > 0)
     {
       for (unsigned int spin = maxspin; ((r >> 1) > 0) && (spin > 0); spin--)
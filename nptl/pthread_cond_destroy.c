@@ -48,6 +48,16 @@ __pthread_cond_destroy (pthread_cond_t *cond)
      that they finished.  */
   unsigned int wrefs = atomic_fetch_or_acquire (&cond->__data.__wrefs, 4);
   int private = __condvar_get_private (wrefs);
+
+  /* Waiters woken by a broadcast wake each other one at a time after
+     re-acquiring the mutex, which the caller may hold.  Wake all of them
+     so that they can confirm their wake-up.  */
+  if (wrefs >> 3 != 0)
+    {
+      futex_wake (cond->__data.__g_signals, INT_MAX, private);
+      futex_wake (cond->__data.__g_signals + 1, INT_MAX, private);
+    }
+
   while (wrefs >> 3 != 0)
     {
       futex_wait_simple (&cond->__data.__wrefs, wrefs, private);
@@ -189,6 +189,76 @@ __condvar_cleanup_waiting (void *arg)
   __pthread_mutex_cond_lock (cbuffer->mutex);
 }
 
+/* Called after we grabbed a signal from group slot G, with SEQ being our
+   position in the waiter sequence.  */
+static void
+__condvar_check_stolen_signal (pthread_cond_t *cond, uint64_t seq,
+			       unsigned int g, int private)
+{
+  /* We consumed a signal but we could have consumed from a more recent group
+     that aliased with ours due to being in the same group slot.  If this
+     might be the case our group must be closed as visible through
+     __g1_start.  */
+  uint64_t g1_start = __condvar_load_g1_start_relaxed (cond);
+  if (seq < (g1_start >> 1))
+    {
+      /* We potentially stole a signal from a more recent group but we do not
+	 know which group we really consumed from.
+	 We do not care about groups older than current G1 because they are
+	 closed; we could have stolen from these, but then we just add a
+	 spurious wake-up for the current groups.
+	 We will never steal a signal from current G2 that was really intended
+	 for G2 because G2 never receives signals (until it becomes G1).  We
+	 could have stolen a signal from G2 that was conservatively added by a
+	 previous waiter that also thought it stole a signal -- but given that
+	 that signal was added unnecessarily, it's not a problem if we steal
+	 it.
+	 Thus, the remaining case is that we could have stolen from the current
+	 G1, where "current" means the __g1_start value we observed.  However,
+	 if the current G1 does not have the same slot index as we do, we did
+	 not steal from it and do not need to undo that.  This is the reason
+	 for putting a bit with G2's index into__g1_start as well.  */
+      if (((g1_start & 1) ^ 1) == g)
+	{
+	  /* We have to conservatively undo our potential mistake of stealing
+	     a signal.  We can stop trying to do that when the current G1
+	     changes because other spinning waiters will notice this too and
+	     __condvar_quiesce_and_switch_g1 has checked that there are no
+	     futex waiters anymore before switching G1.
+	     Relaxed MO is fine for the __g1_start load because we need to
+	     merely be able to observe this fact and not have to observe
+	     something else as well.
+	     ??? Would it help to spin for a little while to see whether the
+	     current G1 gets closed?  This might be worthwhile if the group is
+	     small or close to being closed.  */
+	  unsigned int s = atomic_load_relaxed (cond->__data.__g_signals + g);
+	  while (__condvar_load_g1_start_relaxed (cond) == g1_start)
+	    {
+	      /* Try to add a signal.  We don't need to acquire the lock
+		 because at worst we can cause a spurious wake-up.  If the
+		 group is in the process of being closed (LSB is true), this
+		 has an effect similar to us adding a signal.  */
+	      if (((s & 1) != 0)
+		  || atomic_compare_exchange_weak_relaxed
+		       (cond->__data.__g_signals + g, &s, s + 2))
+		{
+		  /* If we added a signal, we also need to add a wake-up on
+		     the futex.  We also need to do that if we skipped adding
+		     a signal because the group is being closed because
+		     while __condvar_quiesce_and_switch_g1 could have closed
+		     the group, it might stil be waiting for futex waiters to
+		     leave (and one of those waiters might be the one we stole
+		     the signal from, which cause it to block using the
+		     futex).  */
+		  futex_wake (cond->__data.__g_signals + g, 1, private);
+		  break;
+		}
+	      /* TODO Back off.  */
+	    }
+	}
+    }
+}
+
 /* This condvar implementation guarantees that all calls to signal and
    broadcast and all of the three virtually atomic parts of each call to wait
    (i.e., (1) releasing the mutex and blocking, (2) unblocking, and (3) re-
@@ -270,6 +340,21 @@ __condvar_cleanup_waiting (void *arg)
    decrement it after they stopped waiting but right before they acquire the
    mutex associated with the condvar.
 
+   A broadcast makes signals available to all waiters but wakes only one
+   futex waiter per group.  Waking all of them at once would just make
+   them contend for the mutex, and all but one would block again on the
+   mutex futex.  We cannot requeue them onto the mutex futex either
+   because the condvar does not know the mutex, and because a waiter
+   blocked on the mutex would still hold its group reference, which would
+   deadlock with a signaler that holds the mutex and has to quiesce the
+   group.  Instead, a waiter that grabbed a signal while more signals were
+   left wakes the next futex waiter of its group once it has re-acquired
+   the mutex.  Thus, at most one woken waiter competes with the mutex
+   owner at a time, and the wake-ups are handed over along with the mutex.
+   Group quiescence and pthread_cond_destroy cannot wait for this chain
+   to finish because they may run while the mutex is held, so they wake
+   all remaining futex waiters themselves.
+
    pthread_cond_t thus consists of the following (bits that are used for
    flags and are not part of the primary value of each field but necessary
    to make some things atomic or because there was no space for them
@@ -382,6 +467,7 @@ __pthread_cond_wait_common (pthread_cond_t *cond, pthread_mutex_t *mutex,
   const int maxspin = 0;
   int err;
   int result = 0;
+  bool wake_next = false;
 
   LIBC_PROBE (cond_wait, 2, cond, mutex);
 
@@ -532,68 +618,11 @@ __pthread_cond_wait_common (pthread_cond_t *cond, pthread_mutex_t *mutex,
   while (!atomic_compare_exchange_weak_acquire (cond->__data.__g_signals + g,
 						&signals, signals - 2));
 
-  /* We consumed a signal but we could have consumed from a more recent group
-     that aliased with ours due to being in the same group slot.  If this
-     might be the case our group must be closed as visible through
-     __g1_start.  */
-  uint64_t g1_start = __condvar_load_g1_start_relaxed (cond);
-  if (seq < (g1_start >> 1))
-    {
-      /* We potentially stole a signal from a more recent group but we do not
-	 know which group we really consumed from.
-	 We do not care about groups older than current G1 because they are
-	 closed; we could have stolen from these, but then we just add a
-	 spurious wake-up for the current groups.
-	 We will never steal a signal from current G2 that was really intended
-	 for G2 because G2 never receives signals (until it becomes G1).  We
-	 could have stolen a signal from G2 that was conservatively added by a
-	 previous waiter that also thought it stole a signal -- but given that
-	 that signal was added unnecessarily, it's not a problem if we steal
-	 it.
-	 Thus, the remaining case is that we could have stolen from the current
-	 G1, where "current" means the __g1_start value we observed.  However,
-	 if the current G1 does not have the same slot index as we do, we did
-	 not steal from it and do not need to undo that.  This is the reason
-	 for putting a bit with G2's index into__g1_start as well.  */
-      if (((g1_start & 1) ^ 1) == g)
-	{
-	  /* We have to conservatively undo our potential mistake of stealing
-	     a signal.  We can stop trying to do that when the current G1
-	     changes because other spinning waiters will notice this too and
-	     __condvar_quiesce_and_switch_g1 has checked that there are no
-	     futex waiters anymore before switching G1.
-	     Relaxed MO is fine for the __g1_start load because we need to
-	     merely be able to observe this fact and not have to observe
-	     something else as well.
-	     ??? Would it help to spin for a little while to see whether the
-	     current G1 gets closed?  This might be worthwhile if the group is
-	     small or close to being closed.  */
-	  unsigned int s = atomic_load_relaxed (cond->__data.__g_signals + g);
-	  while (__condvar_load_g1_start_relaxed (cond) == g1_start)
-	    {
-	      /* Try to add a signal.  We don't need to acquire the lock
-		 because at worst we can cause a spurious wake-up.  If the
-		 group is in the process of being closed (LSB is true), this
-		 has an effect similar to us adding a signal.  */
-	      if (((s & 1) != 0)
-		  || atomic_compare_exchange_weak_relaxed
-		       (cond->__data.__g_signals + g, &s, s + 2))
-		{
-		  /* If we added a signal, we also need to add a wake-up on
-		     the futex.  We also need to do that if we skipped adding
-		     a signal because the group is being closed because
-		     while __condvar_quiesce_and_switch_g1 could have closed
-		     the group, it might stil be waiting for futex waiters to
-		     leave (and one of those waiters might be the one we stole
-		     the signal from, which cause it to block using the
-		     futex).  */
-		  futex_wake (cond->__data.__g_signals + g, 1, private);
-		  break;
-		}
-	      /* TODO Back off.  */
-	    }
-	}
-    }
+  /* If signals are left after ours, a broadcast may have woken only us, so
+     we have to wake the next waiter once we hold the mutex (see above).  */
+  wake_next = (signals >> 1) > 1;
+
+  __condvar_check_stolen_signal (cond, seq, g, private);
 
  done:
 
@@ -605,6 +634,13 @@ __pthread_cond_wait_common (pthread_cond_t *cond, pthread_mutex_t *mutex,
   /* Woken up; now re-acquire the mutex.  If this doesn't fail, return RESULT,
      which is set to ETIMEDOUT if a timeout occured, or zero otherwise.  */
   err = __pthread_mutex_cond_lock (mutex);
+
+  /* Hand the broadcast over to the next waiter.  We do not hold a reference
+     on the group or the condvar anymore, so this may cause a spurious
+     wake-up if the group slot or the condvar memory has been reused.  */
+  if (wake_next)
+    futex_wake (cond->__data.__g_signals + g, 1, private);
+
   /* XXX Abort on errors that are disallowed by POSIX?  */
   return (err != 0) ? err : result;
 }
@@ -708,3 +744,267 @@ versioned_symbol (libc, ___pthread_cond_clockwait,
 compat_symbol (libpthread, ___pthread_cond_clockwait,
 	       pthread_cond_clockwait, GLIBC_2_30);
 #endif
+
+struct _condvar_cleanup_any_buffer
+{
+  pthread_cond_t *const *conds;
+  const uint64_t *wseqs;
+  const int *privates;
+  unsigned int count;
+  pthread_mutex_t *mutex;
+};
+
+/* Clean-up for cancellation of __pthread_cond_wait_any_common.  Like
+   __condvar_cleanup_waiting, but for each of the condvars, on which we hold
+   group references while blocked.  */
+static void
+__condvar_cleanup_waiting_any (void *arg)
+{
+  struct _condvar_cleanup_any_buffer *cbuffer =
+    (struct _condvar_cleanup_any_buffer *) arg;
+
+  for (unsigned int i = 0; i < cbuffer->count; i++)
+    {
+      pthread_cond_t *cond = cbuffer->conds[i];
+      unsigned int g = cbuffer->wseqs[i] & 1;
+      __condvar_dec_grefs (cond, g, cbuffer->privates[i]);
+      __condvar_cancel_waiting (cond, cbuffer->wseqs[i] >> 1, g,
+				cbuffer->privates[i]);
+      /* See __condvar_cleanup_waiting.  */
+      futex_wake (cond->__data.__g_signals + g, 1, cbuffer->privates[i]);
+    }
+  for (unsigned int i = 0; i < cbuffer->count; i++)
+    __condvar_confirm_wakeup (cbuffer->conds[i], cbuffer->privates[i]);
+
+  __pthread_mutex_cond_lock (cbuffer->mutex);
+}
+
+/* Wait until one of the COUNT condvars in CONDS is signaled, and store its
+   index in *INDEX.
+
+   We register as a waiter on each of the condvars as in
+   __pthread_cond_wait_common before releasing MUTEX, so that waiting stays
+   atomic with the release for each condvar.  When there is neither a
+   signal nor a closed group on any of them, we acquire a group reference
+   on each and block on all the __g_signals futex words at once with
+   futex_waitv.  Once we consumed a signal from (or were woken by closing
+   the group of) one of the condvars, we cancel waiting on all the others
+   exactly like a waiter that timed out.  A futex_wake on one of those may
+   have woken us rather than another waiter, so, like sem_any_unregister
+   in sem_wait_any.c, we wake another waiter of each of them that still
+   has signals in our group.
+
+   All other aspects, including how we deal with stolen signals and hand
+   over broadcasts, are the same as in __pthread_cond_wait_common.  */
+static int
+__pthread_cond_wait_any_common (pthread_cond_t *const *conds,
+				unsigned int count, pthread_mutex_t *mutex,
+				clockid_t clockid,
+				const struct __timespec64 *abstime,
+				unsigned int *index)
+{
+  uint64_t wseqs[FUTEX_WAITV_MAX];
+  int privates[FUTEX_WAITV_MAX];
+  struct futex_waiter waiters[FUTEX_WAITV_MAX];
+  unsigned int woken = count;
+  bool wake_next = false;
+  int result = 0;
+  int err;
+
+  for (unsigned int i = 0; i < count; i++)
+    {
+      LIBC_PROBE (cond_wait, 2, conds[i], mutex);
+      /* See __pthread_cond_wait_common for the MOs.  */
+      wseqs[i] = __condvar_fetch_add_wseq_acquire (conds[i], 2);
+      unsigned int flags = atomic_fetch_add_relaxed (&conds[i]->__data.__wrefs,
+						     8);
+      privates[i] = __condvar_get_private (flags);
+    }
+
+  err = __pthread_mutex_unlock_usercnt (mutex, 0);
+  if (__glibc_unlikely (err != 0))
+    {
+      for (unsigned int i = 0; i < count; i++)
+	{
+	  __condvar_cancel_waiting (conds[i], wseqs[i] >> 1, wseqs[i] & 1,
+				    privates[i]);
+	  __condvar_confirm_wakeup (conds[i], privates[i]);
+	}
+      return err;
+    }
+
+  while (1)
+    {
+      /* Look for a signal or a closed group.  */
+      for (unsigned int i = 0; i < count && woken == count; i++)
+	{
+	  pthread_cond_t *cond = conds[i];
+	  unsigned int g = wseqs[i] & 1;
+	  unsigned int signals =
+	    atomic_load_acquire (cond->__data.__g_signals + g);
+	  while (signals != 0)
+	    {
+	      if (signals & 1)
+		{
+		  woken = i;
+		  break;
+		}
+	      if (atomic_compare_exchange_weak_acquire
+		  (cond->__data.__g_signals + g, &signals, signals - 2))
+		{
+		  woken = i;
+		  wake_next = (signals >> 1) > 1;
+		  __condvar_check_stolen_signal (cond, wseqs[i] >> 1, g,
+						 privates[i]);
+		  break;
+		}
+	    }
+	}
+      if (woken != count)
+	break;
+
+      /* Prepare to block on all the groups, which may have been closed
+	 since we checked them.  */
+      unsigned int refs;
+      for (refs = 0; refs < count; refs++)
+	{
+	  pthread_cond_t *cond = conds[refs];
+	  unsigned int g = wseqs[refs] & 1;
+	  atomic_fetch_add_acquire (cond->__data.__g_refs + g, 2);
+	  if (((atomic_load_acquire (cond->__data.__g_signals + g) & 1) != 0)
+	      || ((wseqs[refs] >> 1)
+		  < (__condvar_load_g1_start_relaxed (cond) >> 1)))
+	    {
+	      woken = refs++;
+	      break;
+	    }
+	  futex_waiter_init (&waiters[refs], cond->__data.__g_signals + g, 0,
+			     privates[refs]);
+	}
+
+      if (woken == count)
+	{
+	  struct _pthread_cleanup_buffer buffer;
+	  struct _condvar_cleanup_any_buffer cbuffer;
+	  cbuffer.conds = conds;
+	  cbuffer.wseqs = wseqs;
+	  cbuffer.privates = privates;
+	  cbuffer.count = count;
+	  cbuffer.mutex = mutex;
+	  __pthread_cleanup_push (&buffer, __condvar_cleanup_waiting_any,
+				  &cbuffer);
+
+	  unsigned int ignored;
+	  err = __futex_abstimed_waitv_cancelable64 (waiters, count, &ignored,
+						     clockid, abstime);
+
+	  __pthread_cleanup_pop (&buffer, 0);
+	}
+
+      /* Wake up any signalers that might be waiting.  */
+      for (unsigned int i = 0; i < refs; i++)
+	__condvar_dec_grefs (conds[i], wseqs[i] & 1, privates[i]);
+
+      if (woken != count)
+	break;
+      /* futex_waitv fails with ENOSYS on kernels older than 5.16.  */
+      if (__glibc_unlikely (err == ETIMEDOUT || err == ENOSYS
+			    || err == EINVAL))
+	{
+	  result = err;
+	  break;
+	}
+    }
+
+  /* Stop waiting on all the condvars we were not woken from.  See
+     __pthread_cond_wait_common for why we do not need to hold group
+     references for that.  */
+  for (unsigned int i = 0; i < count; i++)
+    if (i != woken)
+      {
+	unsigned int g = wseqs[i] & 1;
+	__condvar_cancel_waiting (conds[i], wseqs[i] >> 1, g, privates[i]);
+	/* Pass on a wake-up that we may have absorbed.  */
+	if ((atomic_load_relaxed (conds[i]->__data.__g_signals + g) >> 1) != 0)
+	  futex_wake (conds[i]->__data.__g_signals + g, 1, privates[i]);
+      }
+
+  for (unsigned int i = 0; i < count; i++)
+    __condvar_confirm_wakeup (conds[i], privates[i]);
+
+  err = __pthread_mutex_cond_lock (mutex);
+
+  if (wake_next)
+    futex_wake (conds[woken]->__data.__g_signals + (wseqs[woken] & 1), 1,
+		privates[woken]);
+
+  if (result == 0)
+    *index = woken;
+  return (err != 0) ? err : result;
+}
+
+/* See __pthread_cond_wait_any_common.  */
+int
+pthread_cond_wait_any (pthread_cond_t *const *conds, unsigned int count,
+		       pthread_mutex_t *mutex, unsigned int *index)
+{
+  if (count == 0 || count > FUTEX_WAITV_MAX)
+    return EINVAL;
+
+  /* A single condvar does not need futex_waitv.  */
+  if (count == 1)
+    {
+      *index = 0;
+      return __pthread_cond_wait (conds[0], mutex);
+    }
+
+  /* The clock is unused when ABSTIME is NULL.  */
+  return __pthread_cond_wait_any_common (conds, count, mutex,
+					 CLOCK_MONOTONIC, NULL, index);
+}
+
+/* See __pthread_cond_wait_any_common.  */
+int
+__pthread_cond_clockwait_any64 (pthread_cond_t *const *conds,
+				unsigned int count, pthread_mutex_t *mutex,
+				clockid_t clockid,
+				const struct __timespec64 *abstime,
+				unsigned int *index)
+{
+  if (count == 0 || count > FUTEX_WAITV_MAX)
+    return EINVAL;
+
+  /* Check parameter validity.  This should also tell the compiler that
+     it can assume that abstime is not NULL.  */
+  if (! valid_nanoseconds (abstime->tv_nsec))
+    return EINVAL;
+
+  if (!futex_abstimed_supported_clockid (clockid))
+    return EINVAL;
+
+  /* A single condvar does not need futex_waitv.  */
+  if (count == 1)
+    {
+      *index = 0;
+      return __pthread_cond_clockwait64 (conds[0], mutex, clockid, abstime);
+    }
+
+  return __pthread_cond_wait_any_common (conds, count, mutex, clockid,
+					 abstime, index);
+}
+
+#if __TIMESIZE != 64
+libc_hidden_def (__pthread_cond_clockwait_any64)
+
+int
+pthread_cond_clockwait_any (pthread_cond_t *const *conds, unsigned int count,
+			    pthread_mutex_t *mutex, clockid_t clockid,
+			    const struct timespec *abstime,
+			    unsigned int *index)
+{
+  struct __timespec64 ts64 = valid_timespec_to_timespec64 (*abstime);
+
+  return __pthread_cond_clockwait_any64 (conds, count, mutex, clockid, &ts64,
+					 index);
+}
+#endif /* __TIMESIZE != 64 */
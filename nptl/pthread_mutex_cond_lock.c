@@ -1,8 +1,17 @@
 #include <pthreadP.h>
 
-#define LLL_MUTEX_LOCK(mutex) \
-  lll_cond_lock ((mutex)->__data.__lock, PTHREAD_MUTEX_PSHARED (mutex))
-#define LLL_MUTEX_LOCK_OPTIMIZED(mutex) LLL_MUTEX_LOCK (mutex)
+/* lll_cond_lock which accounts contention to CALLER, see
+   pthread_mutex_lock.c.  */
+static __always_inline void
+lll_mutex_cond_lock (pthread_mutex_t *mutex, const void *caller)
+{
+  int *futex = &mutex->__data.__lock;
+  if (__glibc_unlikely (atomic_exchange_acquire (futex, 2) != 0))
+    __lll_lock_wait_caller (futex, PTHREAD_MUTEX_PSHARED (mutex), caller);
+}
+
+#define LLL_MUTEX_LOCK(mutex, caller) lll_mutex_cond_lock (mutex, caller)
+#define LLL_MUTEX_LOCK_OPTIMIZED(mutex, caller) LLL_MUTEX_LOCK (mutex, caller)
 
 /* Not actually elided so far. Needed? */
 #define LLL_MUTEX_LOCK_ELISION(mutex)  \
@@ -24,6 +24,7 @@
 #include <unistd.h>  /* Get STDOUT_FILENO for _dl_printf.  */
 #include <elf/dl-tunables.h>
 #include <nptl-stack.h>
+#include <pthreadP.h>
 
 struct mutex_config __mutex_aconf =
 {
@@ -45,6 +46,12 @@ TUNABLE_CALLBACK (set_stack_cache_size) (tunable_val_t *valp)
   __nptl_stack_cache_maxsize = valp->numval;
 }
 
+static void
+TUNABLE_CALLBACK (set_mutex_profile) (tunable_val_t *valp)
+{
+  __mutex_profile_init (valp->numval);
+}
+
 void
 __pthread_tunables_init (void)
 {
@@ -52,5 +59,7 @@ __pthread_tunables_init (void)
                TUNABLE_CALLBACK (set_mutex_spin_count));
   TUNABLE_GET (stack_cache_size, size_t,
                TUNABLE_CALLBACK (set_stack_cache_size));
+  TUNABLE_GET (mutex_profile, size_t,
+               TUNABLE_CALLBACK (set_mutex_profile));
 }
 #endif
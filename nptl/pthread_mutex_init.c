@@ -135,6 +135,13 @@ ___pthread_mutex_init (pthread_mutex_t *mutex,
 				| PTHREAD_MUTEXATTR_FLAG_ROBUST)) != 0)
     mutex_kind |= PTHREAD_MUTEX_PSHARED_BIT;
 
+  /* The spin queue links the stacks of the waiting threads, which
+     other processes cannot access, and robust mutexes use __list.
+     Such mutexes spin like other adaptive mutexes.  */
+  if ((mutex_kind & ~(PTHREAD_MUTEX_KIND_MASK_NP
+		      | PTHREAD_MUTEX_QUEUED_FLAG_NP)) != 0)
+    mutex_kind &= ~PTHREAD_MUTEX_QUEUED_FLAG_NP;
+
   /* See concurrency notes regarding __kind in struct __pthread_mutex_s
      in sysdeps/nptl/bits/thread-shared-types.h.  */
   atomic_store_relaxed (&(mutex->__data.__kind), mutex_kind);
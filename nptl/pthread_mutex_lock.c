@@ -30,9 +30,20 @@
 /* Some of the following definitions differ when pthread_mutex_cond_lock.c
    includes this file.  */
 #ifndef LLL_MUTEX_LOCK
-/* lll_lock with single-thread optimization.  */
+/* lll_lock which accounts contention to CALLER, the caller of
+   pthread_mutex_lock, in the contention profile.  If CALLER is NULL,
+   the contention is not accounted.  */
+static __always_inline void
+lll_mutex_lock (pthread_mutex_t *mutex, const void *caller)
+{
+  int *futex = &mutex->__data.__lock;
+  if (__glibc_unlikely (atomic_compare_and_exchange_bool_acq (futex, 1, 0)))
+    __lll_lock_wait_caller (futex, PTHREAD_MUTEX_PSHARED (mutex), caller);
+}
+
+/* lll_mutex_lock with single-thread optimization.  */
 static inline void
-lll_mutex_lock_optimized (pthread_mutex_t *mutex)
+lll_mutex_lock_optimized (pthread_mutex_t *mutex, const void *caller)
 {
   /* The single-threaded optimization is only valid for private
      mutexes.  For process-shared mutexes, the mutex could be in a
@@ -45,12 +56,12 @@ lll_mutex_lock_optimized (pthread_mutex_t *mutex)
   if (private == LLL_PRIVATE && SINGLE_THREAD_P && mutex->__data.__lock == 0)
     mutex->__data.__lock = 1;
   else
-    lll_lock (mutex->__data.__lock, private);
+    lll_mutex_lock (mutex, caller);
 }
 
-# define LLL_MUTEX_LOCK(mutex)						\
-  lll_lock ((mutex)->__data.__lock, PTHREAD_MUTEX_PSHARED (mutex))
-# define LLL_MUTEX_LOCK_OPTIMIZED(mutex) lll_mutex_lock_optimized (mutex)
+# define LLL_MUTEX_LOCK(mutex, caller) lll_mutex_lock (mutex, caller)
+# define LLL_MUTEX_LOCK_OPTIMIZED(mutex, caller) \
+  lll_mutex_lock_optimized (mutex, caller)
 # define LLL_MUTEX_TRYLOCK(mutex) \
   lll_trylock ((mutex)->__data.__lock)
 # define LLL_ROBUST_MUTEX_LOCK_MODIFIER 0
@@ -69,7 +80,123 @@ lll_mutex_lock_optimized (pthread_mutex_t *mutex)
   atomic_load_relaxed (&(mutex)->__data.__lock)
 #endif
 
-static int __pthread_mutex_lock_full (pthread_mutex_t *mutex)
+/* Spinning on a PTHREAD_MUTEX_QUEUED_NP mutex.
+
+   With the plain adaptive mutex, every waiter polls the lock word,
+   so that each release makes all spinning threads fetch the cache
+   line and race for it.  Waiters of a queued mutex instead append a
+   node on their stack to an MCS queue and spin on that node.  Only
+   the thread at the head of the queue polls the lock word.  When it
+   acquires the lock, or gives up spinning, it leaves the queue and
+   hands the head position to its successor, so the spinning threads
+   get their turn in FIFO order.
+
+   The lock word keeps its usual meaning, so unlock, trylock,
+   timedlock and the condition variables need no changes.  A thread
+   which does not find the lock free within the spin count of
+   glibc.pthread.mutex_spin_count blocks: while queued, on its node
+   until it becomes the head, and as the head, on the lock word after
+   leaving the queue.
+
+   The tail of the queue is stored in __list.__next, which only robust
+   mutexes use.  pthread_mutex_init does not set the flag for robust
+   and process-shared mutexes.  */
+
+/* The node states.  */
+enum
+  {
+    mutex_spin_waiting,		/* Spinning until it becomes the head.  */
+    mutex_spin_parked,		/* Blocked on the state until then.  */
+    mutex_spin_head,		/* At the head of the queue.  */
+  };
+
+struct mutex_spin_node
+{
+  struct mutex_spin_node *next;
+  unsigned int state;
+};
+
+/* The type of the tail pointer in the mutex.  */
+typedef __typeof (((pthread_mutex_t *) NULL)->__data.__list.__next)
+  mutex_spin_tail_t;
+
+/* Acquire MUTEX, whose lock word was found taken, using the spin
+   queue.  */
+static void
+mutex_queued_lock (pthread_mutex_t *mutex)
+{
+  mutex_spin_tail_t *tail = &mutex->__data.__list.__next;
+  struct mutex_spin_node node = { NULL, mutex_spin_waiting };
+  int max_cnt = max_adaptive_count ();
+  int cnt = 0;
+
+  /* The release MO publishes the initialization of NODE, and the
+     acquire fence makes sure that the store to PREV->next below
+     happens after PREV was initialized.  */
+  struct mutex_spin_node *prev = (struct mutex_spin_node *)
+    atomic_exchange_release (tail, (mutex_spin_tail_t) &node);
+  atomic_thread_fence_acquire ();
+  if (prev != NULL)
+    {
+      atomic_store_release (&prev->next, &node);
+      unsigned int state;
+      while ((state = atomic_load_acquire (&node.state)) != mutex_spin_head)
+	{
+	  if (state == mutex_spin_parked)
+	    futex_wait_simple (&node.state, mutex_spin_parked, FUTEX_PRIVATE);
+	  else if (cnt++ < max_cnt)
+	    atomic_spin_nop ();
+	  else
+	    /* On failure, the predecessor has made us the head.  */
+	    atomic_compare_exchange_weak_relaxed (&node.state, &state,
+						  mutex_spin_parked);
+	}
+      /* The head gets a fresh spin budget, so that a thread which was
+	 woken up to become the head does not block again right away.  */
+      cnt = 0;
+    }
+
+  /* Poll the lock word as the head of the queue.  */
+  bool acquired = false;
+  while (cnt++ < max_cnt)
+    {
+      if (LLL_MUTEX_READ_LOCK (mutex) == 0 && LLL_MUTEX_TRYLOCK (mutex) == 0)
+	{
+	  acquired = true;
+	  break;
+	}
+      atomic_spin_nop ();
+    }
+
+  /* Leave the queue.  If another thread has swapped itself into the
+     tail, wait until it has linked itself to NODE, and make it the
+     head.  The successor may have already returned from this function
+     after seeing the new state when the futex wake-up happens, which
+     only causes a spurious wake-up of whatever uses that address.  */
+  struct mutex_spin_node *next = atomic_load_acquire (&node.next);
+  if (next == NULL)
+    {
+      mutex_spin_tail_t expected;
+      do
+	expected = (mutex_spin_tail_t) &node;
+      while (!atomic_compare_exchange_weak_release (tail, &expected, NULL)
+	     && expected == (mutex_spin_tail_t) &node);
+      if (expected != (mutex_spin_tail_t) &node)
+	while ((next = atomic_load_acquire (&node.next)) == NULL)
+	  atomic_spin_nop ();
+    }
+  if (next != NULL
+      && atomic_exchange_release (&next->state, mutex_spin_head)
+	 == mutex_spin_parked)
+    futex_wake (&next->state, 1, FUTEX_PRIVATE);
+
+  /* The caller accounts the contention.  */
+  if (!acquired)
+    LLL_MUTEX_LOCK (mutex, NULL);
+}
+
+static int __pthread_mutex_lock_full (pthread_mutex_t *mutex,
+				      const void *caller)
      __attribute_noinline__;
 
 int
@@ -83,14 +210,14 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
 
   if (__builtin_expect (type & ~(PTHREAD_MUTEX_KIND_MASK_NP
 				 | PTHREAD_MUTEX_ELISION_FLAGS_NP), 0))
-    return __pthread_mutex_lock_full (mutex);
+    return __pthread_mutex_lock_full (mutex, __builtin_return_address (0));
 
   if (__glibc_likely (type == PTHREAD_MUTEX_TIMED_NP))
     {
       FORCE_ELISION (mutex, goto elision);
     simple:
       /* Normal mutex.  */
-      LLL_MUTEX_LOCK_OPTIMIZED (mutex);
+      LLL_MUTEX_LOCK_OPTIMIZED (mutex, __builtin_return_address (0));
       assert (mutex->__data.__owner == 0);
     }
 #if ENABLE_ELISION_SUPPORT
@@ -125,7 +252,7 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
 	}
 
       /* We have to get the mutex.  */
-      LLL_MUTEX_LOCK_OPTIMIZED (mutex);
+      LLL_MUTEX_LOCK_OPTIMIZED (mutex, __builtin_return_address (0));
 
       assert (mutex->__data.__owner == 0);
       mutex->__data.__count = 1;
@@ -133,8 +260,18 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
   else if (__builtin_expect (PTHREAD_MUTEX_TYPE (mutex)
 			  == PTHREAD_MUTEX_ADAPTIVE_NP, 1))
     {
-      if (LLL_MUTEX_TRYLOCK (mutex) != 0)
+      uint64_t start = 0;
+      if (LLL_MUTEX_TRYLOCK (mutex) == 0)
+	;
+      else if (atomic_load_relaxed (&mutex->__data.__kind)
+	       & PTHREAD_MUTEX_QUEUED_FLAG_NP)
+	{
+	  start = __mutex_profile_start ();
+	  mutex_queued_lock (mutex);
+	}
+      else
 	{
+	  start = __mutex_profile_start ();
 	  int cnt = 0;
 	  int max_cnt = MIN (max_adaptive_count (),
 			     mutex->__data.__spins * 2 + 10);
@@ -150,7 +287,7 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
 		{
 		  /* If cnt exceeds max spin count, just go to wait
 		     queue.  */
-		  LLL_MUTEX_LOCK (mutex);
+		  LLL_MUTEX_LOCK (mutex, NULL);
 		  break;
 		}
 	      do
@@ -164,6 +301,8 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
 
 	  mutex->__data.__spins += (cnt - mutex->__data.__spins) / 8;
 	}
+      /* Account the time spent spinning and blocking.  */
+      __mutex_profile_end (mutex, __builtin_return_address (0), start);
       assert (mutex->__data.__owner == 0);
     }
   else
@@ -190,10 +329,12 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
 }
 
 static int
-__pthread_mutex_lock_full (pthread_mutex_t *mutex)
+__pthread_mutex_lock_full (pthread_mutex_t *mutex, const void *caller)
 {
   int oldval;
   pid_t id = THREAD_GETMEM (THREAD_SELF, tid);
+  /* The start of a contended acquisition, see __mutex_profile_start.  */
+  uint64_t start = 0;
 
   switch (PTHREAD_MUTEX_TYPE (mutex))
     {
@@ -331,6 +472,9 @@ __pthread_mutex_lock_full (pthread_mutex_t *mutex)
 	     above and thus do not cause lost wake-ups.  */
 	  assume_other_futex_waiters |= FUTEX_WAITERS;
 
+	  if (start == 0)
+	    start = __mutex_profile_start ();
+
 	  /* Block using the futex and reload current lock value.  */
 	  futex_wait ((unsigned int *) &mutex->__data.__lock, oldval,
 		      PTHREAD_ROBUST_MUTEX_PSHARED (mutex));
@@ -438,6 +582,7 @@ __pthread_mutex_lock_full (pthread_mutex_t *mutex)
 	    int private = (robust
 			   ? PTHREAD_ROBUST_MUTEX_PSHARED (mutex)
 			   : PTHREAD_MUTEX_PSHARED (mutex));
+	    start = __mutex_profile_start ();
 	    int e = __futex_lock_pi64 (&mutex->__data.__lock, 0 /* ununsed  */,
 				       NULL, private);
 	    if (e == ESRCH || e == EDEADLK)
@@ -594,9 +739,13 @@ __pthread_mutex_lock_full (pthread_mutex_t *mutex)
 		  break;
 
 		if (oldval != ceilval)
-		  futex_wait ((unsigned int * ) &mutex->__data.__lock,
-			      ceilval | 2,
-			      PTHREAD_MUTEX_PSHARED (mutex));
+		  {
+		    if (start == 0)
+		      start = __mutex_profile_start ();
+		    futex_wait ((unsigned int * ) &mutex->__data.__lock,
+				ceilval | 2,
+				PTHREAD_MUTEX_PSHARED (mutex));
+		  }
 	      }
 	    while (atomic_compare_and_exchange_val_acq (&mutex->__data.__lock,
 							ceilval | 2, ceilval)
@@ -614,6 +763,8 @@ __pthread_mutex_lock_full (pthread_mutex_t *mutex)
       return EINVAL;
     }
 
+  __mutex_profile_end (mutex, caller, start);
+
   /* Record the ownership.  */
   mutex->__data.__owner = id;
 #ifndef NO_INCR
@@ -0,0 +1,128 @@
+/* Contention profile of mutexes and low-level locks.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* If the glibc.pthread.mutex_profile tunable is set to N, a table of
+   at least N entries is allocated at startup.  Each time a thread finds
+   a mutex or a low-level lock taken, the time until it acquires the
+   lock is accounted to the entry of the lock and the call site, which
+   is the caller of pthread_mutex_lock or of the function that called
+   the lll_lock slow path.  The table is written to standard error at
+   exit and by pthread_mutex_profile_dump_np.
+
+   The fast paths of the locks are unchanged: only the slow paths check
+   whether the table exists.  Entries are claimed and updated without a
+   lock because recording happens inside the slow path of the locks
+   themselves.  Once the table is full, further call sites are only
+   counted as dropped.
+
+   The dump and the initialization are in pthread_mutex_profile_dump.c,
+   so that the lock slow paths, which the dynamic linker uses as well,
+   do not depend on them.  */
+
+#include <time.h>
+#include "pthreadP.h"
+
+struct mutex_profile_entry *__mutex_profile_table;
+size_t __mutex_profile_mask;
+uint64_t __mutex_profile_dropped;
+
+/* Counters are updated with relaxed atomics where the machine supports
+   them.  Otherwise, concurrent updates may be lost, which only makes
+   the profile less precise.  */
+static inline void
+profile_add (uint64_t *counter, uint64_t value)
+{
+#if __HAVE_64B_ATOMICS
+  atomic_fetch_add_relaxed (counter, value);
+#else
+  *(volatile uint64_t *) counter += value;
+#endif
+}
+
+static inline void
+profile_max (uint64_t *counter, uint64_t value)
+{
+#if __HAVE_64B_ATOMICS
+  uint64_t max = atomic_load_relaxed (counter);
+  while (value > max
+	 && !atomic_compare_exchange_weak_relaxed (counter, &max, value))
+    ;
+#else
+  if (value > *(volatile uint64_t *) counter)
+    *(volatile uint64_t *) counter = value;
+#endif
+}
+
+uint64_t
+__mutex_profile_now (void)
+{
+  struct __timespec64 ts;
+  __clock_gettime64 (CLOCK_MONOTONIC, &ts);
+  /* Zero means that profiling is disabled, see __mutex_profile_start.  */
+  return ((uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec) | 1;
+}
+
+/* Return the entry of LOCK and CALLER, claiming an unused one if
+   needed, or NULL if the table is full.  */
+static struct mutex_profile_entry *
+profile_find (void *lock, const void *caller)
+{
+  uint64_t h = ((uintptr_t) lock ^ ((uintptr_t) caller << 16))
+	       * 0x9e3779b97f4a7c15ULL;
+  size_t mask = __mutex_profile_mask;
+  size_t slot = (h >> 32) & mask;
+  for (size_t n = 0; n <= mask; n++, slot = (slot + 1) & mask)
+    {
+      struct mutex_profile_entry *e = &__mutex_profile_table[slot];
+      /* Acquire MO so that we see CALLER if it was set before.  */
+      void *l = atomic_load_acquire (&e->lock);
+      while (l == NULL)
+	if (atomic_compare_exchange_weak_acquire (&e->lock, &l, lock))
+	  {
+	    atomic_store_release (&e->caller, caller);
+	    return e;
+	  }
+      if (l == lock)
+	{
+	  const void *c;
+	  /* The thread which claims an entry sets CALLER right after
+	     LOCK.  */
+	  while ((c = atomic_load_acquire (&e->caller)) == NULL)
+	    atomic_spin_nop ();
+	  if (c == caller)
+	    return e;
+	}
+    }
+  return NULL;
+}
+
+void
+__mutex_profile_record (void *lock, const void *caller, uint64_t start)
+{
+  uint64_t wait = __mutex_profile_now () - start;
+  struct mutex_profile_entry *e = profile_find (lock, caller);
+  if (e == NULL)
+    {
+      profile_add (&__mutex_profile_dropped, 1);
+      return;
+    }
+  profile_add (&e->contended, 1);
+  profile_add (&e->wait_ns, wait);
+  profile_max (&e->max_wait_ns, wait);
+}
+
@@ -0,0 +1,129 @@
+/* Output and initialization of the mutex contention profile.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <_itoa.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <not-cancel.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "pthreadP.h"
+
+/* See pthread_mutex_profile.c.  */
+static inline uint64_t
+profile_load (uint64_t *counter)
+{
+#if __HAVE_64B_ATOMICS
+  return atomic_load_relaxed (counter);
+#else
+  return *(volatile uint64_t *) counter;
+#endif
+}
+
+/* Copy the representation of VALUE in BASE to BUF, truncated at END,
+   and return the end of the copy.  */
+static char *
+profile_number (char *buf, char *end, uint64_t value, unsigned int base)
+{
+  char digits[24];
+  char *p = _itoa (value, &digits[sizeof (digits)], base, 0);
+  size_t len = &digits[sizeof (digits)] - p;
+  if (len > end - buf)
+    len = end - buf;
+  return __mempcpy (buf, p, len);
+}
+
+/* Likewise for the string S.  */
+static char *
+profile_string (char *buf, char *end, const char *s)
+{
+  size_t len = strlen (s);
+  if (len > end - buf)
+    len = end - buf;
+  return __mempcpy (buf, s, len);
+}
+
+int
+__pthread_mutex_profile_dump_np (int fd)
+{
+  struct mutex_profile_entry *table = __mutex_profile_table;
+  if (table == NULL)
+    return ENOTSUP;
+
+  char buf[128];
+  char *end = buf + sizeof (buf);
+  char *p = profile_string (buf, end, "mutex contention profile, dropped ");
+  p = profile_number (p, end, profile_load (&__mutex_profile_dropped), 10);
+  p = profile_string (p, end,
+		      "\ncontended wait_ns max_wait_ns lock caller\n");
+  if (__write_nocancel (fd, buf, p - buf) < 0)
+    return errno;
+
+  for (size_t i = 0; i <= __mutex_profile_mask; i++)
+    {
+      struct mutex_profile_entry *e = &table[i];
+      void *lock = atomic_load_acquire (&e->lock);
+      void *caller = (void *) atomic_load_acquire (&e->caller);
+      uint64_t contended = profile_load (&e->contended);
+      if (lock == NULL || caller == NULL || contended == 0)
+	continue;
+
+      p = profile_number (buf, end, contended, 10);
+      p = profile_string (p, end, " ");
+      p = profile_number (p, end, profile_load (&e->wait_ns), 10);
+      p = profile_string (p, end, " ");
+      p = profile_number (p, end, profile_load (&e->max_wait_ns), 10);
+      p = profile_string (p, end, " 0x");
+      p = profile_number (p, end, (uintptr_t) lock, 16);
+      p = profile_string (p, end, " ");
+      if (__write_nocancel (fd, buf, p - buf) < 0)
+	return errno;
+      /* This writes the caller and a newline.  */
+      __backtrace_symbols_fd (&caller, 1, fd);
+    }
+  return 0;
+}
+weak_alias (__pthread_mutex_profile_dump_np, pthread_mutex_profile_dump_np)
+
+static void
+profile_exit (void *closure)
+{
+  __pthread_mutex_profile_dump_np (STDERR_FILENO);
+}
+
+void
+__mutex_profile_init (size_t entries)
+{
+  if (entries == 0)
+    return;
+
+  size_t size = 1;
+  while (size < entries)
+    size *= 2;
+  struct mutex_profile_entry *table
+    = __mmap (NULL, size * sizeof (*table), PROT_READ | PROT_WRITE,
+	      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (table == MAP_FAILED)
+    return;
+
+  __mutex_profile_mask = size - 1;
+  __mutex_profile_table = table;
+  __cxa_atexit (profile_exit, NULL, NULL);
+}
@@ -101,9 +101,15 @@ __pthread_mutex_clocklock_common (pthread_mutex_t *mutex,
     case PTHREAD_MUTEX_ADAPTIVE_NP:
       if (lll_trylock (mutex->__data.__lock) != 0)
 	{
+	  /* Waiting on the spin queue of a queued mutex cannot time out,
+	     so spin on the lock word.  The spin queue overlaps __spins
+	     on some targets, so there is no spin estimate.  */
+	  bool queued = (atomic_load_relaxed (&mutex->__data.__kind)
+			 & PTHREAD_MUTEX_QUEUED_FLAG_NP) != 0;
 	  int cnt = 0;
-	  int max_cnt = MIN (max_adaptive_count (),
-			     mutex->__data.__spins * 2 + 10);
+	  int max_cnt = (queued ? max_adaptive_count ()
+			 : MIN (max_adaptive_count (),
+				mutex->__data.__spins * 2 + 10));
 	  do
 	    {
 	      if (cnt++ >= max_cnt)
@@ -117,7 +123,8 @@ __pthread_mutex_clocklock_common (pthread_mutex_t *mutex,
 	    }
 	  while (lll_trylock (mutex->__data.__lock) != 0);
 
-	  mutex->__data.__spins += (cnt - mutex->__data.__spins) / 8;
+	  if (!queued)
+	    mutex->__data.__spins += (cnt - mutex->__data.__spins) / 8;
 	}
       break;
 
@@ -27,6 +27,8 @@ __pthread_mutexattr_gettype (const pthread_mutexattr_t *attr, int *kind)
 
   *kind = (iattr->mutexkind & ~PTHREAD_MUTEXATTR_FLAG_BITS
 	   & ~PTHREAD_MUTEX_NO_ELISION_NP);
+  if (*kind & PTHREAD_MUTEX_QUEUED_FLAG_NP)
+    *kind = PTHREAD_MUTEX_QUEUED_NP;
 
   return 0;
 }
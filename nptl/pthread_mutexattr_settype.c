@@ -24,7 +24,7 @@ ___pthread_mutexattr_settype (pthread_mutexattr_t *attr, int kind)
 {
   struct pthread_mutexattr *iattr;
 
-  if (kind < PTHREAD_MUTEX_NORMAL || kind > PTHREAD_MUTEX_ADAPTIVE_NP)
+  if (kind < PTHREAD_MUTEX_NORMAL || kind > PTHREAD_MUTEX_QUEUED_NP)
     return EINVAL;
 
   /* Cannot distinguish between DEFAULT and NORMAL. So any settype
@@ -32,6 +32,10 @@ ___pthread_mutexattr_settype (pthread_mutexattr_t *attr, int kind)
   if (kind == PTHREAD_MUTEX_NORMAL)
     kind |= PTHREAD_MUTEX_NO_ELISION_NP;
 
+  /* A queued mutex is an adaptive mutex which spins differently.  */
+  if (kind == PTHREAD_MUTEX_QUEUED_NP)
+    kind = PTHREAD_MUTEX_ADAPTIVE_NP | PTHREAD_MUTEX_QUEUED_FLAG_NP;
+
   iattr = (struct pthread_mutexattr *) attr;
 
   iattr->mutexkind = (iattr->mutexkind & PTHREAD_MUTEXATTR_FLAG_BITS) | kind;
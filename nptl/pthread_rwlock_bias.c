@@ -0,0 +1,112 @@
+/* Reader indicators of reader-biased rwlocks.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <errno.h>
+#include <hp-timing.h>
+#include <sched.h>
+#include <time.h>
+#include "pthreadP.h"
+
+/* See pthread_rwlock_common.c.  */
+pthread_rwlock_t *__pthread_rwlock_bias_table
+  [1 << PTHREAD_RWLOCK_BIAS_TABLE_BITS];
+
+/* The bias stays inhibited for this many times the duration of the
+   last revocation.  */
+enum { bias_inhibit_factor = 9 };
+
+/* Number of times a writer checks a slot before it yields the CPU to
+   the reader holding it.  */
+enum { bias_spin_count = 1000 };
+
+static bool
+timed_out (clockid_t clockid, const struct __timespec64 *abstime)
+{
+  struct __timespec64 now;
+  __clock_gettime64 (clockid, &now);
+  return (now.tv_sec > abstime->tv_sec
+	  || (now.tv_sec == abstime->tv_sec
+	      && now.tv_nsec >= abstime->tv_nsec));
+}
+
+int
+__pthread_rwlock_bias_revoke (pthread_rwlock_t *rwlock, bool block,
+			      clockid_t clockid,
+			      const struct __timespec64 *abstime)
+{
+  hp_timing_t start;
+  HP_TIMING_NOW (start);
+
+  /* See pthread_rwlock_common.c.  Readers cannot enable the bias again
+     while we hold the write lock, so relaxed MO is sufficient for the
+     store, and the fence orders it before the loads of the slots.  */
+  atomic_store_relaxed (&rwlock->__data.__pad3, PTHREAD_RWLOCK_BIAS_INHIBITED);
+  atomic_thread_fence_seq_cst ();
+
+  int err;
+  for (size_t i = 0; i < array_length (__pthread_rwlock_bias_table); i++)
+    {
+      unsigned int spins = 0;
+      /* Acquire MO so that we synchronize with the release of the slot
+	 by the reader.  */
+      while (atomic_load_acquire (&__pthread_rwlock_bias_table[i]) == rwlock)
+	{
+	  if (!block)
+	    {
+	      err = EBUSY;
+	      goto out;
+	    }
+	  if (++spins < bias_spin_count)
+	    {
+	      atomic_spin_nop ();
+	      continue;
+	    }
+	  /* The reader may have been preempted.  */
+	  if (abstime != NULL && timed_out (clockid, abstime))
+	    {
+	      err = ETIMEDOUT;
+	      goto out;
+	    }
+	  __sched_yield ();
+	  spins = 0;
+	}
+    }
+
+  /* Inhibit the bias for a multiple of the time the revocation took,
+     so that frequent writers do not pay for scanning the table every
+     time.  */
+  hp_timing_t end;
+  HP_TIMING_NOW (end);
+  hp_timing_t inhibit = (((end - start) >> PTHREAD_RWLOCK_BIAS_TIME_SHIFT)
+			 * bias_inhibit_factor) + 1;
+  if (inhibit > PTHREAD_RWLOCK_BIAS_INHIBIT_MAX)
+    inhibit = PTHREAD_RWLOCK_BIAS_INHIBIT_MAX;
+  atomic_store_relaxed (&rwlock->__data.__pad4,
+			(unsigned int) (end >> PTHREAD_RWLOCK_BIAS_TIME_SHIFT)
+			+ (unsigned int) inhibit);
+  return 0;
+
+ out:
+  /* Some readers may still hold RWLOCK through the table, so the next
+     writer has to revoke the bias again.  The caller releases the
+     write lock without having modified anything, so readers which see
+     the bias enabled may ignore that it held the lock.  */
+  atomic_store_release (&rwlock->__data.__pad3, PTHREAD_RWLOCK_BIAS_ON);
+  return err;
+}
@@ -24,6 +24,7 @@
 #include <stap-probe.h>
 #include <atomic.h>
 #include <futex-internal.h>
+#include <hp-timing.h>
 #include <time.h>
 
 
@@ -214,6 +215,42 @@
    deciding when to use elision so that enabling it would lead to consistently
    better performance.  */
 
+/* Reader-biased rwlocks (PTHREAD_RWLOCK_READER_BIASED_NP) prefer readers
+   like PTHREAD_RWLOCK_PREFER_READER_NP, but additionally let readers
+   acquire the lock without modifying it while no writer is active, so
+   that read-mostly workloads do not serialize on the cache line of
+   __readers.  The reader indicators cannot be stored in the rwlock
+   itself, so all such rwlocks share __pthread_rwlock_bias_table
+   (see pthread_rwlock_bias.c), in which a reader claims the slot
+   selected by a hash of the rwlock and its thread, and which writers
+   have to scan.
+
+   The bias state in __pad3 tells readers whether they may use the
+   table (PTHREAD_RWLOCK_BIAS_ON).  A reader in this state stores the
+   rwlock in its slot with a CAS from NULL and then checks the bias
+   state again; if it has been disabled in the meantime, the reader
+   clears the slot and falls back to __readers.  A writer first
+   acquires the lock through __readers as usual, which excludes all
+   readers that do not use the table, then disables the bias, and then
+   waits until no slot holds the rwlock anymore.  The seq_cst fences
+   between the store and the load on both sides ensure that either the
+   reader sees the bias disabled or the writer sees the slot.
+
+   Because writers pay for scanning the table, the bias stays inhibited
+   for several times the duration of the scan (see __pad4) after a
+   writer disabled it.  Readers that acquire the lock through __readers
+   without waiting for a writer enable the bias again once that time
+   has passed; they hold a read lock, so no writer can be in the middle
+   of disabling it.  Process-shared rwlocks never enable the bias
+   because the table is private to each process.
+
+   Each thread remembers the rwlocks it holds through the table in its
+   struct pthread (rwlock_bias), so that pthread_rwlock_unlock can tell
+   these read locks from the ones it has to release through __readers,
+   and so that recursive read locks of a rwlock held through the table
+   just increment a counter: acquiring them through __readers could
+   block behind a writer that waits for our slot.  */
+
 
 static int
 __pthread_rwlock_get_private (pthread_rwlock_t *rwlock)
@@ -221,6 +258,123 @@ __pthread_rwlock_get_private (pthread_rwlock_t *rwlock)
   return rwlock->__data.__shared != 0 ? FUTEX_SHARED : FUTEX_PRIVATE;
 }
 
+static __always_inline bool
+__pthread_rwlock_prefer_writer (pthread_rwlock_t *rwlock)
+{
+  return (rwlock->__data.__flags == PTHREAD_RWLOCK_PREFER_WRITER_NP
+	  || (rwlock->__data.__flags
+	      == PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP));
+}
+
+/* Return the slot of __pthread_rwlock_bias_table which SELF uses for
+   RWLOCK.  */
+static __always_inline pthread_rwlock_t **
+__pthread_rwlock_bias_slot (pthread_rwlock_t *rwlock, struct pthread *self)
+{
+  /* Thread descriptors are at least page-aligned, so the low bits of
+     SELF carry no information.  */
+  uint32_t h = ((uint32_t) ((uintptr_t) rwlock >> 3)
+		^ (uint32_t) ((uintptr_t) self >> 12));
+  h *= 0x9e3779b1;
+  return &__pthread_rwlock_bias_table[h >> (32
+					    - PTHREAD_RWLOCK_BIAS_TABLE_BITS)];
+}
+
+/* Try to acquire a read lock of the reader-biased RWLOCK through the
+   reader indicator table.  Return false if the caller has to use
+   __readers instead.  */
+static __always_inline bool
+__pthread_rwlock_bias_rdlock (pthread_rwlock_t *rwlock)
+{
+  struct pthread *self = THREAD_SELF;
+  int unused = -1;
+  for (int i = 0; i < PTHREAD_RWLOCK_BIAS_HELD; i++)
+    if (self->rwlock_bias[i].count == 0)
+      unused = i;
+    else if (self->rwlock_bias[i].rwlock == rwlock)
+      {
+	/* A recursive read lock.  We already hold the slot, and a
+	   writer that has disabled the bias in the meantime waits for
+	   us.  */
+	if (__glibc_unlikely (self->rwlock_bias[i].count == UINT_MAX))
+	  return false;
+	self->rwlock_bias[i].count++;
+	return true;
+      }
+
+  if (unused < 0
+      || (atomic_load_relaxed (&rwlock->__data.__pad3)
+	  != PTHREAD_RWLOCK_BIAS_ON))
+    return false;
+
+  pthread_rwlock_t **slot = __pthread_rwlock_bias_slot (rwlock, self);
+  pthread_rwlock_t *expected = NULL;
+  if (atomic_load_relaxed (slot) != NULL
+      || !atomic_compare_exchange_weak_relaxed (slot, &expected, rwlock))
+    return false;
+  /* See above.  Acquire MO so that we synchronize with the reader that
+     enabled the bias, and thus with the last writer.  */
+  atomic_thread_fence_seq_cst ();
+  if (atomic_load_acquire (&rwlock->__data.__pad3) != PTHREAD_RWLOCK_BIAS_ON)
+    {
+      /* A writer disabled the bias.  We did not acquire the lock, so
+	 relaxed MO is sufficient to let the writer proceed.  */
+      atomic_store_relaxed (slot, NULL);
+      return false;
+    }
+  self->rwlock_bias[unused].rwlock = rwlock;
+  self->rwlock_bias[unused].count = 1;
+  return true;
+}
+
+/* Release a read lock of the reader-biased RWLOCK if the calling
+   thread holds it through the reader indicator table, and return
+   whether it did.  */
+static __always_inline bool
+__pthread_rwlock_bias_rdunlock (pthread_rwlock_t *rwlock)
+{
+  struct pthread *self = THREAD_SELF;
+  for (int i = 0; i < PTHREAD_RWLOCK_BIAS_HELD; i++)
+    if (self->rwlock_bias[i].count != 0
+	&& self->rwlock_bias[i].rwlock == rwlock)
+      {
+	if (--self->rwlock_bias[i].count == 0)
+	  /* Release MO so that a writer waiting for the slot
+	     synchronizes with us.  */
+	  atomic_store_release (__pthread_rwlock_bias_slot (rwlock, self),
+				NULL);
+	return true;
+      }
+  return false;
+}
+
+/* Enable the bias of the reader-biased RWLOCK unless it is inhibited.
+   The caller holds a read lock acquired through __readers.  */
+static __always_inline void
+__pthread_rwlock_bias_enable (pthread_rwlock_t *rwlock)
+{
+  unsigned int bias = atomic_load_relaxed (&rwlock->__data.__pad3);
+  if (__glibc_likely (bias == PTHREAD_RWLOCK_BIAS_ON)
+      || rwlock->__data.__shared != 0)
+    return;
+  if (bias == PTHREAD_RWLOCK_BIAS_INHIBITED)
+    {
+      /* The inhibit time is bounded by __pthread_rwlock_bias_revoke,
+	 so a larger remaining time means that it has passed (or that
+	 the truncated clock has wrapped around, which is harmless).  */
+      hp_timing_t now;
+      HP_TIMING_NOW (now);
+      unsigned int remaining = (atomic_load_relaxed (&rwlock->__data.__pad4)
+				- (unsigned int) (now
+						  >> PTHREAD_RWLOCK_BIAS_TIME_SHIFT));
+      if (remaining <= PTHREAD_RWLOCK_BIAS_INHIBIT_MAX)
+	return;
+    }
+  /* Release MO so that readers which see the bias enabled synchronize
+     with us, and thus with the last writer.  */
+  atomic_store_release (&rwlock->__data.__pad3, PTHREAD_RWLOCK_BIAS_ON);
+}
+
 static __always_inline void
 __pthread_rwlock_rdunlock (pthread_rwlock_t *rwlock)
 {
@@ -299,6 +453,11 @@ __pthread_rwlock_rdlock_full64 (pthread_rwlock_t *rwlock, clockid_t clockid,
 			== THREAD_GETMEM (THREAD_SELF, tid)))
     return EDEADLK;
 
+  bool biased
+    = rwlock->__data.__flags == PTHREAD_RWLOCK_READER_BIASED_NP;
+  if (biased && __pthread_rwlock_bias_rdlock (rwlock))
+    return 0;
+
   /* If we prefer writers, recursive rdlock is disallowed, we are in a read
      phase, and there are other readers present, we try to wait without
      extending the read phase.  We will be unblocked by either one of the
@@ -386,9 +545,17 @@ __pthread_rwlock_rdlock_full64 (pthread_rwlock_t *rwlock, clockid_t clockid,
      cannot have acquired the lock previously as a reader (which could result
      in deadlock if we would wait for the primary writer to run).  However,
      this seems to be a corner case and handling it specially not be worth the
-     complexity.  */
+     complexity.
+     This is also where readers of reader-biased rwlocks may enable the
+     bias again; we do not bother in the other cases, which follow a
+     write phase and are thus likely within the time the bias is
+     inhibited.  */
   if (__glibc_likely ((r & PTHREAD_RWLOCK_WRPHASE) == 0))
-    return 0;
+    {
+      if (biased)
+	__pthread_rwlock_bias_enable (rwlock);
+      return 0;
+    }
   /* Otherwise, if we were in a write phase (states #6 or #8), we must wait
      for explicit hand-over of the read phase; the only exception is if we
      can start a read phase if there is no primary writer currently.  */
@@ -535,7 +702,7 @@ __pthread_rwlock_wrunlock (pthread_rwlock_t *rwlock)
     = ((atomic_exchange_relaxed (&rwlock->__data.__writers_futex, 0)
 	& PTHREAD_RWLOCK_FUTEX_USED) != 0);
 
-  if (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_NP)
+  if (__pthread_rwlock_prefer_writer (rwlock))
     {
       /* First, try to hand over to another writer.  */
       unsigned int w = atomic_load_relaxed (&rwlock->__data.__writers);
@@ -624,8 +791,7 @@ __pthread_rwlock_wrlock_full64 (pthread_rwlock_t *rwlock, clockid_t clockid,
   if (__glibc_unlikely ((r & PTHREAD_RWLOCK_WRLOCKED) != 0))
     {
       /* There is another primary writer.  */
-      bool prefer_writer
-	= (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_NP);
+      bool prefer_writer = __pthread_rwlock_prefer_writer (rwlock);
       if (prefer_writer)
 	{
 	  /* We register as a waiting writer, so that we can make use of
@@ -831,7 +997,7 @@ __pthread_rwlock_wrlock_full64 (pthread_rwlock_t *rwlock, clockid_t clockid,
 					     clockid, abstime, private);
 	  if (err == ETIMEDOUT || err == EOVERFLOW)
 	    {
-	      if (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_NP)
+	      if (__pthread_rwlock_prefer_writer (rwlock))
 		{
 		  /* We try writer--writer hand-over.  */
 		  unsigned int w
@@ -944,6 +1110,21 @@ __pthread_rwlock_wrlock_full64 (pthread_rwlock_t *rwlock, clockid_t clockid,
     }
 
  done:
+  /* Readers that acquired the lock through the reader indicator table
+     have not prevented us from starting a write phase, so we now have
+     to wait for them to leave.  The bias can only have been enabled by
+     readers that synchronize with us through __readers.  */
+  if (rwlock->__data.__flags == PTHREAD_RWLOCK_READER_BIASED_NP
+      && (atomic_load_relaxed (&rwlock->__data.__pad3)
+	  == PTHREAD_RWLOCK_BIAS_ON))
+    {
+      int err = __pthread_rwlock_bias_revoke (rwlock, true, clockid, abstime);
+      if (err != 0)
+	{
+	  __pthread_rwlock_wrunlock (rwlock);
+	  return err;
+	}
+    }
   atomic_store_relaxed (&rwlock->__data.__cur_writer,
 			THREAD_GETMEM (THREAD_SELF, tid));
   return 0;
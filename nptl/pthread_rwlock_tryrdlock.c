@@ -26,6 +26,10 @@
 int
 ___pthread_rwlock_tryrdlock (pthread_rwlock_t *rwlock)
 {
+  if (rwlock->__data.__flags == PTHREAD_RWLOCK_READER_BIASED_NP
+      && __pthread_rwlock_bias_rdlock (rwlock))
+    return 0;
+
   /* For tryrdlock, we could speculate that we will succeed and go ahead and
      register as a reader.  However, if we misspeculate, we have to do the
      same steps as a timed-out rdlock, which will increase contention.
@@ -19,6 +19,7 @@
 #include "pthreadP.h"
 #include <atomic.h>
 #include <shlib-compat.h>
+#include "pthread_rwlock_common.c"
 
 /* See pthread_rwlock_common.c for an overview.  */
 int
@@ -35,8 +36,7 @@ ___pthread_rwlock_trywrlock (pthread_rwlock_t *rwlock)
      further comments) -- and thus must loop until we get a definitive
      observation or state change.  */
   unsigned int r = atomic_load_relaxed (&rwlock->__data.__readers);
-  bool prefer_writer =
-      (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_NP);
+  bool prefer_writer = __pthread_rwlock_prefer_writer (rwlock);
   while (((r & PTHREAD_RWLOCK_WRLOCKED) == 0)
       && (((r >> PTHREAD_RWLOCK_READER_SHIFT) == 0)
 	  || (prefer_writer && ((r & PTHREAD_RWLOCK_WRPHASE) != 0))))
@@ -55,6 +55,17 @@ ___pthread_rwlock_trywrlock (pthread_rwlock_t *rwlock)
 	     may have set the PTHREAD_RWLOCK_FUTEX_USED in the meantime.  */
 	  if ((r & PTHREAD_RWLOCK_WRPHASE) == 0)
 	    atomic_store_relaxed (&rwlock->__data.__wrphase_futex, 1);
+	  /* Fail instead of waiting for readers that acquired the lock
+	     through the reader indicator table (see the full wrlock
+	     code).  */
+	  if (rwlock->__data.__flags == PTHREAD_RWLOCK_READER_BIASED_NP
+	      && (atomic_load_relaxed (&rwlock->__data.__pad3)
+		  == PTHREAD_RWLOCK_BIAS_ON)
+	      && __pthread_rwlock_bias_revoke (rwlock, false, 0, NULL) != 0)
+	    {
+	      __pthread_rwlock_wrunlock (rwlock);
+	      return EBUSY;
+	    }
 	  atomic_store_relaxed (&rwlock->__data.__cur_writer,
 	      THREAD_GETMEM (THREAD_SELF, tid));
 	  return 0;
@@ -0,0 +1,230 @@
+/* Wait for any of several semaphores.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <time.h>
+#include "semaphoreP.h"
+#include "sem_waitcommon.c"
+
+/* A thread waiting for several semaphores registers as a waiter of each of
+   them like __new_sem_wait_slow64 does, and then blocks on all their futex
+   words at once with futex_waitv.  Once it grabbed a token from one of the
+   semaphores, it stops being a waiter of the others.
+
+   sem_post wakes a single waiter only, which may be us even though we
+   then take a token from another semaphore.  Therefore, when we stop being
+   a waiter of a semaphore that has tokens and other waiters, we wake one
+   of them in our place.  */
+
+/* Register as a waiter of SEM.  */
+static void
+sem_any_register (struct new_sem *sem)
+{
+#if __HAVE_64B_ATOMICS
+  /* See __new_sem_wait_slow64 for the MO.  */
+  atomic_fetch_add_relaxed (&sem->data, (uint64_t) 1 << SEM_NWAITERS_SHIFT);
+#else
+  atomic_fetch_add_acquire (&sem->nwaiters, 1);
+#endif
+}
+
+/* Stop being a waiter of SEM without having grabbed a token.  */
+static void
+sem_any_unregister (struct new_sem *sem)
+{
+#if __HAVE_64B_ATOMICS
+  uint64_t d = atomic_fetch_add_relaxed (&sem->data,
+      -((uint64_t) 1 << SEM_NWAITERS_SHIFT));
+  if ((d & SEM_VALUE_MASK) != 0 && (d >> SEM_NWAITERS_SHIFT) > 1)
+    futex_wake ((unsigned int *) &sem->data + SEM_VALUE_OFFSET, 1,
+		sem->private);
+#else
+  __sem_wait_32_finish (sem);
+  if ((atomic_load_relaxed (&sem->value) >> SEM_VALUE_SHIFT) != 0
+      && atomic_load_relaxed (&sem->nwaiters) > 0)
+    futex_wake (&sem->value, 1, sem->private);
+#endif
+}
+
+/* Try to grab a token from SEM, of which we are a registered waiter.
+   Return true and stop being a waiter of SEM if successful.  Otherwise,
+   prepare W for blocking until SEM may have tokens.  */
+static bool
+sem_any_try (struct new_sem *sem, struct futex_waiter *w)
+{
+#if __HAVE_64B_ATOMICS
+  /* See __new_sem_wait_slow64 for the MOs.  */
+  uint64_t d = atomic_load_relaxed (&sem->data);
+  while ((d & SEM_VALUE_MASK) != 0)
+    if (atomic_compare_exchange_weak_acquire (&sem->data,
+	&d, d - 1 - ((uint64_t) 1 << SEM_NWAITERS_SHIFT)))
+      return true;
+  futex_waiter_init (w, (unsigned int *) &sem->data + SEM_VALUE_OFFSET, 0,
+		     sem->private);
+  return false;
+#else
+  /* See __new_sem_wait_slow64 for the MOs and why the nwaiters bit must
+     be set before we block.  */
+  unsigned int v = atomic_load_relaxed (&sem->value);
+  for (;;)
+    {
+      if ((v >> SEM_VALUE_SHIFT) != 0)
+	{
+	  if (atomic_compare_exchange_weak_acquire (&sem->value,
+	      &v, v - (1 << SEM_VALUE_SHIFT)))
+	    {
+	      __sem_wait_32_finish (sem);
+	      return true;
+	    }
+	}
+      else if ((v & SEM_NWAITERS_MASK) != 0)
+	break;
+      else if (atomic_compare_exchange_weak_release (&sem->value,
+	  &v, v | SEM_NWAITERS_MASK))
+	v |= SEM_NWAITERS_MASK;
+    }
+  futex_waiter_init (w, &sem->value, SEM_NWAITERS_MASK, sem->private);
+  return false;
+#endif
+}
+
+struct sem_any_cleanup_buffer
+{
+  sem_t *const *sems;
+  unsigned int count;
+};
+
+static void
+sem_any_cleanup (void *arg)
+{
+  struct sem_any_cleanup_buffer *cbuffer = arg;
+  for (unsigned int i = 0; i < cbuffer->count; i++)
+    sem_any_unregister ((struct new_sem *) cbuffer->sems[i]);
+}
+
+static int
+__attribute__ ((noinline))
+sem_wait_any_slow (sem_t *const *sems, unsigned int count, clockid_t clockid,
+		   const struct __timespec64 *abstime)
+{
+  struct futex_waiter waiters[FUTEX_WAITV_MAX];
+  struct sem_any_cleanup_buffer cbuffer = { sems, count };
+  int result;
+
+  for (unsigned int i = 0; i < count; i++)
+    sem_any_register ((struct new_sem *) sems[i]);
+
+  pthread_cleanup_push (sem_any_cleanup, &cbuffer);
+
+  for (;;)
+    {
+      unsigned int i;
+      for (i = 0; i < count; i++)
+	if (sem_any_try ((struct new_sem *) sems[i], &waiters[i]))
+	  break;
+      if (i < count)
+	{
+	  for (unsigned int j = 0; j < count; j++)
+	    if (j != i)
+	      sem_any_unregister ((struct new_sem *) sems[j]);
+	  result = i;
+	  break;
+	}
+
+      /* See do_futex_wait and __new_sem_wait_slow64 for the errors we
+	 retry on.  futex_waitv fails with ENOSYS on kernels older than
+	 5.16.  */
+      unsigned int woken;
+      int err = __futex_abstimed_waitv_cancelable64 (waiters, count, &woken,
+						     clockid, abstime);
+      if (err == ETIMEDOUT || err == EINTR || err == ENOSYS || err == EINVAL)
+	{
+	  sem_any_cleanup (&cbuffer);
+	  __set_errno (err);
+	  result = -1;
+	  break;
+	}
+    }
+
+  pthread_cleanup_pop (0);
+
+  return result;
+}
+
+/* Grab a token from one of the COUNT semaphores in SEMS, trying them in
+   order, and return its index.  */
+static int
+sem_clockwait_any_common (sem_t *const *sems, unsigned int count,
+			  clockid_t clockid,
+			  const struct __timespec64 *abstime)
+{
+  if (count == 0 || count > FUTEX_WAITV_MAX)
+    {
+      __set_errno (EINVAL);
+      return -1;
+    }
+
+  for (unsigned int i = 0; i < count; i++)
+    if (__new_sem_wait_fast ((struct new_sem *) sems[i], 0) == 0)
+      return i;
+
+  /* A single semaphore does not need futex_waitv.  */
+  if (count == 1)
+    return __new_sem_wait_slow64 ((struct new_sem *) sems[0], clockid,
+				  abstime);
+
+  return sem_wait_any_slow (sems, count, clockid, abstime);
+}
+
+int
+sem_wait_any (sem_t *const *sems, unsigned int count)
+{
+  /* See __new_sem_wait.  */
+  __pthread_testcancel ();
+
+  /* The clock is unused when ABSTIME is NULL.  */
+  return sem_clockwait_any_common (sems, count, CLOCK_MONOTONIC, NULL);
+}
+
+int
+__sem_clockwait_any64 (sem_t *const *sems, unsigned int count,
+		       clockid_t clockid, const struct __timespec64 *abstime)
+{
+  /* Check that supplied clockid is one we support, even if we don't end up
+     waiting.  */
+  if (!futex_abstimed_supported_clockid (clockid)
+      || ! valid_nanoseconds (abstime->tv_nsec))
+    {
+      __set_errno (EINVAL);
+      return -1;
+    }
+
+  return sem_clockwait_any_common (sems, count, clockid, abstime);
+}
+
+#if __TIMESIZE != 64
+libc_hidden_def (__sem_clockwait_any64)
+
+int
+sem_clockwait_any (sem_t *const *sems, unsigned int count, clockid_t clockid,
+		   const struct timespec *abstime)
+{
+  struct __timespec64 ts64 = valid_timespec_to_timespec64 (*abstime);
+
+  return __sem_clockwait_any64 (sems, count, clockid, &ts64);
+}
+#endif /* __TIMESIZE != 64 */
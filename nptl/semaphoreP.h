@@ -50,6 +50,7 @@ extern int __new_sem_getvalue (sem_t *sem, int *sval);
 #if __TIMESIZE == 64
 # define __sem_clockwait64 __sem_clockwait
 # define __sem_timedwait64 __sem_timedwait
+# define __sem_clockwait_any64 sem_clockwait_any
 #else
 extern int
 __sem_clockwait64 (sem_t *sem, clockid_t clockid,
@@ -58,4 +59,8 @@ libc_hidden_proto (__sem_clockwait64)
 extern int
 __sem_timedwait64 (sem_t *sem, const struct __timespec64 *abstime);
 libc_hidden_proto (__sem_timedwait64)
+extern int
+__sem_clockwait_any64 (sem_t *const *sems, unsigned int count,
+                       clockid_t clockid, const struct __timespec64 *abstime);
+libc_hidden_proto (__sem_clockwait_any64)
 #endif
@@ -0,0 +1,113 @@
+/* Waiting for changes of memory locations.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _SYS_WAITADDR_H
+#define _SYS_WAITADDR_H 1
+
+#include <features.h>
+#include <bits/types/clockid_t.h>
+#include <bits/types/struct_timespec.h>
+
+/* Flags of the functions below.  */
+enum
+{
+  /* The word may be accessed from other processes.  Waiters and wakers
+     of the same word have to agree on this flag.  */
+  WAIT_ADDRESS_SHARED = 1,
+#define WAIT_ADDRESS_SHARED WAIT_ADDRESS_SHARED
+  /* Poll the words for a while before blocking, as adaptive mutexes
+     do.  Only valid for waiting.  */
+  WAIT_ADDRESS_SPIN = 2
+#define WAIT_ADDRESS_SPIN WAIT_ADDRESS_SPIN
+};
+
+/* The maximum number of words __wait_on_any_address waits for.  */
+#define WAIT_ADDRESS_MAX 128
+
+/* A word __wait_on_any_address waits for.  */
+struct wait_address
+{
+  /* The word, which has to be aligned to four bytes.  */
+  const unsigned int *addr;
+  /* The value of the word while we wait.  */
+  unsigned int expected;
+  /* Zero or WAIT_ADDRESS_SHARED.  */
+  int flags;
+};
+
+__BEGIN_DECLS
+
+#ifndef __USE_TIME_BITS64
+/* Block while *ADDR is equal to EXPECTED, until another thread calls
+   __wake_by_address for ADDR, or until the time ABSTIME measured
+   against CLOCKID, which is CLOCK_MONOTONIC or CLOCK_REALTIME, passed.
+   If ABSTIME is NULL, wait without a timeout.  Return 0 if woken,
+   which may happen spuriously, or if *ADDR changed while spinning,
+   EAGAIN if *ADDR was not equal to EXPECTED, ETIMEDOUT if the timeout
+   expired, EINTR if a signal interrupted the wait and EINVAL for
+   invalid arguments.  */
+extern int __wait_on_address (const unsigned int *__addr,
+			      unsigned int __expected, int __flags,
+			      clockid_t __clockid,
+			      const struct timespec *__abstime)
+     __THROW __nonnull ((1));
+
+/* Like __wait_on_address, but block while the COUNT words of ADDRS,
+   with 0 < COUNT <= WAIT_ADDRESS_MAX, are all equal to their expected
+   values, and store the index of the word that was woken or found
+   changed in *INDEX.  FLAGS may only contain WAIT_ADDRESS_SPIN.
+   Return ENOSYS if COUNT is greater than one and the kernel cannot
+   wait for several words.  */
+extern int __wait_on_any_address (const struct wait_address *__addrs,
+				  unsigned int __count, int __flags,
+				  clockid_t __clockid,
+				  const struct timespec *__abstime,
+				  unsigned int *__index)
+     __THROW __nonnull ((1, 6));
+#else
+# ifdef __REDIRECT_NTH
+extern int __REDIRECT_NTH (__wait_on_address,
+			   (const unsigned int *__addr,
+			    unsigned int __expected, int __flags,
+			    clockid_t __clockid,
+			    const struct timespec *__abstime),
+			   __wait_on_address64) __nonnull ((1));
+extern int __REDIRECT_NTH (__wait_on_any_address,
+			   (const struct wait_address *__addrs,
+			    unsigned int __count, int __flags,
+			    clockid_t __clockid,
+			    const struct timespec *__abstime,
+			    unsigned int *__index),
+			   __wait_on_any_address64) __nonnull ((1, 6));
+# else
+#  define __wait_on_address __wait_on_address64
+#  define __wait_on_any_address __wait_on_any_address64
+# endif
+#endif
+
+/* Wake up to COUNT threads waiting in __wait_on_address or
+   __wait_on_any_address for ADDR, or all of them if COUNT is INT_MAX.
+   FLAGS may only contain WAIT_ADDRESS_SHARED.  Return the number of
+   threads woken, or -1 and set errno to EINVAL if FLAGS or COUNT is
+   invalid.  */
+extern int __wake_by_address (const unsigned int *__addr, int __count,
+			      int __flags) __THROW __nonnull ((1));
+
+__END_DECLS
+
+#endif /* sys/waitaddr.h */
@@ -0,0 +1,98 @@
+/* Test that the tree of a PTHREAD_BARRIER_TREE_NP barrier uses an
+   interposed malloc.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <support/check.h>
+
+extern void *__libc_malloc (size_t);
+extern void __libc_free (void *);
+
+/* While TRACKING is set, the blocks returned by malloc are recorded,
+   and free fails for blocks which were not.  A block of the glibc
+   allocator passed to the free of another allocator would corrupt its
+   heap.  */
+static bool tracking;
+static void *allocated[16];
+static size_t nallocated;
+static size_t nfreed;
+
+void *
+malloc (size_t size)
+{
+  void *p = __libc_malloc (size);
+  if (tracking && p != NULL)
+    {
+      if (nallocated == array_length (allocated))
+	{
+	  tracking = false;
+	  FAIL_EXIT1 ("too many allocations");
+	}
+      allocated[nallocated++] = p;
+    }
+  return p;
+}
+
+void
+free (void *p)
+{
+  if (tracking && p != NULL)
+    {
+      size_t i;
+      for (i = 0; i < nallocated; i++)
+	if (allocated[i] == p)
+	  break;
+      if (i == nallocated)
+	{
+	  tracking = false;
+	  FAIL_EXIT1 ("free (%p) of a block not allocated by malloc", p);
+	}
+      allocated[i] = NULL;
+      ++nfreed;
+    }
+  __libc_free (p);
+}
+
+static int
+do_test (void)
+{
+  pthread_barrierattr_t attr;
+  TEST_COMPARE (pthread_barrierattr_init (&attr), 0);
+  TEST_COMPARE (pthread_barrierattr_setkind_np (&attr,
+						PTHREAD_BARRIER_TREE_NP), 0);
+
+  for (unsigned int count = 1; count <= 64; count *= 4)
+    {
+      pthread_barrier_t barrier;
+      nallocated = nfreed = 0;
+      tracking = true;
+      TEST_COMPARE (pthread_barrier_init (&barrier, &attr, count), 0);
+      TEST_COMPARE (pthread_barrier_destroy (&barrier), 0);
+      tracking = false;
+      TEST_VERIFY (nallocated > 0);
+      TEST_COMPARE (nfreed, nallocated);
+    }
+
+  TEST_COMPARE (pthread_barrierattr_destroy (&attr), 0);
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,179 @@
+/* Test barriers of kind PTHREAD_BARRIER_TREE_NP.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+enum { rounds = 200 };
+
+static pthread_barrier_t barrier;
+static unsigned int nthreads;
+static unsigned int arrived[rounds];
+static unsigned int serial[rounds];
+
+static void
+init_barrier (unsigned int count, int pshared)
+{
+  pthread_barrierattr_t attr;
+  TEST_COMPARE (pthread_barrierattr_init (&attr), 0);
+  TEST_COMPARE (pthread_barrierattr_setkind_np (&attr,
+						PTHREAD_BARRIER_TREE_NP), 0);
+  TEST_COMPARE (pthread_barrierattr_setpshared (&attr, pshared), 0);
+  TEST_COMPARE (pthread_barrier_init (&barrier, &attr, count), 0);
+  TEST_COMPARE (pthread_barrierattr_destroy (&attr), 0);
+}
+
+static void *
+round_thread (void *closure)
+{
+  for (int i = 0; i < rounds; i++)
+    {
+      __atomic_fetch_add (&arrived[i], 1, __ATOMIC_RELAXED);
+      int ret = pthread_barrier_wait (&barrier);
+      TEST_VERIFY (ret == 0 || ret == PTHREAD_BARRIER_SERIAL_THREAD);
+      if (ret == PTHREAD_BARRIER_SERIAL_THREAD)
+	__atomic_fetch_add (&serial[i], 1, __ATOMIC_RELAXED);
+      /* All threads arrived before anyone left.  */
+      TEST_COMPARE (__atomic_load_n (&arrived[i], __ATOMIC_RELAXED),
+		    nthreads);
+    }
+  return NULL;
+}
+
+/* Run COUNT threads through the barrier for a number of rounds.  */
+static void
+check_rounds (unsigned int count, int pshared)
+{
+  nthreads = count;
+  for (int i = 0; i < rounds; i++)
+    arrived[i] = serial[i] = 0;
+  init_barrier (count, pshared);
+
+  pthread_t *threads = xmalloc (count * sizeof (*threads));
+  for (unsigned int i = 0; i < count; i++)
+    threads[i] = xpthread_create (NULL, round_thread, NULL);
+  for (unsigned int i = 0; i < count; i++)
+    xpthread_join (threads[i]);
+  free (threads);
+
+  for (int i = 0; i < rounds; i++)
+    TEST_COMPARE (serial[i], 1);
+  TEST_COMPARE (pthread_barrier_destroy (&barrier), 0);
+}
+
+static unsigned int total_serial;
+static pthread_barrier_t epoch_barrier;
+
+static void *
+extra_thread (void *closure)
+{
+  /* Each thread waits once per epoch, so that the threads complete
+     exactly three rounds of the barrier in each epoch.  */
+  for (int i = 0; i < rounds; i++)
+    {
+      if (pthread_barrier_wait (&barrier) == PTHREAD_BARRIER_SERIAL_THREAD)
+	__atomic_fetch_add (&total_serial, 1, __ATOMIC_RELAXED);
+      xpthread_barrier_wait (&epoch_barrier);
+    }
+  return NULL;
+}
+
+/* More threads than COUNT use the barrier concurrently.  */
+static void
+check_extra_threads (void)
+{
+  enum { count = 5, threads_count = 3 * count };
+  init_barrier (count, PTHREAD_PROCESS_PRIVATE);
+  xpthread_barrier_init (&epoch_barrier, NULL, threads_count);
+  total_serial = 0;
+  pthread_t threads[threads_count];
+  for (int i = 0; i < threads_count; i++)
+    threads[i] = xpthread_create (NULL, extra_thread, NULL);
+  for (int i = 0; i < threads_count; i++)
+    xpthread_join (threads[i]);
+  TEST_COMPARE (total_serial, threads_count * rounds / count);
+  xpthread_barrier_destroy (&epoch_barrier);
+  TEST_COMPARE (pthread_barrier_destroy (&barrier), 0);
+}
+
+static void *
+destroy_thread (void *closure)
+{
+  /* The serial thread of the last round destroys the barrier while the
+     other threads may still be leaving it.  */
+  for (int i = 0; i < rounds; i++)
+    if (pthread_barrier_wait (&barrier) == PTHREAD_BARRIER_SERIAL_THREAD
+	&& i == rounds - 1)
+      TEST_COMPARE (pthread_barrier_destroy (&barrier), 0);
+  return NULL;
+}
+
+static void
+check_destroy (void)
+{
+  enum { count = 9 };
+  for (int run = 0; run < 20; run++)
+    {
+      init_barrier (count, PTHREAD_PROCESS_PRIVATE);
+      pthread_t threads[count];
+      for (int i = 0; i < count; i++)
+	threads[i] = xpthread_create (NULL, destroy_thread, NULL);
+      for (int i = 0; i < count; i++)
+	xpthread_join (threads[i]);
+    }
+}
+
+static int
+do_test (void)
+{
+  pthread_barrierattr_t attr;
+  int kind = -1;
+  TEST_COMPARE (pthread_barrierattr_init (&attr), 0);
+  TEST_COMPARE (pthread_barrierattr_getkind_np (&attr, &kind), 0);
+  TEST_COMPARE (kind, PTHREAD_BARRIER_DEFAULT_NP);
+  TEST_COMPARE (pthread_barrierattr_setkind_np (&attr,
+						PTHREAD_BARRIER_TREE_NP), 0);
+  TEST_COMPARE (pthread_barrierattr_getkind_np (&attr, &kind), 0);
+  TEST_COMPARE (kind, PTHREAD_BARRIER_TREE_NP);
+  TEST_COMPARE (pthread_barrierattr_setkind_np (&attr, -1), EINVAL);
+  TEST_COMPARE (pthread_barrierattr_setkind_np (&attr, 2), EINVAL);
+  /* The kind does not change the process-shared flag.  */
+  int pshared = -1;
+  TEST_COMPARE (pthread_barrierattr_getpshared (&attr, &pshared), 0);
+  TEST_COMPARE (pshared, PTHREAD_PROCESS_PRIVATE);
+  TEST_COMPARE (pthread_barrier_init (&barrier, &attr, 0), EINVAL);
+  TEST_COMPARE (pthread_barrierattr_destroy (&attr), 0);
+
+  /* Single leaves, several leaves, and several levels of inner nodes,
+     with full and partial leaves.  */
+  static const unsigned int counts[] = { 1, 2, 4, 5, 16, 17, 67 };
+  for (int i = 0; i < sizeof (counts) / sizeof (counts[0]); i++)
+    check_rounds (counts[i], PTHREAD_PROCESS_PRIVATE);
+  /* Process-shared barriers use the default algorithm.  */
+  check_rounds (7, PTHREAD_PROCESS_SHARED);
+
+  check_extra_threads ();
+  check_destroy ();
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,162 @@
+/* Test the mutex contention profile.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+/* The largest distance between the start of the locker function and
+   its call of pthread_mutex_lock.  */
+enum { max_call_offset = 1024 };
+
+/* Each check uses new mutexes, so that their entries do not mix with
+   those of the previous checks, which stay in the table.  */
+enum { checks = 4 };
+static pthread_mutex_t mutexes[checks][2];
+static pthread_mutex_t *contended;
+static pthread_mutex_t *uncontended;
+
+static void *
+locker (void *closure)
+{
+  pthread_mutex_lock (contended);
+  pthread_mutex_unlock (contended);
+  return NULL;
+}
+
+/* Return true if a thread waits for CONTENDED in the kernel.  */
+static bool
+has_waiters (void)
+{
+  int lock = __atomic_load_n (&contended->__data.__lock, __ATOMIC_RELAXED);
+  return lock == 2 || (lock & 0x80000000) != 0;
+}
+
+/* Make a thread wait for CONTENDED once.  */
+static void
+contend (void)
+{
+  xpthread_mutex_lock (contended);
+  pthread_t thr = xpthread_create (NULL, locker, NULL);
+  while (!has_waiters ())
+    usleep (1000);
+  /* Let the wait time be noticeable.  */
+  usleep (10 * 1000);
+  xpthread_mutex_unlock (contended);
+  xpthread_join (thr);
+}
+
+/* Return the entry for LOCK in the profile written to PROFILE, or
+   NULL.  */
+static char *
+find_entry (char *profile, void *lock)
+{
+  char pattern[64];
+  snprintf (pattern, sizeof (pattern), " 0x%lx ", (unsigned long) lock);
+  char *p = strstr (profile, pattern);
+  if (p == NULL)
+    return NULL;
+  while (p > profile && p[-1] != '\n')
+    --p;
+  return p;
+}
+
+static char *
+dump (void)
+{
+  int fds[2];
+  xpipe (fds);
+  TEST_COMPARE (pthread_mutex_profile_dump_np (fds[1]), 0);
+  xclose (fds[1]);
+  static char buf[16384];
+  size_t len = 0;
+  ssize_t ret;
+  while ((ret = read (fds[0], buf + len, sizeof (buf) - 1 - len)) > 0)
+    len += ret;
+  TEST_VERIFY (ret == 0);
+  buf[len] = '\0';
+  xclose (fds[0]);
+  printf ("info: profile:\n%s", buf);
+  TEST_VERIFY (strncmp (buf, "mutex contention profile, dropped 0\n", 36)
+	       == 0);
+  return buf;
+}
+
+static void
+check_type (int check, int type, bool robust)
+{
+  contended = &mutexes[check][0];
+  uncontended = &mutexes[check][1];
+  pthread_mutexattr_t attr;
+  xpthread_mutexattr_init (&attr);
+  xpthread_mutexattr_settype (&attr, type);
+  if (robust)
+    xpthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_ROBUST);
+  xpthread_mutex_init (contended, &attr);
+  xpthread_mutex_init (uncontended, &attr);
+  xpthread_mutexattr_destroy (&attr);
+
+  for (int i = 0; i < 3; i++)
+    {
+      contend ();
+      xpthread_mutex_lock (uncontended);
+      xpthread_mutex_unlock (uncontended);
+    }
+
+  char *profile = dump ();
+  TEST_VERIFY (find_entry (profile, uncontended) == NULL);
+  char *entry = find_entry (profile, contended);
+  TEST_VERIFY_EXIT (entry != NULL);
+
+  unsigned long long count, wait, max_wait;
+  TEST_COMPARE (sscanf (entry, "%llu %llu %llu", &count, &wait, &max_wait),
+		3);
+  TEST_COMPARE (count, 3);
+  TEST_VERIFY (max_wait >= 10 * 1000 * 1000);
+  TEST_VERIFY (wait >= 3 * 10 * 1000 * 1000);
+  TEST_VERIFY (wait >= max_wait);
+
+  /* The call site is printed in brackets at the end of the line.  */
+  char *caller = strchr (entry, '[');
+  TEST_VERIFY_EXIT (caller != NULL);
+  uintptr_t site = strtoul (caller + 1, NULL, 16);
+  TEST_VERIFY (site > (uintptr_t) locker
+	       && site < (uintptr_t) locker + max_call_offset);
+
+  xpthread_mutex_destroy (contended);
+  xpthread_mutex_destroy (uncontended);
+}
+
+static int
+do_test (void)
+{
+  check_type (0, PTHREAD_MUTEX_NORMAL, false);
+  check_type (1, PTHREAD_MUTEX_ADAPTIVE_NP, false);
+  check_type (2, PTHREAD_MUTEX_RECURSIVE, false);
+  check_type (3, PTHREAD_MUTEX_NORMAL, true);
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1 @@
+#include "tst-mutex-queued.c"
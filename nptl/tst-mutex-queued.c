@@ -0,0 +1,141 @@
+/* Test PTHREAD_MUTEX_QUEUED_NP mutexes under contention.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum
+  {
+    thread_count = 32,
+    iterations = 5000,
+  };
+
+static pthread_mutex_t mutex;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static pthread_barrier_t barrier;
+
+/* Only modified with MUTEX held.  */
+static volatile int in_section;
+static long int counter;
+static int tokens;
+
+/* Increment COUNTER, checking that no other thread is in the critical
+   section.  Every eighth iteration uses trylock.  Every thirty-second
+   one adds a token and takes one, waiting on COND if other threads
+   have taken all of them, so that the mutex is also reacquired by
+   pthread_cond_wait.  */
+static void *
+thread_func (void *closure)
+{
+  xpthread_barrier_wait (&barrier);
+  for (int i = 0; i < iterations; ++i)
+    {
+      if (i % 8 == 7)
+	{
+	  int ret;
+	  while ((ret = pthread_mutex_trylock (&mutex)) == EBUSY)
+	    ;
+	  TEST_COMPARE (ret, 0);
+	}
+      else
+	xpthread_mutex_lock (&mutex);
+
+      TEST_COMPARE (in_section, 0);
+      in_section = 1;
+      ++counter;
+      if (i % 32 == 31)
+	{
+	  ++tokens;
+	  xpthread_cond_signal (&cond);
+	  in_section = 0;
+	  while (tokens == 0)
+	    xpthread_cond_wait (&cond, &mutex);
+	  TEST_COMPARE (in_section, 0);
+	  in_section = 1;
+	  --tokens;
+	}
+      in_section = 0;
+
+      xpthread_mutex_unlock (&mutex);
+    }
+  return NULL;
+}
+
+static void
+check_type (int pshared)
+{
+  pthread_mutexattr_t attr;
+  TEST_COMPARE (pthread_mutexattr_init (&attr), 0);
+  TEST_COMPARE (pthread_mutexattr_settype (&attr, PTHREAD_MUTEX_QUEUED_NP),
+		0);
+  TEST_COMPARE (pthread_mutexattr_setpshared (&attr, pshared), 0);
+  int type;
+  TEST_COMPARE (pthread_mutexattr_gettype (&attr, &type), 0);
+  TEST_COMPARE (type, PTHREAD_MUTEX_QUEUED_NP);
+  TEST_COMPARE (pthread_mutexattr_settype (&attr,
+					   PTHREAD_MUTEX_QUEUED_NP + 1),
+		EINVAL);
+
+  xpthread_mutex_init (&mutex, &attr);
+  TEST_COMPARE (pthread_mutexattr_destroy (&attr), 0);
+}
+
+static void
+run_threads (void)
+{
+  pthread_t threads[thread_count];
+  counter = 0;
+  tokens = 0;
+
+  /* Hold the mutex until all threads have queued up behind it.  */
+  xpthread_mutex_lock (&mutex);
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, NULL);
+  usleep (100 * 1000);
+  xpthread_mutex_unlock (&mutex);
+
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  TEST_COMPARE (counter, (long int) thread_count * iterations);
+  TEST_COMPARE (in_section, 0);
+}
+
+static int
+do_test (void)
+{
+  xpthread_barrier_init (&barrier, NULL, thread_count);
+
+  /* Process-shared mutexes do not use the spin queue, but behave
+     the same otherwise.  */
+  static const int pshared[] =
+    { PTHREAD_PROCESS_PRIVATE, PTHREAD_PROCESS_SHARED };
+  for (int i = 0; i < 2; ++i)
+    {
+      check_type (pshared[i]);
+      run_threads ();
+      xpthread_mutex_destroy (&mutex);
+    }
+
+  xpthread_barrier_destroy (&barrier);
+  return 0;
+}
+
+#include <support/test-driver.c>
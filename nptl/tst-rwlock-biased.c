@@ -0,0 +1,255 @@
+/* Test PTHREAD_RWLOCK_READER_BIASED_NP rwlocks.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xthread.h>
+#include <pthreadP.h>
+
+static pthread_rwlock_t lock;
+
+static void
+init_lock (pthread_rwlock_t *rwlock, int pshared)
+{
+  pthread_rwlockattr_t attr;
+  xpthread_rwlockattr_init (&attr);
+  xpthread_rwlockattr_setkind_np (&attr, PTHREAD_RWLOCK_READER_BIASED_NP);
+  TEST_COMPARE (pthread_rwlockattr_setpshared (&attr, pshared), 0);
+  int kind;
+  TEST_COMPARE (pthread_rwlockattr_getkind_np (&attr, &kind), 0);
+  TEST_COMPARE (kind, PTHREAD_RWLOCK_READER_BIASED_NP);
+  xpthread_rwlock_init (rwlock, &attr);
+  TEST_COMPARE (pthread_rwlockattr_destroy (&attr), 0);
+}
+
+/* Return the number of readers registered in __readers.  */
+static unsigned int
+readers (pthread_rwlock_t *rwlock)
+{
+  return rwlock->__data.__readers >> PTHREAD_RWLOCK_READER_SHIFT;
+}
+
+/* Enable the bias of LOCK by acquiring it once through __readers.  */
+static void
+enable_bias (void)
+{
+  xpthread_rwlock_rdlock (&lock);
+  xpthread_rwlock_unlock (&lock);
+  TEST_COMPARE (lock.__data.__pad3, PTHREAD_RWLOCK_BIAS_ON);
+}
+
+static void
+check_fast_path (void)
+{
+  init_lock (&lock, PTHREAD_PROCESS_PRIVATE);
+  TEST_COMPARE (lock.__data.__pad3, PTHREAD_RWLOCK_BIAS_OFF);
+  enable_bias ();
+
+  /* Read locks, including recursive ones, do not modify the lock.  */
+  xpthread_rwlock_rdlock (&lock);
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (pthread_rwlock_tryrdlock (&lock), 0);
+  TEST_COMPARE (readers (&lock), 0);
+  TEST_COMPARE (pthread_rwlock_trywrlock (&lock), EBUSY);
+  for (int i = 0; i < 3; i++)
+    xpthread_rwlock_unlock (&lock);
+  TEST_COMPARE (readers (&lock), 0);
+
+  /* A writer disables the bias.  */
+  TEST_COMPARE (pthread_rwlock_trywrlock (&lock), 0);
+  TEST_COMPARE (lock.__data.__pad3, PTHREAD_RWLOCK_BIAS_INHIBITED);
+  TEST_COMPARE (pthread_rwlock_tryrdlock (&lock), EBUSY);
+  TEST_COMPARE (pthread_rwlock_rdlock (&lock), EDEADLK);
+  xpthread_rwlock_unlock (&lock);
+
+  /* Readers use __readers until the inhibit time has passed.  */
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (readers (&lock), 1);
+  xpthread_rwlock_unlock (&lock);
+  /* The revocation was quick, so the bias is inhibited for a short
+     time only.  */
+  usleep (10 * 1000);
+  enable_bias ();
+
+  xpthread_rwlock_destroy (&lock);
+}
+
+/* More read locks than a thread can hold through the table.  */
+static void
+check_many_locks (void)
+{
+  enum { count = PTHREAD_RWLOCK_BIAS_HELD + 3 };
+  pthread_rwlock_t locks[count];
+  for (int i = 0; i < count; i++)
+    {
+      init_lock (&locks[i], PTHREAD_PROCESS_PRIVATE);
+      xpthread_rwlock_rdlock (&locks[i]);
+      xpthread_rwlock_unlock (&locks[i]);
+    }
+  for (int i = 0; i < count; i++)
+    xpthread_rwlock_rdlock (&locks[i]);
+  int slow = 0;
+  for (int i = 0; i < count; i++)
+    slow += readers (&locks[i]);
+  TEST_VERIFY (slow >= count - PTHREAD_RWLOCK_BIAS_HELD);
+  for (int i = count - 1; i >= 0; i--)
+    {
+      TEST_COMPARE (pthread_rwlock_trywrlock (&locks[i]), EBUSY);
+      xpthread_rwlock_unlock (&locks[i]);
+      TEST_COMPARE (readers (&locks[i]), 0);
+      TEST_COMPARE (pthread_rwlock_trywrlock (&locks[i]), 0);
+      xpthread_rwlock_unlock (&locks[i]);
+      xpthread_rwlock_destroy (&locks[i]);
+    }
+}
+
+static volatile int writer_done;
+
+static void *
+timed_writer (void *closure)
+{
+  struct timespec ts = timespec_add (xclock_now (CLOCK_MONOTONIC),
+				     make_timespec (0, 100 * 1000 * 1000));
+  TEST_COMPARE (pthread_rwlock_clockwrlock (&lock, CLOCK_MONOTONIC, &ts),
+		ETIMEDOUT);
+  TEST_COMPARE (pthread_rwlock_trywrlock (&lock), EBUSY);
+  return NULL;
+}
+
+static void *
+writer (void *closure)
+{
+  xpthread_rwlock_wrlock (&lock);
+  writer_done = 1;
+  xpthread_rwlock_unlock (&lock);
+  return NULL;
+}
+
+/* Writers wait for readers which hold the lock through the table, and
+   these readers can still acquire it recursively.  */
+static void
+check_writer_waits (void)
+{
+  init_lock (&lock, PTHREAD_PROCESS_PRIVATE);
+  enable_bias ();
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (readers (&lock), 0);
+  xpthread_join (xpthread_create (NULL, timed_writer, NULL));
+  /* The failed writers left the bias enabled because we still hold the
+     lock through the table.  */
+  TEST_COMPARE (lock.__data.__pad3, PTHREAD_RWLOCK_BIAS_ON);
+
+  writer_done = 0;
+  pthread_t thr = xpthread_create (NULL, writer, NULL);
+  usleep (100 * 1000);
+  TEST_COMPARE (writer_done, 0);
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (writer_done, 0);
+  xpthread_rwlock_unlock (&lock);
+  TEST_COMPARE (writer_done, 0);
+  xpthread_rwlock_unlock (&lock);
+  xpthread_join (thr);
+  TEST_COMPARE (writer_done, 1);
+  xpthread_rwlock_destroy (&lock);
+}
+
+enum
+  {
+    reader_count = 8,
+    reads = 20000,
+  };
+
+/* Only modified with LOCK held for writing.  */
+static volatile unsigned int values[2];
+static unsigned int readers_done;
+
+static void *
+stress_reader (void *closure)
+{
+  for (int i = 0; i < reads; )
+    {
+      if (i % 16 == 15)
+	{
+	  int ret = pthread_rwlock_tryrdlock (&lock);
+	  if (ret == EBUSY)
+	    continue;
+	  TEST_COMPARE (ret, 0);
+	}
+      else
+	xpthread_rwlock_rdlock (&lock);
+      TEST_COMPARE (values[0], values[1]);
+      xpthread_rwlock_unlock (&lock);
+      ++i;
+    }
+  __atomic_fetch_add (&readers_done, 1, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+/* Readers check that they do not overlap with the writer, which keeps
+   writing until they are done.  */
+static void
+check_stress (int pshared)
+{
+  init_lock (&lock, pshared);
+  values[0] = values[1] = 0;
+  readers_done = 0;
+
+  pthread_t threads[reader_count];
+  for (int i = 0; i < reader_count; i++)
+    threads[i] = xpthread_create (NULL, stress_reader, NULL);
+  for (int i = 0;
+       __atomic_load_n (&readers_done, __ATOMIC_RELAXED) < reader_count;
+       i++)
+    {
+      if (i % 4 == 3)
+	{
+	  if (pthread_rwlock_trywrlock (&lock) != 0)
+	    continue;
+	}
+      else
+	xpthread_rwlock_wrlock (&lock);
+      ++values[0];
+      ++values[1];
+      xpthread_rwlock_unlock (&lock);
+      usleep (100);
+    }
+  for (int i = 0; i < reader_count; i++)
+    xpthread_join (threads[i]);
+
+  TEST_COMPARE (readers (&lock), 0);
+  if (pshared == PTHREAD_PROCESS_SHARED)
+    TEST_COMPARE (lock.__data.__pad3, PTHREAD_RWLOCK_BIAS_OFF);
+  xpthread_rwlock_destroy (&lock);
+}
+
+static int
+do_test (void)
+{
+  check_fast_path ();
+  check_many_locks ();
+  check_writer_waits ();
+  check_stress (PTHREAD_PROCESS_PRIVATE);
+  check_stress (PTHREAD_PROCESS_SHARED);
+  return 0;
+}
+
+#include <support/test-driver.c>
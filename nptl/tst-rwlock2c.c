@@ -0,0 +1,2 @@
+#define TYPE PTHREAD_RWLOCK_READER_BIASED_NP
+#include "tst-rwlock2.c"
@@ -0,0 +1 @@
+#include "tst-stack-cache.c"
@@ -0,0 +1,130 @@
+/* Test reuse of cached thread stacks with different attributes.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/xstdio.h>
+#include <support/xthread.h>
+
+static size_t pagesize;
+
+struct config
+{
+  size_t stacksize;
+  size_t guardsize;
+};
+
+static const struct config configs[] =
+  {
+    { 64 * 1024, 1 },
+    { 64 * 1024, 4 },
+    { 64 * 1024, 1 },
+    { 256 * 1024, 1 },
+    { 64 * 1024, 0 },
+    { 64 * 1024, 2 },
+  };
+
+static __thread int tls_value = 42;
+
+/* Store the permissions of the mapping which contains ADDR, as listed
+   in /proc/self/maps, in PERMS.  Return false if there is none.  */
+static bool
+mapping_perms (uintptr_t addr, char perms[5])
+{
+  FILE *fp = xfopen ("/proc/self/maps", "r");
+  bool found = false;
+  char *line = NULL;
+  size_t len = 0;
+  while (!found && xgetline (&line, &len, fp) > 0)
+    {
+      unsigned long int start, end;
+      found = (sscanf (line, "%lx-%lx %4s", &start, &end, perms) == 3
+	       && addr >= start && addr < end);
+    }
+  free (line);
+  xfclose (fp);
+  return found;
+}
+
+static void *
+check_thread (void *closure)
+{
+  const struct config *config = closure;
+
+  /* The static TLS block has been reinitialized.  */
+  TEST_COMPARE (tls_value, 42);
+  tls_value = 0;
+
+  pthread_attr_t attr;
+  TEST_COMPARE (pthread_getattr_np (pthread_self (), &attr), 0);
+  void *stackaddr;
+  size_t stacksize, guardsize;
+  TEST_COMPARE (pthread_attr_getstack (&attr, &stackaddr, &stacksize), 0);
+  TEST_COMPARE (pthread_attr_getguardsize (&attr, &guardsize), 0);
+  xpthread_attr_destroy (&attr);
+
+  TEST_VERIFY (stacksize >= config->stacksize);
+  TEST_COMPARE (guardsize, config->guardsize * pagesize);
+
+  /* The whole stack is usable, and the guard area below it is not
+     accessible.  */
+  memset (stackaddr, 0xcc, pagesize);
+  char perms[5] = "";
+  TEST_VERIFY (mapping_perms ((uintptr_t) stackaddr, perms));
+  TEST_COMPARE_STRING (perms, "rw-p");
+  if (config->guardsize > 0)
+    {
+      TEST_VERIFY (mapping_perms ((uintptr_t) stackaddr - 1, perms));
+      TEST_COMPARE_STRING (perms, "---p");
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  pagesize = sysconf (_SC_PAGESIZE);
+
+  for (int round = 0; round < 20; round++)
+    for (size_t i = 0; i < array_length (configs); i++)
+      {
+	pthread_attr_t attr;
+	xpthread_attr_init (&attr);
+	xpthread_attr_setstacksize (&attr, configs[i].stacksize);
+	xpthread_attr_setguardsize (&attr, configs[i].guardsize * pagesize);
+	/* Threads created at the same time cannot share a stack.  */
+	pthread_t thr[2];
+	for (int j = 0; j < 2; j++)
+	  thr[j] = xpthread_create (&attr, check_thread,
+				    (void *) &configs[i]);
+	for (int j = 0; j < 2; j++)
+	  xpthread_join (thr[j]);
+	xpthread_attr_destroy (&attr);
+      }
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1 @@
+#include "tst-wait-any.c"
@@ -0,0 +1,372 @@
+/* Test sem_wait_any and pthread_cond_wait_any.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xthread.h>
+
+enum { sem_count = 3 };
+static sem_t sem_storage[sem_count];
+static sem_t *sems[sem_count];
+
+static int
+sem_value (int i)
+{
+  int value;
+  TEST_COMPARE (sem_getvalue (sems[i], &value), 0);
+  return value;
+}
+
+static struct timespec
+timeout_in (long int msec)
+{
+  return timespec_add (xclock_now (CLOCK_MONOTONIC),
+		       make_timespec (0, msec * 1000 * 1000));
+}
+
+static void *
+sem_poster (void *closure)
+{
+  usleep (50 * 1000);
+  TEST_COMPARE (sem_post (sems[(intptr_t) closure]), 0);
+  return NULL;
+}
+
+static void
+check_sem_basic (void)
+{
+  /* Without blocking, the first semaphore with a token is taken.  */
+  TEST_COMPARE (sem_post (sems[1]), 0);
+  TEST_COMPARE (sem_post (sems[2]), 0);
+  TEST_COMPARE (sem_wait_any (sems, sem_count), 1);
+  TEST_COMPARE (sem_wait_any (sems, sem_count), 2);
+  for (int i = 0; i < sem_count; i++)
+    TEST_COMPARE (sem_value (i), 0);
+
+  for (int i = 0; i < sem_count; i++)
+    {
+      pthread_t thr = xpthread_create (NULL, sem_poster,
+				       (void *) (intptr_t) i);
+      TEST_COMPARE (sem_wait_any (sems, sem_count), i);
+      xpthread_join (thr);
+      for (int j = 0; j < sem_count; j++)
+	TEST_COMPARE (sem_value (j), 0);
+    }
+
+  struct timespec ts = timeout_in (50);
+  errno = 0;
+  TEST_COMPARE (sem_clockwait_any (sems, sem_count, CLOCK_MONOTONIC, &ts),
+		-1);
+  TEST_COMPARE (errno, ETIMEDOUT);
+  ts = timespec_add (xclock_now (CLOCK_REALTIME), make_timespec (10, 0));
+  pthread_t thr = xpthread_create (NULL, sem_poster, (void *) 2);
+  TEST_COMPARE (sem_clockwait_any (sems, sem_count, CLOCK_REALTIME, &ts), 2);
+  xpthread_join (thr);
+
+  errno = 0;
+  TEST_COMPARE (sem_wait_any (sems, 0), -1);
+  TEST_COMPARE (errno, EINVAL);
+  ts.tv_nsec = -1;
+  errno = 0;
+  TEST_COMPARE (sem_clockwait_any (sems, sem_count, CLOCK_MONOTONIC, &ts),
+		-1);
+  TEST_COMPARE (errno, EINVAL);
+}
+
+enum
+  {
+    sem_waiters = 4,
+    posts_per_waiter = 2000,
+  };
+
+static unsigned int taken[sem_count];
+
+static void *
+sem_waiter (void *closure)
+{
+  for (int i = 0; i < posts_per_waiter; i++)
+    {
+      int ret = sem_wait_any (sems, sem_count);
+      TEST_VERIFY (ret >= 0 && ret < sem_count);
+      if (ret >= 0 && ret < sem_count)
+	__atomic_fetch_add (&taken[ret], 1, __ATOMIC_RELAXED);
+    }
+  return NULL;
+}
+
+/* Each post must be taken even though a waiter woken for one semaphore
+   may take a token from another one.  */
+static void
+check_sem_stress (void)
+{
+  pthread_t threads[sem_waiters];
+  for (int i = 0; i < sem_waiters; i++)
+    threads[i] = xpthread_create (NULL, sem_waiter, NULL);
+  unsigned int posted[sem_count] = { 0 };
+  for (int i = 0; i < sem_waiters * posts_per_waiter; i++)
+    {
+      int s = (i * 7) % sem_count;
+      TEST_COMPARE (sem_post (sems[s]), 0);
+      ++posted[s];
+      if (i % 64 == 0)
+	sched_yield ();
+    }
+  for (int i = 0; i < sem_waiters; i++)
+    xpthread_join (threads[i]);
+  for (int i = 0; i < sem_count; i++)
+    {
+      TEST_COMPARE (taken[i], posted[i]);
+      TEST_COMPARE (sem_value (i), 0);
+    }
+}
+
+static void *
+sem_cancel_waiter (void *closure)
+{
+  sem_wait_any (sems, sem_count);
+  FAIL_EXIT1 ("sem_wait_any returned");
+}
+
+static void
+check_sem_cancel (void)
+{
+  pthread_t thr = xpthread_create (NULL, sem_cancel_waiter, NULL);
+  usleep (50 * 1000);
+  xpthread_cancel (thr);
+  TEST_VERIFY (xpthread_join (thr) == PTHREAD_CANCELED);
+
+  /* The canceled thread is no waiter anymore.  */
+  pthread_t poster = xpthread_create (NULL, sem_poster, (void *) 0);
+  TEST_COMPARE (sem_wait_any (sems, sem_count), 0);
+  xpthread_join (poster);
+}
+
+enum { cond_count = 3 };
+static pthread_cond_t cond_storage[cond_count];
+static pthread_cond_t *conds[cond_count];
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static int ready[cond_count];
+static int started;
+
+/* Wait for READY[I] for any I, and return I.  */
+static int
+wait_ready (void)
+{
+  for (;;)
+    {
+      for (int i = 0; i < cond_count; i++)
+	if (ready[i])
+	  {
+	    --ready[i];
+	    return i;
+	  }
+      unsigned int index = cond_count;
+      TEST_COMPARE (pthread_cond_wait_any (conds, cond_count, &mutex,
+					   &index), 0);
+      TEST_VERIFY (index < cond_count);
+    }
+}
+
+static void *
+cond_waiter (void *closure)
+{
+  xpthread_mutex_lock (&mutex);
+  ++started;
+  int i = wait_ready ();
+  xpthread_mutex_unlock (&mutex);
+  return (void *) (intptr_t) i;
+}
+
+static void *
+plain_waiter (void *closure)
+{
+  xpthread_mutex_lock (&mutex);
+  ++started;
+  while (ready[2] == 0)
+    xpthread_cond_wait (conds[2], &mutex);
+  --ready[2];
+  xpthread_mutex_unlock (&mutex);
+  return NULL;
+}
+
+static void
+wait_started (int count)
+{
+  for (;;)
+    {
+      xpthread_mutex_lock (&mutex);
+      bool done = started == count;
+      xpthread_mutex_unlock (&mutex);
+      if (done)
+	break;
+      usleep (1000);
+    }
+  /* Let the waiters block.  */
+  usleep (20 * 1000);
+}
+
+static void
+check_cond_basic (void)
+{
+  for (int i = 0; i < cond_count; i++)
+    {
+      started = 0;
+      pthread_t thr = xpthread_create (NULL, cond_waiter, NULL);
+      wait_started (1);
+      xpthread_mutex_lock (&mutex);
+      ++ready[i];
+      xpthread_cond_signal (conds[i]);
+      xpthread_mutex_unlock (&mutex);
+      TEST_COMPARE ((intptr_t) xpthread_join (thr), i);
+    }
+
+  /* A broadcast wakes all waiters.  */
+  enum { waiters = 3 };
+  pthread_t threads[waiters];
+  started = 0;
+  for (int i = 0; i < waiters; i++)
+    threads[i] = xpthread_create (NULL, cond_waiter, NULL);
+  wait_started (waiters);
+  xpthread_mutex_lock (&mutex);
+  ready[1] = waiters;
+  TEST_COMPARE (pthread_cond_broadcast (conds[1]), 0);
+  xpthread_mutex_unlock (&mutex);
+  for (int i = 0; i < waiters; i++)
+    TEST_COMPARE ((intptr_t) xpthread_join (threads[i]), 1);
+
+  /* The waiters stopped waiting on the condvars they did not wake
+     from, so a signal reaches a plain waiter.  */
+  started = 0;
+  pthread_t thr = xpthread_create (NULL, plain_waiter, NULL);
+  wait_started (1);
+  xpthread_mutex_lock (&mutex);
+  ++ready[2];
+  xpthread_cond_signal (conds[2]);
+  xpthread_mutex_unlock (&mutex);
+  xpthread_join (thr);
+
+  xpthread_mutex_lock (&mutex);
+  struct timespec ts = timeout_in (50);
+  unsigned int index = cond_count;
+  TEST_COMPARE (pthread_cond_clockwait_any (conds, cond_count, &mutex,
+					    CLOCK_MONOTONIC, &ts, &index),
+		ETIMEDOUT);
+  TEST_COMPARE (index, cond_count);
+  TEST_COMPARE (pthread_mutex_trylock (&mutex), EBUSY);
+  TEST_COMPARE (pthread_cond_wait_any (conds, 0, &mutex, &index), EINVAL);
+  ts.tv_nsec = -1;
+  TEST_COMPARE (pthread_cond_clockwait_any (conds, cond_count, &mutex,
+					    CLOCK_MONOTONIC, &ts, &index),
+		EINVAL);
+  xpthread_mutex_unlock (&mutex);
+}
+
+/* A waiter on several condvars may be woken by the futex_wake of a
+   signal on one condvar but consume the signal of another one.  It must
+   then pass the wake-up on to the other waiters of the first condvar.  */
+static void
+check_cond_passed_wakeup (void)
+{
+  for (int round = 0; round < 10; round++)
+    {
+      started = 0;
+      pthread_t any = xpthread_create (NULL, cond_waiter, NULL);
+      wait_started (1);
+      /* The plain waiter blocks after the other one, so the futex_wake on
+	 conds[2] is likely to wake the other one.  */
+      pthread_t plain = xpthread_create (NULL, plain_waiter, NULL);
+      wait_started (2);
+      xpthread_mutex_lock (&mutex);
+      ++ready[0];
+      xpthread_cond_signal (conds[0]);
+      ++ready[2];
+      xpthread_cond_signal (conds[2]);
+      xpthread_mutex_unlock (&mutex);
+      TEST_COMPARE ((intptr_t) xpthread_join (any), 0);
+      xpthread_join (plain);
+    }
+}
+
+static void
+unlock_mutex (void *closure)
+{
+  xpthread_mutex_unlock (&mutex);
+}
+
+static void *
+cond_cancel_waiter (void *closure)
+{
+  xpthread_mutex_lock (&mutex);
+  ++started;
+  pthread_cleanup_push (unlock_mutex, NULL);
+  unsigned int index;
+  pthread_cond_wait_any (conds, cond_count, &mutex, &index);
+  FAIL_EXIT1 ("pthread_cond_wait_any returned");
+  pthread_cleanup_pop (1);
+  return NULL;
+}
+
+static void
+check_cond_cancel (void)
+{
+  started = 0;
+  pthread_t thr = xpthread_create (NULL, cond_cancel_waiter, NULL);
+  wait_started (1);
+  xpthread_cancel (thr);
+  TEST_VERIFY (xpthread_join (thr) == PTHREAD_CANCELED);
+
+  /* The condvars can still be used and destroyed.  */
+  check_cond_basic ();
+}
+
+static int
+do_test (void)
+{
+  for (int i = 0; i < sem_count; i++)
+    {
+      sems[i] = &sem_storage[i];
+      TEST_COMPARE (sem_init (sems[i], 0, 0), 0);
+    }
+  check_sem_basic ();
+  check_sem_stress ();
+  check_sem_cancel ();
+  for (int i = 0; i < sem_count; i++)
+    TEST_COMPARE (sem_destroy (sems[i]), 0);
+
+  for (int i = 0; i < cond_count; i++)
+    {
+      conds[i] = &cond_storage[i];
+      TEST_COMPARE (pthread_cond_init (conds[i], NULL), 0);
+    }
+  check_cond_basic ();
+  check_cond_passed_wakeup ();
+  check_cond_cancel ();
+  for (int i = 0; i < cond_count; i++)
+    TEST_COMPARE (pthread_cond_destroy (conds[i]), 0);
+  return 0;
+}
+
+#include <support/test-driver.c>
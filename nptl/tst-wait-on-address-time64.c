@@ -0,0 +1 @@
+#include "tst-wait-on-address.c"
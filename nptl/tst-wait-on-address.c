@@ -0,0 +1,184 @@
+/* Test __wait_on_address, __wait_on_any_address and __wake_by_address.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/waitaddr.h>
+#include <time.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xthread.h>
+
+static unsigned int words[2];
+static int wait_flags;
+
+static struct timespec
+in_ms (clockid_t clockid, int ms)
+{
+  return timespec_add (xclock_now (clockid),
+		       make_timespec (0, ms * 1000 * 1000));
+}
+
+static void
+check_errors (void)
+{
+  words[0] = 1;
+  TEST_COMPARE (__wait_on_address (&words[0], 0, 0, CLOCK_MONOTONIC, NULL),
+		EAGAIN);
+  TEST_COMPARE (__wait_on_address (&words[0], 1, 4, CLOCK_MONOTONIC, NULL),
+		EINVAL);
+  TEST_COMPARE (__wait_on_address (&words[0], 1, 0, CLOCK_PROCESS_CPUTIME_ID,
+				   NULL),
+		EINVAL);
+  TEST_COMPARE (__wake_by_address (&words[0], 1, WAIT_ADDRESS_SPIN), -1);
+  TEST_COMPARE (errno, EINVAL);
+  TEST_COMPARE (__wake_by_address (&words[0], INT_MAX, 0), 0);
+
+  struct wait_address addrs[WAIT_ADDRESS_MAX + 1] = { };
+  unsigned int index;
+  for (int i = 0; i < array_length (addrs); i++)
+    addrs[i].addr = &words[1];
+  TEST_COMPARE (__wait_on_any_address (addrs, 0, 0, CLOCK_MONOTONIC, NULL,
+				       &index),
+		EINVAL);
+  TEST_COMPARE (__wait_on_any_address (addrs, WAIT_ADDRESS_MAX + 1, 0,
+				       CLOCK_MONOTONIC, NULL, &index),
+		EINVAL);
+  TEST_COMPARE (__wait_on_any_address (addrs, 2, WAIT_ADDRESS_SHARED,
+				       CLOCK_MONOTONIC, NULL, &index),
+		EINVAL);
+  addrs[1].addr = &words[0];
+  index = -1;
+  TEST_COMPARE (__wait_on_any_address (addrs, 2, 0, CLOCK_MONOTONIC, NULL,
+				       &index),
+		EAGAIN);
+  TEST_COMPARE (index, 1);
+  words[0] = 0;
+}
+
+static void
+check_timeouts (clockid_t clockid)
+{
+  for (int spin = 0; spin <= WAIT_ADDRESS_SPIN; spin += WAIT_ADDRESS_SPIN)
+    {
+      struct timespec ts = in_ms (clockid, 50);
+      TEST_COMPARE (__wait_on_address (&words[0], 0, spin, clockid, &ts),
+		    ETIMEDOUT);
+      TEST_VERIFY (timespec_sub (xclock_now (clockid), ts).tv_sec >= 0);
+
+      ts = make_timespec (-1, 0);
+      TEST_COMPARE (__wait_on_address (&words[0], 0,
+				       spin | WAIT_ADDRESS_SHARED, clockid,
+				       &ts),
+		    ETIMEDOUT);
+
+      struct wait_address addrs[] =
+	{
+	  { &words[0], 0, 0 },
+	  { &words[1], 0, WAIT_ADDRESS_SHARED },
+	};
+      unsigned int index;
+      ts = in_ms (clockid, 50);
+      int ret = __wait_on_any_address (addrs, array_length (addrs), spin,
+				       clockid, &ts, &index);
+      if (ret == ENOSYS)
+	puts ("warning: futex_waitv is not supported");
+      else
+	TEST_COMPARE (ret, ETIMEDOUT);
+    }
+}
+
+static void *
+waiter (void *closure)
+{
+  unsigned int *word = closure;
+  while (__atomic_load_n (word, __ATOMIC_RELAXED) == 0)
+    {
+      int ret = __wait_on_address (word, 0, wait_flags, CLOCK_REALTIME, NULL);
+      TEST_VERIFY (ret == 0 || ret == EAGAIN);
+    }
+  return NULL;
+}
+
+static void *
+any_waiter (void *closure)
+{
+  struct wait_address addrs[] =
+    {
+      { &words[0], 0, wait_flags & WAIT_ADDRESS_SHARED },
+      { &words[1], 0, wait_flags & WAIT_ADDRESS_SHARED },
+    };
+  unsigned int index;
+  do
+    {
+      int ret = __wait_on_any_address (addrs, array_length (addrs),
+				       wait_flags & WAIT_ADDRESS_SPIN,
+				       CLOCK_MONOTONIC, NULL, &index);
+      TEST_VERIFY (ret == 0 || ret == EAGAIN);
+      TEST_VERIFY (index < array_length (addrs));
+    }
+  while (__atomic_load_n (&words[1], __ATOMIC_RELAXED) == 0);
+  TEST_COMPARE (words[0], 0);
+  return NULL;
+}
+
+/* Wake the thread THR waiting for WORD once, which shows that it was
+   blocked, and then let it return.  */
+static void
+wake (pthread_t thr, unsigned int *word)
+{
+  int woken;
+  while ((woken = __wake_by_address (word, 1,
+				     wait_flags & WAIT_ADDRESS_SHARED)) == 0)
+    usleep (1000);
+  TEST_COMPARE (woken, 1);
+  __atomic_store_n (word, 1, __ATOMIC_RELAXED);
+  TEST_VERIFY (__wake_by_address (word, INT_MAX,
+				  wait_flags & WAIT_ADDRESS_SHARED) <= 1);
+  xpthread_join (thr);
+  *word = 0;
+}
+
+static int
+do_test (void)
+{
+  check_errors ();
+  check_timeouts (CLOCK_MONOTONIC);
+  check_timeouts (CLOCK_REALTIME);
+
+  struct wait_address addrs[] = { { &words[0], 0, 0 }, { &words[1], 0, 0 } };
+  unsigned int index;
+  struct timespec ts = { 0, 0 };
+  bool have_waitv = __wait_on_any_address (addrs, 2, 0, CLOCK_MONOTONIC,
+					   &ts, &index) != ENOSYS;
+
+  for (wait_flags = 0;
+       wait_flags <= (WAIT_ADDRESS_SHARED | WAIT_ADDRESS_SPIN); wait_flags++)
+    {
+      printf ("info: flags %d\n", wait_flags);
+      wake (xpthread_create (NULL, waiter, &words[0]), &words[0]);
+      if (have_waitv)
+	wake (xpthread_create (NULL, any_waiter, NULL), &words[1]);
+    }
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,71 @@
+/* Wait for a change of a memory location.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <futex-internal.h>
+#include <sys/waitaddr.h>
+#include <time.h>
+#include "pthreadP.h"
+
+int
+__wait_on_address64 (const unsigned int *addr, unsigned int expected,
+		     int flags, clockid_t clockid,
+		     const struct __timespec64 *abstime)
+{
+  if ((flags & ~(WAIT_ADDRESS_SHARED | WAIT_ADDRESS_SPIN)) != 0
+      || !futex_abstimed_supported_clockid (clockid))
+    return EINVAL;
+
+  /* The futex operations do not modify the word.  */
+  unsigned int *word = (unsigned int *) addr;
+  if (atomic_load_relaxed (word) != expected)
+    return EAGAIN;
+
+  if (flags & WAIT_ADDRESS_SPIN)
+    /* Spin like adaptive mutexes, hoping that the thread which will
+       change the word runs on another CPU.  */
+    for (int cnt = max_adaptive_count (); cnt > 0; cnt--)
+      {
+	atomic_spin_nop ();
+	if (atomic_load_relaxed (word) != expected)
+	  return 0;
+      }
+
+  int private = (flags & WAIT_ADDRESS_SHARED) ? FUTEX_SHARED : FUTEX_PRIVATE;
+  return __futex_abstimed_wait64 (word, expected, clockid, abstime, private);
+}
+
+#if __TIMESIZE != 64
+libc_hidden_def (__wait_on_address64)
+
+int
+__wait_on_address (const unsigned int *addr, unsigned int expected,
+		   int flags, clockid_t clockid,
+		   const struct timespec *abstime)
+{
+  if (abstime != NULL)
+    {
+      struct __timespec64 ts64 = valid_timespec_to_timespec64 (*abstime);
+      return __wait_on_address64 (addr, expected, flags, clockid, &ts64);
+    }
+  else
+    return __wait_on_address64 (addr, expected, flags, clockid, NULL);
+}
+#else
+libc_hidden_def (__wait_on_address)
+#endif
@@ -0,0 +1,123 @@
+/* Wait for a change of one of several memory locations.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <futex-internal.h>
+#include <sys/waitaddr.h>
+#include <time.h>
+#include "pthreadP.h"
+
+/* Return the index of a word of ADDRS whose value is not the expected
+   one, or COUNT if there is none.  */
+static unsigned int
+changed_word (const struct wait_address *addrs, unsigned int count)
+{
+  for (unsigned int i = 0; i < count; i++)
+    if (atomic_load_relaxed ((unsigned int *) addrs[i].addr)
+	!= addrs[i].expected)
+      return i;
+  return count;
+}
+
+int
+__wait_on_any_address64 (const struct wait_address *addrs,
+			 unsigned int count, int flags, clockid_t clockid,
+			 const struct __timespec64 *abstime,
+			 unsigned int *index)
+{
+  if (count == 0 || count > WAIT_ADDRESS_MAX
+      || (flags & ~WAIT_ADDRESS_SPIN) != 0)
+    return EINVAL;
+  for (unsigned int i = 0; i < count; i++)
+    if ((addrs[i].flags & ~WAIT_ADDRESS_SHARED) != 0)
+      return EINVAL;
+
+  /* A single word does not need futex_waitv.  */
+  if (count == 1)
+    {
+      *index = 0;
+      return __wait_on_address64 (addrs[0].addr, addrs[0].expected,
+				  addrs[0].flags | flags, clockid, abstime);
+    }
+
+  if (!futex_abstimed_supported_clockid (clockid))
+    return EINVAL;
+
+  unsigned int i = changed_word (addrs, count);
+  if (i < count)
+    {
+      *index = i;
+      return EAGAIN;
+    }
+
+  if (flags & WAIT_ADDRESS_SPIN)
+    /* See __wait_on_address64.  */
+    for (int cnt = max_adaptive_count (); cnt > 0; cnt--)
+      {
+	atomic_spin_nop ();
+	i = changed_word (addrs, count);
+	if (i < count)
+	  {
+	    *index = i;
+	    return 0;
+	  }
+      }
+
+  struct futex_waiter waiters[WAIT_ADDRESS_MAX];
+  for (i = 0; i < count; i++)
+    futex_waiter_init (&waiters[i], (unsigned int *) addrs[i].addr,
+		       addrs[i].expected,
+		       (addrs[i].flags & WAIT_ADDRESS_SHARED)
+		       ? FUTEX_SHARED : FUTEX_PRIVATE);
+  int err = __futex_abstimed_waitv64 (waiters, count, index, clockid,
+				      abstime);
+  if (err == EAGAIN)
+    {
+      /* One of the words changed after we checked them above.  If it
+	 changed back in the meantime, report a spurious wake-up.  */
+      *index = changed_word (addrs, count);
+      if (*index == count)
+	{
+	  *index = 0;
+	  err = 0;
+	}
+    }
+  return err;
+}
+
+#if __TIMESIZE != 64
+libc_hidden_def (__wait_on_any_address64)
+
+int
+__wait_on_any_address (const struct wait_address *addrs, unsigned int count,
+		       int flags, clockid_t clockid,
+		       const struct timespec *abstime, unsigned int *index)
+{
+  if (abstime != NULL)
+    {
+      struct __timespec64 ts64 = valid_timespec_to_timespec64 (*abstime);
+      return __wait_on_any_address64 (addrs, count, flags, clockid, &ts64,
+				      index);
+    }
+  else
+    return __wait_on_any_address64 (addrs, count, flags, clockid, NULL,
+				    index);
+}
+#else
+libc_hidden_def (__wait_on_any_address)
+#endif
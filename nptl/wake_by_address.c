@@ -0,0 +1,43 @@
+/* Wake threads waiting for a change of a memory location.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <futex-internal.h>
+#include <sys/waitaddr.h>
+#include <sysdep.h>
+
+int
+__wake_by_address (const unsigned int *addr, int count, int flags)
+{
+  if ((flags & ~WAIT_ADDRESS_SHARED) != 0 || count < 0)
+    {
+      __set_errno (EINVAL);
+      return -1;
+    }
+
+  int private = (flags & WAIT_ADDRESS_SHARED) ? FUTEX_SHARED : FUTEX_PRIVATE;
+  long int ret = INTERNAL_SYSCALL_CALL (futex, addr,
+					__lll_private_flag (FUTEX_WAKE,
+							    private),
+					count);
+  /* As in futex_wake, EFAULT and EINVAL are not errors because the
+     memory may have been reused after the last waiter returned.  */
+  if (INTERNAL_SYSCALL_ERROR_P (ret))
+    return 0;
+  return ret;
+}
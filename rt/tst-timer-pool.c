@@ -0,0 +1,311 @@
+/* Test the reuse of threads for SIGEV_THREAD timer notifications.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+static sem_t done;
+
+static void
+arm (timer_t timer)
+{
+  struct itimerspec its = { .it_value = { 0, 1000 * 1000 } };
+  TEST_COMPARE (timer_settime (timer, 0, &its, NULL), 0);
+}
+
+static void
+wait_done (int count)
+{
+  for (int i = 0; i < count; i++)
+    TEST_COMPARE (sem_wait (&done), 0);
+}
+
+enum { timers = 20, rounds = 50 };
+
+static unsigned int notified[timers];
+
+static void
+count_handler (union sigval sv)
+{
+  __atomic_fetch_add (&notified[sv.sival_int], 1, __ATOMIC_RELAXED);
+  TEST_COMPARE (sem_post (&done), 0);
+}
+
+/* Each expiry of each timer results in one notification with the value
+   of the timer.  */
+static void
+check_delivery (void)
+{
+  timer_t timer[timers];
+  for (int i = 0; i < timers; i++)
+    {
+      struct sigevent sev =
+	{
+	  .sigev_notify = SIGEV_THREAD,
+	  .sigev_notify_function = count_handler,
+	  .sigev_value.sival_int = i,
+	};
+      TEST_COMPARE (timer_create (CLOCK_MONOTONIC, &sev, &timer[i]), 0);
+    }
+  for (int round = 0; round < rounds; round++)
+    {
+      for (int i = 0; i < timers; i++)
+	arm (timer[i]);
+      wait_done (timers);
+    }
+  for (int i = 0; i < timers; i++)
+    {
+      TEST_COMPARE (notified[i], rounds);
+      TEST_COMPARE (timer_delete (timer[i]), 0);
+    }
+}
+
+/* More notifications than idle workers run concurrently.  */
+enum { concurrent = 12 };
+static pthread_barrier_t barrier;
+
+static void
+barrier_handler (union sigval sv)
+{
+  xpthread_barrier_wait (&barrier);
+}
+
+static void
+check_concurrency (void)
+{
+  xpthread_barrier_init (&barrier, NULL, concurrent + 1);
+  timer_t timer[concurrent];
+  struct sigevent sev =
+    {
+      .sigev_notify = SIGEV_THREAD,
+      .sigev_notify_function = barrier_handler,
+    };
+  for (int i = 0; i < concurrent; i++)
+    TEST_COMPARE (timer_create (CLOCK_MONOTONIC, &sev, &timer[i]), 0);
+  for (int round = 0; round < 5; round++)
+    {
+      for (int i = 0; i < concurrent; i++)
+	arm (timer[i]);
+      xpthread_barrier_wait (&barrier);
+    }
+  for (int i = 0; i < concurrent; i++)
+    TEST_COMPARE (timer_delete (timer[i]), 0);
+  xpthread_barrier_destroy (&barrier);
+}
+
+/* Each notification starts in the state of a new thread, whatever the
+   previous ones did.  */
+static pthread_key_t key;
+static unsigned int destructed;
+
+static void
+key_destructor (void *value)
+{
+  __atomic_fetch_add (&destructed, 1, __ATOMIC_RELAXED);
+}
+
+static void
+state_handler (union sigval sv)
+{
+  TEST_VERIFY (pthread_getspecific (key) == NULL);
+  TEST_COMPARE (pthread_setspecific (key, &key), 0);
+
+  int old;
+  TEST_COMPARE (pthread_setcancelstate (PTHREAD_CANCEL_DISABLE, &old), 0);
+  TEST_COMPARE (old, PTHREAD_CANCEL_ENABLE);
+  TEST_COMPARE (pthread_setcanceltype (PTHREAD_CANCEL_ASYNCHRONOUS, &old), 0);
+  TEST_COMPARE (old, PTHREAD_CANCEL_DEFERRED);
+
+  /* See tst-timer-sigmask.  */
+  sigset_t ss;
+  TEST_COMPARE (pthread_sigmask (SIG_BLOCK, NULL, &ss), 0);
+  TEST_VERIFY (sigismember (&ss, SIGUSR1));
+  sigemptyset (&ss);
+  sigaddset (&ss, SIGUSR1);
+  TEST_COMPARE (pthread_sigmask (SIG_UNBLOCK, &ss, NULL), 0);
+
+  TEST_COMPARE (sem_post (&done), 0);
+  /* Some notifications exit the thread they run in.  */
+  if (sv.sival_int % 3 == 0)
+    pthread_exit (NULL);
+}
+
+static void
+check_state (void)
+{
+  TEST_COMPARE (pthread_key_create (&key, key_destructor), 0);
+  struct sigevent sev =
+    {
+      .sigev_notify = SIGEV_THREAD,
+      .sigev_notify_function = state_handler,
+    };
+  for (int i = 0; i < rounds; i++)
+    {
+      timer_t timer;
+      sev.sigev_value.sival_int = i;
+      TEST_COMPARE (timer_create (CLOCK_MONOTONIC, &sev, &timer), 0);
+      arm (timer);
+      wait_done (1);
+      TEST_COMPARE (timer_delete (timer), 0);
+    }
+  /* All values have been destructed, but the one of the last
+     notification may not be yet.  */
+  TEST_VERIFY (__atomic_load_n (&destructed, __ATOMIC_RELAXED)
+	       >= rounds - 1);
+}
+
+/* The notifications run on the CPUs of the notification attributes.  */
+static cpu_set_t expected_cpus;
+
+static void
+affinity_handler (union sigval sv)
+{
+  cpu_set_t cpus;
+  TEST_COMPARE (sched_getaffinity (0, sizeof (cpus), &cpus), 0);
+  TEST_VERIFY (CPU_EQUAL (&cpus, &expected_cpus));
+  TEST_COMPARE (sem_post (&done), 0);
+}
+
+static void
+check_affinity (void)
+{
+  cpu_set_t cpus;
+  TEST_COMPARE (sched_getaffinity (0, sizeof (cpus), &cpus), 0);
+  CPU_ZERO (&expected_cpus);
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    if (CPU_ISSET (cpu, &cpus))
+      {
+	CPU_SET (cpu, &expected_cpus);
+	break;
+      }
+
+  pthread_attr_t attr;
+  xpthread_attr_init (&attr);
+  TEST_COMPARE (pthread_attr_setaffinity_np (&attr, sizeof (expected_cpus),
+					     &expected_cpus), 0);
+  struct sigevent sev =
+    {
+      .sigev_notify = SIGEV_THREAD,
+      .sigev_notify_function = affinity_handler,
+      .sigev_notify_attributes = &attr,
+    };
+  timer_t timer;
+  TEST_COMPARE (timer_create (CLOCK_MONOTONIC, &sev, &timer), 0);
+  /* The timer keeps its own copy of the attributes.  */
+  xpthread_attr_destroy (&attr);
+
+  /* Notifications without affinity may reuse no worker of the timer.  */
+  timer_t other;
+  sev.sigev_notify_function = count_handler;
+  sev.sigev_notify_attributes = NULL;
+  sev.sigev_value.sival_int = 0;
+  TEST_COMPARE (timer_create (CLOCK_MONOTONIC, &sev, &other), 0);
+
+  for (int round = 0; round < 10; round++)
+    {
+      arm (timer);
+      arm (other);
+      wait_done (2);
+    }
+  TEST_COMPARE (timer_delete (timer), 0);
+  TEST_COMPARE (timer_delete (other), 0);
+}
+
+/* Scheduling parameters, CPU affinity and name set by a notification
+   function, and a cancellation request it leaves pending, do not carry
+   over to later notifications.  */
+static cpu_set_t initial_cpus;
+static char initial_name[16];
+static unsigned int sched_calls;
+
+static void
+sched_handler (union sigval sv)
+{
+  TEST_COMPARE (sched_getscheduler (0), SCHED_OTHER);
+  int policy;
+  struct sched_param param;
+  TEST_COMPARE (pthread_getschedparam (pthread_self (), &policy, &param), 0);
+  TEST_COMPARE (policy, SCHED_OTHER);
+  TEST_COMPARE (param.sched_priority, 0);
+  cpu_set_t cpus;
+  TEST_COMPARE (sched_getaffinity (0, sizeof (cpus), &cpus), 0);
+  TEST_VERIFY (CPU_EQUAL (&cpus, &initial_cpus));
+  char name[16];
+  TEST_COMPARE (pthread_getname_np (pthread_self (), name, sizeof (name)), 0);
+  TEST_COMPARE_STRING (name, initial_name);
+
+  /* A pending request from an earlier notification would act here.  */
+  pthread_testcancel ();
+  TEST_COMPARE (sem_post (&done), 0);
+
+  unsigned int call = __atomic_fetch_add (&sched_calls, 1, __ATOMIC_RELAXED);
+  if (call % 2 == 0)
+    TEST_COMPARE (pthread_setschedparam (pthread_self (), SCHED_BATCH,
+					 &param), 0);
+  else
+    TEST_COMPARE (sched_setscheduler (0, SCHED_BATCH, &param), 0);
+  CPU_ZERO (&cpus);
+  CPU_SET (sched_getcpu (), &cpus);
+  TEST_COMPARE (sched_setaffinity (0, sizeof (cpus), &cpus), 0);
+  TEST_COMPARE (pthread_setname_np (pthread_self (), "timer-handler"), 0);
+  if (call % 3 == 0)
+    TEST_COMPARE (pthread_cancel (pthread_self ()), 0);
+}
+
+static void
+check_sched (void)
+{
+  TEST_COMPARE (sched_getaffinity (0, sizeof (initial_cpus), &initial_cpus),
+		0);
+  TEST_COMPARE (pthread_getname_np (pthread_self (), initial_name,
+				    sizeof (initial_name)), 0);
+  struct sigevent sev =
+    {
+      .sigev_notify = SIGEV_THREAD,
+      .sigev_notify_function = sched_handler,
+    };
+  timer_t timer;
+  TEST_COMPARE (timer_create (CLOCK_MONOTONIC, &sev, &timer), 0);
+  for (int i = 0; i < rounds; i++)
+    {
+      arm (timer);
+      wait_done (1);
+    }
+  TEST_COMPARE (timer_delete (timer), 0);
+}
+
+static int
+do_test (void)
+{
+  TEST_COMPARE (sem_init (&done, 0, 0), 0);
+  check_delivery ();
+  check_concurrency ();
+  check_state ();
+  check_affinity ();
+  check_sched ();
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -26,3 +26,25 @@ check_may_shrink_heap (void)
 {
   return __libc_enable_secure;
 }
+
+/* Return the CPU the calling thread is currently running on, or -1 if
+   this cannot be determined cheaply.  */
+static inline int
+malloc_getcpu (void)
+{
+  return -1;
+}
+
+/* Return the NUMA node of CPU, or -1 if it cannot be determined.  */
+static inline int
+malloc_getnode (int cpu)
+{
+  return -1;
+}
+
+/* Ask the system to place the pages of the LENGTH bytes at ADDR on
+   NODE.  */
+static inline void
+malloc_bind_node (void *addr, size_t length, int node)
+{
+}
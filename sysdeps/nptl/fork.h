@@ -24,6 +24,7 @@
 #include <ldsodefs.h>
 #include <list.h>
 #include <mqueue.h>
+#include <nptl/nptl-stack.h>
 #include <pthreadP.h>
 #include <sysdep.h>
 
@@ -131,6 +132,14 @@ reclaim_stacks (void)
 	}
     }
 
+  /* The stacks in the cache slots may have belonged to threads which
+     were still exiting.  Like the lists, the slots only change with the
+     cache lock held, right next to the list operation which moves the
+     stack.  */
+  for (int i = 0; i < NPTL_STACK_SLOTS; i++)
+    if (__nptl_stack_slots[i] != NULL)
+      __nptl_stack_slots[i]->tid = 0;
+
   /* Add the stack of all running threads to the cache.  */
   list_splice (&GL (dl_stack_used), &GL (dl_stack_cache));
 
@@ -23,6 +23,7 @@
 #include <sys/time.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <lowlevellock-futex.h>
 #include <libc-diag.h>
 
@@ -312,6 +313,53 @@ __futex_abstimed_wait64 (unsigned int* futex_word, unsigned int expected,
                          int private);
 libc_hidden_proto (__futex_abstimed_wait64);
 
+/* An entry of __futex_abstimed_waitv64.  This has the layout of struct
+   futex_waitv of the kernel.  */
+struct futex_waiter
+{
+  uint64_t val;
+  uint64_t uaddr;
+  uint32_t flags;
+  uint32_t __reserved;
+};
+
+/* Set up W to wait while *FUTEX_WORD == EXPECTED.  */
+static __always_inline void
+futex_waiter_init (struct futex_waiter *w, unsigned int *futex_word,
+		   unsigned int expected, int private)
+{
+  w->val = expected;
+  w->uaddr = (uintptr_t) futex_word;
+  w->flags = FUTEX2_SIZE_U32 | (private == FUTEX_PRIVATE ? FUTEX2_PRIVATE : 0);
+  w->__reserved = 0;
+}
+
+/* Like __futex_abstimed_wait64, but waits on the COUNT futexes of
+   WAITERS, with 0 < COUNT <= FUTEX_WAITV_MAX, until one of them is
+   woken.  Each entry is set up with futex_waiter_init.
+
+   Returns 0 if woken by a futex operation on one of the futexes or
+   spuriously, and stores the index of the futex in *WOKEN.
+   Returns EAGAIN if the futex word of any of the entries did not match
+   the expected value.
+   Returns EINTR if waiting was interrupted by a signal.
+   Returns ETIMEDOUT if the timeout expired.
+   Returns EINVAL if CLOCKID or ABSTIME is invalid.
+   Returns ENOSYS if the kernel does not support futex_waitv.  */
+int
+__futex_abstimed_waitv64 (struct futex_waiter *waiters, unsigned int count,
+			  unsigned int *woken, clockid_t clockid,
+			  const struct __timespec64 *abstime);
+libc_hidden_proto (__futex_abstimed_waitv64);
+
+/* Likewise, but the call acts as a cancellation entrypoint.  */
+int
+__futex_abstimed_waitv_cancelable64 (struct futex_waiter *waiters,
+				     unsigned int count, unsigned int *woken,
+				     clockid_t clockid,
+				     const struct __timespec64 *abstime);
+libc_hidden_proto (__futex_abstimed_waitv_cancelable64);
+
 
 static __always_inline int
 __futex_clocklock64 (int *futex, clockid_t clockid,
@@ -109,8 +109,17 @@ struct pthread_rwlockattr
    of how these fields are used.  */
 struct pthread_barrier
 {
-  unsigned int in;
-  unsigned int current_round;
+  union
+  {
+    struct
+    {
+      unsigned int in;
+      unsigned int current_round;
+    };
+    /* The state of PTHREAD_BARRIER_TREE_NP barriers, which have a COUNT
+       of zero, see pthread_barrier_tree.c.  */
+    struct pthread_barrier_tree *tree;
+  };
   unsigned int count;
   int shared;
   unsigned int out;
@@ -122,7 +131,8 @@ struct pthread_barrier
 /* Barrier variable attribute data structure.  */
 struct pthread_barrierattr
 {
-  int pshared;
+  short int pshared;
+  short int kind;
 };
 
 
@@ -42,6 +42,13 @@
 #define FUTEX_PRIVATE_FLAG	128
 #define FUTEX_CLOCK_REALTIME	256
 
+/* Flags of the entries of a futex_waitv call.  */
+#define FUTEX2_SIZE_U32		0x02
+#define FUTEX2_PRIVATE		FUTEX_PRIVATE_FLAG
+
+/* Maximum number of futexes of a futex_waitv call.  */
+#define FUTEX_WAITV_MAX		128
+
 #define FUTEX_BITSET_MATCH_ANY	0xffffffff
 
 /* Values for 'private' parameter of locking macros.  Yes, the
@@ -80,6 +80,10 @@ extern void __lll_lock_wait_private (int *futex);
 libc_hidden_proto (__lll_lock_wait_private)
 extern void __lll_lock_wait (int *futex, int private);
 libc_hidden_proto (__lll_lock_wait)
+/* Like __lll_lock_wait, but account the contention to CALLER in the
+   mutex contention profile, or not at all if CALLER is NULL.  */
+extern void __lll_lock_wait_caller (int *futex, int private,
+				    const void *caller) attribute_hidden;
 
 /* This is an expression rather than a statement even though its value is
    void, so that it can be used in a comma expression or as an expression
@@ -60,6 +60,8 @@ enum
 #ifdef __USE_GNU
   /* For compatibility.  */
   , PTHREAD_MUTEX_FAST_NP = PTHREAD_MUTEX_TIMED_NP
+  /* Adaptive mutex whose spinning waiters queue up in FIFO order.  */
+  , PTHREAD_MUTEX_QUEUED_NP = PTHREAD_MUTEX_ADAPTIVE_NP + 1
 #endif
 };
 
@@ -106,6 +108,11 @@ enum
   PTHREAD_RWLOCK_PREFER_READER_NP,
   PTHREAD_RWLOCK_PREFER_WRITER_NP,
   PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP,
+# ifdef __USE_GNU
+  /* Prefer readers, which mark themselves in a per-process table
+     instead of the lock while no writer is active.  */
+  PTHREAD_RWLOCK_READER_BIASED_NP,
+# endif
   PTHREAD_RWLOCK_DEFAULT_NP = PTHREAD_RWLOCK_PREFER_READER_NP
 };
 
@@ -191,6 +198,17 @@ enum
    the required number of threads have called this function.
    -1 is distinct from 0 and all errno constants */
 # define PTHREAD_BARRIER_SERIAL_THREAD -1
+
+# ifdef __USE_GNU
+/* Barrier kinds.  */
+enum
+{
+  PTHREAD_BARRIER_DEFAULT_NP,
+  /* Threads arrive at the nodes of a combining tree instead of a single
+     counter.  Only process-private barriers use the tree.  */
+  PTHREAD_BARRIER_TREE_NP
+};
+# endif
 #endif
 
 
@@ -866,6 +884,13 @@ pthread_mutex_consistent_np is deprecated, use pthread_mutex_consistent");
 # endif
 #endif
 
+#ifdef __USE_GNU
+/* Write the contention profile collected for mutexes and internal locks
+   to FD.  Profiling is enabled by the glibc.pthread.mutex_profile
+   tunable; ENOTSUP is returned if it is disabled.  */
+extern int pthread_mutex_profile_dump_np (int __fd) __THROW;
+#endif
+
 
 /* Functions for handling mutex attributes.  */
 
@@ -1188,6 +1213,49 @@ extern int __REDIRECT (pthread_cond_clockwait,
 #  endif
 # endif
 
+# ifdef __USE_GNU
+/* Wait for one of the COUNT condition variables in CONDS to be signaled or
+   broadcast, and store its index in *INDEX.  MUTEX is assumed to be
+   locked before, and all the condition variables must be used with it.
+
+   This function is a cancellation point and therefore not marked with
+   __THROW.  */
+extern int pthread_cond_wait_any (pthread_cond_t *const *__conds,
+				  unsigned int __count,
+				  pthread_mutex_t *__mutex,
+				  unsigned int *__index)
+     __nonnull ((1, 3, 4));
+
+/* Similar to `pthread_cond_wait_any' but wait only until ABSTIME
+   measured by the specified clock.
+
+   This function is a cancellation point and therefore not marked with
+   __THROW.  */
+#  ifndef __USE_TIME_BITS64
+extern int pthread_cond_clockwait_any (pthread_cond_t *const *__conds,
+				       unsigned int __count,
+				       pthread_mutex_t *__mutex,
+				       __clockid_t __clock_id,
+				       const struct timespec *__abstime,
+				       unsigned int *__index)
+     __nonnull ((1, 3, 5, 6));
+#  else
+#   ifdef __REDIRECT
+extern int __REDIRECT (pthread_cond_clockwait_any,
+		       (pthread_cond_t *const *__conds,
+			unsigned int __count,
+			pthread_mutex_t *__mutex,
+			__clockid_t __clock_id,
+			const struct timespec *__abstime,
+			unsigned int *__index),
+		       __pthread_cond_clockwait_any64)
+     __nonnull ((1, 3, 5, 6));
+#   else
+#    define pthread_cond_clockwait_any __pthread_cond_clockwait_any64
+#   endif
+#  endif
+# endif
+
 /* Functions for handling condition variable attributes.  */
 
 /* Initialize condition variable attribute ATTR.  */
@@ -1283,6 +1351,19 @@ extern int pthread_barrierattr_getpshared (const pthread_barrierattr_t *
 extern int pthread_barrierattr_setpshared (pthread_barrierattr_t *__attr,
 					   int __pshared)
      __THROW __nonnull ((1));
+
+# ifdef __USE_GNU
+/* Get the barrier kind of the barrier attribute ATTR.  */
+extern int pthread_barrierattr_getkind_np (const pthread_barrierattr_t *
+					   __restrict __attr,
+					   int *__restrict __kind)
+     __THROW __nonnull ((1, 2));
+
+/* Set the barrier kind of the barrier attribute ATTR.  */
+extern int pthread_barrierattr_setkind_np (pthread_barrierattr_t *__attr,
+					   int __kind)
+     __THROW __nonnull ((1));
+# endif
 #endif
 
 
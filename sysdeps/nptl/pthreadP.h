@@ -107,6 +107,11 @@ enum
 	  PTHREAD_MUTEX_TIMED_NP | PTHREAD_MUTEX_ELISION_NP,
   PTHREAD_MUTEX_TIMED_NO_ELISION_NP =
 	  PTHREAD_MUTEX_TIMED_NP | PTHREAD_MUTEX_NO_ELISION_NP,
+
+  /* Set together with PTHREAD_MUTEX_ADAPTIVE_NP for the
+     PTHREAD_MUTEX_QUEUED_NP type.  Like the elision flags, it is not
+     part of PTHREAD_MUTEX_TYPE.  */
+  PTHREAD_MUTEX_QUEUED_FLAG_NP = 1024,
 };
 #define PTHREAD_MUTEX_PSHARED_BIT 128
 
@@ -165,6 +170,102 @@ enum
 					 << (sizeof (unsigned int) * 8 - 1))
 #define PTHREAD_RWLOCK_FUTEX_USED	2
 
+/* Values of the bias state of PTHREAD_RWLOCK_READER_BIASED_NP rwlocks,
+   kept in __pad3.  While the bias is inhibited, __pad4 holds the
+   time (HP_TIMING_NOW >> PTHREAD_RWLOCK_BIAS_TIME_SHIFT, truncated)
+   after which readers may enable it again.  */
+#define PTHREAD_RWLOCK_BIAS_OFF		0
+#define PTHREAD_RWLOCK_BIAS_ON		1
+#define PTHREAD_RWLOCK_BIAS_INHIBITED	2
+#define PTHREAD_RWLOCK_BIAS_TIME_SHIFT	10
+#define PTHREAD_RWLOCK_BIAS_INHIBIT_MAX	(1U << 20)
+
+/* The reader indicator table shared by all reader-biased rwlocks.  A
+   reader which acquires such an rwlock through the table stores the
+   address of the rwlock in the slot selected by
+   __pthread_rwlock_bias_slot.  */
+#define PTHREAD_RWLOCK_BIAS_TABLE_BITS	12
+extern pthread_rwlock_t *__pthread_rwlock_bias_table
+  [1 << PTHREAD_RWLOCK_BIAS_TABLE_BITS] attribute_hidden;
+
+/* Disable the bias of RWLOCK, which the caller has write-locked, and
+   wait until no reader holds it through the table.  Return EBUSY
+   instead of waiting if BLOCK is false, and ETIMEDOUT if ABSTIME
+   (measured against CLOCKID) has passed first.  */
+extern int __pthread_rwlock_bias_revoke (pthread_rwlock_t *rwlock,
+					 bool block, clockid_t clockid,
+					 const struct __timespec64 *abstime)
+  attribute_hidden;
+
+
+/* Allocate the tree of a PTHREAD_BARRIER_TREE_NP barrier for COUNT
+   threads, or return NULL.  */
+extern struct pthread_barrier_tree *__pthread_barrier_tree_init
+  (unsigned int count) attribute_hidden;
+
+/* Wait on the tree barrier TREE, see pthread_barrier_wait.  */
+extern int __pthread_barrier_tree_wait (struct pthread_barrier_tree *tree)
+  attribute_hidden;
+
+/* Wait until all threads have left the tree barrier TREE, and free it.  */
+extern void __pthread_barrier_tree_destroy
+  (struct pthread_barrier_tree *tree) attribute_hidden;
+
+/* The contention profile enabled by the glibc.pthread.mutex_profile
+   tunable, see pthread_mutex_profile.c.  */
+struct mutex_profile_entry
+{
+  /* The lock, or NULL if the entry is unused.  Set before CALLER.  */
+  void *lock;
+  /* The call site, or NULL while the entry is being claimed.  */
+  const void *caller;
+  uint64_t contended;
+  uint64_t wait_ns;
+  uint64_t max_wait_ns;
+};
+
+/* The table of __MUTEX_PROFILE_MASK + 1 entries, or NULL if the profile
+   is disabled.  */
+extern struct mutex_profile_entry *__mutex_profile_table attribute_hidden;
+extern size_t __mutex_profile_mask attribute_hidden;
+/* Number of contended acquisitions which found the table full.  */
+extern uint64_t __mutex_profile_dropped attribute_hidden;
+
+/* Allocate a table of at least ENTRIES entries if ENTRIES is not zero.  */
+extern void __mutex_profile_init (size_t entries) attribute_hidden;
+
+/* Return the current time in nanoseconds, which is never zero.  */
+extern uint64_t __mutex_profile_now (void) attribute_hidden;
+
+/* Account the time since START, as returned by __mutex_profile_now, to
+   LOCK and CALLER.  */
+extern void __mutex_profile_record (void *lock, const void *caller,
+				    uint64_t start) attribute_hidden;
+
+/* Return the start time of a contended acquisition, or zero if the
+   profile is disabled.  The locks of the dynamic linker are not
+   profiled.  */
+static inline uint64_t
+__mutex_profile_start (void)
+{
+#if IS_IN (libc)
+  if (__glibc_unlikely (__mutex_profile_table != NULL))
+    return __mutex_profile_now ();
+#endif
+  return 0;
+}
+
+/* Record the contended acquisition of LOCK by CALLER which started at
+   START, as returned by __mutex_profile_start.  */
+static inline void
+__mutex_profile_end (void *lock, const void *caller, uint64_t start)
+{
+#if IS_IN (libc)
+  if (__glibc_unlikely (start != 0))
+    __mutex_profile_record (lock, caller, start);
+#endif
+}
+
 
 /* Bits used in robust mutex implementation.  */
 #define FUTEX_WAITERS		0x80000000
@@ -334,6 +435,7 @@ extern int __pthread_getschedparam (pthread_t thread_id, int *policy,
 libc_hidden_proto (__pthread_getschedparam)
 extern int __pthread_setschedparam (pthread_t thread_id, int policy,
 				    const struct sched_param *param);
+libc_hidden_proto (__pthread_setschedparam)
 extern int __pthread_mutex_init (pthread_mutex_t *__mutex,
 				 const pthread_mutexattr_t *__mutexattr);
 libc_hidden_proto (__pthread_mutex_init)
@@ -423,6 +525,7 @@ libc_hidden_proto (__pthread_cond_wait)
 # define __pthread_timedjoin_np64 __pthread_timedjoin_np
 # define __pthread_cond_timedwait64 __pthread_cond_timedwait
 # define __pthread_cond_clockwait64 __pthread_cond_clockwait
+# define __pthread_cond_clockwait_any64 pthread_cond_clockwait_any
 # define __pthread_rwlock_clockrdlock64 __pthread_rwlock_clockrdlock
 # define __pthread_rwlock_clockwrlock64 __pthread_rwlock_clockwrlock
 # define __pthread_rwlock_timedrdlock64 __pthread_rwlock_timedrdlock
@@ -446,6 +549,13 @@ extern int __pthread_cond_clockwait64 (pthread_cond_t *cond,
                                        clockid_t clockid,
                                        const struct __timespec64 *abstime);
 libc_hidden_proto (__pthread_cond_clockwait64)
+extern int __pthread_cond_clockwait_any64 (pthread_cond_t *const *conds,
+                                           unsigned int count,
+                                           pthread_mutex_t *mutex,
+                                           clockid_t clockid,
+                                           const struct __timespec64 *abstime,
+                                           unsigned int *index);
+libc_hidden_proto (__pthread_cond_clockwait_any64)
 extern int __pthread_rwlock_clockrdlock64 (pthread_rwlock_t *rwlock,
                                            clockid_t clockid,
                                            const struct __timespec64 *abstime);
@@ -96,6 +96,44 @@ extern int __REDIRECT (sem_clockwait,
 # endif
 #endif
 
+#ifdef __USE_GNU
+/* Wait until one of the COUNT semaphores in SEMS can be decremented,
+   decrement it and return its index.  If several can be decremented, the
+   one with the lowest index is.  On failure return -1 and set errno.
+   EINTR means that a signal handler installed without SA_RESTART
+   interrupted the wait.  ENOSYS means that COUNT is greater than one and
+   the kernel lacks futex_waitv, which was added in Linux 5.16, so the
+   caller has to fall back to another mechanism.
+
+   This function is a cancellation point and therefore not marked with
+   __THROW.  */
+extern int sem_wait_any (sem_t *const *__sems, unsigned int __count)
+  __nonnull ((1));
+
+/* Similar to `sem_wait_any' but wait only until ABSTIME measured by
+   CLOCK.
+
+   This function is a cancellation point and therefore not marked with
+   __THROW.  */
+# ifndef __USE_TIME_BITS64
+extern int sem_clockwait_any (sem_t *const *__sems, unsigned int __count,
+			      clockid_t __clock,
+			      const struct timespec *__abstime)
+  __nonnull ((1, 4));
+# else
+#  ifdef __REDIRECT
+extern int __REDIRECT (sem_clockwait_any,
+		       (sem_t *const *__sems, unsigned int __count,
+			clockid_t __clock,
+			const struct timespec *__abstime),
+		       __sem_clockwait_any64)
+  __nonnull ((1, 4));
+#  else
+#   define sem_clockwait_any __sem_clockwait_any64
+#  endif
+# endif
+#endif
+
 /* Test whether SEM is posted.  */
 extern int sem_trywait (sem_t *__sem) __THROWNL __nonnull ((1));
 
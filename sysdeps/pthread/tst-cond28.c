@@ -0,0 +1,149 @@
+/* Test that pthread_cond_broadcast wakes all waiters even if the mutex is
+   held while the condvar is signaled again or destroyed.
+   Copyright (C) 2023 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum { waiter_count = 8 };
+
+static pthread_mutex_t mut = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+/* Protected by MUT.  */
+static int waiting;
+static int woken;
+static unsigned int round;
+
+static void *
+waiter (void *closure)
+{
+  xpthread_mutex_lock (&mut);
+  unsigned int my_round = round;
+  ++waiting;
+  while (round == my_round)
+    xpthread_cond_wait (&cond, &mut);
+  --waiting;
+  ++woken;
+  xpthread_mutex_unlock (&mut);
+  return NULL;
+}
+
+/* Start COUNT waiters and return with MUT held once all of them have
+   released it in pthread_cond_wait.  */
+static void
+start_waiters (pthread_t *threads, int count)
+{
+  for (int i = 0; i < count; i++)
+    threads[i] = xpthread_create (NULL, waiter, NULL);
+  while (true)
+    {
+      xpthread_mutex_lock (&mut);
+      if (waiting == count)
+	break;
+      xpthread_mutex_unlock (&mut);
+      usleep (1000);
+    }
+  /* Give the waiters time to block on the futex.  */
+  xpthread_mutex_unlock (&mut);
+  usleep (10 * 1000);
+  xpthread_mutex_lock (&mut);
+}
+
+static void
+join_waiters (pthread_t *threads, int count)
+{
+  for (int i = 0; i < count; i++)
+    xpthread_join (threads[i]);
+  TEST_COMPARE (woken, count);
+  TEST_COMPARE (waiting, 0);
+  woken = 0;
+}
+
+/* Waiters woken by the broadcast reacquire the mutex one after the
+   other.  */
+static void
+check_broadcast (void)
+{
+  pthread_t threads[waiter_count];
+  for (int i = 0; i < 100; i++)
+    {
+      start_waiters (threads, waiter_count);
+      ++round;
+      TEST_COMPARE (pthread_cond_broadcast (&cond), 0);
+      xpthread_mutex_unlock (&mut);
+      join_waiters (threads, waiter_count);
+    }
+}
+
+/* A signal sent while holding the mutex after a broadcast has to switch
+   groups, which waits for the waiters woken by the broadcast.  */
+static void
+check_signal_after_broadcast (void)
+{
+  pthread_t threads[waiter_count + 1];
+  start_waiters (threads, waiter_count);
+  ++round;
+  TEST_COMPARE (pthread_cond_broadcast (&cond), 0);
+  xpthread_mutex_unlock (&mut);
+
+  /* Let one more waiter arrive in the new group while the first ones
+     still wait for the mutex.  */
+  threads[waiter_count] = xpthread_create (NULL, waiter, NULL);
+  while (true)
+    {
+      xpthread_mutex_lock (&mut);
+      if (waiting + woken == waiter_count + 1)
+	break;
+      xpthread_mutex_unlock (&mut);
+      usleep (1000);
+    }
+  ++round;
+  xpthread_cond_signal (&cond);
+  xpthread_cond_signal (&cond);
+  xpthread_mutex_unlock (&mut);
+  join_waiters (threads, waiter_count + 1);
+}
+
+/* The condvar can be destroyed while holding the mutex after a
+   broadcast.  */
+static void
+check_destroy_after_broadcast (void)
+{
+  pthread_t threads[waiter_count];
+  start_waiters (threads, waiter_count);
+  ++round;
+  TEST_COMPARE (pthread_cond_broadcast (&cond), 0);
+  TEST_COMPARE (pthread_cond_destroy (&cond), 0);
+  xpthread_mutex_unlock (&mut);
+  join_waiters (threads, waiter_count);
+}
+
+static int
+do_test (void)
+{
+  check_broadcast ();
+  check_signal_after_broadcast ();
+  check_destroy_after_broadcast ();
+  return 0;
+}
+
+#include <support/test-driver.c>
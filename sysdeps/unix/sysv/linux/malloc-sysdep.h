@@ -18,6 +18,10 @@
 
 #include <fcntl.h>
 #include <not-cancel.h>
+#include <sched.h>
+#include <string.h>
+#include <sysdep.h>
+#include <tls.h>
 
 /* The Linux kernel overcommits address space by default and if there is not
    enough memory available, it uses various parameters to decide the process to
@@ -56,4 +60,49 @@ check_may_shrink_heap (void)
   return may_shrink_heap;
 }
 
+/* Return the CPU the calling thread is currently running on, as
+   published by the kernel in the registered rseq area, or -1 if rseq
+   is not available.  The result is only a hint: the thread may migrate
+   at any point after the read.  */
+static inline int
+malloc_getcpu (void)
+{
+#ifdef RSEQ_SIG
+  return (int) THREAD_GETMEM_VOLATILE (THREAD_SELF, rseq_area.cpu_id);
+#else
+  return -1;
+#endif
+}
+
+/* Return the NUMA node of CPU, or -1 if it cannot be determined,
+   including if the calling thread no longer runs on CPU.  */
+static inline int
+malloc_getnode (int cpu)
+{
+  unsigned int c, node;
+  if (__getcpu (&c, &node) != 0 || c != (unsigned int) cpu)
+    return -1;
+  return node;
+}
+
+/* Ask the kernel to place the pages of the LENGTH bytes at ADDR on
+   NODE if possible.  Errors are ignored: the pages are then placed on
+   the node of the thread which first touches them.  */
+static inline void
+malloc_bind_node (void *addr, size_t length, int node)
+{
+#ifdef __NR_mbind
+  /* The highest node number supported by the kernel.  */
+  enum { max_nodes = 1024, mpol_preferred = 1 };
+  unsigned long int mask[max_nodes / (8 * sizeof (unsigned long int))];
+
+  if (node < 0 || node >= max_nodes)
+    return;
+  memset (mask, 0, sizeof (mask));
+  mask[node / (8 * sizeof (mask[0]))] = 1UL << (node % (8 * sizeof (mask[0])));
+  INTERNAL_SYSCALL_CALL (mbind, addr, length, mpol_preferred, mask,
+			 max_nodes + 1, 0);
+#endif
+}
+
 #define HAVE_MREMAP 1
@@ -101,6 +101,20 @@ ___timer_create (clockid_t clock_id, struct sigevent *evp, timer_t *timerid)
 	    nattr->guardsize = oattr->guardsize;
 	    nattr->stackaddr = oattr->stackaddr;
 	    nattr->stacksize = oattr->stacksize;
+
+	    /* The notifications run on the CPUs the user asked for.  */
+	    if (oattr->extension != NULL && oattr->extension->cpuset != NULL)
+	      {
+		int ret = __pthread_attr_setaffinity_np
+		  (&newp->attr, oattr->extension->cpusetsize,
+		   oattr->extension->cpuset);
+		if (ret != 0)
+		  {
+		    free (newp);
+		    __set_errno (ret);
+		    return -1;
+		  }
+	      }
 	  }
 
 	/* In any case set the detach flag.  */
@@ -119,6 +133,7 @@ ___timer_create (clockid_t clock_id, struct sigevent *evp, timer_t *timerid)
 				     &newp->ktimerid);
 	if (INTERNAL_SYSCALL_ERROR_P (res))
 	  {
+	    __pthread_attr_destroy (&newp->attr);
 	    free (newp);
 	    __set_errno (INTERNAL_SYSCALL_ERRNO (res));
 	    return -1;
@@ -53,6 +53,7 @@ ___timer_delete (timer_t timerid)
 	    }
 	  __pthread_mutex_unlock (&__timer_active_sigev_thread_lock);
 
+	  __pthread_attr_destroy (&kt->attr);
 	  free (kt);
 	}
 
@@ -19,10 +19,18 @@
 #include <setjmp.h>
 #include <signal.h>
 #include <stdbool.h>
+#include <string.h>
+#include <sys/prctl.h>
 #include <sysdep-cancel.h>
+#include <futex-internal.h>
 #include <pthreadP.h>
 #include "kernel-posix-timers.h"
 
+#if HAVE_TUNABLES
+# define TUNABLE_NAMESPACE pthread
+# include <elf/dl-tunables.h>
+#endif
+
 
 /* List of active SIGEV_THREAD timers.  */
 struct timer *__timer_active_sigev_thread;
@@ -34,6 +42,8 @@ struct thread_start_data
 {
   void (*thrfunc) (sigval_t);
   sigval_t sival;
+  /* A copy of the attributes of the timer, for timer_sigev_worker.  */
+  pthread_attr_t attr;
 };
 
 
@@ -57,6 +67,299 @@ timer_sigev_thread (void *arg)
 }
 
 
+/* Starting a thread for each expiry is expensive with many timers or
+   short periods.  Therefore, a thread which has called the notification
+   function stays around as a worker and waits for the next notification
+   of a timer with the same thread attributes, unless there are already
+   glibc.pthread.timer_pool_size idle workers.  The helper thread hands
+   notifications to idle workers and only starts a new thread if none is
+   idle, so notifications are never delayed by the functions of earlier
+   ones that still run.  Workers which stay idle for
+   TIMER_POOL_IDLE_TIMEOUT seconds exit.
+
+   Before a worker waits again, it restores the scheduling parameters,
+   CPU affinity and name it started with, in case the notification
+   function changed them.  A worker which cannot do so, or which has a
+   cancellation request pending, exits instead.  */
+
+#define TIMER_POOL_IDLE_TIMEOUT 10
+
+/* Size of a thread name including the terminating null byte, see
+   pthread_getname.c.  */
+#define TIMER_NAME_LEN 16
+
+struct timer_worker
+{
+  /* Next idle worker.  */
+  struct timer_worker *next;
+  /* The attributes the worker was created with.  */
+  pthread_attr_t attr;
+  /* The notification to run, valid once PENDING is set.  */
+  void (*thrfunc) (sigval_t);
+  sigval_t sival;
+  unsigned int pending;
+  /* The state of the worker before its first notification.  */
+  int policy;
+  struct sched_param param;
+  cpu_set_t cpuset;
+  int cpusetsize;
+  char name[TIMER_NAME_LEN];
+};
+
+/* Maximum number of idle workers.  */
+static size_t timer_pool_size;
+
+/* Idle workers, most recently used first, and their number.  Protected
+   by __timer_active_sigev_thread_lock.  */
+static struct timer_worker *timer_idle_workers;
+static size_t timer_idle_count;
+
+/* Return true if a worker created with attributes A can run the
+   notifications of timers with attributes B.  */
+static bool
+timer_attr_equal (const pthread_attr_t *a, const pthread_attr_t *b)
+{
+  const struct pthread_attr *ia = (const struct pthread_attr *) a;
+  const struct pthread_attr *ib = (const struct pthread_attr *) b;
+  if (ia->schedparam.sched_priority != ib->schedparam.sched_priority
+      || ia->schedpolicy != ib->schedpolicy
+      || ia->flags != ib->flags
+      || ia->guardsize != ib->guardsize
+      || ia->stacksize != ib->stacksize)
+    return false;
+
+  size_t asize = (ia->extension != NULL && ia->extension->cpuset != NULL
+		  ? ia->extension->cpusetsize : 0);
+  size_t bsize = (ib->extension != NULL && ib->extension->cpuset != NULL
+		  ? ib->extension->cpusetsize : 0);
+  return (asize == bsize
+	  && (asize == 0
+	      || memcmp (ia->extension->cpuset, ib->extension->cpuset,
+			 asize) == 0));
+}
+
+/* Take an idle worker created with attributes ATTR out of the pool, or
+   return NULL.  Must be called with __timer_active_sigev_thread_lock
+   held.  */
+static struct timer_worker *
+timer_pool_get (const pthread_attr_t *attr)
+{
+  for (struct timer_worker **wp = &timer_idle_workers; *wp != NULL;
+       wp = &(*wp)->next)
+    if (timer_attr_equal (&(*wp)->attr, attr))
+      {
+	struct timer_worker *w = *wp;
+	*wp = w->next;
+	--timer_idle_count;
+	return w;
+      }
+  return NULL;
+}
+
+/* Put W into the pool and wait for its next notification.  Return false
+   if W should exit instead.  */
+static bool
+timer_worker_wait (struct timer_worker *w)
+{
+  __pthread_mutex_lock (&__timer_active_sigev_thread_lock);
+  bool pooled = timer_idle_count < timer_pool_size;
+  if (pooled)
+    {
+      w->pending = 0;
+      w->next = timer_idle_workers;
+      timer_idle_workers = w;
+      ++timer_idle_count;
+    }
+  __pthread_mutex_unlock (&__timer_active_sigev_thread_lock);
+  if (!pooled)
+    return false;
+
+  struct __timespec64 deadline;
+  __clock_gettime64 (CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += TIMER_POOL_IDLE_TIMEOUT;
+  /* Acquire MO to synchronize with timer_helper_thread setting the
+     notification.  */
+  while (atomic_load_acquire (&w->pending) == 0)
+    if (__futex_abstimed_wait64 (&w->pending, 0, CLOCK_MONOTONIC, &deadline,
+				 FUTEX_PRIVATE) == ETIMEDOUT)
+      {
+	/* Leave the pool unless the helper thread has just taken us out
+	   of it.  */
+	__pthread_mutex_lock (&__timer_active_sigev_thread_lock);
+	bool idle = atomic_load_relaxed (&w->pending) == 0;
+	if (idle)
+	  {
+	    struct timer_worker **wp = &timer_idle_workers;
+	    while (*wp != w)
+	      wp = &(*wp)->next;
+	    *wp = w->next;
+	    --timer_idle_count;
+	  }
+	__pthread_mutex_unlock (&__timer_active_sigev_thread_lock);
+	if (idle)
+	  return false;
+      }
+  return true;
+}
+
+/* Record the scheduling parameters, CPU affinity and name of the
+   calling worker W.  Return false on failure.  */
+static bool
+timer_worker_save (struct timer_worker *w)
+{
+  int res = INTERNAL_SYSCALL_CALL (sched_getaffinity, 0, sizeof (w->cpuset),
+				   &w->cpuset);
+  if (INTERNAL_SYSCALL_ERROR_P (res))
+    return false;
+  w->cpusetsize = res;
+
+  return (__pthread_getschedparam ((pthread_t) THREAD_SELF, &w->policy,
+				   &w->param) == 0
+	  && __prctl (PR_GET_NAME, w->name) == 0);
+}
+
+/* Restore the state recorded by timer_worker_save if the notification
+   function has changed it.  Return false if W should exit instead of
+   running further notifications.  */
+static bool
+timer_worker_restore (struct timer_worker *w)
+{
+  struct pthread *self = THREAD_SELF;
+
+  /* A new thread would not see the request.  */
+  if (atomic_load_relaxed (&self->cancelhandling) & CANCELED_BITMASK)
+    return false;
+
+  /* The function may have used sched_setscheduler, which does not update
+     the thread descriptor, or pthread_setschedparam.  */
+  struct sched_param param;
+  bool changed = (__sched_getparam (0, &param) != 0
+		  || param.sched_priority != w->param.sched_priority
+		  || __sched_getscheduler (0) != w->policy
+		  || self->schedparam.sched_priority != w->param.sched_priority
+		  || self->schedpolicy != w->policy);
+  if (changed
+      && __pthread_setschedparam ((pthread_t) self, w->policy, &w->param) != 0)
+    return false;
+
+  cpu_set_t cpuset;
+  int res = INTERNAL_SYSCALL_CALL (sched_getaffinity, 0, sizeof (cpuset),
+				   &cpuset);
+  changed = (INTERNAL_SYSCALL_ERROR_P (res) || res != w->cpusetsize
+	     || memcmp (&cpuset, &w->cpuset, res) != 0);
+  if (changed
+      && INTERNAL_SYSCALL_ERROR_P (INTERNAL_SYSCALL_CALL (sched_setaffinity, 0,
+							  w->cpusetsize,
+							  &w->cpuset)))
+    return false;
+
+  char name[TIMER_NAME_LEN];
+  changed = (__prctl (PR_GET_NAME, name) != 0
+	     || strcmp (name, w->name) != 0);
+  if (changed && __prctl (PR_SET_NAME, w->name) != 0)
+    return false;
+
+  return true;
+}
+
+static void
+timer_worker_cleanup (void *arg)
+{
+  struct timer_worker *w = arg;
+  __pthread_attr_destroy (&w->attr);
+}
+
+/* Thread to call the user-provided functions of several expiries.  */
+static void *
+timer_sigev_worker (void *arg)
+{
+  signal_unblock_sigtimer ();
+
+  /* Each notification starts with the signal mask of a new thread.  */
+  sigset_t mask;
+  INTERNAL_SYSCALL_CALL (rt_sigprocmask, SIG_BLOCK, NULL, &mask,
+			 __NSIG_BYTES);
+
+  /* The TD object was allocated in timer_helper_thread.  */
+  struct thread_start_data *td = (struct thread_start_data *) arg;
+  struct timer_worker w;
+  w.attr = td->attr;
+  w.thrfunc = td->thrfunc;
+  w.sival = td->sival;
+  free (td);
+
+  bool reuse = timer_worker_save (&w);
+
+  /* The user-provided function may exit the thread.  */
+  pthread_cleanup_push (timer_worker_cleanup, &w);
+  do
+    {
+      w.thrfunc (w.sival);
+
+      /* Undo what the function may have changed and a new thread would
+	 not see.  */
+      __nptl_deallocate_tsd ();
+      __pthread_setcancelstate (PTHREAD_CANCEL_ENABLE, NULL);
+      __pthread_setcanceltype (PTHREAD_CANCEL_DEFERRED, NULL);
+      INTERNAL_SYSCALL_CALL (rt_sigprocmask, SIG_SETMASK, &mask, NULL,
+			     __NSIG_BYTES);
+      reuse = reuse && timer_worker_restore (&w);
+    }
+  while (reuse && timer_worker_wait (&w));
+  pthread_cleanup_pop (1);
+
+  return NULL;
+}
+
+/* Run the notification function of TK in a new thread or, if possible,
+   in a worker.  Must be called with __timer_active_sigev_thread_lock
+   held.  */
+static void
+timer_notify (struct timer *tk)
+{
+  /* Threads with a user-provided stack cannot be reused.  */
+  bool pool = (timer_pool_size > 0
+	       && (((struct pthread_attr *) &tk->attr)->flags
+		   & ATTR_FLAG_STACKADDR) == 0);
+
+  if (pool)
+    {
+      struct timer_worker *w = timer_pool_get (&tk->attr);
+      if (w != NULL)
+	{
+	  w->thrfunc = tk->thrfunc;
+	  w->sival = tk->sival;
+	  atomic_store_release (&w->pending, 1);
+	  futex_wake (&w->pending, 1, FUTEX_PRIVATE);
+	  return;
+	}
+    }
+
+  struct thread_start_data *td = malloc (sizeof (*td));
+
+  /* There is not much we can do if the allocation fails.  */
+  if (td == NULL)
+    return;
+
+  /* This is the signal we are waiting for.  */
+  td->thrfunc = tk->thrfunc;
+  td->sival = tk->sival;
+
+  if (pool && __pthread_attr_copy (&td->attr, &tk->attr) != 0)
+    pool = false;
+
+  pthread_t th;
+  if (__pthread_create (&th, &tk->attr,
+			pool ? timer_sigev_worker : timer_sigev_thread,
+			td) != 0)
+    {
+      if (pool)
+	__pthread_attr_destroy (&td->attr);
+      free (td);
+    }
+}
+
+
 /* Helper function to support starting threads for SIGEV_THREAD.  */
 static _Noreturn void *
 timer_helper_thread (void *arg)
@@ -84,20 +387,7 @@ timer_helper_thread (void *arg)
 	    runp = runp->next;
 
 	  if (runp != NULL)
-	    {
-	      struct thread_start_data *td = malloc (sizeof (*td));
-
-	      /* There is not much we can do if the allocation fails.  */
-	      if (td != NULL)
-		{
-		  /* This is the signal we are waiting for.  */
-		  td->thrfunc = tk->thrfunc;
-		  td->sival = tk->sival;
-
-		  pthread_t th;
-		  __pthread_create (&th, &tk->attr, timer_sigev_thread, td);
-		}
-	    }
+	    timer_notify (tk);
 
 	  __pthread_mutex_unlock (&__timer_active_sigev_thread_lock);
 	}
@@ -119,12 +409,19 @@ __timer_fork_subprocess (void)
 {
   __timer_helper_once = PTHREAD_ONCE_INIT;
   __timer_helper_tid = 0;
+  /* The workers have not been inherited.  */
+  timer_idle_workers = NULL;
+  timer_idle_count = 0;
 }
 
 
 void
 __timer_start_helper_thread (void)
 {
+#if HAVE_TUNABLES
+  timer_pool_size = TUNABLE_GET (timer_pool_size, size_t, NULL);
+#endif
+
   /* The helper thread needs only very little resources
      and should go away automatically when canceled.  */
   pthread_attr_t attr;